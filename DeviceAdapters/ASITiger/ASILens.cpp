@@ -511,6 +511,17 @@ int CLens::AddToStageSequence(double position)
    return DEVICE_OK;
 }
 
+int CLens::LoadStageSequence(const double* positions, unsigned long nrPositions)
+// replaces the whole sequence; the ring buffer is cleared only once, by SendStageSequence()
+{
+   if (!ttl_trigger_supported_)
+   {
+      return DEVICE_UNSUPPORTED_COMMAND;
+   }
+   sequence_.assign(positions, positions + nrPositions);
+   return SendStageSequence();
+}
+
 
 ////////////////
 // action handlers
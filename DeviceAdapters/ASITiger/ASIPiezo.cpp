@@ -616,6 +616,21 @@ int CPiezo::AddToStageSequence(double position)
    return DEVICE_OK;
 }
 
+int CPiezo::LoadStageSequence(const double* positions, unsigned long nrPositions)
+// replaces the whole sequence; the ring buffer is cleared only once, by SendStageSequence()
+{
+   if (runningFastSequence_)
+   {
+      return DEVICE_OK;
+   }
+   if (!ttl_trigger_supported_)
+   {
+      return DEVICE_UNSUPPORTED_COMMAND;
+   }
+   sequence_.assign(positions, positions + nrPositions);
+   return SendStageSequence();
+}
+
 
 ////////////////
 // action handlers
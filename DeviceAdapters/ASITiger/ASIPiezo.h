@@ -67,6 +67,7 @@ public:
    int ClearStageSequence();
    int AddToStageSequence(double position);
    int SendStageSequence();
+   int LoadStageSequence(const double* positions, unsigned long nrPositions);
 
    // action interface
    // ----------------
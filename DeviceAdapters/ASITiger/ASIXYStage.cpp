@@ -755,6 +755,18 @@ int CXYStage::AddToXYStageSequence(double positionX, double positionY)
    return DEVICE_OK;
 }
 
+int CXYStage::LoadXYStageSequence(const double* positionsX, const double* positionsY, unsigned long nrPositions)
+// replaces the whole sequence; the ring buffer is cleared only once, by SendXYStageSequence()
+{
+   if (!ttl_trigger_supported_)
+   {
+      return DEVICE_UNSUPPORTED_COMMAND;
+   }
+   sequenceX_.assign(positionsX, positionsX + nrPositions);
+   sequenceY_.assign(positionsY, positionsY + nrPositions);
+   return SendXYStageSequence();
+}
+
 
 int CXYStage::Move(double vx, double vy)
 {
@@ -68,6 +68,7 @@ public:
    int ClearXYStageSequence();
    int AddToXYStageSequence(double positionX, double positionY);
    int SendXYStageSequence();
+   int LoadXYStageSequence(const double* positionsX, const double* positionsY, unsigned long nrPositions);
 
    // leave default implementation which call corresponding "Steps" functions
    //    while accounting for mirroring and so forth
@@ -20,6 +20,7 @@
 
 #include "Monitors.h"
 #include "OffscreenBuffer.h"
+#include "PatternConverter.h"
 #include "SLMWindowThread.h"
 #include "SleepBlocker.h"
 
@@ -46,7 +47,8 @@ enum {
    ERR_CANNOT_DETACH,
    ERR_CANNOT_ATTACH,
    ERR_OFFSCREEN_BUFFER_UNAVAILABLE,
-   ERR_NO_DISPLAY_CONTEXT
+   ERR_NO_DISPLAY_CONTEXT,
+   ERR_UNKNOWN_PATTERN
 };
 
 
@@ -85,6 +87,7 @@ GenericSLM::GenericSLM(const char* name) :
    height_(0),
    windowThread_(0),
    sleepBlocker_(0),
+   patternConverter_(0),
    shouldBlitInverted_(false),
    invert_(false),
    inversionStr_("Off"),
@@ -100,6 +103,8 @@ GenericSLM::GenericSLM(const char* name) :
          "Failed to attach monitor to desktop");
    SetErrorText(ERR_OFFSCREEN_BUFFER_UNAVAILABLE,
          "Cannot set image (device uninitialized?)");
+   SetErrorText(ERR_UNKNOWN_PATTERN,
+         "No such pattern");
 
    availableMonitors_ = GetMonitorNames(true, false);
 
@@ -240,6 +245,8 @@ int GenericSLM::Initialize()
    width_ = w;
    height_ = h;
 
+   patternConverter_ = new PatternConverter(w, h, monoColor_, invert_);
+
    return DEVICE_OK;
 }
 
@@ -248,6 +255,12 @@ int GenericSLM::Shutdown()
 {
    width_ = height_ = 0;
 
+   if (patternConverter_)
+   {
+      delete patternConverter_;
+      patternConverter_ = 0;
+   }
+
    if (sleepBlocker_)
    {
       sleepBlocker_->Stop();
@@ -339,6 +352,44 @@ int GenericSLM::SetImage(unsigned int* pixels)
 }
 
 
+int GenericSLM::PrepareSLMPattern(long patternId, const unsigned char* pixels)
+{
+   if (!patternConverter_)
+      return ERR_OFFSCREEN_BUFFER_UNAVAILABLE;
+
+   patternConverter_->Add(patternId, pixels);
+   return DEVICE_OK;
+}
+
+
+int GenericSLM::ReleaseSLMPattern(long patternId)
+{
+   if (!patternConverter_)
+      return ERR_OFFSCREEN_BUFFER_UNAVAILABLE;
+
+   if (!patternConverter_->Remove(patternId))
+      return ERR_UNKNOWN_PATTERN;
+   return DEVICE_OK;
+}
+
+
+int GenericSLM::SetSLMPattern(long patternId)
+{
+   OffscreenBuffer* offscreen = windowThread_->GetOffscreenBuffer();
+   if (!offscreen || !patternConverter_)
+      return ERR_OFFSCREEN_BUFFER_UNAVAILABLE;
+
+   const unsigned int* pixels = patternConverter_->GetConverted(patternId);
+   if (!pixels)
+      return ERR_UNKNOWN_PATTERN;
+
+   // Color and inversion have already been applied
+   offscreen->DrawImage(pixels);
+   shouldBlitInverted_ = false;
+   return DEVICE_OK;
+}
+
+
 int GenericSLM::SetPixelsTo(unsigned char intensity)
 {
    OffscreenBuffer* offscreen = windowThread_->GetOffscreenBuffer();
@@ -426,6 +477,8 @@ int GenericSLM::OnInversion(MM::PropertyBase* pProp, MM::ActionType eAct)
       if (ret != DEVICE_OK)
          return ret;
       invert_ = (data != 0);
+      if (patternConverter_)
+         patternConverter_->SetColor(monoColor_, invert_);
    }
 
    return DEVICE_OK;
@@ -447,6 +500,8 @@ int GenericSLM::OnMonochromeColor(MM::PropertyBase* pProp, MM::ActionType eAct)
       if (ret != DEVICE_OK)
          return ret;
       monoColor_ = (SLMColor)data;
+      if (patternConverter_)
+         patternConverter_->SetColor(monoColor_, invert_);
    }
 
    return DEVICE_OK;
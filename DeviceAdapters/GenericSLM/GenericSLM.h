@@ -24,6 +24,7 @@
 #include "DeviceBase.h"
 #include "DeviceUtils.h"
 
+class PatternConverter;
 class SLMWindowThread;
 class SleepBlocker;
 
@@ -61,6 +62,10 @@ public:
    virtual int IsSLMSequenceable(bool& isSequenceable) const
    { isSequenceable = false; return DEVICE_OK; }
 
+   virtual int PrepareSLMPattern(long patternId, const unsigned char* pixels);
+   virtual int ReleaseSLMPattern(long patternId);
+   virtual int SetSLMPattern(long patternId);
+
 private: // Action handlers
    int OnInversion(MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnMonochromeColor(MM::PropertyBase* pProp, MM::ActionType eAct);
@@ -77,6 +82,7 @@ private: // Private data
 
    SLMWindowThread* windowThread_;
    SleepBlocker* sleepBlocker_;
+   PatternConverter* patternConverter_;
    RefreshWaiter refreshWaiter_;
 
    bool shouldBlitInverted_;
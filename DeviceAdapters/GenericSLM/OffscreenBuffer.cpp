@@ -77,7 +77,7 @@ void OffscreenBuffer::FillWithColor(COLORREF color)
 }
 
 
-void OffscreenBuffer::DrawImage(unsigned int* pixels)
+void OffscreenBuffer::DrawImage(const unsigned int* pixels)
 {
    DWORD srcWidthBytes = width_ * 4;
    DWORD destWidthBytes = GetWidthBytes();
@@ -91,7 +91,7 @@ void OffscreenBuffer::DrawImage(unsigned int* pixels)
       for (unsigned row = 0; row < height_; ++row)
       {
          memcpy((unsigned char*)pixels_ + row * destWidthBytes,
-               (unsigned char*)pixels + row * srcWidthBytes,
+               (const unsigned char*)pixels + row * srcWidthBytes,
                srcWidthBytes);
       }
    }
@@ -39,7 +39,7 @@ public:
    DWORD GetHeight() const { return height_; }
 
    void FillWithColor(COLORREF color);
-   void DrawImage(unsigned int* pixels); // RGBA
+   void DrawImage(const unsigned int* pixels); // RGBA
    void DrawImage(unsigned char* pixels, SLMColor color, bool invert); // Gray8
    DWORD BlitTo(HDC onscreenDC, DWORD op);
 
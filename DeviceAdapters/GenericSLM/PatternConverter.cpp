@@ -0,0 +1,177 @@
+// DESCRIPTION:   GenericSLM device adapter
+// COPYRIGHT:     2009-2016 Regents of the University of California
+//                2016 Open Imaging, Inc.
+//
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "PatternConverter.h"
+
+#include <cstring>
+
+
+PatternConverter::PatternConverter(unsigned width, unsigned height,
+      SLMColor color, bool invert) :
+   width_(width),
+   height_(height),
+   wakeEvent_(0),
+   stopping_(false),
+   generation_(0)
+{
+   SetColor(color, invert);
+   wakeEvent_ = ::CreateEventA(0, FALSE, FALSE, 0);
+   activate();
+}
+
+
+PatternConverter::~PatternConverter()
+{
+   {
+      MMThreadGuard g(lock_);
+      stopping_ = true;
+   }
+   ::SetEvent(wakeEvent_);
+   wait();
+   ::CloseHandle(wakeEvent_);
+}
+
+
+void PatternConverter::Add(long id, const unsigned char* pixels)
+{
+   {
+      MMThreadGuard g(lock_);
+      Pattern& pattern = patterns_[id];
+      pattern.source = pixels;
+      pattern.converted.clear();
+      pattern.generation = 0;
+      pending_.push_back(id);
+   }
+   ::SetEvent(wakeEvent_);
+}
+
+
+bool PatternConverter::Remove(long id)
+{
+   MMThreadGuard c(conversionLock_);
+   MMThreadGuard g(lock_);
+   return patterns_.erase(id) > 0;
+}
+
+
+void PatternConverter::SetColor(SLMColor color, bool invert)
+{
+   unsigned char xorMask = invert ? 0xff : 0x00;
+   unsigned int blueMask = (color & SLM_COLOR_BLUE) ? 0xff : 0x00;
+   unsigned int greenMask = (color & SLM_COLOR_GREEN) ? 0xff : 0x00;
+   unsigned int redMask = (color & SLM_COLOR_RED) ? 0xff : 0x00;
+
+   {
+      MMThreadGuard g(lock_);
+      for (unsigned i = 0; i < 256; ++i)
+      {
+         unsigned int pixel = static_cast<unsigned char>(i ^ xorMask);
+         lut_[i] = (pixel & blueMask) |
+            ((pixel & greenMask) << 8) |
+            ((pixel & redMask) << 16);
+      }
+      ++generation_;
+
+      pending_.clear();
+      for (std::map<long, Pattern>::const_iterator it = patterns_.begin(),
+            end = patterns_.end(); it != end; ++it)
+         pending_.push_back(it->first);
+   }
+   if (wakeEvent_)
+      ::SetEvent(wakeEvent_);
+}
+
+
+const unsigned int* PatternConverter::GetConverted(long id)
+{
+   MMThreadGuard g(lock_);
+   std::map<long, Pattern>::iterator it = patterns_.find(id);
+   if (it == patterns_.end())
+      return 0;
+
+   Pattern& pattern = it->second;
+   if (pattern.generation != generation_)
+   {
+      Convert(pattern.source, lut_, pattern.converted);
+      pattern.generation = generation_;
+   }
+   return &pattern.converted[0];
+}
+
+
+int PatternConverter::svc()
+{
+   for (;;)
+   {
+      ::WaitForSingleObject(wakeEvent_, INFINITE);
+
+      // Convert pending patterns until there are none left
+      for (;;)
+      {
+         MMThreadGuard c(conversionLock_);
+
+         long id = 0;
+         const unsigned char* source = 0;
+         unsigned generation = 0;
+         unsigned int lut[256];
+         {
+            MMThreadGuard g(lock_);
+            if (stopping_)
+               return 0;
+            while (!pending_.empty() && !source)
+            {
+               id = pending_.front();
+               pending_.pop_front();
+               std::map<long, Pattern>::const_iterator it = patterns_.find(id);
+               if (it != patterns_.end() &&
+                     it->second.generation != generation_)
+               {
+                  source = it->second.source;
+                  generation = generation_;
+                  memcpy(lut, lut_, sizeof(lut));
+               }
+            }
+         }
+         if (!source)
+            break;
+
+         std::vector<unsigned int> converted;
+         Convert(source, lut, converted);
+
+         {
+            MMThreadGuard g(lock_);
+            std::map<long, Pattern>::iterator it = patterns_.find(id);
+            // Discard if the colors changed or GetConverted() got there first
+            if (it != patterns_.end() && generation == generation_ &&
+                  it->second.generation != generation_)
+            {
+               it->second.converted.swap(converted);
+               it->second.generation = generation;
+            }
+         }
+      }
+   }
+}
+
+
+void PatternConverter::Convert(const unsigned char* source,
+      const unsigned int* lut, std::vector<unsigned int>& converted) const
+{
+   const size_t nrPixels = static_cast<size_t>(width_) * height_;
+   converted.resize(nrPixels);
+   unsigned int* pDest = &converted[0];
+   for (size_t i = 0; i < nrPixels; ++i)
+      pDest[i] = lut[source[i]];
+}
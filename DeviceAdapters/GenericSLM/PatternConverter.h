@@ -0,0 +1,78 @@
+// DESCRIPTION:   GenericSLM device adapter
+// COPYRIGHT:     2009-2016 Regents of the University of California
+//                2016 Open Imaging, Inc.
+//
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "SLMColor.h"
+
+#include "DeviceThreads.h"
+
+#include <Windows.h>
+
+#include <deque>
+#include <map>
+#include <vector>
+
+
+// Converts the Gray8 patterns registered by the Core into 32-bit pixels in
+// the layout of the offscreen buffer (with the monochrome color and inversion
+// applied), on a background thread, so that setting a pattern is a plain
+// copy. The Core's pattern pixels are read until the pattern is removed.
+class PatternConverter : private MMDeviceThreadBase
+{
+   struct Pattern
+   {
+      const unsigned char* source;
+      std::vector<unsigned int> converted;
+      unsigned generation; // Of the lookup table used for converted; 0 if none
+   };
+
+   const unsigned width_, height_;
+
+   // Held while converting on the background thread, so that Remove() can
+   // wait until the source pixels are no longer in use
+   MMThreadLock conversionLock_;
+   MMThreadLock lock_;
+   HANDLE wakeEvent_;
+   bool stopping_;
+   unsigned int lut_[256]; // Gray8 to BGRX
+   unsigned generation_;
+   std::map<long, Pattern> patterns_;
+   std::deque<long> pending_;
+
+public:
+   PatternConverter(unsigned width, unsigned height,
+         SLMColor color, bool invert);
+   virtual ~PatternConverter();
+
+   void Add(long id, const unsigned char* pixels);
+   bool Remove(long id);
+
+   // Patterns are reconverted as needed after a change
+   void SetColor(SLMColor color, bool invert);
+
+   // Returns null if there is no such pattern. Converts on the calling
+   // thread if the background thread has not yet done so. The result is
+   // valid until the next call to any other member function.
+   const unsigned int* GetConverted(long id);
+
+private:
+   virtual int svc();
+   void Convert(const unsigned char* source, const unsigned int* lut,
+         std::vector<unsigned int>& converted) const;
+
+private:
+   PatternConverter& operator=(const PatternConverter&);
+};
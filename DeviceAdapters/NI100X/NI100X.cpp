@@ -1255,14 +1255,14 @@ int AnalogIO::OnVolts(MM::PropertyBase* pProp, MM::ActionType eAct)
       // Transfer the sequence into our internal storage.
       ClearDASequence();
       SetupTask();
-      std::vector<std::string> sequence = pProp->GetSequence();
+      std::vector<double> sequence = pProp->GetNumericSequence();
       if (sequence.size() > (unsigned long) maxSequenceLength_)
       {
          return DEVICE_SEQUENCE_TOO_LARGE;
       }
       for (unsigned long i = 0; i < sequence.size(); ++i)
       {
-         AddToDASequence(boost::lexical_cast<float64>(sequence[i]));
+         AddToDASequence(sequence[i]);
       }
    }
    else if (eAct == MM::StartSequence)
@@ -24,6 +24,9 @@
 #include "InterDevice.h"
 #include "SequenceTester.h"
 
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread.hpp>
+
 
 SettingLogger*
 InterDevice::GetLogger()
@@ -49,3 +52,14 @@ InterDevice::RegisterEdgeTriggerSource(const std::string& port,
 {
    edgeTriggersSources_[port] = &signal;
 }
+
+
+void
+InterDevice::SimulateCommandLatency() const
+{
+   if (commandLatencyMs_ > 0.0)
+   {
+      boost::this_thread::sleep(boost::posix_time::microseconds(
+               static_cast<long>(1000.0 * commandLatencyMs_)));
+   }
+}
@@ -43,7 +43,8 @@ class InterDevice : public boost::enable_shared_from_this<InterDevice>
 public:
    typedef boost::shared_ptr<InterDevice> Ptr;
 
-   InterDevice(const std::string& name) : name_(name) {}
+   InterDevice(const std::string& name) :
+      name_(name), commandLatencyMs_(0.0) {}
    virtual ~InterDevice() {}
    virtual void SetHub(boost::shared_ptr<TesterHub> hub) { hub_ = hub; }
 
@@ -55,12 +56,21 @@ public:
 
    virtual EdgeTriggerSignal* GetEdgeTriggerSource(const std::string& port);
 
+   // Simulated time taken by the (virtual) hardware to carry out each setting
+   // change requested by the Core. Zero (the default) means no delay.
+   void SetCommandLatencyMs(double ms) { commandLatencyMs_ = ms; }
+   // Sleeps for the command latency. Must be called _without_ the hub global
+   // mutex held (after the setting has been changed), so that other devices
+   // and the camera's sequence thread are not blocked meanwhile.
+   void SimulateCommandLatency() const;
+
 protected:
    void RegisterEdgeTriggerSource(const std::string& port,
          EdgeTriggerSignal& signal);
 
 private:
    const std::string name_;
+   double commandLatencyMs_;
    boost::shared_ptr<TesterHub> hub_;
    boost::unordered_map<std::string, EdgeTriggerSignal*> edgeTriggersSources_;
 };
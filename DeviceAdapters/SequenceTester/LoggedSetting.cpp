@@ -239,18 +239,24 @@ BoolSetting::NewPropertyAction(PropertyDisplay displayMode)
             setting_.MarkBusy();
             std::string strVal;
             long intVal;
+            int err = DEVICE_OK;
             switch (displayMode_)
             {
                case ON_OFF:
                   pProp->Get(strVal);
-                  return setting_.Set(strVal == "On");
+                  err = setting_.Set(strVal == "On");
+                  break;
                case YES_NO:
                   pProp->Get(strVal);
-                  return setting_.Set(strVal == "Yes");
+                  err = setting_.Set(strVal == "Yes");
+                  break;
                case ONE_ZERO:
                   pProp->Get(intVal);
-                  return setting_.Set(intVal != 0);
+                  err = setting_.Set(intVal != 0);
+                  break;
             }
+            setting_.GetDevice()->SimulateCommandLatency();
+            return err;
          }
          else if (eAct == MM::IsSequenceable)
          {
@@ -421,7 +427,9 @@ IntegerSetting::NewPropertyAction()
             setting_.MarkBusy();
             long v;
             pProp->Get(v);
-            return setting_.Set(v);
+            int err = setting_.Set(v);
+            setting_.GetDevice()->SimulateCommandLatency();
+            return err;
          }
          else if (eAct == MM::IsSequenceable)
          {
@@ -587,7 +595,9 @@ FloatSetting::NewPropertyAction()
             setting_.MarkBusy();
             double v;
             pProp->Get(v);
-            return setting_.Set(v);
+            int err = setting_.Set(v);
+            setting_.GetDevice()->SimulateCommandLatency();
+            return err;
          }
          else if (eAct == MM::IsSequenceable)
          {
@@ -685,7 +695,9 @@ StringSetting::NewPropertyAction()
             setting_.MarkBusy();
             std::string v;
             pProp->Get(v);
-            return setting_.Set(v);
+            int err = setting_.Set(v);
+            setting_.GetDevice()->SimulateCommandLatency();
+            return err;
          }
          return DEVICE_OK;
       }
@@ -27,6 +27,7 @@
 #include "ModuleInterface.h"
 
 #include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <boost/move/move.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
@@ -244,6 +245,7 @@ TesterCamera::TesterCamera(const std::string& name) :
    produceHumanReadableImages_(true),
    imageWidth_(384),
    imageHeight_(384),
+   simulateExposure_(false),
    nextSerialNr_(0),
    nextSnapImageNr_(0),
    nextSequenceImageNr_(0),
@@ -261,6 +263,12 @@ TesterCamera::TesterCamera(const std::string& name) :
    CCameraBase<Self>::CreateIntegerProperty("ImageHeight", imageHeight_,
          false, 0, true);
    SetPropertyLimits("ImageHeight", 32, 4096);
+   // When enabled, images are delivered only after the exposure time has
+   // elapsed (otherwise images are generated as fast as possible)
+   CCameraBase<Self>::CreateStringProperty("SimulateExposure", "No",
+         false, 0, true);
+   AddAllowedValue("SimulateExposure", "No");
+   AddAllowedValue("SimulateExposure", "Yes");
 }
 
 
@@ -286,6 +294,9 @@ TesterCamera::Initialize()
    produceHumanReadableImages_ = (imageMode == std::string("HumanReadable"));
    GetProperty("ImageWidth", imageWidth_);
    GetProperty("ImageHeight", imageHeight_);
+   char simulateExposure[MM::MaxStrLength];
+   GetProperty("SimulateExposure", simulateExposure);
+   simulateExposure_ = (simulateExposure == std::string("Yes"));
 
    TesterHub::Guard g(GetHub()->LockGlobalMutex());
 
@@ -309,11 +320,14 @@ TesterCamera::Initialize()
 int
 TesterCamera::SnapImage()
 {
-   TesterHub::Guard g(GetHub()->LockGlobalMutex());
+   {
+      TesterHub::Guard g(GetHub()->LockGlobalMutex());
 
-   delete[] snapImage_;
-   snapImage_ = GenerateLogImage(false, nextSnapImageNr_++);
+      delete[] snapImage_;
+      snapImage_ = GenerateLogImage(false, nextSnapImageNr_++);
+   }
 
+   SimulateExposure();
    return DEVICE_OK;
 }
 
@@ -339,10 +353,15 @@ TesterCamera::GetBinning() const
 int
 TesterCamera::SetBinning(int binSize)
 {
-   TesterHub::Guard g(GetHub()->LockGlobalMutex());
+   int err;
+   {
+      TesterHub::Guard g(GetHub()->LockGlobalMutex());
 
-   binningSetting_->MarkBusy();
-   return binningSetting_->Set(binSize);
+      binningSetting_->MarkBusy();
+      err = binningSetting_->Set(binSize);
+   }
+   SimulateCommandLatency();
+   return err;
 }
 
 
@@ -370,10 +389,13 @@ TesterCamera::GetImageHeight() const
 void
 TesterCamera::SetExposure(double exposureMs)
 {
-   TesterHub::Guard g(GetHub()->LockGlobalMutex());
+   {
+      TesterHub::Guard g(GetHub()->LockGlobalMutex());
 
-   exposureSetting_->MarkBusy();
-   exposureSetting_->Set(exposureMs);
+      exposureSetting_->MarkBusy();
+      exposureSetting_->Set(exposureMs);
+   }
+   SimulateCommandLatency();
 }
 
 
@@ -523,6 +545,24 @@ TesterCamera::GenerateLogImage(bool isSequenceImage, size_t cumulativeNr,
 }
 
 
+void
+TesterCamera::SimulateExposure()
+{
+   if (!simulateExposure_)
+      return;
+
+   double exposureMs;
+   {
+      TesterHub::Guard g(GetHub()->LockGlobalMutex());
+      exposureMs = exposureSetting_->Get();
+   }
+   // The image records the state at the start of the exposure; we just
+   // hold it back until the exposure would have ended.
+   boost::this_thread::sleep(boost::posix_time::microseconds(
+            static_cast<long>(1000.0 * exposureMs)));
+}
+
+
 void
 TesterCamera::SendSequence(bool finite, long count, bool stopOnOverflow)
 {
@@ -556,6 +596,8 @@ TesterCamera::SendSequence(bool finite, long count, bool stopOnOverflow)
          bytes = GenerateLogImage(true, nextSequenceImageNr_++, frame);
       }
 
+      SimulateExposure();
+
       try
       {
          int err;
@@ -619,10 +661,15 @@ TesterShutter::Initialize()
 int
 TesterShutter::SetOpen(bool open)
 {
-   TesterHub::Guard g(GetHub()->LockGlobalMutex());
+   int err;
+   {
+      TesterHub::Guard g(GetHub()->LockGlobalMutex());
 
-   shutterOpen_->MarkBusy();
-   return shutterOpen_->Set(open);
+      shutterOpen_->MarkBusy();
+      err = shutterOpen_->Set(open);
+   }
+   SimulateCommandLatency();
+   return err;
 }
 
 
@@ -672,12 +719,16 @@ TesterXYStage::Initialize()
 int
 TesterXYStage::SetPositionSteps(long x, long y)
 {
-   TesterHub::Guard g(GetHub()->LockGlobalMutex());
+   int err1, err2;
+   {
+      TesterHub::Guard g(GetHub()->LockGlobalMutex());
 
-   xPositionSteps_->MarkBusy();
-   yPositionSteps_->MarkBusy();
-   int err1 = xPositionSteps_->Set(x);
-   int err2 = yPositionSteps_->Set(y);
+      xPositionSteps_->MarkBusy();
+      yPositionSteps_->MarkBusy();
+      err1 = xPositionSteps_->Set(x);
+      err2 = yPositionSteps_->Set(y);
+   }
+   SimulateCommandLatency();
    if (err1 != DEVICE_OK)
       return err1;
    if (err2 != DEVICE_OK)
@@ -704,50 +755,75 @@ TesterXYStage::GetPositionSteps(long& x, long& y)
 int
 TesterXYStage::Home()
 {
-   TesterHub::Guard g(GetHub()->LockGlobalMutex());
+   int err;
+   {
+      TesterHub::Guard g(GetHub()->LockGlobalMutex());
 
-   home_->MarkBusy();
-   return home_->Set();
+      home_->MarkBusy();
+      err = home_->Set();
+   }
+   SimulateCommandLatency();
+   return err;
 }
 
 
 int
 TesterXYStage::Stop()
 {
-   TesterHub::Guard g(GetHub()->LockGlobalMutex());
+   int err;
+   {
+      TesterHub::Guard g(GetHub()->LockGlobalMutex());
 
-   stop_->MarkBusy();
-   return stop_->Set();
+      stop_->MarkBusy();
+      err = stop_->Set();
+   }
+   SimulateCommandLatency();
+   return err;
 }
 
 
 int
 TesterXYStage::SetOrigin()
 {
-   TesterHub::Guard g(GetHub()->LockGlobalMutex());
+   int err;
+   {
+      TesterHub::Guard g(GetHub()->LockGlobalMutex());
 
-   setOrigin_->MarkBusy();
-   return setOrigin_->Set();
+      setOrigin_->MarkBusy();
+      err = setOrigin_->Set();
+   }
+   SimulateCommandLatency();
+   return err;
 }
 
 
 int
 TesterXYStage::SetXOrigin()
 {
-   TesterHub::Guard g(GetHub()->LockGlobalMutex());
+   int err;
+   {
+      TesterHub::Guard g(GetHub()->LockGlobalMutex());
 
-   setXOrigin_->MarkBusy();
-   return setXOrigin_->Set();
+      setXOrigin_->MarkBusy();
+      err = setXOrigin_->Set();
+   }
+   SimulateCommandLatency();
+   return err;
 }
 
 
 int
 TesterXYStage::SetYOrigin()
 {
-   TesterHub::Guard g(GetHub()->LockGlobalMutex());
+   int err;
+   {
+      TesterHub::Guard g(GetHub()->LockGlobalMutex());
 
-   setYOrigin_->MarkBusy();
-   return setYOrigin_->Set();
+      setYOrigin_->MarkBusy();
+      err = setYOrigin_->Set();
+   }
+   SimulateCommandLatency();
+   return err;
 }
 
 
@@ -911,10 +987,15 @@ TesterAutofocus::Initialize()
 int
 TesterAutofocus::SetContinuousFocusing(bool state)
 {
-   TesterHub::Guard g(GetHub()->LockGlobalMutex());
+   int err;
+   {
+      TesterHub::Guard g(GetHub()->LockGlobalMutex());
 
-   continuousFocusEnabled_->MarkBusy();
-   return continuousFocusEnabled_->Set(state);
+      continuousFocusEnabled_->MarkBusy();
+      err = continuousFocusEnabled_->Set(state);
+   }
+   SimulateCommandLatency();
+   return err;
 }
 
 
@@ -994,10 +1075,15 @@ TesterAutofocus::GetOffset(double& offset)
 int
 TesterAutofocus::SetOffset(double offset)
 {
-   TesterHub::Guard g(GetHub()->LockGlobalMutex());
+   int err;
+   {
+      TesterHub::Guard g(GetHub()->LockGlobalMutex());
 
-   offset_->MarkBusy();
-   return offset_->Set(offset);
+      offset_->MarkBusy();
+      err = offset_->Set(offset);
+   }
+   SimulateCommandLatency();
+   return err;
 }
 
 
@@ -1077,7 +1163,9 @@ int
 TesterSwitcher::SetGateOpen(bool open)
 {
    gateOpen_->MarkBusy();
-   return gateOpen_->Set(open);
+   int err = gateOpen_->Set(open);
+   SimulateCommandLatency();
+   return err;
 }
 
 
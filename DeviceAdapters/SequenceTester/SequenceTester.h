@@ -49,7 +49,7 @@ public:
    typedef TesterBase Self;
    typedef TDeviceBase<UConcreteDevice> Super;
 
-   TesterBase(const std::string& name) : InterDevice(name) {}
+   TesterBase(const std::string& name);
    virtual ~TesterBase() {}
 
    virtual void GetName(char* name) const;
@@ -173,6 +173,9 @@ private:
    int StartSequenceAcquisitionImpl(bool finite, long count,
          bool stopOnOverflow);
 
+   // Must be called _without_ the hub global mutex held.
+   void SimulateExposure();
+
    void SendSequence(bool finite, long count, bool stopOnOverflow);
 
 private:
@@ -180,6 +183,8 @@ private:
    long imageWidth_;
    long imageHeight_;
 
+   bool simulateExposure_;
+
    size_t nextSerialNr_;
    size_t nextSnapImageNr_;
    size_t nextSequenceImageNr_;
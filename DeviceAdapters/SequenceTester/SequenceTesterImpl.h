@@ -32,6 +32,18 @@
 #include <string>
 
 
+template <template <class> class TDeviceBase, class UConcreteDevice>
+TesterBase<TDeviceBase, UConcreteDevice>::TesterBase(const std::string& name) :
+   InterDevice(name)
+{
+   // Simulated delay for each setting change (e.g. stage move, exposure
+   // change), for benchmarking. Not a logged setting, so that it does not
+   // appear in the images.
+   Super::CreateFloatProperty("CommandLatencyMs", 0.0, false, 0, true);
+   Super::SetPropertyLimits("CommandLatencyMs", 0.0, 10000.0);
+}
+
+
 template <template <class> class TDeviceBase, class UConcreteDevice>
 void
 TesterBase<TDeviceBase, UConcreteDevice>::GetName(char* name) const
@@ -71,6 +83,12 @@ TesterBase<TDeviceBase, UConcreteDevice>::CommonHubPeripheralInitialize()
    if (err != DEVICE_OK)
       return err;
 
+   double latencyMs;
+   err = Super::GetProperty("CommandLatencyMs", latencyMs);
+   if (err != DEVICE_OK)
+      return err;
+   SetCommandLatencyMs(latencyMs);
+
    // Devices are initially "busy"
    busySetting_ = CountDownSetting::New(GetLogger(), this, "Busy", 1);
    return DEVICE_OK;
@@ -221,9 +239,14 @@ template <class TConcreteStage, long UStepsPerMicrometer>
 int
 Tester1DStageBase<TConcreteStage, UStepsPerMicrometer>::SetPositionUm(double pos)
 {
-   TesterHub::Guard g(Super::GetHub()->LockGlobalMutex());
-   zPositionUm_->MarkBusy();
-   return zPositionUm_->Set(pos);
+   int err;
+   {
+      TesterHub::Guard g(Super::GetHub()->LockGlobalMutex());
+      zPositionUm_->MarkBusy();
+      err = zPositionUm_->Set(pos);
+   }
+   Super::SimulateCommandLatency();
+   return err;
 }
 
 
@@ -240,9 +263,14 @@ template <class TConcreteStage, long UStepsPerMicrometer>
 int
 Tester1DStageBase<TConcreteStage, UStepsPerMicrometer>::SetPositionSteps(long steps)
 {
-   TesterHub::Guard g(Super::GetHub()->LockGlobalMutex());
-   zPositionUm_->MarkBusy();
-   return zPositionUm_->Set(0.1 * steps);
+   int err;
+   {
+      TesterHub::Guard g(Super::GetHub()->LockGlobalMutex());
+      zPositionUm_->MarkBusy();
+      err = zPositionUm_->Set(0.1 * steps);
+   }
+   Super::SimulateCommandLatency();
+   return err;
 }
 
 
@@ -264,9 +292,14 @@ template <class TConcreteStage, long UStepsPerMicrometer>
 int
 Tester1DStageBase<TConcreteStage, UStepsPerMicrometer>::Home()
 {
-   TesterHub::Guard g(Super::GetHub()->LockGlobalMutex());
-   home_->MarkBusy();
-   return home_->Set();
+   int err;
+   {
+      TesterHub::Guard g(Super::GetHub()->LockGlobalMutex());
+      home_->MarkBusy();
+      err = home_->Set();
+   }
+   Super::SimulateCommandLatency();
+   return err;
 }
 
 
@@ -274,9 +307,14 @@ template <class TConcreteStage, long UStepsPerMicrometer>
 int
 Tester1DStageBase<TConcreteStage, UStepsPerMicrometer>::Stop()
 {
-   TesterHub::Guard g(Super::GetHub()->LockGlobalMutex());
-   stop_->MarkBusy();
-   return stop_->Set();
+   int err;
+   {
+      TesterHub::Guard g(Super::GetHub()->LockGlobalMutex());
+      stop_->MarkBusy();
+      err = stop_->Set();
+   }
+   Super::SimulateCommandLatency();
+   return err;
 }
 
 
@@ -284,9 +322,14 @@ template <class TConcreteStage, long UStepsPerMicrometer>
 int
 Tester1DStageBase<TConcreteStage, UStepsPerMicrometer>::SetOrigin()
 {
-   TesterHub::Guard g(Super::GetHub()->LockGlobalMutex());
-   originSet_->MarkBusy();
-   return originSet_->Set();
+   int err;
+   {
+      TesterHub::Guard g(Super::GetHub()->LockGlobalMutex());
+      originSet_->MarkBusy();
+      err = originSet_->Set();
+   }
+   Super::SimulateCommandLatency();
+   return err;
 }
 
 
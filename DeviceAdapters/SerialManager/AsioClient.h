@@ -30,6 +30,8 @@
 #include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include <algorithm>
+#include <cstring>
 #include <deque>
 #include <exception>
 #include <string>
@@ -304,7 +306,7 @@ public:
    {
       // clear read buffer;
       {
-         MMThreadGuard g(readBufferLock_);
+         boost::mutex::scoped_lock g(readBufferMutex_);
          data_read_.clear();
       }
 
@@ -316,18 +318,50 @@ public:
    }
 
 
-   // read one character, ret. is false if no characters are available.
-   bool ReadOneCharacter(char& msg)
+   // Copy up to maxLen available characters into buf without waiting.
+   // Returns the number of characters copied.
+   size_t ReadAvailableCharacters(char* buf, size_t maxLen)
    {
-      bool retval = false;
-      MMThreadGuard g(readBufferLock_);
-      if (0 < data_read_.size())
+      boost::mutex::scoped_lock g(readBufferMutex_);
+      size_t n = (std::min)(maxLen, data_read_.size());
+      std::copy(data_read_.begin(), data_read_.begin() + n, buf);
+      data_read_.erase(data_read_.begin(), data_read_.begin() + n);
+      return n;
+   }
+
+   enum ReadResult
+   {
+      ReadTerminated, // terminator received
+      ReadBufferFull, // characters available but no space left in buffer
+      ReadTimedOut
+   };
+
+   // Append received characters to buf (starting at buf[offset]) until term
+   // has been received or the deadline passes, waiting for the read handler
+   // to signal new data. Characters following the terminator are left in the
+   // receive buffer. An empty term never matches (read until the deadline).
+   ReadResult ReadUntilTerminator(char* buf, size_t bufLen, size_t& offset,
+         const std::string& term, const boost::system_time& deadline)
+   {
+      boost::mutex::scoped_lock g(readBufferMutex_);
+      for (;;)
       {
-         retval = true;
-         msg = data_read_.front();
-         data_read_.pop_front();
+         while (!data_read_.empty())
+         {
+            if (offset >= bufLen)
+               return ReadBufferFull;
+            buf[offset++] = data_read_.front();
+            data_read_.pop_front();
+
+            // Only the end of the answer (where the new character may have
+            // completed the terminator) needs to be checked
+            if (!term.empty() && offset >= term.size() &&
+                  0 == memcmp(buf + offset - term.size(), term.data(), term.size()))
+               return ReadTerminated;
+         }
+         if (!dataAvailable_.timed_wait(g, deadline) && data_read_.empty())
+            return ReadTimedOut;
       }
-      return retval;
    }
 
    void ShutDownInProgress(const bool v){ shutDownInProgress_ = v;};
@@ -363,13 +397,10 @@ private:
       if (!error)
       { // read completed, so process the data
          {
-            MMThreadGuard g(readBufferLock_);
-            for(unsigned int ib = 0; ib < bytes_transferred; ++ib)
-            {
-               data_read_.push_back(read_msg_[ib]);
-            }
+            boost::mutex::scoped_lock g(readBufferMutex_);
+            data_read_.insert(data_read_.end(), read_msg_, read_msg_ + bytes_transferred);
          }
-         CDeviceUtils::SleepMs(1);
+         dataAvailable_.notify_all();
          ReadStart(); // start waiting for another asynchronous read again
       }
       else
@@ -466,7 +497,8 @@ private:
    SerialPort* pSerialPortAdapter_;
    std::string device_;
 
-   MMThreadLock readBufferLock_;
+   boost::mutex readBufferMutex_; // guards data_read_
+   boost::condition_variable dataAvailable_; // signaled when data_read_ grows
    MMThreadLock writeBufferLock_;
    MMThreadLock implementationLock_;
    bool shutDownInProgress_;
@@ -0,0 +1,320 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          ReplayPort.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Serial port stand-in that replays a recorded traffic trace
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "SerialManager.h" // For error codes
+#include "ReplayPort.h"
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+const char* g_ReplayPortName = "ReplayPort";
+
+namespace
+{
+   const char* const g_Timing_Original = "Original";
+   const char* const g_Timing_Immediate = "Immediate";
+
+   void SleepUs(long long us)
+   {
+      if (us > 0)
+         boost::this_thread::sleep(boost::posix_time::microseconds(us));
+   }
+} // anonymous namespace
+
+
+ReplayPort::ReplayPort() :
+   initialized_(false),
+   originalTiming_(true),
+   answerTimeoutMs_(500.0),
+   nextRecord_(0),
+   anchorUs_(0),
+   anchorTraceUs_(0)
+{
+   InitializeDefaultErrorMessages();
+   SetErrorText(ERR_OPEN_FAILED, "Cannot read the trace file");
+   SetErrorText(ERR_TERM_TIMEOUT, "No answer (with the expected terminator) left in the trace");
+   SetErrorText(ERR_BUFFER_OVERRUN, "Buffer overrun");
+   SetErrorText(ERR_PORT_NOTINITIALIZED, "Port not initialized");
+
+   CreateProperty(MM::g_Keyword_Name, g_ReplayPortName, MM::String, true);
+   CreateProperty(MM::g_Keyword_Description,
+         "Serial port replaying recorded traffic", MM::String, true);
+
+   CreateProperty("TraceFile", "", MM::String, false,
+         new CPropertyAction(this, &ReplayPort::OnTraceFile), true);
+
+   CreateProperty("Timing", g_Timing_Original, MM::String, false,
+         new CPropertyAction(this, &ReplayPort::OnTiming), true);
+   AddAllowedValue("Timing", g_Timing_Original);
+   AddAllowedValue("Timing", g_Timing_Immediate);
+
+   CreateProperty("AnswerTimeout", "500", MM::Float, false,
+         new CPropertyAction(this, &ReplayPort::OnTimeout), true);
+}
+
+ReplayPort::~ReplayPort()
+{
+   Shutdown();
+}
+
+int ReplayPort::Initialize()
+{
+   if (initialized_)
+      return DEVICE_OK;
+
+   PortTraceReader reader;
+   if (!reader.Open(traceFile_))
+      return ERR_OPEN_FAILED;
+
+   records_.clear();
+   PortTraceRecord record;
+   while (reader.Next(record))
+      records_.push_back(record);
+   LogMessage(("Loaded " + boost::lexical_cast<std::string>(records_.size()) +
+            " records from " + traceFile_).c_str(), true);
+
+   MMThreadGuard g(lock_);
+   nextRecord_ = 0;
+   unmatched_.clear();
+   pending_.clear();
+   received_.clear();
+   anchorUs_ = NowUs();
+   anchorTraceUs_ = records_.empty() ? 0 : records_.front().timeUs;
+   // Data the device sent before the first command
+   ReleaseIncoming(anchorUs_);
+
+   initialized_ = true;
+   return DEVICE_OK;
+}
+
+int ReplayPort::Shutdown()
+{
+   initialized_ = false;
+   return DEVICE_OK;
+}
+
+void ReplayPort::GetName(char* pszName) const
+{
+   CDeviceUtils::CopyLimitedString(pszName, g_ReplayPortName);
+}
+
+int ReplayPort::SetCommand(const char* command, const char* term)
+{
+   if (!initialized_)
+      return ERR_PORT_NOTINITIALIZED;
+
+   std::string sendText(command);
+   if (term != 0)
+      sendText += term;
+   Send(sendText);
+   return DEVICE_OK;
+}
+
+int ReplayPort::Write(const unsigned char* buf, unsigned long bufLen)
+{
+   if (!initialized_)
+      return ERR_PORT_NOTINITIALIZED;
+
+   Send(std::string(reinterpret_cast<const char*>(buf), bufLen));
+   return DEVICE_OK;
+}
+
+int ReplayPort::GetAnswer(char* answer, unsigned bufLen, const char* term)
+{
+   if (!initialized_)
+      return ERR_PORT_NOTINITIALIZED;
+   if (bufLen < 1)
+      return ERR_BUFFER_OVERRUN;
+   memset(answer, 0, bufLen);
+
+   const std::string terminator(term ? term : "");
+   const long long deadlineUs = NowUs() +
+      static_cast<long long>(answerTimeoutMs_ * 1000.0);
+   for (;;)
+   {
+      long long waitUntilUs;
+      {
+         MMThreadGuard g(lock_);
+         long long nowUs = NowUs();
+         MoveReadyData(nowUs);
+
+         std::size_t termPos = terminator.empty() ? std::string::npos :
+            received_.find(terminator);
+         if (termPos != std::string::npos)
+         {
+            std::string ans = received_.substr(0, termPos);
+            received_.erase(0, termPos + terminator.size());
+            if (ans.size() >= bufLen)
+               return ERR_BUFFER_OVERRUN;
+            memcpy(answer, ans.data(), ans.size());
+            return DEVICE_OK;
+         }
+
+         if (nowUs >= deadlineUs)
+            return ERR_TERM_TIMEOUT;
+         if (pending_.empty() && !originalTiming_)
+            return ERR_TERM_TIMEOUT; // Nothing more will arrive
+         waitUntilUs = pending_.empty() ? deadlineUs :
+            (std::min)(deadlineUs, pending_.front().readyUs);
+      }
+      SleepUs(waitUntilUs - NowUs());
+   }
+}
+
+int ReplayPort::Read(unsigned char* buf, unsigned long bufLen, unsigned long& charsRead)
+{
+   if (!initialized_)
+      return ERR_PORT_NOTINITIALIZED;
+
+   MMThreadGuard g(lock_);
+   MoveReadyData(NowUs());
+   charsRead = static_cast<unsigned long>(
+         (std::min)(static_cast<std::size_t>(bufLen), received_.size()));
+   memcpy(buf, received_.data(), charsRead);
+   received_.erase(0, charsRead);
+   return DEVICE_OK;
+}
+
+int ReplayPort::Purge()
+{
+   if (!initialized_)
+      return ERR_PORT_NOTINITIALIZED;
+
+   MMThreadGuard g(lock_);
+   MoveReadyData(NowUs());
+   received_.clear();
+   return DEVICE_OK;
+}
+
+long long ReplayPort::NowUs()
+{
+   return static_cast<long long>(GetCurrentMMTime().getMsec() * 1000.0);
+}
+
+void ReplayPort::Send(const std::string& data)
+{
+   MMThreadGuard g(lock_);
+   const long long nowUs = NowUs();
+   unmatched_ += data;
+
+   while (!unmatched_.empty() && nextRecord_ < records_.size())
+   {
+      const PortTraceRecord& record = records_[nextRecord_];
+      if (!record.IsOutgoing())
+      {
+         // Should not happen, as incoming records are released eagerly
+         ReleaseIncoming(nowUs);
+         continue;
+      }
+
+      if (unmatched_.compare(0, record.data.size(), record.data) == 0)
+      {
+         unmatched_.erase(0, record.data.size());
+      }
+      else if (record.data.compare(0, unmatched_.size(), unmatched_) == 0)
+      {
+         break; // Partially sent; wait for the rest
+      }
+      else
+      {
+         LogMessage(("Sent data does not match trace record " +
+                  boost::lexical_cast<std::string>(nextRecord_) +
+                  "; replaying it anyway").c_str(), false);
+         unmatched_.clear();
+      }
+
+      anchorUs_ = nowUs;
+      anchorTraceUs_ = record.timeUs;
+      ++nextRecord_;
+      ReleaseIncoming(nowUs);
+   }
+
+   if (nextRecord_ >= records_.size())
+      unmatched_.clear(); // Past the end of the trace
+}
+
+// Must be called with lock_ held. Releases the incoming records that follow
+// the last matched outgoing record.
+void ReplayPort::ReleaseIncoming(long long nowUs)
+{
+   while (nextRecord_ < records_.size() && !records_[nextRecord_].IsOutgoing())
+   {
+      const PortTraceRecord& record = records_[nextRecord_++];
+      Chunk chunk;
+      chunk.readyUs = originalTiming_ ?
+         anchorUs_ + (record.timeUs - anchorTraceUs_) : nowUs;
+      chunk.data = record.data;
+      pending_.push_back(chunk);
+   }
+}
+
+// Must be called with lock_ held.
+void ReplayPort::MoveReadyData(long long nowUs)
+{
+   while (!pending_.empty() && pending_.front().readyUs <= nowUs)
+   {
+      received_ += pending_.front().data;
+      pending_.pop_front();
+   }
+}
+
+int ReplayPort::OnTraceFile(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(traceFile_.c_str());
+   }
+   else if (eAct == MM::AfterSet)
+   {
+      pProp->Get(traceFile_);
+   }
+   return DEVICE_OK;
+}
+
+int ReplayPort::OnTiming(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(originalTiming_ ? g_Timing_Original : g_Timing_Immediate);
+   }
+   else if (eAct == MM::AfterSet)
+   {
+      std::string timing;
+      pProp->Get(timing);
+      originalTiming_ = (timing == g_Timing_Original);
+   }
+   return DEVICE_OK;
+}
+
+int ReplayPort::OnTimeout(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(answerTimeoutMs_);
+   }
+   else if (eAct == MM::AfterSet)
+   {
+      pProp->Get(answerTimeoutMs_);
+   }
+   return DEVICE_OK;
+}
@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          ReplayPort.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Serial port stand-in that replays a recorded traffic trace
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "DeviceBase.h"
+#include "PortTrace.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+
+extern const char* g_ReplayPortName;
+
+
+// Serves the responses recorded in a trace file (see the TraceFile property
+// of SerialPort and TCPIPPort), so that device adapters can be exercised and
+// benchmarked without hardware.
+//
+// Data sent by the adapter is matched against the outgoing records of the
+// trace. Once an outgoing record has been matched, the incoming records that
+// follow it become available to GetAnswer() and Read(), either with their
+// original delay relative to the outgoing record or immediately.
+class ReplayPort : public CSerialBase<ReplayPort>
+{
+public:
+   ReplayPort();
+   ~ReplayPort();
+
+   // MMDevice API
+   int Initialize();
+   int Shutdown();
+   void GetName(char* pszName) const;
+   bool Busy() { return false; }
+
+   // Serial API
+   MM::PortType GetPortType() const { return MM::SerialPort; }
+   int SetCommand(const char* command, const char* term);
+   int GetAnswer(char* answer, unsigned bufLen, const char* term);
+   int Write(const unsigned char* buf, unsigned long bufLen);
+   int Read(unsigned char* buf, unsigned long bufLen, unsigned long& charsRead);
+   int Purge();
+
+   int OnTraceFile(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnTiming(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnTimeout(MM::PropertyBase* pProp, MM::ActionType eAct);
+
+private:
+   struct Chunk
+   {
+      long long readyUs; // time at which the data becomes available
+      std::string data;
+   };
+
+   long long NowUs();
+   void Send(const std::string& data);
+   void ReleaseIncoming(long long nowUs);
+   void MoveReadyData(long long nowUs);
+
+   bool initialized_;
+   std::string traceFile_;
+   bool originalTiming_;
+   double answerTimeoutMs_;
+
+   MMThreadLock lock_;
+   std::vector<PortTraceRecord> records_;
+   std::size_t nextRecord_; // first record not yet matched or released
+   std::string unmatched_; // sent data not yet matched to the trace
+   long long anchorUs_; // when the last outgoing record was matched
+   long long anchorTraceUs_; // trace time of the last outgoing record
+   std::deque<Chunk> pending_; // released incoming data, not yet ready
+   std::string received_; // incoming data ready to be read
+};
@@ -23,6 +23,7 @@
 #include "SerialManager.h"
 
 #include "AsioClient.h"
+#include "ReplayPort.h"
 
 #include "ModuleInterface.h"
 #include "DeviceUtils.h"
@@ -283,15 +284,23 @@ MODULE_API void InitializeModuleData()
       it++;
    }
 
+   RegisterDevice(g_ReplayPortName, MM::SerialDevice, "Replays recorded port traffic (for testing without hardware)");
 }
 
 MODULE_API MM::Device* CreateDevice(const char* deviceName)
 {
+   if (deviceName && strcmp(deviceName, g_ReplayPortName) == 0)
+      return new ReplayPort();
    return g_serialManager.CreatePort(deviceName);
 }
 
 MODULE_API void DeleteDevice(MM::Device* pDevice)
 {
+   if (dynamic_cast<ReplayPort*>(pDevice))
+   {
+      delete pDevice;
+      return;
+   }
    g_serialManager.DestroyPort(pDevice);
 }
 
@@ -479,6 +488,11 @@ SerialPort::SerialPort(const char* portName) :
    (void)CreateProperty("Verbose", (verbose_?"1":"0"), MM::Integer, false, pActTD, true);
    AddAllowedValue("Verbose", "0");
    AddAllowedValue("Verbose", "1");
+
+   // binary traffic trace (empty for none)
+   CPropertyAction* pActTrace = new CPropertyAction (this, &SerialPort::OnTraceFile);
+   ret = CreateProperty("TraceFile", "", MM::String, false, pActTrace);
+   assert(ret == DEVICE_OK);
 }
 
 SerialPort::~SerialPort()
@@ -752,6 +766,7 @@ int SerialPort::SetCommand(const char* command, const char* term)
       }
    }
 
+   Trace(PortTraceCommand, sendText.data(), sendText.size());
    LogAsciiCommunication("SetCommand", false, sendText);
 
    return DEVICE_OK;
@@ -762,71 +777,115 @@ int SerialPort::GetAnswer(char* answer, unsigned bufLen, const char* term)
    if (!initialized_)
       return ERR_PORT_NOTINITIALIZED;
 
-   if (bufLen < 1)
-   {
-      LogMessage("BUFFER_OVERRUN error occured!");
-      return ERR_BUFFER_OVERRUN;
-   }
-   std::ostringstream logMsg;
-   unsigned long answerOffset = 0;
-   memset(answer,0,bufLen);
-   char theData = 0;
+   return ReceiveAnswer(answer, bufLen, term, answerTimeoutMs_);
+}
 
-   MM::MMTime startTime = GetCurrentMMTime();
-   MM::MMTime answerTimeout(answerTimeoutMs_ * 1000.0);
-   MM::MMTime nonTerminatedAnswerTimeout(5.0 * 1000.0); // For bug-compatibility
-   while ((GetCurrentMMTime() - startTime)  < answerTimeout)
+int SerialPort::SendCommandBatch(unsigned nrCommands,
+      const char* const* commands, const char* commandTerm,
+      char* answers, unsigned maxAnswerChars, const char* answerTerm,
+      const double* answerTimeoutsMs, unsigned& nrAnswers)
+{
+   nrAnswers = 0;
+   if (!initialized_)
+      return ERR_PORT_NOTINITIALIZED;
+
+   if (transmitCharWaitMs_ < 0.001)
    {
-      bool anyRead =  pPort_->ReadOneCharacter(theData);
-      if (anyRead)
+      // Send all commands in a single write
+      std::string sendText;
+      for (unsigned i = 0; i < nrCommands; ++i)
       {
-         if (bufLen <= answerOffset)
-         {
-            answer[answerOffset] = '\0';
-            LogMessage("BUFFER_OVERRUN error occured!");
-            return ERR_BUFFER_OVERRUN;
-         }
-         answer[answerOffset++] = theData;
+         sendText += commands[i];
+         if (commandTerm != 0)
+            sendText += commandTerm;
       }
-      else
+      if (!sendText.empty())
+         pPort_->WriteCharactersAsynchronously(sendText.c_str(), sendText.length());
+      Trace(PortTraceCommand, sendText.data(), sendText.size());
+      LogAsciiCommunication("SendCommandBatch", false, sendText);
+   }
+   else
+   {
+      for (unsigned i = 0; i < nrCommands; ++i)
       {
-         //Yield to other threads:
-         CDeviceUtils::SleepMs(1);
+         int ret = SetCommand(commands[i], commandTerm);
+         if (ret != DEVICE_OK)
+            return ret;
       }
+   }
 
-      // look for the terminator, if any
-      if (term && term[0])
-      {
-         // check for terminating sequence
-         char* termPos = strstr(answer, term);
-         if (termPos != 0) // found the terminator
-         {
-            LogAsciiCommunication("GetAnswer", true, answer);
+   for (unsigned i = 0; i < nrCommands; ++i)
+   {
+      double timeoutMs = answerTimeoutMs_;
+      if (answerTimeoutsMs != 0 && answerTimeoutsMs[i] > 0.0)
+         timeoutMs = answerTimeoutsMs[i];
+      int ret = ReceiveAnswer(answers + i * maxAnswerChars, maxAnswerChars,
+            answerTerm, timeoutMs);
+      if (ret != DEVICE_OK)
+         return ret;
+      ++nrAnswers;
+   }
+   return DEVICE_OK;
+}
 
-            // erase the terminator from the answer:
-            *termPos = '\0';
+int SerialPort::ReceiveAnswer(char* answer, unsigned bufLen, const char* term,
+      double answerTimeoutMs)
+{
+   if (bufLen < 1)
+   {
+      LogMessage("BUFFER_OVERRUN error occured!");
+      return ERR_BUFFER_OVERRUN;
+   }
+   memset(answer,0,bufLen);
 
-            return DEVICE_OK;
-         }
-      }
-      else
-      {
-         // XXX Shouldn't it be an error to not have a terminator?
-         // TODO Make it a precondition check (immediate error) once we've made
-         // sure that no device adapter calls us without a terminator. For now,
-         // keep the behavior for the sake of bug-compatibility.
+   const std::string terminator(term ? term : "");
+   const double nonTerminatedAnswerTimeoutMs = 5.0 * 1000.0; // For bug-compatibility
+   double timeoutMs = answerTimeoutMs;
+   if (terminator.empty())
+   {
+      // XXX Shouldn't it be an error to not have a terminator?
+      // TODO Make it a precondition check (immediate error) once we've made
+      // sure that no device adapter calls us without a terminator. For now,
+      // keep the behavior for the sake of bug-compatibility.
+      timeoutMs = (std::min)(timeoutMs, nonTerminatedAnswerTimeoutMs);
+   }
 
-         MM::MMTime elapsed = GetCurrentMMTime() - startTime;
-         if (elapsed > nonTerminatedAnswerTimeout)
+   MM::MMTime startTime = GetCurrentMMTime();
+   boost::system_time deadline = boost::get_system_time() +
+      boost::posix_time::microseconds(static_cast<boost::int64_t>(timeoutMs * 1000.0));
+
+   // Leave room for the null terminator
+   size_t answerOffset = 0;
+   AsioClient::ReadResult result = pPort_->ReadUntilTerminator(answer,
+         bufLen - 1, answerOffset, terminator, deadline);
+   answer[answerOffset] = '\0';
+
+   switch (result)
+   {
+      case AsioClient::ReadTerminated:
+         Trace(PortTraceAnswer, answer, answerOffset);
+         LogAsciiCommunication("GetAnswer", true, answer);
+         // erase the terminator from the answer:
+         answer[answerOffset - terminator.size()] = '\0';
+         return DEVICE_OK;
+
+      case AsioClient::ReadBufferFull:
+         Trace(PortTraceAnswer, answer, answerOffset);
+         LogMessage("BUFFER_OVERRUN error occured!");
+         return ERR_BUFFER_OVERRUN;
+
+      case AsioClient::ReadTimedOut:
+         if (terminator.empty() && answerTimeoutMs > nonTerminatedAnswerTimeoutMs)
          {
+            Trace(PortTraceAnswer, answer, answerOffset);
             LogAsciiCommunication("GetAnswer", true, answer);
-            long millisecs = static_cast<long>(elapsed.getMsec());
+            long millisecs = static_cast<long>((GetCurrentMMTime() - startTime).getMsec());
             LogMessage(("GetAnswer without terminator returning after " +
                      boost::lexical_cast<std::string>(millisecs) +
                      "msec").c_str(), true);
             return DEVICE_OK;
          }
-      }
+         break;
    }
 
    LogMessage("TERM_TIMEOUT error occured!");
@@ -856,6 +915,7 @@ int SerialPort::Write(const unsigned char* buf, unsigned long bufLen)
       }
    }
 
+   Trace(PortTraceWrite, reinterpret_cast<const char*>(buf), bufLen);
    if (verbose_)
    {
       LogBinaryCommunication("Write", false, buf, bufLen);
@@ -874,30 +934,12 @@ int SerialPort::Read(unsigned char* buf, unsigned long bufLen, unsigned long& ch
    {
       // zero the buffer
       memset(buf, 0, bufLen);
-      charsRead = 0;
 
-      bool anyRead = false;
-      char theData = 0;
-      for (;;)
-      {
-         anyRead = pPort_->ReadOneCharacter(theData);
-         if (anyRead)
-         {
-            buf[charsRead] = (unsigned char)theData;
-            if (bufLen <= ++charsRead)
-            {
-               // buffer is full
-               break;
-            }
-         }
-         else
-         {
-            // no data was available
-            break;
-         }
-      }
+      charsRead = static_cast<unsigned long>(pPort_->ReadAvailableCharacters(
+               reinterpret_cast<char*>(buf), bufLen));
       if (0 < charsRead)
       {
+         Trace(PortTraceRead, reinterpret_cast<const char*>(buf), charsRead);
          if (verbose_)
          {
             LogBinaryCommunication("Read", true, buf, charsRead);
@@ -1077,6 +1119,30 @@ int SerialPort::OnVerbose(MM::PropertyBase* pProp, MM::ActionType eAct)
 }
 
 
+int SerialPort::OnTraceFile(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(traceFile_.c_str());
+   }
+   else if (eAct == MM::AfterSet)
+   {
+      std::string traceFile;
+      pProp->Get(traceFile);
+      if (!trace_.Open(traceFile))
+      {
+         traceFile_.clear();
+         pProp->Set("");
+         LogMessage(("Cannot open trace file " + traceFile).c_str());
+         return ERR_OPEN_FAILED;
+      }
+      traceFile_ = traceFile;
+   }
+
+   return DEVICE_OK;
+}
+
+
 int SerialPort::OnDelayBetweenCharsMs(MM::PropertyBase* pProp, MM::ActionType eAct)
 {
    if (eAct == MM::BeforeGet)
@@ -1259,6 +1325,14 @@ static void PrintCommunicationPrefix(std::ostream& strm, const char* prefix, boo
    strm << (isInput ? " <- " : " -> ");
 }
 
+void SerialPort::Trace(PortTraceRecordKind kind, const char* data, std::size_t length)
+{
+   if (!trace_.IsOpen())
+      return;
+   trace_.Record(static_cast<long long>(GetCurrentMMTime().getMsec() * 1000.0),
+         kind, data, length);
+}
+
 void SerialPort::LogAsciiCommunication(const char* prefix, bool isInput, const std::string& data)
 {
    std::ostringstream oss;
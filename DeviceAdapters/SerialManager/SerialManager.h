@@ -26,6 +26,7 @@
 #define WIN32_LEAN_AND_MEAN
 
 #include "DeviceBase.h"
+#include "PortTrace.h"
 
 #ifdef __APPLE__
 // OS X 10.5 kqueue does not support serial
@@ -90,6 +91,10 @@ public:
    int Read(unsigned char* buf, unsigned long bufLen, unsigned long& charsRead);
    MM::PortType GetPortType() const {return MM::SerialPort;}
    int Purge();
+   int SendCommandBatch(unsigned nrCommands,
+         const char* const* commands, const char* commandTerm,
+         char* answers, unsigned maxAnswerChars, const char* answerTerm,
+         const double* answerTimeoutsMs, unsigned& nrAnswers);
 
    std::string Name() const;
 
@@ -113,6 +118,7 @@ public:
    int OnTimeout(MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnDelayBetweenCharsMs(MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnVerbose(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnTraceFile(MM::PropertyBase* pProp, MM::ActionType eAct);
 
    void AddReference() {refCount_++;}
    void RemoveReference() {refCount_--;}
@@ -147,6 +153,10 @@ private:
    boost::thread* pThread_;
    bool verbose_; // if false, turn off LogBinaryMessage even in Debug Log
 
+   // Binary record of all traffic, for replay with ReplayPort
+   std::string traceFile_;
+   PortTraceWriter trace_;
+
 
 #ifdef _WIN32
    bool dtrEnable_; // currently only used on Windows
@@ -155,6 +165,8 @@ private:
    int OnDTR(MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnFastUSB2Serial(MM::PropertyBase* pProp, MM::ActionType eAct);
 #endif
+   int ReceiveAnswer(char* answer, unsigned bufLen, const char* term, double answerTimeoutMs);
+   void Trace(PortTraceRecordKind kind, const char* data, std::size_t length);
    void LogAsciiCommunication(const char* prefix, bool isInput, const std::string& content);
    void LogBinaryCommunication(const char* prefix, bool isInput, const unsigned char* content, std::size_t length);
 };
@@ -30,6 +30,8 @@
 
 #include "Util.h"
 
+#include <algorithm>
+
 using boost::asio::ip::tcp;
 
 const char* deviceName = "TCP/IP serial port adapter";
@@ -42,16 +44,27 @@ TCPIPPort::TCPIPPort(int index) :
 	port_(0),
 	initialized_(false),
 	sock_(ios_),
-	answerTimeoutMs_(500)
+	answerTimeoutMs_(500),
+	noDelay_(true),
+	rxBuffer_(4096),
+	rxBegin_(0),
+	rxEnd_(0),
+	rxScanned_(0)
 {
 	SetErrorText(ERR_BUFFER_OVERRUN, "Buffer overrun occured during read");
 	SetErrorText(ERR_TERM_TIMEOUT, "Timeout occured during init or read");
 	SetErrorText(ERR_PORT_CHANGE_FORBIDDEN, "Cannot change host/port after initialization");
 	SetErrorText(ERR_PORT_NOTINITIALIZED, "Operation failed. Port not inititalized");
+	SetErrorText(ERR_TRACE_OPEN_FAILED, "Cannot open the trace file");
 
 	CreateProperty("Host", "127.0.0.1", MM::String, false, new CPropertyAction(this, &TCPIPPort::OnHost), true);
 	CreateProperty("TCP Port", "0", MM::Integer, false, new CPropertyAction(this, &TCPIPPort::OnPort), true);
 	CreateProperty("Answer timeout", "500", MM::Integer, false, new CPropertyAction(this, &TCPIPPort::OnAnswerTimeout), false);
+	CreateProperty("TCP_NODELAY", "Yes", MM::String, false, new CPropertyAction(this, &TCPIPPort::OnNoDelay), true);
+	AddAllowedValue("TCP_NODELAY", "Yes");
+	AddAllowedValue("TCP_NODELAY", "No");
+	// Records the port traffic, for replay with the ReplayPort device
+	CreateProperty("TraceFile", "", MM::String, false, new CPropertyAction(this, &TCPIPPort::OnTraceFile), false);
 }
 
 TCPIPPort::~TCPIPPort()
@@ -79,18 +92,34 @@ ERRH_START
 	tcp::resolver::iterator it = tcp::resolver(ios_).resolve(endpoint);
 
 	boost::system::error_code ec = boost::asio::error::would_block;
+	boost::system::error_code timerError = boost::asio::error::would_block;
 
 	boost::asio::deadline_timer deadline(ios_);
 	deadline.expires_from_now(boost::posix_time::millisec(answerTimeoutMs_));
-	deadline.async_wait(boost::lambda::bind(&TCPIPPort::close_sock, this));
+	deadline.async_wait(boost::lambda::var(timerError) = boost::lambda::_1);
 	
 	boost::asio::async_connect(sock_, it, boost::lambda::var(ec) = boost::lambda::_1);
 
-	do ios_.run_one(); while (ec == boost::asio::error::would_block);
+	do
+	{
+		ios_.run_one();
+		if (timerError != boost::asio::error::would_block &&
+			ec == boost::asio::error::would_block)
+			close_sock(); // timed out
+	} while (ec == boost::asio::error::would_block);
+
+	// Complete the timer wait so that it does not fire during later reads
+	deadline.cancel();
+	while (timerError == boost::asio::error::would_block)
+		ios_.run_one();
 
 	if (ec || !sock_.is_open())
 		return ERR_TERM_TIMEOUT;
 
+	if (noDelay_)
+		sock_.set_option(tcp::no_delay(true));
+
+	rxBegin_ = rxEnd_ = rxScanned_ = 0;
 	initialized_ = true;
 
 	if (index_ == GetCount())
@@ -140,91 +169,210 @@ int TCPIPPort::SetCommand(const char* command, const char* term)
 	boost::asio::write(sock_, boost::asio::buffer(cmd));
 
 	LogAsciiCommunication("SetCommand", false, cmd);
+	Trace(PortTraceCommand, cmd.data(), cmd.size());
 	ERRH_END
 }
 
-//mostly copied from SerialManager.cpp (Serialport::GetAnswer)
 int TCPIPPort::GetAnswer(char* txt, unsigned maxChars, const char* term)
 {
+	if (!initialized_)
+		return ERR_PORT_NOTINITIALIZED;
+
+	return ReceiveAnswer(txt, maxChars, term, answerTimeoutMs_);
+}
+
+int TCPIPPort::SendCommandBatch(unsigned nrCommands,
+	const char* const* commands, const char* commandTerm,
+	char* answers, unsigned maxAnswerChars, const char* answerTerm,
+	const double* answerTimeoutsMs, unsigned& nrAnswers)
+{
+	nrAnswers = 0;
 ERRH_START
 	if (!initialized_)
 		return ERR_PORT_NOTINITIALIZED;
 
+	// Send all commands in a single write
+	std::string cmd;
+	for (unsigned i = 0; i < nrCommands; ++i)
+	{
+		cmd += commands[i];
+		if (commandTerm != 0)
+			cmd += commandTerm;
+	}
+
+	boost::asio::write(sock_, boost::asio::buffer(cmd));
+
+	LogAsciiCommunication("SendCommandBatch", false, cmd);
+	Trace(PortTraceCommand, cmd.data(), cmd.size());
+
+	for (unsigned i = 0; i < nrCommands; ++i)
+	{
+		double timeoutMs = answerTimeoutMs_;
+		if (answerTimeoutsMs != 0 && answerTimeoutsMs[i] > 0.0)
+			timeoutMs = answerTimeoutsMs[i];
+		int ret = ReceiveAnswer(answers + i * maxAnswerChars, maxAnswerChars, answerTerm, timeoutMs);
+		if (ret != DEVICE_OK)
+			return ret;
+		++nrAnswers;
+	}
+ERRH_END
+}
+
+//mostly copied from SerialManager.cpp (Serialport::GetAnswer)
+int TCPIPPort::ReceiveAnswer(char* txt, unsigned maxChars, const char* term, double answerTimeoutMs)
+{
+ERRH_START
 	if (maxChars < 1)
 	{
 		LogMessage("BUFFER_OVERRUN error occured!");
 		return ERR_BUFFER_OVERRUN;
 	}
-	std::ostringstream logMsg;
-	unsigned long answerOffset = 0;
 	memset(txt, 0, maxChars);
-	char theData = 0;
 
-	MM::MMTime startTime = GetCurrentMMTime();
-	MM::MMTime answerTimeout(answerTimeoutMs_ * 1000.0);
-	MM::MMTime nonTerminatedAnswerTimeout(5.0 * 1000.0); // For bug-compatibility
-	while ((GetCurrentMMTime() - startTime) < answerTimeout)
+	const std::string terminator(term ? term : "");
+	const double nonTerminatedAnswerTimeoutMs = 5.0 * 1000.0; // For bug-compatibility
+	double timeoutMs = answerTimeoutMs;
+	if (terminator.empty())
 	{
-		boost::asio::socket_base::bytes_readable command(true);
-		sock_.io_control(command);
-		size_t bytes_readable = command.get();
+		// XXX Shouldn't it be an error to not have a terminator?
+		// TODO Make it a precondition check (immediate error) once we've made
+		// sure that no device adapter calls us without a terminator. For now,
+		// keep the behavior for the sake of bug-compatibility.
+		timeoutMs = (std::min)(timeoutMs, nonTerminatedAnswerTimeoutMs);
+	}
 
-		if (bytes_readable > 0)
+	const boost::posix_time::ptime startTime = boost::posix_time::microsec_clock::universal_time();
+	const boost::posix_time::ptime deadline = startTime +
+		boost::posix_time::microseconds(static_cast<boost::int64_t>(timeoutMs * 1000.0));
+	for (;;)
+	{
+		if (!terminator.empty())
 		{
-			sock_.read_some(boost::asio::buffer(&theData, 1));
+			// Only search the bytes received since the last search (and the
+			// end of the previously searched bytes, in case the terminator
+			// was split between reads)
+			std::size_t searchStart = rxBegin_;
+			if (rxScanned_ >= rxBegin_ + terminator.size())
+				searchStart = rxScanned_ - terminator.size() + 1;
+			std::vector<char>::iterator termPos = std::search(
+				rxBuffer_.begin() + searchStart, rxBuffer_.begin() + rxEnd_,
+				terminator.begin(), terminator.end());
+
+			if (termPos != rxBuffer_.begin() + rxEnd_)
+			{
+				// Bytes following the terminator remain unsearched
+				std::size_t answerLen = termPos - (rxBuffer_.begin() + rxBegin_);
+				std::string answer(rxBuffer_.begin() + rxBegin_, termPos);
+				rxScanned_ = rxBegin_ + answerLen + terminator.size();
+				ConsumeReceived(answerLen + terminator.size());
+
+				LogAsciiCommunication("GetAnswer", true, answer + terminator);
+				Trace(PortTraceAnswer, (answer + terminator).data(), answerLen + terminator.size());
+				if (answerLen >= maxChars)
+				{
+					LogMessage("BUFFER_OVERRUN error occured!");
+					return ERR_BUFFER_OVERRUN;
+				}
+				memcpy(txt, answer.data(), answerLen);
+				return DEVICE_OK;
+			}
 
-			if (maxChars <= answerOffset)
+			rxScanned_ = rxEnd_;
+
+			if (rxEnd_ - rxBegin_ >= maxChars + terminator.size())
 			{
-				txt[answerOffset] = '\0';
+				// The answer can no longer fit; drop what we have
+				ConsumeReceived(rxEnd_ - rxBegin_);
 				LogMessage("BUFFER_OVERRUN error occured!");
 				return ERR_BUFFER_OVERRUN;
 			}
-			txt[answerOffset++] = theData;
-		}
-		else
-		{
-			//Yield to other threads:
-			CDeviceUtils::SleepMs(1);
 		}
 
-		// look for the terminator, if any
-		if (term && term[0])
-		{
-			// check for terminating sequence
-			char* termPos = strstr(txt, term);
-			if (termPos != 0) // found the terminator
-			{
-				LogAsciiCommunication("GetAnswer", true, txt);
+		const boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+		if (now >= deadline || ReceiveMore(deadline - now) == 0)
+			break;
+	}
 
-				// erase the terminator from the answer:
-				*termPos = '\0';
+	if (terminator.empty() && answerTimeoutMs > nonTerminatedAnswerTimeoutMs)
+	{
+		std::size_t answerLen = (std::min)(rxEnd_ - rxBegin_, std::size_t(maxChars - 1));
+		memcpy(txt, &rxBuffer_[rxBegin_], answerLen);
+		ConsumeReceived(answerLen);
+
+		LogAsciiCommunication("GetAnswer", true, txt);
+		Trace(PortTraceAnswer, txt, answerLen);
+		long millisecs = static_cast<long>((boost::posix_time::microsec_clock::universal_time() - startTime).total_milliseconds());
+		LogMessage(("GetAnswer without terminator returning after " +
+			boost::lexical_cast<std::string>(millisecs) +
+			"msec").c_str(), true);
+		return DEVICE_OK;
+	}
 
-				return DEVICE_OK;
-			}
+	LogMessage("TERM_TIMEOUT error occured!");
+	return ERR_TERM_TIMEOUT;
+ERRH_END
+}
+
+// Wait (up to timeout) for data on the socket and append it to the receive
+// buffer. Returns the number of bytes received (0 on timeout). Throws
+// boost::system::system_error if the connection fails.
+std::size_t TCPIPPort::ReceiveMore(const boost::posix_time::time_duration& timeout)
+{
+	if (rxEnd_ == rxBuffer_.size())
+	{
+		if (rxBegin_ > 0)
+		{
+			std::copy(rxBuffer_.begin() + rxBegin_, rxBuffer_.begin() + rxEnd_, rxBuffer_.begin());
+			rxEnd_ -= rxBegin_;
+			rxScanned_ -= rxBegin_;
+			rxBegin_ = 0;
 		}
 		else
 		{
-			// XXX Shouldn't it be an error to not have a terminator?
-			// TODO Make it a precondition check (immediate error) once we've made
-			// sure that no device adapter calls us without a terminator. For now,
-			// keep the behavior for the sake of bug-compatibility.
-
-			MM::MMTime elapsed = GetCurrentMMTime() - startTime;
-			if (elapsed > nonTerminatedAnswerTimeout)
-			{
-				LogAsciiCommunication("GetAnswer", true, txt);
-				long millisecs = static_cast<long>(elapsed.getMsec());
-				LogMessage(("GetAnswer without terminator returning after " +
-					boost::lexical_cast<std::string>(millisecs) +
-					"msec").c_str(), true);
-				return DEVICE_OK;
-			}
+			rxBuffer_.resize(2 * rxBuffer_.size());
 		}
 	}
 
-	LogMessage("TERM_TIMEOUT error occured!");
-	return ERR_TERM_TIMEOUT;
-	ERRH_END
+	boost::system::error_code readError = boost::asio::error::would_block;
+	boost::system::error_code timerError = boost::asio::error::would_block;
+	std::size_t bytesRead = 0;
+
+	boost::asio::deadline_timer deadline(ios_);
+	deadline.expires_from_now(timeout);
+	deadline.async_wait(boost::lambda::var(timerError) = boost::lambda::_1);
+
+	sock_.async_read_some(boost::asio::buffer(&rxBuffer_[rxEnd_], rxBuffer_.size() - rxEnd_),
+		(boost::lambda::var(readError) = boost::lambda::_1,
+		 boost::lambda::var(bytesRead) = boost::lambda::_2));
+
+	ios_.reset();
+	while (readError == boost::asio::error::would_block)
+	{
+		ios_.run_one();
+		if (timerError != boost::asio::error::would_block &&
+			readError == boost::asio::error::would_block)
+			sock_.cancel(); // timed out
+	}
+	deadline.cancel();
+	while (timerError == boost::asio::error::would_block)
+		ios_.run_one();
+
+	if (readError == boost::asio::error::operation_aborted)
+		return 0;
+	if (readError)
+		throw boost::system::system_error(readError);
+
+	rxEnd_ += bytesRead;
+	return bytesRead;
+}
+
+void TCPIPPort::ConsumeReceived(std::size_t count)
+{
+	rxBegin_ += count;
+	if (rxBegin_ >= rxEnd_)
+		rxBegin_ = rxEnd_ = rxScanned_ = 0;
+	else if (rxScanned_ < rxBegin_)
+		rxScanned_ = rxBegin_;
 }
 
 int TCPIPPort::Write(const unsigned char* buf, unsigned long bufLen)
@@ -236,6 +384,7 @@ int TCPIPPort::Write(const unsigned char* buf, unsigned long bufLen)
 	boost::asio::write(sock_, boost::asio::buffer(buf, bufLen));
 
 	LogBinaryCommunication("Write", false, buf, bufLen);
+	Trace(PortTraceWrite, reinterpret_cast<const char*>(buf), bufLen);
 	ERRH_END
 }
 
@@ -245,21 +394,39 @@ int TCPIPPort::Read(unsigned char* buf, unsigned long bufLen, unsigned long& cha
 		if (!initialized_)
 			return ERR_PORT_NOTINITIALIZED;
 
-	if (bufLen < 0)
-		return ERR_BUFFER_OVERRUN;
-
 	memset(buf, 0, bufLen);
 
-	charsRead = (unsigned long)boost::asio::read(sock_, boost::asio::buffer(buf, bufLen));
+	// Data already received (e.g. following an answer) comes first
+	charsRead = (unsigned long)(std::min)(std::size_t(bufLen), rxEnd_ - rxBegin_);
+	if (charsRead > 0)
+	{
+		memcpy(buf, &rxBuffer_[rxBegin_], charsRead);
+		ConsumeReceived(charsRead);
+	}
+
+	if (charsRead < bufLen && sock_.available() > 0)
+		charsRead += (unsigned long)sock_.read_some(boost::asio::buffer(buf + charsRead, bufLen - charsRead));
 
 	if (charsRead > 0)
+	{
 		LogBinaryCommunication("Read", true, buf, charsRead);
+		Trace(PortTraceRead, reinterpret_cast<const char*>(buf), charsRead);
+	}
 	ERRH_END
 }
 
 int TCPIPPort::Purge()
 {
-	return DEVICE_OK;
+	ERRH_START
+		if (!initialized_)
+			return ERR_PORT_NOTINITIALIZED;
+
+	ConsumeReceived(rxEnd_ - rxBegin_);
+
+	std::vector<char> discard(1024);
+	while (sock_.available() > 0)
+		sock_.read_some(boost::asio::buffer(discard));
+	ERRH_END
 }
 
 int TCPIPPort::OnHost(MM::PropertyBase* pProp, MM::ActionType eAct)
@@ -320,6 +487,58 @@ int TCPIPPort::OnAnswerTimeout(MM::PropertyBase* pProp, MM::ActionType eAct)
 	return DEVICE_OK;
 }
 
+int TCPIPPort::OnNoDelay(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+	if (eAct == MM::BeforeGet)
+	{
+		pProp->Set(noDelay_ ? "Yes" : "No");
+	}
+	else if (eAct == MM::AfterSet)
+	{
+		if (initialized_)
+		{
+			// revert
+			pProp->Set(noDelay_ ? "Yes" : "No");
+			return ERR_PORT_CHANGE_FORBIDDEN;
+		}
+		std::string s;
+		pProp->Get(s);
+		noDelay_ = (s == "Yes");
+	}
+
+	return DEVICE_OK;
+}
+
+int TCPIPPort::OnTraceFile(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+	if (eAct == MM::BeforeGet)
+	{
+		pProp->Set(traceFile_.c_str());
+	}
+	else if (eAct == MM::AfterSet)
+	{
+		std::string traceFile;
+		pProp->Get(traceFile);
+		if (!trace_.Open(traceFile))
+		{
+			traceFile_.clear();
+			pProp->Set("");
+			LogMessage(("Cannot open trace file " + traceFile).c_str());
+			return ERR_TRACE_OPEN_FAILED;
+		}
+		traceFile_ = traceFile;
+	}
+
+	return DEVICE_OK;
+}
+
+void TCPIPPort::Trace(PortTraceRecordKind kind, const char* data, std::size_t length)
+{
+	if (!trace_.IsOpen())
+		return;
+	trace_.Record(static_cast<long long>(GetCurrentMMTime().getMsec() * 1000.0), kind, data, length);
+}
+
 int TCPIPPort::GetCount()
 {
 	return count_;
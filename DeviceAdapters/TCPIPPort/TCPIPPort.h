@@ -26,9 +26,12 @@
 #include "boost/asio.hpp"
 
 #include <istream>
+#include <string>
+#include <vector>
 
 #include "../../MMDevice/MMDevice.h"
 #include "../../MMDevice/DeviceBase.h"
+#include "../../MMDevice/PortTrace.h"
 
 #define BOOST_ERROR 20000
 
@@ -38,6 +41,7 @@
 #define ERR_TERM_TIMEOUT 107
 #define ERR_PORT_CHANGE_FORBIDDEN 109
 #define ERR_PORT_NOTINITIALIZED 111
+#define ERR_TRACE_OPEN_FAILED 112
 
 extern const char* deviceName;
 
@@ -62,11 +66,17 @@ public:
 	int Write(const unsigned char* buf, unsigned long bufLen);
 	int Read(unsigned char* buf, unsigned long bufLen, unsigned long& charsRead);
 	int Purge();
+	int SendCommandBatch(unsigned nrCommands,
+		const char* const* commands, const char* commandTerm,
+		char* answers, unsigned maxAnswerChars, const char* answerTerm,
+		const double* answerTimeoutsMs, unsigned& nrAnswers);
 
 	//Action handlers
 	int OnHost(MM::PropertyBase* pProp, MM::ActionType eAct);
 	int OnPort(MM::PropertyBase* pProp, MM::ActionType eAct);
 	int OnAnswerTimeout(MM::PropertyBase* pProp, MM::ActionType eAct);
+	int OnNoDelay(MM::PropertyBase* pProp, MM::ActionType eAct);
+	int OnTraceFile(MM::PropertyBase* pProp, MM::ActionType eAct);
 
 	void close_sock();
 
@@ -84,6 +94,21 @@ private:
 	std::string host_;
 	unsigned short port_;
 	unsigned int answerTimeoutMs_;
+	bool noDelay_;
+	std::string traceFile_;
+	PortTraceWriter trace_;
+
+	// Received data not yet returned to the caller: [rxBegin_, rxEnd_).
+	// Bytes before rxScanned_ have already been searched for the terminator.
+	std::vector<char> rxBuffer_;
+	std::size_t rxBegin_;
+	std::size_t rxEnd_;
+	std::size_t rxScanned_;
+
+	int ReceiveAnswer(char* txt, unsigned maxChars, const char* term, double answerTimeoutMs);
+	std::size_t ReceiveMore(const boost::posix_time::time_duration& timeout);
+	void ConsumeReceived(std::size_t count);
+	void Trace(PortTraceRecordKind kind, const char* data, std::size_t length);
 
 	void LogAsciiCommunication(const char * prefix, bool isInput, const std::string & data);
 	void LogBinaryCommunication(const char* prefix, bool isInput, const unsigned char* content, std::size_t length);
@@ -33,6 +33,7 @@
 #include "../../MMDevice/ModuleInterface.h"
 #include "../../MMDevice/MMDevice.h"
 
+#include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
 
 #include <algorithm>
@@ -326,13 +327,276 @@ int MultiShutter::OnState(MM::PropertyBase* pProp, MM::ActionType eAct)
    return DEVICE_OK;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// MultiCamera helpers
+///////////////////////////////////////////////////////////////////////////////
+CameraSnapThread::CameraSnapThread(MM::Camera* camera) :
+   camera_(camera),
+   snapRequested_(false),
+   snapping_(false),
+   quit_(false),
+   result_(DEVICE_OK),
+   thread_(boost::bind(&CameraSnapThread::Run, this))
+{
+}
+
+CameraSnapThread::~CameraSnapThread()
+{
+   {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      quit_ = true;
+   }
+   cond_.notify_all();
+   thread_.join();
+}
+
+void CameraSnapThread::Snap()
+{
+   {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      snapRequested_ = true;
+      snapping_ = true;
+   }
+   cond_.notify_all();
+}
+
+int CameraSnapThread::WaitForSnap()
+{
+   boost::unique_lock<boost::mutex> lock(mutex_);
+   while (snapping_)
+      cond_.wait(lock);
+   return result_;
+}
+
+void CameraSnapThread::Run()
+{
+   boost::unique_lock<boost::mutex> lock(mutex_);
+   for (;;)
+   {
+      while (!snapRequested_ && !quit_)
+         cond_.wait(lock);
+      if (quit_)
+         return;
+      snapRequested_ = false;
+
+      lock.unlock();
+      int ret = camera_->SnapImage();
+      lock.lock();
+
+      result_ = ret;
+      snapping_ = false;
+      cond_.notify_all();
+   }
+}
+
+
+// Longest a camera may run ahead of the others before its images are passed
+// on without waiting for the rest of their set
+const std::size_t g_MaxPendingImages = 16;
+
+SequenceFrameAligner::SequenceFrameAligner() :
+   core_(0),
+   nrUnaligned_(0),
+   active_(false)
+{
+}
+
+SequenceFrameAligner::~SequenceFrameAligner()
+{
+}
+
+void SequenceFrameAligner::Start(MM::Core* core, const std::vector<MM::Camera*>& cameras)
+{
+   MMThreadGuard guard(lock_);
+   core_ = core;
+   cameras_ = cameras;
+   pending_.clear();
+   pending_.resize(cameras.size());
+   nrUnaligned_ = 0;
+   active_ = true;
+}
+
+long SequenceFrameAligner::Finish()
+{
+   MMThreadGuard guard(lock_);
+   if (!active_)
+      return 0;
+
+   // Whatever is left did not get a complete set; keep the camera order as
+   // far as possible
+   bool inserted = true;
+   while (inserted)
+   {
+      inserted = false;
+      for (std::size_t i = 0; i < pending_.size(); i++)
+      {
+         if (!pending_[i].empty())
+         {
+            InsertPending(static_cast<int>(i));
+            nrUnaligned_++;
+            inserted = true;
+         }
+      }
+   }
+   active_ = false;
+   return nrUnaligned_;
+}
+
+int SequenceFrameAligner::Channel(const MM::Device* caller) const
+{
+   if (!active_)
+      return -1;
+   for (std::size_t i = 0; i < cameras_.size(); i++)
+   {
+      if (cameras_[i] == caller)
+         return static_cast<int>(i);
+   }
+   return -1;
+}
+
+/**
+ * True if an image of this channel is the last one missing from the oldest
+ * set. At most one set can be complete at a time, since complete sets are
+ * inserted right away.
+ */
+bool SequenceFrameAligner::CompletesSet(int channel) const
+{
+   if (!pending_[channel].empty())
+      return false;
+   for (std::size_t i = 0; i < pending_.size(); i++)
+   {
+      if (static_cast<int>(i) != channel && pending_[i].empty())
+         return false;
+   }
+   return true;
+}
+
+void SequenceFrameAligner::Enqueue(int channel, const MM::Device* caller,
+      const unsigned char* buf, unsigned width, unsigned height,
+      unsigned byteDepth, unsigned nComponents,
+      const std::string& serializedMetadata, bool doProcess)
+{
+   std::deque<PendingImage>& queue = pending_[channel];
+   if (queue.size() >= g_MaxPendingImages)
+   {
+      // The other cameras are not keeping up (or have dropped images); give
+      // up on aligning the oldest image rather than buffering without limit
+      InsertPending(channel);
+      nrUnaligned_++;
+   }
+
+   queue.push_back(PendingImage());
+   PendingImage& image = queue.back();
+   image.caller = caller;
+   image.pixels.assign(buf, buf + width * height * byteDepth);
+   image.width = width;
+   image.height = height;
+   image.byteDepth = byteDepth;
+   image.nComponents = nComponents;
+   image.serializedMetadata = serializedMetadata;
+   image.doProcess = doProcess;
+}
+
+int SequenceFrameAligner::InsertPending(int channel)
+{
+   std::deque<PendingImage>& queue = pending_[channel];
+   const PendingImage& image = queue.front();
+   int ret = core_->InsertImage(image.caller, &image.pixels[0], image.width,
+         image.height, image.byteDepth, image.nComponents,
+         image.serializedMetadata.c_str(), image.doProcess);
+   queue.pop_front();
+   return ret;
+}
+
+int SequenceFrameAligner::InsertPending(int firstChannel, int lastChannel)
+{
+   int ret = DEVICE_OK;
+   for (int i = firstChannel; i < lastChannel; i++)
+   {
+      int nRet = InsertPending(i);
+      if (ret == DEVICE_OK)
+         ret = nRet;
+   }
+   return ret;
+}
+
+int SequenceFrameAligner::InsertImage(const MM::Device* caller, const ImgBuffer& buf)
+{
+   MMThreadGuard guard(lock_);
+   int channel = Channel(caller);
+   if (channel < 0)
+      return core_->InsertImage(caller, buf);
+   if (!CompletesSet(channel))
+   {
+      Enqueue(channel, caller, buf.GetPixels(), buf.Width(), buf.Height(),
+            buf.Depth(), 1, buf.GetMetadata().Serialize(), true);
+      return DEVICE_OK;
+   }
+
+   int ret = InsertPending(0, channel);
+   int nRet = core_->InsertImage(caller, buf);
+   if (ret == DEVICE_OK)
+      ret = nRet;
+   nRet = InsertPending(channel + 1, static_cast<int>(pending_.size()));
+   return ret != DEVICE_OK ? ret : nRet;
+}
+
+int SequenceFrameAligner::InsertImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents, const char* serializedMetadata, const bool doProcess)
+{
+   MMThreadGuard guard(lock_);
+   int channel = Channel(caller);
+   if (channel < 0)
+      return core_->InsertImage(caller, buf, width, height, byteDepth, nComponents, serializedMetadata, doProcess);
+   if (!CompletesSet(channel))
+   {
+      Enqueue(channel, caller, buf, width, height, byteDepth, nComponents,
+            serializedMetadata ? serializedMetadata : "", doProcess);
+      return DEVICE_OK;
+   }
+
+   int ret = InsertPending(0, channel);
+   int nRet = core_->InsertImage(caller, buf, width, height, byteDepth, nComponents, serializedMetadata, doProcess);
+   if (ret == DEVICE_OK)
+      ret = nRet;
+   nRet = InsertPending(channel + 1, static_cast<int>(pending_.size()));
+   return ret != DEVICE_OK ? ret : nRet;
+}
+
+int SequenceFrameAligner::InsertImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, const Metadata* md, const bool doProcess)
+{
+   MMThreadGuard guard(lock_);
+   int channel = Channel(caller);
+   if (channel < 0)
+      return core_->InsertImage(caller, buf, width, height, byteDepth, md, doProcess);
+   if (!CompletesSet(channel))
+   {
+      Enqueue(channel, caller, buf, width, height, byteDepth, 1,
+            md ? md->Serialize() : std::string(), doProcess);
+      return DEVICE_OK;
+   }
+
+   int ret = InsertPending(0, channel);
+   int nRet = core_->InsertImage(caller, buf, width, height, byteDepth, md, doProcess);
+   if (ret == DEVICE_OK)
+      ret = nRet;
+   nRet = InsertPending(channel + 1, static_cast<int>(pending_.size()));
+   return ret != DEVICE_OK ? ret : nRet;
+}
+
+int SequenceFrameAligner::InsertImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, const char* serializedMetadata, const bool doProcess)
+{
+   return InsertImage(caller, buf, width, height, byteDepth, 1, serializedMetadata, doProcess);
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Multi Shutter implementation
 ///////////////////////////////////////////////////////////////////////////////
 MultiCamera::MultiCamera() :
    imageBuffer_(0),
    nrCamerasInUse_(0),
-   initialized_(false)
+   initialized_(false),
+   alignFrames_(true)
 {
    InitializeDefaultErrorMessages();
 
@@ -349,6 +613,7 @@ MultiCamera::MultiCamera() :
    for (int i = 0; i < MAX_NUMBER_PHYSICAL_CAMERAS; i++) {
       usedCameras_.push_back(g_Undefined);
       physicalCameras_.push_back(0);
+      snapThreads_.push_back(boost::shared_ptr<CameraSnapThread>());
    }
 }
 
@@ -360,7 +625,11 @@ MultiCamera::~MultiCamera()
 
 int MultiCamera::Shutdown()
 {
+   StopFrameAlignment();
+   for (unsigned int i = 0; i < snapThreads_.size(); i++)
+      snapThreads_[i].reset();
    delete imageBuffer_;
+   imageBuffer_ = 0;
    // Rely on the cameras to shut themselves down
    return DEVICE_OK;
 }
@@ -409,6 +678,13 @@ int MultiCamera::Initialize()
    CPropertyAction* pAct = new CPropertyAction(this, &MultiCamera::OnBinning);
    CreateProperty(MM::g_Keyword_Binning, "1", MM::Integer, false, pAct, false);
 
+   // Insert the images of sequence acquisitions as sets of one image per
+   // camera. Switch off for cameras that run at different frame rates.
+   pAct = new CPropertyAction(this, &MultiCamera::OnAlignFrames);
+   CreateProperty("Align Sequence Frames", "Yes", MM::String, false, pAct, false);
+   AddAllowedValue("Align Sequence Frames", "No");
+   AddAllowedValue("Align Sequence Frames", "Yes");
+
    initialized_ = true;
 
    return DEVICE_OK;
@@ -427,19 +703,27 @@ int MultiCamera::SnapImage()
    if (!ImageSizesAreEqual())
       return ERR_NO_EQUAL_SIZE;
 
-   CameraSnapThread t[MAX_NUMBER_PHYSICAL_CAMERAS];
-   for (unsigned int i = 0; i < physicalCameras_.size(); i++)
+   // Snap the first camera on this thread and the others on their helper
+   // threads, then wait until all cameras are done
+   int first = Logical2Physical(0);
+   for (unsigned int i = first + 1; i < snapThreads_.size(); i++)
    {
-      if (physicalCameras_[i] != 0) 
+      if (snapThreads_[i])
+         snapThreads_[i]->Snap();
+   }
+
+   int ret = physicalCameras_[first]->SnapImage();
+
+   for (unsigned int i = first + 1; i < snapThreads_.size(); i++)
+   {
+      if (snapThreads_[i])
       {
-         t[i].SetCamera(physicalCameras_[i]);
-         t[i].Start();
+         int nRet = snapThreads_[i]->WaitForSnap();
+         if (ret == DEVICE_OK)
+            ret = nRet;
       }
    }
-   // I think that the CameraSnapThread destructor waits until the SnapImage function is done
-   // So, we are likely to be waiting here until all cameras are done snapping
-
-   return DEVICE_OK;
+   return ret;
 }
 
 /**
@@ -453,46 +737,17 @@ const unsigned char* MultiCamera::GetImageBuffer()
    return GetImageBuffer(0);
 }
 
+/**
+ * return the ImageBuffer of the given physical camera. SnapImage only
+ * succeeds when all cameras have the same image size, so the physical
+ * camera's buffer can be handed out without copying.
+ */
 const unsigned char* MultiCamera::GetImageBuffer(unsigned channelNr)
 {
-   // We have a vector of physicalCameras, and a vector of Strings listing the cameras
-   // we actually use.  
-   int j = -1;
-   unsigned height = GetImageHeight();
-   unsigned width = GetImageWidth();
-   unsigned pixDepth = GetImageBytesPerPixel();
-   for (unsigned int i = 0; i < physicalCameras_.size(); i++)
-   {
-      if (usedCameras_[i] != g_Undefined)
-         j++;
-      if (j == (int) channelNr)
-      {
-         unsigned thisHeight = physicalCameras_[i]->GetImageHeight();
-         unsigned thisWidth = physicalCameras_[i]->GetImageWidth();
-         if (height == thisHeight && width == thisWidth)
-            return physicalCameras_[i]->GetImageBuffer();
-         else
-         {
-            img_.Resize(width, height, pixDepth);
-            img_.ResetPixels();
-            if (width == thisWidth)
-            {
-               memcpy(img_.GetPixelsRW(), physicalCameras_[i]->GetImageBuffer(), thisHeight * thisWidth * pixDepth);
-            }
-            else 
-            {
-               // we need to copy line by line
-               const unsigned char* pixels = physicalCameras_[i]->GetImageBuffer();
-               for (unsigned i=0; i < thisHeight; i++)
-               {
-                  memcpy(img_.GetPixelsRW() + i * width, pixels + i * thisWidth, thisWidth);
-               }
-            }
-            return img_.GetPixels();
-         }
-      }
-   }
-   return 0;
+   int i = Logical2Physical(channelNr);
+   if (i < 0 || physicalCameras_[i] == 0)
+      return 0;
+   return physicalCameras_[i]->GetImageBuffer();
 }
 
 bool MultiCamera::IsCapturing()
@@ -742,10 +997,20 @@ int MultiCamera::StartSequenceAcquisition(double interval)
                  usedCameras_[i].c_str());
          physicalCameras_[i]->AddTag(MM::g_Keyword_CameraChannelIndex, usedCameras_[i].c_str(),
                  os.str().c_str());
-         
+      }
+   }
+
+   StartFrameAlignment();
+   for (unsigned int i = 0; i < physicalCameras_.size(); i++)
+   {
+      if (physicalCameras_[i] != 0)
+      {
          int ret = physicalCameras_[i]->StartSequenceAcquisition(interval);
          if (ret != DEVICE_OK)
+         {
+            StopSequenceAcquisition();
             return ret;
+         }
       }
    }
    return DEVICE_OK;
@@ -756,13 +1021,17 @@ int MultiCamera::StartSequenceAcquisition(long numImages, double interval_ms, bo
    if (nrCamerasInUse_ < 1)
       return ERR_NO_PHYSICAL_CAMERA;
 
+   StartFrameAlignment();
    for (unsigned int i = 0; i < physicalCameras_.size(); i++)
    {
       if (physicalCameras_[i] != 0)
       {
          int ret = physicalCameras_[i]->StartSequenceAcquisition(numImages, interval_ms, stopOnOverflow);
          if (ret != DEVICE_OK)
+         {
+            StopSequenceAcquisition();
             return ret;
+         }
       }
    }
    return DEVICE_OK;
@@ -778,7 +1047,10 @@ int MultiCamera::StopSequenceAcquisition()
 
          // 
          if (ret != DEVICE_OK)
+         {
+            StopFrameAlignment();
             return ret;
+         }
          std::ostringstream os;
          os << i;
          physicalCameras_[i]->AddTag(MM::g_Keyword_CameraChannelName, usedCameras_[i].c_str(),
@@ -787,9 +1059,54 @@ int MultiCamera::StopSequenceAcquisition()
                  os.str().c_str());
       }
    }
+   StopFrameAlignment();
    return DEVICE_OK;
 }
 
+/**
+ * Route the images of the physical cameras through frameAligner_ for the
+ * coming sequence acquisition
+ */
+void MultiCamera::StartFrameAlignment()
+{
+   StopFrameAlignment();
+   if (!alignFrames_ || nrCamerasInUse_ < 2)
+      return;
+
+   std::vector<MM::Camera*> cameras;
+   for (unsigned int i = 0; i < physicalCameras_.size(); i++)
+   {
+      if (physicalCameras_[i] != 0)
+         cameras.push_back(physicalCameras_[i]);
+   }
+   frameAligner_.Start(GetCoreCallback(), cameras);
+   for (unsigned int i = 0; i < cameras.size(); i++)
+      cameras[i]->SetCallback(&frameAligner_);
+}
+
+/**
+ * Give the physical cameras back their own callback. The cameras must have
+ * stopped inserting images.
+ */
+void MultiCamera::StopFrameAlignment()
+{
+   if (!frameAligner_.IsActive())
+      return;
+
+   for (unsigned int i = 0; i < physicalCameras_.size(); i++)
+   {
+      if (physicalCameras_[i] != 0)
+         physicalCameras_[i]->SetCallback(GetCoreCallback());
+   }
+   long nrUnaligned = frameAligner_.Finish();
+   if (nrUnaligned > 0)
+   {
+      std::ostringstream os;
+      os << nrUnaligned << " images could not be aligned with the images of the other cameras";
+      LogMessage(os.str().c_str());
+   }
+}
+
 int MultiCamera::GetBinning() const
 {
    int binning = 0;
@@ -880,6 +1197,8 @@ int MultiCamera::OnPhysicalCamera(MM::PropertyBase* pProp, MM::ActionType eAct,
       std::string cameraName;
       pProp->Get(cameraName);
 
+      StopFrameAlignment();
+      snapThreads_[i].reset();
       if (cameraName == g_Undefined) {
          usedCameras_[i] = g_Undefined;
          physicalCameras_[i] = 0;
@@ -894,6 +1213,7 @@ int MultiCamera::OnPhysicalCamera(MM::PropertyBase* pProp, MM::ActionType eAct,
             GetLabel(myName);
             camera->AddTag(MM::g_Keyword_CameraChannelName, myName, usedCameras_[i].c_str());
             camera->AddTag(MM::g_Keyword_CameraChannelIndex, myName, os.str().c_str());
+            snapThreads_[i].reset(new CameraSnapThread(camera));
          } else
             return ERR_INVALID_DEVICE_NAME;
       }
@@ -938,6 +1258,23 @@ int MultiCamera::OnBinning(MM::PropertyBase* pProp, MM::ActionType eAct)
    return DEVICE_OK;
 }
 
+int MultiCamera::OnAlignFrames(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(alignFrames_ ? "Yes" : "No");
+   }
+   else if (eAct == MM::AfterSet)
+   {
+      if (IsCapturing())
+         return DEVICE_CAMERA_BUSY_ACQUIRING;
+      std::string value;
+      pProp->Get(value);
+      alignFrames_ = (value == "Yes");
+   }
+   return DEVICE_OK;
+}
+
 
 /*
  * MultiStage implementation
@@ -27,8 +27,14 @@
 #include "../../MMDevice/MMDevice.h"
 #include "../../MMDevice/DeviceBase.h"
 #include "../../MMDevice/ImgBuffer.h"
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <deque>
 #include <string>
 #include <map>
+#include <vector>
 
 //////////////////////////////////////////////////////////////////////////////
 // Error codes
@@ -100,26 +106,138 @@ private:
 
 /**
  * CameraSnapThread: helper thread for MultiCamera
+ *
+ * The thread lives as long as the physical camera is assigned, and snaps
+ * whenever it is asked to, so that no thread needs to be created per snap.
  */
-class CameraSnapThread : public MMDeviceThreadBase
+class CameraSnapThread
 {
    public:
-      CameraSnapThread() :
-         camera_(0),
-         started_(false)
-      {}
+      CameraSnapThread(MM::Camera* camera);
+      ~CameraSnapThread();
 
-      ~CameraSnapThread() { if (started_) wait(); }
+      // Start a snap on the helper thread
+      void Snap();
+      // Wait for the snap started by Snap() and return its result
+      int WaitForSnap();
 
-      void SetCamera(MM::Camera* camera) { camera_ = camera; }
+   private:
+      void Run();
 
-      int svc() { camera_->SnapImage(); return 0; }
+      MM::Camera* camera_;
+      boost::mutex mutex_;
+      boost::condition_variable cond_;
+      bool snapRequested_;
+      bool snapping_;
+      bool quit_;
+      int result_;
+      boost::thread thread_;
+};
 
-      void Start() { activate(); started_ = true; }
+/**
+ * SequenceFrameAligner: Core callback used by MultiCamera during sequence
+ * acquisitions
+ *
+ * While a sequence runs, MultiCamera installs this as the callback of its
+ * physical cameras. Images are passed on to the Core one camera at a time, in
+ * camera order, so that the n-th images of all cameras are inserted next to
+ * each other whatever order they arrive in. Images of the camera that
+ * completes a set are passed on without copying; the others wait in a copy.
+ * All other calls are forwarded to the Core unchanged.
+ */
+class SequenceFrameAligner : public MM::Core
+{
+public:
+   SequenceFrameAligner();
+   ~SequenceFrameAligner();
+
+   void Start(MM::Core* core, const std::vector<MM::Camera*>& cameras);
+   // Insert the images still waiting for their set and detach from the Core.
+   // Returns the number of images that could not be aligned.
+   long Finish();
+   bool IsActive() const { return active_; }
+
+   int InsertImage(const MM::Device* caller, const ImgBuffer& buf);
+   int InsertImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents, const char* serializedMetadata, const bool doProcess = true);
+   int InsertImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, const Metadata* md = 0, const bool doProcess = true);
+   int InsertImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, const char* serializedMetadata, const bool doProcess = true);
+
+   // Forwarded unchanged
+   int LogMessage(const MM::Device* caller, const char* msg, bool debugOnly) const { return core_->LogMessage(caller, msg, debugOnly); }
+   MM::Device* GetDevice(const MM::Device* caller, const char* label) { return core_->GetDevice(caller, label); }
+   int GetDeviceProperty(const char* deviceName, const char* propName, char* value) { return core_->GetDeviceProperty(deviceName, propName, value); }
+   int SetDeviceProperty(const char* deviceName, const char* propName, const char* value) { return core_->SetDeviceProperty(deviceName, propName, value); }
+   void GetLoadedDeviceOfType(const MM::Device* caller, MM::DeviceType devType, char* pDeviceName, const unsigned int deviceIterator) { core_->GetLoadedDeviceOfType(caller, devType, pDeviceName, deviceIterator); }
+   int SetSerialProperties(const char* portName, const char* answerTimeout, const char* baudRate, const char* delayBetweenCharsMs, const char* handshaking, const char* parity, const char* stopBits) { return core_->SetSerialProperties(portName, answerTimeout, baudRate, delayBetweenCharsMs, handshaking, parity, stopBits); }
+   int SetSerialCommand(const MM::Device* caller, const char* portName, const char* command, const char* term) { return core_->SetSerialCommand(caller, portName, command, term); }
+   int GetSerialAnswer(const MM::Device* caller, const char* portName, unsigned long ansLength, char* answer, const char* term) { return core_->GetSerialAnswer(caller, portName, ansLength, answer, term); }
+   int SendSerialCommandBatch(const MM::Device* caller, const char* portName, unsigned nrCommands, const char* const* commands, const char* commandTerm, char* answers, unsigned maxAnswerChars, const char* answerTerm, const double* answerTimeoutsMs, unsigned& nrAnswers) { return core_->SendSerialCommandBatch(caller, portName, nrCommands, commands, commandTerm, answers, maxAnswerChars, answerTerm, answerTimeoutsMs, nrAnswers); }
+   int WriteToSerial(const MM::Device* caller, const char* port, const unsigned char* buf, unsigned long length) { return core_->WriteToSerial(caller, port, buf, length); }
+   int ReadFromSerial(const MM::Device* caller, const char* port, unsigned char* buf, unsigned long length, unsigned long& read) { return core_->ReadFromSerial(caller, port, buf, length, read); }
+   int PurgeSerial(const MM::Device* caller, const char* portName) { return core_->PurgeSerial(caller, portName); }
+   MM::PortType GetSerialPortType(const char* portName) const { return core_->GetSerialPortType(portName); }
+   int OnPropertiesChanged(const MM::Device* caller) { return core_->OnPropertiesChanged(caller); }
+   int OnPropertyChanged(const MM::Device* caller, const char* propName, const char* propValue) { return core_->OnPropertyChanged(caller, propName, propValue); }
+   int OnStagePositionChanged(const MM::Device* caller, double pos) { return core_->OnStagePositionChanged(caller, pos); }
+   int OnXYStagePositionChanged(const MM::Device* caller, double xPos, double yPos) { return core_->OnXYStagePositionChanged(caller, xPos, yPos); }
+   int OnExposureChanged(const MM::Device* caller, double newExposure) { return core_->OnExposureChanged(caller, newExposure); }
+   int OnExposureFinished(const MM::Device* caller) { return core_->OnExposureFinished(caller); }
+   int OnSLMExposureChanged(const MM::Device* caller, double newExposure) { return core_->OnSLMExposureChanged(caller, newExposure); }
+   int OnMagnifierChanged(const MM::Device* caller) { return core_->OnMagnifierChanged(caller); }
+   unsigned long GetClockTicksUs(const MM::Device* caller) { return core_->GetClockTicksUs(caller); }
+   MM::MMTime GetCurrentMMTime() { return core_->GetCurrentMMTime(); }
+   int AcqFinished(const MM::Device* caller, int statusCode) { return core_->AcqFinished(caller, statusCode); }
+   int PrepareForAcq(const MM::Device* caller) { return core_->PrepareForAcq(caller); }
+   void ClearImageBuffer(const MM::Device* caller) { core_->ClearImageBuffer(caller); }
+   bool InitializeImageBuffer(unsigned channels, unsigned slices, unsigned int w, unsigned int h, unsigned int pixDepth) { return core_->InitializeImageBuffer(channels, slices, w, h, pixDepth); }
+   int InsertMultiChannel(const MM::Device* caller, const unsigned char* buf, unsigned numChannels, unsigned width, unsigned height, unsigned byteDepth, Metadata* md = 0) { return core_->InsertMultiChannel(caller, buf, numChannels, width, height, byteDepth, md); }
+   const char* GetImage() { return core_->GetImage(); }
+   int GetImageDimensions(int& width, int& height, int& depth) { return core_->GetImageDimensions(width, height, depth); }
+   int GetFocusPosition(double& pos) { return core_->GetFocusPosition(pos); }
+   int SetFocusPosition(double pos) { return core_->SetFocusPosition(pos); }
+   int MoveFocus(double velocity) { return core_->MoveFocus(velocity); }
+   int SetXYPosition(double x, double y) { return core_->SetXYPosition(x, y); }
+   int GetXYPosition(double& x, double& y) { return core_->GetXYPosition(x, y); }
+   int MoveXYStage(double vX, double vY) { return core_->MoveXYStage(vX, vY); }
+   int SetExposure(double expMs) { return core_->SetExposure(expMs); }
+   int GetExposure(double& expMs) { return core_->GetExposure(expMs); }
+   int SetConfig(const char* group, const char* name) { return core_->SetConfig(group, name); }
+   int GetCurrentConfig(const char* group, int bufLen, char* name) { return core_->GetCurrentConfig(group, bufLen, name); }
+   int GetChannelConfig(char* channelConfigName, const unsigned int channelConfigIterator) { return core_->GetChannelConfig(channelConfigName, channelConfigIterator); }
+   MM::ImageProcessor* GetImageProcessor(const MM::Device* caller) { return core_->GetImageProcessor(caller); }
+   MM::AutoFocus* GetAutoFocus(const MM::Device* caller) { return core_->GetAutoFocus(caller); }
+   MM::Hub* GetParentHub(const MM::Device* caller) const { return core_->GetParentHub(caller); }
+   MM::State* GetStateDevice(const MM::Device* caller, const char* deviceName) { return core_->GetStateDevice(caller, deviceName); }
+   MM::SignalIO* GetSignalIODevice(const MM::Device* caller, const char* deviceName) { return core_->GetSignalIODevice(caller, deviceName); }
+   void NextPostedError(int& errorCode, char* pMessage, int maxlen, int& messageLength) { core_->NextPostedError(errorCode, pMessage, maxlen, messageLength); }
+   void PostError(const int errorCode, const char* message) { core_->PostError(errorCode, message); }
+   void ClearPostedErrors() { core_->ClearPostedErrors(); }
 
-   private:
-      MM::Camera* camera_;
-      bool started_;
+private:
+   struct PendingImage
+   {
+      const MM::Device* caller;
+      std::vector<unsigned char> pixels;
+      unsigned width;
+      unsigned height;
+      unsigned byteDepth;
+      unsigned nComponents;
+      std::string serializedMetadata;
+      bool doProcess;
+   };
+
+   int Channel(const MM::Device* caller) const;
+   bool CompletesSet(int channel) const;
+   void Enqueue(int channel, const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents, const std::string& serializedMetadata, bool doProcess);
+   int InsertPending(int channel);
+   int InsertPending(int firstChannel, int lastChannel);
+
+   MM::Core* core_;
+   std::vector<MM::Camera*> cameras_;
+   std::vector< std::deque<PendingImage> > pending_;
+   long nrUnaligned_;
+   bool active_;
+   MMThreadLock lock_;
 };
 
 /*
@@ -165,10 +283,13 @@ public:
    // ---------------
    int OnPhysicalCamera(MM::PropertyBase* pProp, MM::ActionType eAct, long nr);
    int OnBinning(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnAlignFrames(MM::PropertyBase* pProp, MM::ActionType eAct);
 
 private:
    int Logical2Physical(int logical);
    bool ImageSizesAreEqual();
+   void StartFrameAlignment();
+   void StopFrameAlignment();
    unsigned char* imageBuffer_;
 
    std::vector<std::string> availableCameras_;
@@ -178,7 +299,9 @@ private:
    std::vector<MM::Camera*> physicalCameras_;
    unsigned int nrCamerasInUse_;
    bool initialized_;
-   ImgBuffer img_;
+   std::vector< boost::shared_ptr<CameraSnapThread> > snapThreads_;
+   bool alignFrames_;
+   SequenceFrameAligner frameAligner_;
 };
 
 
@@ -0,0 +1,671 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          AcquisitionEngine.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Runs acquisition plans on a dedicated thread
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "AcquisitionEngine.h"
+
+#include "../MMDevice/ImageMetadata.h"
+#include "CircularBuffer.h"
+#include "CoreUtils.h"
+#include "DeviceManager.h"
+#include "Devices/DeviceInstances.h"
+#include "LogManager.h"
+#include "MMCore.h"
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <algorithm>
+#include <exception>
+
+namespace mm
+{
+
+namespace
+{
+
+void
+AddEventTags(Metadata& md, const AcquisitionEvent& event, long eventIndex)
+{
+   md.PutImageTag("FrameIndex", event.getFrameIndex());
+   md.PutImageTag("PositionIndex", event.getPositionIndex());
+   md.PutImageTag("ChannelIndex", event.getChannelIndex());
+   md.PutImageTag("SliceIndex", event.getSliceIndex());
+   md.PutImageTag("AcquisitionEventIndex", eventIndex);
+   if (event.hasConfig())
+      md.PutImageTag(event.getConfigGroup(), event.getConfigPreset());
+   if (event.hasZPosition())
+      md.PutImageTag("ZPositionUm", event.getZPosition());
+   if (event.hasXYPosition())
+   {
+      md.PutImageTag("XPositionUm", event.getXPosition());
+      md.PutImageTag("YPositionUm", event.getYPosition());
+   }
+}
+
+// The channel given by the image's own CameraChannelIndex tag, or -1
+int
+TaggedCameraChannel(Metadata& md, unsigned nrChannels)
+{
+   if (!md.HasTag(MM::g_Keyword_CameraChannelIndex))
+      return -1;
+   const MetadataSingleTag* tag =
+      md.FindTag(MM::g_Keyword_CameraChannelIndex)->ToSingleTag();
+   if (!tag)
+      return -1;
+   try
+   {
+      unsigned channel = boost::lexical_cast<unsigned>(tag->GetValue());
+      if (channel < nrChannels)
+         return static_cast<int>(channel);
+   }
+   catch (const boost::bad_lexical_cast&)
+   {
+   }
+   return -1;
+}
+
+} // anonymous namespace
+
+
+AcquisitionEngine::AcquisitionEngine(CMMCore& core) :
+   core_(core),
+   logger_(core.logManager_->NewLogger("Core:AcquisitionEngine")),
+   running_(false),
+   stopRequested_(false),
+   nrEventsDone_(0),
+   hasError_(false),
+   errorCode_(MMERR_OK),
+   burstEvents_(0),
+   burstFirstEvent_(0),
+   burstNrEvents_(0)
+{
+}
+
+
+AcquisitionEngine::~AcquisitionEngine()
+{
+   Stop();
+}
+
+
+void
+AcquisitionEngine::Start(const AcquisitionPlan& plan) throw (CMMError)
+{
+   // Reap the previous run, if any
+   if (thread_)
+   {
+      if (IsRunning())
+         throw CMMError("An acquisition plan is already running",
+               MMERR_NotAllowedDuringSequenceAcquisition);
+      thread_->join();
+      thread_.reset();
+   }
+
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   running_ = true;
+   stopRequested_ = false;
+   nrEventsDone_ = 0;
+   hasError_ = false;
+   errorMessage_.clear();
+   errorCode_ = MMERR_OK;
+
+   LOG_INFO(logger_) << "Starting acquisition plan of " <<
+      plan.getNumberOfEvents() << " events";
+   thread_.reset(new boost::thread(
+            boost::bind(&AcquisitionEngine::Run, this, plan)));
+}
+
+
+void
+AcquisitionEngine::Stop()
+{
+   {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      stopRequested_ = true;
+   }
+   stopCondition_.notify_all();
+   if (thread_)
+   {
+      thread_->join();
+      thread_.reset();
+   }
+}
+
+
+void
+AcquisitionEngine::Wait() throw (CMMError)
+{
+   if (thread_)
+   {
+      thread_->join();
+      thread_.reset();
+   }
+
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   if (hasError_)
+      throw CMMError(errorMessage_, errorCode_);
+}
+
+
+bool
+AcquisitionEngine::IsRunning() const
+{
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   return running_;
+}
+
+
+long
+AcquisitionEngine::GetNumberOfEventsDone() const
+{
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   return nrEventsDone_;
+}
+
+
+void
+AcquisitionEngine::Run(AcquisitionPlan plan)
+{
+   const std::vector<AcquisitionEvent>& events = plan.events_;
+   const boost::posix_time::ptime startTime =
+      boost::posix_time::microsec_clock::universal_time();
+
+   try
+   {
+      std::vector<SequenceBurst> bursts;
+      if (plan.getUseHardwareSequencing())
+      {
+         SequenceCapabilities capabilities =
+            QuerySequenceCapabilities(core_, events);
+         capabilities.cameraMaxLength = static_cast<long>(
+               core_.cbuf_->GetSize() / core_.getNumberOfCameraChannels());
+         bursts = PlanSequenceBursts(events, capabilities);
+      }
+      else
+      {
+         for (std::size_t i = 0; i < events.size(); ++i)
+            bursts.push_back(SequenceBurst(i));
+      }
+      LOG_DEBUG(logger_) << "Acquisition plan split into " << bursts.size() <<
+         " bursts";
+
+      AppliedSettings applied;
+      bool nextMovesStarted = false;
+      for (std::size_t b = 0; b < bursts.size(); ++b)
+      {
+         const SequenceBurst& burst = bursts[b];
+         const std::size_t i = burst.firstEvent;
+         const AcquisitionEvent& event = events[i];
+         if (!nextMovesStarted)
+            StartMoves(event, applied);
+         ApplySettings(event, applied);
+         WaitForMoves(applied);
+         nextMovesStarted = false;
+
+         const boost::posix_time::ptime deadline = startTime +
+            boost::posix_time::microseconds(static_cast<boost::int64_t>(
+                     event.getMinimumStartTime() * 1000.0));
+
+         if (burst.IsHardwareSequenced())
+         {
+            if (!RunBurst(events, burst, deadline, applied))
+               break;
+            continue;
+         }
+
+         if (!WaitUntil(deadline))
+            break;
+
+         if (plan.getOverlapMovesWithReadout() && i + 1 < events.size())
+         {
+            // Returns when the exposure has ended; the camera may still be
+            // reading out (InsertImages() waits for the image).
+            core_.startSnapImage();
+            StartMoves(events[i + 1], applied);
+            nextMovesStarted = true;
+         }
+         else
+            core_.snapImage();
+
+         if (!InsertImages(event, static_cast<long>(i)))
+            break;
+
+         boost::lock_guard<boost::mutex> lock(mutex_);
+         ++nrEventsDone_;
+         if (stopRequested_)
+            break;
+      }
+      WaitForMoves(applied);
+   }
+   catch (const CMMError& e)
+   {
+      LOG_ERROR(logger_) << "Acquisition plan stopped by error: " <<
+         e.getFullMsg();
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      hasError_ = true;
+      errorMessage_ = e.getFullMsg();
+      errorCode_ = e.getCode();
+   }
+   catch (const std::exception& e)
+   {
+      LOG_ERROR(logger_) << "Acquisition plan stopped by error: " << e.what();
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      hasError_ = true;
+      errorMessage_ = e.what();
+      errorCode_ = MMERR_UnhandledException;
+   }
+
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   LOG_INFO(logger_) << "Acquisition plan finished after " <<
+      nrEventsDone_ << " of " << events.size() << " events";
+   running_ = false;
+}
+
+
+void
+AcquisitionEngine::StartMoves(const AcquisitionEvent& event,
+      AppliedSettings& applied)
+{
+   if (event.hasZPosition() &&
+         !(applied.hasZ && applied.zUm == event.getZPosition()))
+   {
+      core_.setPosition(event.getZPosition());
+      applied.hasZ = true;
+      applied.zUm = event.getZPosition();
+      applied.zMoving = true;
+   }
+
+   if (event.hasXYPosition() &&
+         !(applied.hasXY && applied.xUm == event.getXPosition() &&
+            applied.yUm == event.getYPosition()))
+   {
+      core_.setXYPosition(event.getXPosition(), event.getYPosition());
+      applied.hasXY = true;
+      applied.xUm = event.getXPosition();
+      applied.yUm = event.getYPosition();
+      applied.xyMoving = true;
+   }
+}
+
+
+void
+AcquisitionEngine::ApplySettings(const AcquisitionEvent& event,
+      AppliedSettings& applied)
+{
+   if (event.hasConfig() &&
+         !(applied.hasConfig &&
+            applied.configGroup == event.getConfigGroup() &&
+            applied.configPreset == event.getConfigPreset()))
+   {
+      const std::string group = event.getConfigGroup();
+      const std::string preset = event.getConfigPreset();
+      core_.setConfig(group.c_str(), preset.c_str());
+      core_.waitForConfig(group.c_str(), preset.c_str());
+      applied.hasConfig = true;
+      applied.configGroup = group;
+      applied.configPreset = preset;
+   }
+
+   if (event.hasExposure() &&
+         !(applied.hasExposure && applied.exposureMs == event.getExposure()))
+   {
+      core_.setExposure(event.getExposure());
+      applied.hasExposure = true;
+      applied.exposureMs = event.getExposure();
+   }
+}
+
+
+void
+AcquisitionEngine::WaitForMoves(AppliedSettings& applied)
+{
+   if (applied.zMoving)
+   {
+      core_.waitForDevice(core_.getFocusDevice().c_str());
+      applied.zMoving = false;
+   }
+   if (applied.xyMoving)
+   {
+      core_.waitForDevice(core_.getXYStageDevice().c_str());
+      applied.xyMoving = false;
+   }
+}
+
+
+bool
+AcquisitionEngine::WaitUntil(boost::posix_time::ptime deadline)
+{
+   boost::unique_lock<boost::mutex> lock(mutex_);
+   while (!stopRequested_ &&
+         boost::posix_time::microsec_clock::universal_time() < deadline)
+      stopCondition_.timed_wait(lock, deadline);
+   return !stopRequested_;
+}
+
+
+bool
+AcquisitionEngine::InsertImages(const AcquisitionEvent& event,
+      long eventIndex)
+{
+   CircularBuffer* cbuf = core_.cbuf_;
+   const unsigned width = core_.getImageWidth();
+   const unsigned height = core_.getImageHeight();
+   const unsigned bytesPerPixel = core_.getBytesPerPixel();
+   const unsigned nrComponents = core_.getNumberOfComponents();
+   const unsigned nrChannels = core_.getNumberOfCameraChannels();
+   const std::string camera = core_.getCameraDevice();
+
+   Metadata md;
+   AddEventTags(md, event, eventIndex);
+
+   for (unsigned ch = 0; ch < nrChannels; ++ch)
+   {
+      const unsigned char* pixels =
+         static_cast<const unsigned char*>(core_.getImage(ch));
+
+      Metadata channelMd(md);
+      if (nrChannels > 1)
+      {
+         channelMd.put("Camera", core_.getCameraChannelName(ch));
+         channelMd.PutImageTag("CameraChannelIndex", ch);
+      }
+      else
+         channelMd.put("Camera", camera);
+
+      if (!WaitForBufferSpace(1))
+         return false;
+      if (!cbuf->InsertImage(pixels, width, height, bytesPerPixel,
+               nrComponents, &channelMd))
+         throw CMMError("Circular buffer overflowed during acquisition plan");
+   }
+   return true;
+}
+
+
+bool
+AcquisitionEngine::WaitForBufferSpace(unsigned long nrImages)
+{
+   // Let the consumer catch up rather than overflowing the buffer
+   while (core_.cbuf_->GetFreeSize() < nrImages)
+   {
+      if (!WaitUntil(boost::posix_time::microsec_clock::universal_time() +
+               boost::posix_time::milliseconds(1)))
+         return false;
+   }
+   return true;
+}
+
+
+bool
+AcquisitionEngine::RunBurst(const std::vector<AcquisitionEvent>& events,
+      const SequenceBurst& burst, boost::posix_time::ptime deadline,
+      AppliedSettings& applied)
+{
+   LOG_DEBUG(logger_) << "Running events " << burst.firstEvent << " to " <<
+      (burst.firstEvent + burst.nrEvents - 1) << " as a hardware sequence";
+
+   // The sequenced devices end up in an unknown state
+   if (burst.sequenceZ)
+      applied.hasZ = false;
+   if (burst.sequenceXY)
+      applied.hasXY = false;
+   if (burst.sequenceExposure)
+      applied.hasExposure = false;
+   if (!burst.properties.empty())
+      applied.hasConfig = false;
+
+   bool completed = false;
+   try
+   {
+      StartSequences(events, burst);
+      completed = WaitUntil(deadline) && RunCameraSequence(events, burst);
+   }
+   catch (const CMMError&)
+   {
+      StopSequences(burst);
+      throw;
+   }
+   StopSequences(burst);
+   return completed;
+}
+
+
+void
+AcquisitionEngine::StartSequences(const std::vector<AcquisitionEvent>& events,
+      const SequenceBurst& burst)
+{
+   const std::size_t begin = burst.firstEvent;
+   const std::size_t end = burst.firstEvent + burst.nrEvents;
+
+   if (burst.sequenceZ)
+   {
+      std::vector<double> positions;
+      for (std::size_t i = begin; i < end; ++i)
+         positions.push_back(events[i].getZPosition());
+      const std::string focus = core_.getFocusDevice();
+      core_.loadStageSequence(focus.c_str(), positions);
+      core_.startStageSequence(focus.c_str());
+   }
+   if (burst.sequenceXY)
+   {
+      std::vector<double> xPositions, yPositions;
+      for (std::size_t i = begin; i < end; ++i)
+      {
+         xPositions.push_back(events[i].getXPosition());
+         yPositions.push_back(events[i].getYPosition());
+      }
+      const std::string xyStage = core_.getXYStageDevice();
+      core_.loadXYStageSequence(xyStage.c_str(), xPositions, yPositions);
+      core_.startXYStageSequence(xyStage.c_str());
+   }
+   if (burst.sequenceExposure)
+   {
+      std::vector<double> exposures;
+      for (std::size_t i = begin; i < end; ++i)
+         exposures.push_back(events[i].getExposure());
+      const std::string camera = core_.getCameraDevice();
+      core_.loadExposureSequence(camera.c_str(), exposures);
+      core_.startExposureSequence(camera.c_str());
+   }
+   for (std::vector<PropertySequence>::const_iterator it =
+         burst.properties.begin(), end = burst.properties.end();
+         it != end; ++it)
+   {
+      core_.loadPropertySequence(it->device.c_str(), it->property.c_str(),
+            it->values);
+      core_.startPropertySequence(it->device.c_str(), it->property.c_str());
+   }
+}
+
+
+void
+AcquisitionEngine::StopSequences(const SequenceBurst& burst)
+{
+   // Best effort: a device that fails to stop must not prevent stopping the
+   // others
+   try
+   {
+      if (burst.sequenceZ)
+         core_.stopStageSequence(core_.getFocusDevice().c_str());
+   }
+   catch (const CMMError& e)
+   {
+      LOG_ERROR(logger_) << e.getFullMsg();
+   }
+   try
+   {
+      if (burst.sequenceXY)
+         core_.stopXYStageSequence(core_.getXYStageDevice().c_str());
+   }
+   catch (const CMMError& e)
+   {
+      LOG_ERROR(logger_) << e.getFullMsg();
+   }
+   try
+   {
+      if (burst.sequenceExposure)
+         core_.stopExposureSequence(core_.getCameraDevice().c_str());
+   }
+   catch (const CMMError& e)
+   {
+      LOG_ERROR(logger_) << e.getFullMsg();
+   }
+   for (std::vector<PropertySequence>::const_iterator it =
+         burst.properties.begin(), end = burst.properties.end();
+         it != end; ++it)
+   {
+      try
+      {
+         core_.stopPropertySequence(it->device.c_str(), it->property.c_str());
+      }
+      catch (const CMMError& e)
+      {
+         LOG_ERROR(logger_) << e.getFullMsg();
+      }
+   }
+}
+
+
+bool
+AcquisitionEngine::RunCameraSequence(
+      const std::vector<AcquisitionEvent>& events, const SequenceBurst& burst)
+{
+   boost::shared_ptr<CameraInstance> camera =
+      core_.currentCameraDevice_.lock();
+   if (!camera)
+      throw CMMError(core_.getCoreErrorText(MMERR_CameraNotAvailable).c_str(),
+            MMERR_CameraNotAvailable);
+
+   const unsigned nrChannels = core_.getNumberOfCameraChannels();
+   const unsigned long nrImages = burst.nrEvents * nrChannels;
+
+   // The camera stops on overflow, so make room for the whole burst first
+   if (!WaitForBufferSpace(nrImages))
+      return false;
+
+   // Multi-channel cameras may insert the images of each channel from its
+   // own physical camera (e.g. Multi Camera)
+   std::vector<std::string> channelCameras;
+   if (nrChannels > 1)
+   {
+      for (unsigned ch = 0; ch < nrChannels; ++ch)
+         channelCameras.push_back(core_.getCameraChannelName(ch));
+   }
+
+   {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      burstEvents_ = &events;
+      burstFirstEvent_ = burst.firstEvent;
+      burstNrEvents_ = burst.nrEvents;
+      burstCamera_ = camera->GetLabel();
+      burstChannelCameras_.swap(channelCameras);
+      burstNrImagesTagged_.assign(nrChannels, 0);
+   }
+
+   int nRet;
+   {
+      mm::DeviceModuleLockGuard guard(camera);
+      nRet = camera->StartSequenceAcquisition(
+            static_cast<long>(burst.nrEvents), 0.0, true);
+   }
+   if (nRet == DEVICE_OK)
+   {
+      while (core_.isSequenceRunning())
+      {
+         if (!WaitUntil(boost::posix_time::microsec_clock::universal_time() +
+                  boost::posix_time::milliseconds(1)))
+         {
+            core_.stopSequenceAcquisition();
+            break;
+         }
+      }
+   }
+
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   // Events are done once all channels have their image
+   const unsigned long nrDone = *std::min_element(
+         burstNrImagesTagged_.begin(), burstNrImagesTagged_.end());
+   burstEvents_ = 0;
+   if (nRet != DEVICE_OK)
+      throw CMMError(core_.getDeviceErrorText(nRet, camera));
+
+   nrEventsDone_ += static_cast<long>(nrDone);
+   if (stopRequested_)
+      return false;
+   if (nrDone < burst.nrEvents)
+      throw CMMError("Camera stopped after " + ToString(nrDone) + " of " +
+            ToString(burst.nrEvents) + " events of a hardware-sequenced burst");
+   return true;
+}
+
+
+void
+AcquisitionEngine::AddSequencedImageTags(Metadata& md,
+      const std::string& cameraLabel, unsigned nrChannels)
+{
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   if (!burstEvents_)
+      return;
+
+   std::vector<std::string>::const_iterator physicalCamera =
+      std::find(burstChannelCameras_.begin(), burstChannelCameras_.end(),
+            cameraLabel);
+   if (cameraLabel != burstCamera_ &&
+         physicalCamera == burstChannelCameras_.end())
+      return;
+
+   // Images of different channels may arrive in any order, so find the
+   // channel of this image and count the images of each channel separately
+   const unsigned burstNrChannels =
+      static_cast<unsigned>(burstNrImagesTagged_.size());
+   const int taggedChannel = TaggedCameraChannel(md, burstNrChannels);
+   unsigned firstChannel = 0;
+   unsigned lastChannel = 0;
+   if (nrChannels >= burstNrChannels)
+      lastChannel = burstNrChannels - 1; // All channels inserted together
+   else if (taggedChannel >= 0)
+      firstChannel = lastChannel = static_cast<unsigned>(taggedChannel);
+   else if (physicalCamera != burstChannelCameras_.end())
+      firstChannel = lastChannel = static_cast<unsigned>(
+            physicalCamera - burstChannelCameras_.begin());
+   else
+   {
+      // No way to tell; assume the channels arrive in turn
+      firstChannel = lastChannel = static_cast<unsigned>(
+            std::min_element(burstNrImagesTagged_.begin(),
+               burstNrImagesTagged_.end()) - burstNrImagesTagged_.begin());
+   }
+
+   const unsigned long nrTagged = burstNrImagesTagged_[firstChannel];
+   if (nrTagged >= burstNrEvents_)
+      return;
+
+   const std::size_t eventIndex = burstFirstEvent_ + nrTagged;
+   AddEventTags(md, (*burstEvents_)[eventIndex],
+         static_cast<long>(eventIndex));
+   if (burstNrChannels > 1 && firstChannel == lastChannel &&
+         taggedChannel < 0)
+      md.PutImageTag(MM::g_Keyword_CameraChannelIndex, firstChannel);
+   for (unsigned ch = firstChannel; ch <= lastChannel; ++ch)
+      ++burstNrImagesTagged_[ch];
+}
+
+} // namespace mm
@@ -0,0 +1,166 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          AcquisitionEngine.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Runs acquisition plans on a dedicated thread
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "AcquisitionPlan.h"
+#include "Logging/Logger.h"
+#include "SequencePlanner.h"
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/utility.hpp>
+
+#include <string>
+#include <vector>
+
+class CMMCore;
+class Metadata;
+
+namespace mm
+{
+
+/**
+ * Runs the events of an AcquisitionPlan on its own thread, inserting the
+ * images into the Core's circular buffer.
+ *
+ * For each event, the stage moves are started first, then the configuration
+ * and exposure are applied, then the engine waits for the moved stages and
+ * snaps an image. Settings equal to those of the previous event are not
+ * applied again. If the plan allows, the moves for the next event are
+ * started right after the exposure ends (see CMMCore::startSnapImage()), so
+ * that they overlap with the readout of the image.
+ *
+ * Unless the plan disables it, runs of events that the devices can sequence
+ * (see PlanSequenceBursts()) are taken as a single camera sequence instead,
+ * after loading the varying settings into the devices.
+ *
+ * Images carry the event indices (FrameIndex, PositionIndex, ChannelIndex,
+ * SliceIndex) in their metadata. When the circular buffer is full, the
+ * engine waits until images have been removed.
+ */
+class AcquisitionEngine : boost::noncopyable
+{
+public:
+   explicit AcquisitionEngine(CMMCore& core);
+   ~AcquisitionEngine();
+
+   /**
+    * Start running plan. The circular buffer must have been initialized for
+    * the current camera.
+    */
+   void Start(const AcquisitionPlan& plan) throw (CMMError);
+
+   /**
+    * Request the running plan to stop after the current event, and wait for
+    * it to stop.
+    */
+   void Stop();
+
+   /**
+    * Wait for the plan to finish. Throws the error that stopped the plan, if
+    * any.
+    */
+   void Wait() throw (CMMError);
+
+   bool IsRunning() const;
+   long GetNumberOfEventsDone() const;
+
+   /**
+    * Add the event tags to an image inserted by a camera during a
+    * hardware-sequenced burst. Called for every image inserted by any
+    * camera, with the number of channels inserted together with md; does
+    * nothing outside of bursts or for images of other cameras.
+    */
+   void AddSequencedImageTags(Metadata& md, const std::string& cameraLabel,
+         unsigned nrChannels);
+
+private:
+   // Settings applied so far during a run
+   struct AppliedSettings
+   {
+      bool hasConfig;
+      std::string configGroup;
+      std::string configPreset;
+      bool hasExposure;
+      double exposureMs;
+      bool hasZ;
+      double zUm;
+      bool hasXY;
+      double xUm;
+      double yUm;
+      bool zMoving;
+      bool xyMoving;
+
+      AppliedSettings() :
+         hasConfig(false), hasExposure(false), exposureMs(0.0),
+         hasZ(false), zUm(0.0), hasXY(false), xUm(0.0), yUm(0.0),
+         zMoving(false), xyMoving(false)
+      {}
+   };
+
+   void Run(AcquisitionPlan plan);
+   void StartMoves(const AcquisitionEvent& event, AppliedSettings& applied);
+   void ApplySettings(const AcquisitionEvent& event,
+         AppliedSettings& applied);
+   void WaitForMoves(AppliedSettings& applied);
+   // Return false if stopped while waiting
+   bool WaitUntil(boost::posix_time::ptime deadline);
+   // Return false if stopped while waiting for room in the buffer
+   bool InsertImages(const AcquisitionEvent& event, long eventIndex);
+   // Return false if stopped while waiting for room in the buffer
+   bool WaitForBufferSpace(unsigned long nrImages);
+   // Return false if stopped before the end of the burst
+   bool RunBurst(const std::vector<AcquisitionEvent>& events,
+         const SequenceBurst& burst, boost::posix_time::ptime deadline,
+         AppliedSettings& applied);
+   void StartSequences(const std::vector<AcquisitionEvent>& events,
+         const SequenceBurst& burst);
+   void StopSequences(const SequenceBurst& burst);
+   bool RunCameraSequence(const std::vector<AcquisitionEvent>& events,
+         const SequenceBurst& burst);
+
+   CMMCore& core_;
+   mm::logging::Logger logger_;
+
+   mutable boost::mutex mutex_;
+   boost::condition_variable stopCondition_;
+   boost::scoped_ptr<boost::thread> thread_;
+   bool running_;
+   bool stopRequested_;
+   long nrEventsDone_;
+   bool hasError_;
+   std::string errorMessage_;
+   int errorCode_;
+
+   // The burst whose images are being inserted by the camera, if any
+   const std::vector<AcquisitionEvent>* burstEvents_;
+   std::size_t burstFirstEvent_;
+   unsigned long burstNrEvents_;
+   std::string burstCamera_;
+   // Physical camera of each channel of a multi-channel camera
+   std::vector<std::string> burstChannelCameras_;
+   std::vector<unsigned long> burstNrImagesTagged_; // Per channel
+};
+
+} // namespace mm
@@ -0,0 +1,161 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          AcquisitionPlan.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Event list for multi-dimensional acquisitions run by the Core
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "AcquisitionPlan.h"
+
+#include "ErrorCodes.h"
+
+
+AcquisitionEvent::AcquisitionEvent() :
+   frameIndex_(0),
+   positionIndex_(0),
+   channelIndex_(0),
+   sliceIndex_(0),
+   hasExposure_(false),
+   exposureMs_(0.0),
+   hasZ_(false),
+   zUm_(0.0),
+   hasXY_(false),
+   xUm_(0.0),
+   yUm_(0.0),
+   minStartTimeMs_(0.0)
+{
+}
+
+
+AcquisitionEvent::AcquisitionEvent(int frameIndex, int positionIndex,
+      int channelIndex, int sliceIndex) :
+   frameIndex_(frameIndex),
+   positionIndex_(positionIndex),
+   channelIndex_(channelIndex),
+   sliceIndex_(sliceIndex),
+   hasExposure_(false),
+   exposureMs_(0.0),
+   hasZ_(false),
+   zUm_(0.0),
+   hasXY_(false),
+   xUm_(0.0),
+   yUm_(0.0),
+   minStartTimeMs_(0.0)
+{
+}
+
+
+void
+AcquisitionEvent::setIndices(int frameIndex, int positionIndex,
+      int channelIndex, int sliceIndex)
+{
+   frameIndex_ = frameIndex;
+   positionIndex_ = positionIndex;
+   channelIndex_ = channelIndex;
+   sliceIndex_ = sliceIndex;
+}
+
+
+void
+AcquisitionEvent::setConfig(const char* group, const char* preset)
+{
+   configGroup_ = group ? group : "";
+   configPreset_ = preset ? preset : "";
+}
+
+
+void
+AcquisitionEvent::setExposure(double exposureMs)
+{
+   hasExposure_ = true;
+   exposureMs_ = exposureMs;
+}
+
+
+void
+AcquisitionEvent::setZPosition(double zUm)
+{
+   hasZ_ = true;
+   zUm_ = zUm;
+}
+
+
+void
+AcquisitionEvent::setXYPosition(double xUm, double yUm)
+{
+   hasXY_ = true;
+   xUm_ = xUm;
+   yUm_ = yUm;
+}
+
+
+void
+AcquisitionEvent::setMinimumStartTime(double ms)
+{
+   minStartTimeMs_ = ms;
+}
+
+
+AcquisitionPlan::AcquisitionPlan() :
+   overlapMoves_(true),
+   useSequencing_(true)
+{
+}
+
+
+void
+AcquisitionPlan::addEvent(const AcquisitionEvent& event)
+{
+   events_.push_back(event);
+}
+
+
+long
+AcquisitionPlan::getNumberOfEvents() const
+{
+   return static_cast<long>(events_.size());
+}
+
+
+AcquisitionEvent
+AcquisitionPlan::getEvent(long index) const throw (CMMError)
+{
+   if (index < 0 || index >= static_cast<long>(events_.size()))
+      throw CMMError("Acquisition event index out of range",
+            MMERR_InvalidContents);
+   return events_[index];
+}
+
+
+void
+AcquisitionPlan::clear()
+{
+   events_.clear();
+}
+
+
+void
+AcquisitionPlan::setOverlapMovesWithReadout(bool overlap)
+{
+   overlapMoves_ = overlap;
+}
+
+
+void
+AcquisitionPlan::setUseHardwareSequencing(bool use)
+{
+   useSequencing_ = use;
+}
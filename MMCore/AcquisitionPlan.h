@@ -0,0 +1,152 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          AcquisitionPlan.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Event list for multi-dimensional acquisitions run by the Core
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#ifdef WIN32
+// disable exception scpecification warnings in MSVC
+#pragma warning( disable : 4290 )
+#endif
+
+#include "Error.h"
+
+#include <string>
+#include <vector>
+
+namespace mm {
+   class AcquisitionEngine;
+} // namespace mm
+
+
+/**
+ * One image of a multi-dimensional acquisition, together with the settings
+ * to apply before taking it. Designed to be wrapped by SWIG.
+ *
+ * Settings that are not set are left unchanged. The indices are not
+ * interpreted by the Core; they are attached to the image metadata
+ * (FrameIndex, PositionIndex, ChannelIndex, SliceIndex).
+ */
+class AcquisitionEvent
+{
+public:
+   AcquisitionEvent();
+   AcquisitionEvent(int frameIndex, int positionIndex, int channelIndex,
+         int sliceIndex);
+
+   void setIndices(int frameIndex, int positionIndex, int channelIndex,
+         int sliceIndex);
+   int getFrameIndex() const { return frameIndex_; }
+   int getPositionIndex() const { return positionIndex_; }
+   int getChannelIndex() const { return channelIndex_; }
+   int getSliceIndex() const { return sliceIndex_; }
+
+   /**
+    * Apply a configuration preset (e.g. the channel) before the image.
+    */
+   void setConfig(const char* group, const char* preset);
+   bool hasConfig() const { return !configGroup_.empty(); }
+   std::string getConfigGroup() const { return configGroup_; }
+   std::string getConfigPreset() const { return configPreset_; }
+
+   /**
+    * Set the exposure of the current camera.
+    */
+   void setExposure(double exposureMs);
+   bool hasExposure() const { return hasExposure_; }
+   double getExposure() const { return exposureMs_; }
+
+   /**
+    * Move the current focus device.
+    */
+   void setZPosition(double zUm);
+   bool hasZPosition() const { return hasZ_; }
+   double getZPosition() const { return zUm_; }
+
+   /**
+    * Move the current XY stage.
+    */
+   void setXYPosition(double xUm, double yUm);
+   bool hasXYPosition() const { return hasXY_; }
+   double getXPosition() const { return xUm_; }
+   double getYPosition() const { return yUm_; }
+
+   /**
+    * Do not take the image earlier than this time after the start of the
+    * acquisition (for time lapses).
+    */
+   void setMinimumStartTime(double ms);
+   double getMinimumStartTime() const { return minStartTimeMs_; }
+
+private:
+   int frameIndex_;
+   int positionIndex_;
+   int channelIndex_;
+   int sliceIndex_;
+   std::string configGroup_;
+   std::string configPreset_;
+   bool hasExposure_;
+   double exposureMs_;
+   bool hasZ_;
+   double zUm_;
+   bool hasXY_;
+   double xUm_;
+   double yUm_;
+   double minStartTimeMs_;
+};
+
+
+/**
+ * A list of acquisition events, to be run by CMMCore::startAcquisitionPlan().
+ * Designed to be wrapped by SWIG.
+ */
+class AcquisitionPlan
+{
+   friend class mm::AcquisitionEngine;
+
+public:
+   AcquisitionPlan();
+
+   void addEvent(const AcquisitionEvent& event);
+   long getNumberOfEvents() const;
+   AcquisitionEvent getEvent(long index) const throw (CMMError);
+   void clear();
+
+   /**
+    * Allow the stage moves for the next event to start as soon as the
+    * exposure of the current event has ended, while the image is still being
+    * read out and transferred (default: true).
+    */
+   void setOverlapMovesWithReadout(bool overlap);
+   bool getOverlapMovesWithReadout() const { return overlapMoves_; }
+
+   /**
+    * Allow runs of events to be taken as a single camera sequence, with the
+    * stage positions, exposures and preset properties that vary between them
+    * loaded into the devices as hardware sequences (default: true). Events
+    * that cannot be sequenced are run in software.
+    */
+   void setUseHardwareSequencing(bool use);
+   bool getUseHardwareSequencing() const { return useSequencing_; }
+
+private:
+   std::vector<AcquisitionEvent> events_;
+   bool overlapMoves_;
+   bool useSequencing_;
+};
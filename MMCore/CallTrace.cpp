@@ -0,0 +1,248 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          CallTrace.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Timing trace of device calls, exportable as Chrome trace JSON
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "CallTrace.h"
+
+#include "CoreUtils.h"
+
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <set>
+#include <vector>
+
+namespace mm
+{
+
+namespace
+{
+
+struct Event
+{
+   const char* device;
+   const char* function;
+   CallTrace::Category category;
+   boost::int64_t startUs;
+   boost::int64_t endUs;
+};
+
+// Ring buffer of one thread's events. Written by its thread; read when the
+// trace is stopped. The mutex is practically never contended.
+struct ThreadBuffer
+{
+   boost::mutex mutex;
+   unsigned threadNumber; // Used as tid in the trace
+   unsigned session; // The trace session that events belong to
+   std::size_t capacity;
+   std::vector<Event> events;
+   std::size_t nextIndex; // Ring position
+   std::size_t nrRecorded; // Including overwritten events
+};
+
+struct Registry
+{
+   boost::mutex mutex;
+   std::vector< boost::shared_ptr<ThreadBuffer> > buffers;
+   unsigned nextThreadNumber;
+   boost::int64_t startUs;
+   // Read without holding mutex when recording
+   boost::atomic<unsigned> session;
+   boost::atomic<std::size_t> maxEventsPerThread;
+
+   Registry() :
+      nextThreadNumber(1),
+      startUs(0),
+      session(0),
+      maxEventsPerThread(CallTrace::DefaultMaxEventsPerThread)
+   {}
+};
+
+// Constructed on first use (during static initialization, from the
+// initialization of g_initRegistry below, so before any threads are started).
+Registry& GetRegistry()
+{
+   static Registry registry;
+   return registry;
+}
+Registry& g_initRegistry = GetRegistry();
+
+// The thread's entry in the registry (which keeps its own reference, so that
+// the events of a thread are kept after the thread exits).
+boost::thread_specific_ptr< boost::shared_ptr<ThreadBuffer> >&
+ThreadBufferPtr()
+{
+   static boost::thread_specific_ptr< boost::shared_ptr<ThreadBuffer> > ptr;
+   return ptr;
+}
+boost::thread_specific_ptr< boost::shared_ptr<ThreadBuffer> >&
+   g_initThreadBufferPtr = ThreadBufferPtr();
+
+ThreadBuffer& GetThreadBuffer()
+{
+   boost::thread_specific_ptr< boost::shared_ptr<ThreadBuffer> >& ptr =
+      ThreadBufferPtr();
+   if (!ptr.get())
+   {
+      boost::shared_ptr<ThreadBuffer> buffer = boost::make_shared<ThreadBuffer>();
+      buffer->session = 0;
+      buffer->capacity = 0;
+      buffer->nextIndex = 0;
+      buffer->nrRecorded = 0;
+
+      Registry& registry = GetRegistry();
+      boost::lock_guard<boost::mutex> lock(registry.mutex);
+      buffer->threadNumber = registry.nextThreadNumber++;
+      registry.buffers.push_back(buffer);
+      ptr.reset(new boost::shared_ptr<ThreadBuffer>(buffer));
+   }
+   return **ptr;
+}
+
+const char* CategoryName(CallTrace::Category category)
+{
+   switch (category)
+   {
+      case CallTrace::CategoryDeviceCall: return "device";
+      case CallTrace::CategoryLockWait: return "lock";
+      default: return "other";
+   }
+}
+
+} // anonymous namespace
+
+
+boost::atomic<bool> CallTrace::running_(false);
+
+
+void
+CallTrace::Start(std::size_t maxEventsPerThread)
+{
+   Registry& registry = GetRegistry();
+   boost::lock_guard<boost::mutex> lock(registry.mutex);
+
+   // Forget the buffers of threads that have exited
+   std::vector< boost::shared_ptr<ThreadBuffer> > live;
+   for (std::size_t i = 0; i < registry.buffers.size(); ++i)
+   {
+      if (!registry.buffers[i].unique())
+         live.push_back(registry.buffers[i]);
+   }
+   registry.buffers.swap(live);
+
+   // Buffers are cleared lazily, when first written in the new session
+   registry.maxEventsPerThread = maxEventsPerThread > 0 ? maxEventsPerThread : 1;
+   ++registry.session;
+   registry.startUs = UTCMicrosecondsNow();
+   running_ = true;
+}
+
+
+void
+CallTrace::Stop(std::ostream& json)
+{
+   Registry& registry = GetRegistry();
+   boost::lock_guard<boost::mutex> lock(registry.mutex);
+   if (!running_)
+      return;
+   running_ = false;
+
+   std::size_t nrDropped = 0;
+   bool first = true;
+   json << "{\"traceEvents\":[";
+   for (std::size_t i = 0; i < registry.buffers.size(); ++i)
+   {
+      ThreadBuffer& buffer = *registry.buffers[i];
+      boost::lock_guard<boost::mutex> bufferLock(buffer.mutex);
+      if (buffer.session != registry.session.load())
+         continue;
+
+      if (buffer.nrRecorded > buffer.events.size())
+         nrDropped += buffer.nrRecorded - buffer.events.size();
+
+      // Oldest first
+      const std::size_t nrEvents = buffer.events.size();
+      const std::size_t firstIndex =
+         (buffer.nrRecorded > nrEvents) ? buffer.nextIndex : 0;
+      for (std::size_t j = 0; j < nrEvents; ++j)
+      {
+         const Event& e = buffer.events[(firstIndex + j) % nrEvents];
+         json << (first ? "\n" : ",\n");
+         first = false;
+         json << "{\"name\":" << ToJSONString(e.function) <<
+            ",\"cat\":\"" << CategoryName(e.category) << "\"" <<
+            ",\"ph\":\"X\"" <<
+            ",\"ts\":" << (e.startUs - registry.startUs) <<
+            ",\"dur\":" << (e.endUs - e.startUs) <<
+            ",\"pid\":1,\"tid\":" << buffer.threadNumber <<
+            ",\"args\":{\"device\":" << ToJSONString(e.device) << "}}";
+      }
+   }
+   json << "\n],\"displayTimeUnit\":\"ms\"" <<
+      ",\"otherData\":{\"droppedEvents\":" << nrDropped << "}}\n";
+}
+
+
+const char*
+CallTrace::InternLabel(const std::string& label)
+{
+   // As with log component labels, strings are never removed, so pointers to
+   // them stay valid.
+   static boost::mutex mutex;
+   static std::set<std::string> strings;
+
+   boost::lock_guard<boost::mutex> lock(mutex);
+   return strings.insert(label).first->c_str();
+}
+
+
+void
+CallTrace::Record(const char* device, const char* function,
+      Category category, boost::int64_t startUs, boost::int64_t endUs)
+{
+   if (!IsRunning())
+      return;
+
+   ThreadBuffer& buffer = GetThreadBuffer();
+   boost::lock_guard<boost::mutex> lock(buffer.mutex);
+
+   // A span that straddles a restart is attributed to the new session.
+   Registry& registry = GetRegistry();
+   const unsigned session = registry.session;
+   if (buffer.session != session)
+   {
+      buffer.session = session;
+      buffer.capacity = registry.maxEventsPerThread;
+      buffer.events.clear();
+      buffer.events.reserve(buffer.capacity);
+      buffer.nextIndex = 0;
+      buffer.nrRecorded = 0;
+   }
+
+   Event e = { device, function, category, startUs, endUs };
+   if (buffer.events.size() < buffer.capacity)
+      buffer.events.push_back(e);
+   else
+      buffer.events[buffer.nextIndex] = e;
+   buffer.nextIndex = (buffer.nextIndex + 1) % buffer.capacity;
+   ++buffer.nrRecorded;
+}
+
+} // namespace mm
@@ -0,0 +1,162 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          CallTrace.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Timing trace of device calls, exportable as Chrome trace JSON
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "LocalClock.h"
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+namespace mm
+{
+
+/**
+ * Process-wide recorder of timed spans (device calls and module lock waits).
+ *
+ * While a trace is running, each thread records spans into its own ring
+ * buffer; when the buffer is full, the oldest spans are overwritten. Stopping
+ * the trace writes the spans of all threads in the Chrome trace event format
+ * (JSON), which can be viewed with chrome://tracing or Perfetto.
+ *
+ * Recording is skipped with a single atomic load while no trace is running.
+ */
+class CallTrace
+{
+public:
+   enum Category
+   {
+      CategoryDeviceCall,
+      CategoryLockWait
+   };
+
+   static const std::size_t DefaultMaxEventsPerThread = 65536;
+
+   /**
+    * Start a trace, discarding any previously recorded spans.
+    */
+   static void Start(std::size_t maxEventsPerThread = DefaultMaxEventsPerThread);
+
+   /**
+    * Stop the trace and write the recorded spans as JSON.
+    *
+    * Nothing is written if no trace was running.
+    */
+   static void Stop(std::ostream& json);
+
+   static bool IsRunning()
+   { return running_.load(boost::memory_order_relaxed); }
+
+   /**
+    * Return a copy of label that stays valid for the life of the process.
+    */
+   static const char* InternLabel(const std::string& label);
+
+   /**
+    * Record a span on the calling thread, if a trace is running.
+    *
+    * device and function must stay valid for the life of the process.
+    */
+   static void Record(const char* device, const char* function,
+         Category category, boost::int64_t startUs, boost::int64_t endUs);
+
+private:
+   static boost::atomic<bool> running_;
+};
+
+
+/**
+ * Records a span from construction to destruction (or End()), if a trace is
+ * running at construction.
+ */
+class CallSpan
+{
+   const char* device_;
+   const char* function_;
+   CallTrace::Category category_;
+   boost::int64_t startUs_;
+   mutable bool active_;
+
+public:
+   CallSpan(const char* device, const char* function,
+         CallTrace::Category category = CallTrace::CategoryDeviceCall) :
+      device_(device),
+      function_(function),
+      category_(category),
+      startUs_(0),
+      active_(CallTrace::IsRunning())
+   {
+      if (active_)
+         startUs_ = UTCMicrosecondsNow();
+   }
+
+   // The copy takes over recording the span, so that spans can be returned
+   // by value (see TracedCall).
+   CallSpan(const CallSpan& other) :
+      device_(other.device_),
+      function_(other.function_),
+      category_(other.category_),
+      startUs_(other.startUs_),
+      active_(other.active_)
+   { other.active_ = false; }
+
+   ~CallSpan() { End(); }
+
+   void End()
+   {
+      if (!active_)
+         return;
+      active_ = false;
+      CallTrace::Record(device_, function_, category_, startUs_,
+            UTCMicrosecondsNow());
+   }
+
+private:
+   CallSpan& operator=(const CallSpan&);
+};
+
+
+/**
+ * Pointer wrapper recording a span for the member function call made
+ * through it.
+ *
+ * Usage: TracedCall<MM::Stage>(pStage, label, "Home")->Home(); the temporary
+ * lives until the end of the full expression, i.e. until the call returns.
+ */
+template <typename T>
+class TracedCall
+{
+   T* impl_;
+   CallSpan span_;
+
+public:
+   TracedCall(T* impl, const char* device, const char* function) :
+      impl_(impl),
+      span_(device, function)
+   {}
+
+   T* operator->() const { return impl_; }
+};
+
+} // namespace mm
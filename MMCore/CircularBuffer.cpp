@@ -41,10 +41,9 @@ CircularBuffer::CircularBuffer(unsigned int memorySizeMB) :
    insertIndex_(0), 
    saveIndex_(0), 
    memorySizeMB_(memorySizeMB), 
-   overflow_(false)
+   overflow_(false),
+   timestampFormatter_(' ', mm::TimestampFormatter::FractionAlways)
 {
-   facet = new boost::posix_time::time_facet("%Y-%m-%d %H:%M:%s");
-   tStream.imbue(std::locale(tStream.getloc(), facet));
 }
 
 CircularBuffer::~CircularBuffer() {}
@@ -53,7 +52,7 @@ bool CircularBuffer::Initialize(unsigned channels, unsigned int w, unsigned int
 {
    MMThreadGuard guard(g_bufferLock);
    imageNumbers_.clear();
-   boost::posix_time::ptime t = boost::posix_time::microsec_clock::local_time();
+   boost::posix_time::ptime t = mm::LocalTimeNow();
    startTime_ = GetMMTimeNow(t);
 
    bool ret = true;
@@ -119,7 +118,7 @@ void CircularBuffer::Clear()
    insertIndex_=0; 
    saveIndex_=0; 
    overflow_ = false;
-   boost::posix_time::ptime t = boost::posix_time::microsec_clock::local_time();
+   boost::posix_time::ptime t = mm::LocalTimeNow();
    startTime_ = GetMMTimeNow(t);
    imageNumbers_.clear();
 }
@@ -206,59 +205,76 @@ bool CircularBuffer::InsertMultiChannel(const unsigned char* pixArray, unsigned
  
           if (pMd)
           {
-             // TODO: the same metadata is inserted for each channel ???
-             // Perhaps we need to add specific tags to each channel
              md = *pMd;
           }
+      }
 
-         std::string cameraName = md.GetSingleTag("Camera").GetValue();
-         if (imageNumbers_.end() == imageNumbers_.find(cameraName))
-         {
-            imageNumbers_[cameraName] = 0;
-         }
+      // The channels share the given metadata; tell them apart
+      if (numChannels > 1)
+         md.PutImageTag(MM::g_Keyword_CameraChannelIndex, i);
+      CompleteMetadata(md, width, height, byteDepth, nComponents);
+      pImg->SetMetadata(md);
+      pImg->SetPixels(pixArray + i*singleChannelSize);
+   }
 
-         // insert image number. 
-         md.put(MM::g_Keyword_Metadata_ImageNumber, CDeviceUtils::ConvertToString(imageNumbers_[cameraName]));
-         ++imageNumbers_[cameraName];
-      }
+   {
+      MMThreadGuard guard(g_bufferLock);
 
-      boost::posix_time::ptime t = boost::posix_time::microsec_clock::local_time();
-      if (!md.HasTag(MM::g_Keyword_Elapsed_Time_ms))
+      imageCounter_++;
+      insertIndex_++;
+      if ((insertIndex_ - (long)frameArray_.size()) > adjustThreshold && (saveIndex_- (long)frameArray_.size()) > adjustThreshold)
       {
-         // if time tag was not supplied by the camera insert current timestamp
-         MM::MMTime timestamp = GetMMTimeNow(t);
-         md.PutImageTag(MM::g_Keyword_Elapsed_Time_ms, CDeviceUtils::ConvertToString((timestamp - startTime_).getMsec()));
+         // adjust buffer indices to avoid overflowing integer size
+         insertIndex_ -= adjustThreshold;
+         saveIndex_ -= adjustThreshold;
       }
-      tStream << t;
-      md.PutImageTag(MM::g_Keyword_Metadata_TimeInCore, tStream.str().c_str());
-      tStream.str(std::string());
-      tStream.clear();
-
-      md.PutImageTag("Width",width);
-      md.PutImageTag("Height",height);
-      if (byteDepth == 1)
-         md.PutImageTag("PixelType","GRAY8");
-      else if (byteDepth == 2)
-         md.PutImageTag("PixelType","GRAY16");
-      else if (byteDepth == 4)
-      {
-         if (nComponents == 1)
-            md.PutImageTag("PixelType","GRAY32");
-         else
-            md.PutImageTag("PixelType","RGB32");
+   }
+
+   return true;
+}
+ 
+
+/**
+* Inserts a multi-channel frame assembled by the caller, by exchanging it with
+* the next free frame in the buffer; no pixels are copied. The metadata of
+* each channel is completed as for the other insert functions. On return,
+* frame holds the images of the buffer frame it replaced, for reuse.
+*/
+bool CircularBuffer::InsertFrame(mm::FrameBuffer& frame, unsigned nComponents) throw (CMMError)
+{
+   MMThreadGuard guard(g_insertLock);
+
+   {
+      MMThreadGuard guard(g_bufferLock);
+
+      if (frame.Width() != width_ || frame.Height() != height_ || frame.Depth() != pixDepth_)
+         throw CMMError("Incompatible image dimensions in the circular buffer", MMERR_CircularBufferIncompatibleImage);
+
+      bool overflowed = (insertIndex_ - saveIndex_) >= static_cast<long>(frameArray_.size());
+      if (overflowed) {
+         overflow_ = true;
+         return false;
       }
-      else if (byteDepth == 8)
-         md.PutImageTag("PixelType","RGB64");
-      else
-         md.PutImageTag("PixelType","Unknown"); 
+   }
 
+   for (unsigned i = 0; i < frame.NumberOfChannels(); i++)
+   {
+      mm::ImgBuffer* pImg = frame.FindImage(i);
+      if (!pImg)
+         continue;
+      Metadata md = pImg->GetMetadata();
+      CompleteMetadata(md, frame.Width(), frame.Height(), frame.Depth(), nComponents);
       pImg->SetMetadata(md);
-      pImg->SetPixels(pixArray + i*singleChannelSize);
    }
 
    {
       MMThreadGuard guard(g_bufferLock);
 
+      mm::FrameBuffer& slot = frameArray_[insertIndex_ % frameArray_.size()];
+      slot.Swap(frame);
+      // Keep every frame able to take numChannels_ channels
+      slot.Preallocate(numChannels_);
+
       imageCounter_++;
       insertIndex_++;
       if ((insertIndex_ - (long)frameArray_.size()) > adjustThreshold && (saveIndex_- (long)frameArray_.size()) > adjustThreshold)
@@ -271,7 +287,55 @@ bool CircularBuffer::InsertMultiChannel(const unsigned char* pixArray, unsigned
 
    return true;
 }
- 
+
+/**
+* Adds the image number, timing, size and pixel type tags to the metadata of
+* an image about to be inserted.
+*/
+void CircularBuffer::CompleteMetadata(Metadata& md, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents)
+{
+   {
+      MMThreadGuard guard(g_bufferLock);
+
+      std::string cameraName = md.GetSingleTag("Camera").GetValue();
+      if (imageNumbers_.end() == imageNumbers_.find(cameraName))
+      {
+         imageNumbers_[cameraName] = 0;
+      }
+
+      // insert image number. 
+      md.put(MM::g_Keyword_Metadata_ImageNumber, CDeviceUtils::ConvertToString(imageNumbers_[cameraName]));
+      ++imageNumbers_[cameraName];
+   }
+
+   boost::posix_time::ptime t = mm::LocalTimeNow();
+   if (!md.HasTag(MM::g_Keyword_Elapsed_Time_ms))
+   {
+      // if time tag was not supplied by the camera insert current timestamp
+      MM::MMTime timestamp = GetMMTimeNow(t);
+      md.PutImageTag(MM::g_Keyword_Elapsed_Time_ms, CDeviceUtils::ConvertToString((timestamp - startTime_).getMsec()));
+   }
+   md.PutImageTag(MM::g_Keyword_Metadata_TimeInCore,
+         timestampFormatter_.Format(t).c_str());
+
+   md.PutImageTag("Width",width);
+   md.PutImageTag("Height",height);
+   if (byteDepth == 1)
+      md.PutImageTag("PixelType","GRAY8");
+   else if (byteDepth == 2)
+      md.PutImageTag("PixelType","GRAY16");
+   else if (byteDepth == 4)
+   {
+      if (nComponents == 1)
+         md.PutImageTag("PixelType","GRAY32");
+      else
+         md.PutImageTag("PixelType","RGB32");
+   }
+   else if (byteDepth == 8)
+      md.PutImageTag("PixelType","RGB64");
+   else
+      md.PutImageTag("PixelType","Unknown"); 
+}
 
 const unsigned char* CircularBuffer::GetTopImage() const
 {
@@ -328,3 +392,19 @@ const mm::ImgBuffer* CircularBuffer::GetNextImageBuffer(unsigned channel)
    ++saveIndex_;
    return frameArray_[targetIndex].FindImage(channel);
 }
+
+/**
+* Like GetNextImageBuffer(), but leaves the frame in the buffer, so that the
+* other channels of a multi-channel frame can be read before it is removed.
+*/
+const mm::ImgBuffer* CircularBuffer::PeekNextImageBuffer(unsigned channel) const
+{
+   MMThreadGuard guard(g_bufferLock);
+
+   long availableImages = insertIndex_ - saveIndex_;
+   if (availableImages < 1)
+      return 0;
+
+   long targetIndex = saveIndex_ % frameArray_.size();
+   return frameArray_[targetIndex].FindImage(channel);
+}
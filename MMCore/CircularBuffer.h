@@ -27,6 +27,7 @@
 #include "Error.h"
 #include "ErrorCodes.h"
 #include "FrameBuffer.h"
+#include "LocalClock.h"
 
 #include "../MMDevice/DeviceThreads.h"
 #include "../MMDevice/MMDevice.h"
@@ -60,12 +61,14 @@ public:
    bool InsertMultiChannel(const unsigned char* pixArray, unsigned int numChannels, unsigned int width, unsigned int height, unsigned int byteDepth, const Metadata* pMd) throw (CMMError);
     bool InsertImage(const unsigned char* pixArray, unsigned int width, unsigned int height, unsigned int byteDepth, unsigned int nComponents, const Metadata* pMd) throw (CMMError);
    bool InsertMultiChannel(const unsigned char* pixArray, unsigned int numChannels, unsigned int width, unsigned int height, unsigned int byteDepth, unsigned int nComponents, const Metadata* pMd) throw (CMMError);
+   bool InsertFrame(mm::FrameBuffer& frame, unsigned int nComponents) throw (CMMError);
    const unsigned char* GetTopImage() const;
    const unsigned char* GetNextImage();
    const mm::ImgBuffer* GetTopImageBuffer(unsigned channel) const;
    const mm::ImgBuffer* GetNthFromTopImageBuffer(unsigned long n) const;
    const mm::ImgBuffer* GetNthFromTopImageBuffer(long n, unsigned channel) const;
    const mm::ImgBuffer* GetNextImageBuffer(unsigned channel);
+   const mm::ImgBuffer* PeekNextImageBuffer(unsigned channel) const;
    void Clear(); 
 
    bool Overflow() {MMThreadGuard guard(g_bufferLock); return overflow_;}
@@ -74,6 +77,8 @@ public:
    mutable MMThreadLock g_insertLock;
 
 private:
+   void CompleteMetadata(Metadata& md, unsigned int width, unsigned int height, unsigned int byteDepth, unsigned int nComponents);
+
    unsigned int width_;
    unsigned int height_;
    unsigned int pixDepth_;
@@ -92,6 +97,5 @@ private:
    bool overflow_;
    std::vector<mm::FrameBuffer> frameArray_;
 
-   boost::posix_time::time_facet * facet;
-   std::ostringstream tStream;
+   mm::TimestampFormatter timestampFormatter_;
 };
@@ -44,6 +44,7 @@ public:
    void Define(const char* configName)
    {
       configs_[configName];
+      ++generation_;
    }
 
 	/**
@@ -53,6 +54,7 @@ public:
    {
       PropertySetting setting(deviceLabel, propName, value);
       configs_[configName].addSetting(setting);
+      ++generation_;
 	}
 
    /**
@@ -67,6 +69,15 @@ public:
          return &(it->second);
    }
 
+   const T* Find(const char* configName) const
+   {
+      typename std::map<std::string,T>::const_iterator it = configs_.find(configName);
+      if (it == configs_.end())
+         return 0;
+      else
+         return &(it->second);
+   }
+
     /**
     * Renames a preset (addressed by old name).
     */
@@ -82,6 +93,7 @@ public:
 	  
 	  configs_[newConfigName] = it->second;
       configs_.erase(it->first);
+      ++generation_;
       return true;
    }
 
@@ -98,6 +110,7 @@ public:
       if (it == configs_.end())
          return false;
       configs_.erase(configName);
+      ++generation_;
       return true;
    }
 
@@ -117,6 +130,7 @@ public:
 	  
 	  // Delete the specified property
       configs_[configName].deleteSetting(deviceLabel,propName);
+      ++generation_;
 	  return true;
    }
 
@@ -138,11 +152,19 @@ public:
       return configs_.size() == 0;
    }
 
+   /**
+    * Returns a counter that is incremented whenever presets are defined,
+    * renamed, or deleted, so that derived data can be rebuilt only when
+    * needed.
+    */
+   unsigned long GetGeneration() const { return generation_; }
+
 protected:
-   ConfigGroupBase() {}
+   ConfigGroupBase() : generation_(0) {}
    virtual ~ConfigGroupBase() {}
 
    std::map<std::string, T> configs_;
+   unsigned long generation_;
 };
 
 
@@ -158,7 +180,7 @@ class ConfigGroup : public ConfigGroupBase<Configuration>
  */
 class ConfigGroupCollection {
 public:
-   ConfigGroupCollection() {}
+   ConfigGroupCollection() : generation_(0) {}
    ~ConfigGroupCollection() {}
 
    /**
@@ -167,6 +189,7 @@ public:
    void Define(const char* groupName, const char* configName)
    {
       groups_[groupName].Define(configName);
+      ++generation_;
    }
 
    /**
@@ -175,6 +198,7 @@ public:
    void Define(const char* groupName, const char* configName, const char* deviceLabel, const char* propName, const char* value)
    {
       groups_[groupName].Define(configName, deviceLabel, propName, value);
+      ++generation_;
    }
 
    /**
@@ -186,6 +210,7 @@ public:
       if (it == groups_.end())
       {
          groups_[groupName]; // effectively inserts an empty group
+         ++generation_;
          return true;
       }
       else
@@ -204,6 +229,15 @@ public:
          return it->second.Find(configName);
    }
 
+   const Configuration* Find(const char* groupName, const char* configName) const
+   {
+      std::map<std::string, ConfigGroup>::const_iterator it = groups_.find(groupName);
+      if (it == groups_.end())
+         return 0;
+      else
+         return it->second.Find(configName);
+   }
+
    /**
     * Checks if group exists.
     */
@@ -232,6 +266,7 @@ public:
             return false; // group not found
          if (it->second.Rename(oldConfigName, newConfigName))
          {
+            ++generation_;
             // NOTE: changed to not remove empty groups, N.A. 1.31.2006
             // check if the config group is empty, and if so remove it
             //if (it->second.IsEmpty())
@@ -259,6 +294,7 @@ public:
          return false; // group not found
       if (it->second.Delete(configName, deviceLabel, propName))
       {
+         ++generation_;
          return true;
       }
       else
@@ -280,6 +316,7 @@ public:
          return false; // group not found
       if (it->second.Delete(configName))
       {
+         ++generation_;
          // NOTE: changed to not remove empty groups, N.A. 1.31.2006
          // check if the config group is empty, and if so remove it
          //if (it->second.IsEmpty())
@@ -303,6 +340,7 @@ public:
       if (it != groups_.end())
       {
          groups_.erase(it->first);
+         ++generation_;
          return true;
       }
       return false; //not found
@@ -324,6 +362,7 @@ public:
          {
             groups_[newGroupName] = it->second;
             groups_.erase(it->first);
+            ++generation_;
             return true;
          }
          return false; //not found
@@ -366,11 +405,19 @@ public:
    void Clear()
    {
       groups_.clear();
+      ++generation_;
    }
 
+   /**
+    * Returns a counter that is incremented whenever groups or presets are
+    * defined, renamed, or deleted.
+    */
+   unsigned long GetGeneration() const { return generation_; }
+
 
 private:
    std::map<std::string, ConfigGroup> groups_;
+   unsigned long generation_;
 };
 
 /**
@@ -425,6 +472,7 @@ public:
    {
       PropertySetting setting(deviceLabel, propName, value);
       configs_[resolutionID].addSetting(setting);
+      ++generation_;
       if (configs_[resolutionID].getPixelSizeUm() == 0.0)
       {
          // this is the first setting, so it is OK to set pixel size
@@ -0,0 +1,127 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          ConfigPropertyIndex.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Reverse index from device properties to the configuration
+//                groups and pixel size presets that include them
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "ConfigPropertyIndex.h"
+
+#include "ConfigGroup.h"
+#include "Configuration.h"
+
+#include <algorithm>
+
+namespace mm
+{
+
+const std::vector<std::string> ConfigPropertyIndex::emptyGroupList_;
+
+
+ConfigPropertyIndex::ConfigPropertyIndex() :
+   built_(false),
+   groupsGeneration_(0),
+   pixelSizeGeneration_(0)
+{
+}
+
+
+void
+ConfigPropertyIndex::Update(const ConfigGroupCollection& configGroups,
+      const PixelSizeConfigGroup& pixelSizeGroup)
+{
+   if (built_ &&
+         configGroups.GetGeneration() == groupsGeneration_ &&
+         pixelSizeGroup.GetGeneration() == pixelSizeGeneration_)
+      return;
+
+   Rebuild(configGroups, pixelSizeGroup);
+   groupsGeneration_ = configGroups.GetGeneration();
+   pixelSizeGeneration_ = pixelSizeGroup.GetGeneration();
+   built_ = true;
+}
+
+
+void
+ConfigPropertyIndex::Rebuild(const ConfigGroupCollection& configGroups,
+      const PixelSizeConfigGroup& pixelSizeGroup)
+{
+   entries_.clear();
+
+   std::vector<std::string> groups = configGroups.GetAvailableGroups();
+   for (std::vector<std::string>::const_iterator git = groups.begin(),
+         gend = groups.end(); git != gend; ++git)
+   {
+      std::vector<std::string> presets =
+         configGroups.GetAvailableConfigs(git->c_str());
+      for (std::vector<std::string>::const_iterator pit = presets.begin(),
+            pend = presets.end(); pit != pend; ++pit)
+      {
+         const Configuration* preset =
+            configGroups.Find(git->c_str(), pit->c_str());
+         if (!preset || preset->size() <= 1)
+            continue;
+         for (size_t i = 0; i < preset->size(); ++i)
+         {
+            std::vector<std::string>& affected =
+               entries_[preset->getSetting(i).getKey()].groups;
+            if (std::find(affected.begin(), affected.end(), *git) ==
+                  affected.end())
+               affected.push_back(*git);
+         }
+      }
+   }
+
+   std::vector<std::string> pixelSizePresets = pixelSizeGroup.GetAvailable();
+   for (std::vector<std::string>::const_iterator it = pixelSizePresets.begin(),
+         end = pixelSizePresets.end(); it != end; ++it)
+   {
+      const PixelSizeConfiguration* preset = pixelSizeGroup.Find(it->c_str());
+      if (!preset)
+         continue;
+      for (size_t i = 0; i < preset->size(); ++i)
+      {
+         entries_[preset->getSetting(i).getKey()].affectsPixelSize = true;
+      }
+   }
+}
+
+
+const std::vector<std::string>&
+ConfigPropertyIndex::GetAffectedGroups(const char* device,
+      const char* property) const
+{
+   EntryMap::const_iterator found =
+      entries_.find(PropertySetting::generateKey(device, property));
+   if (found == entries_.end())
+      return emptyGroupList_;
+   return found->second.groups;
+}
+
+
+bool
+ConfigPropertyIndex::IsPixelSizeAffected(const char* device,
+      const char* property) const
+{
+   EntryMap::const_iterator found =
+      entries_.find(PropertySetting::generateKey(device, property));
+   if (found == entries_.end())
+      return false;
+   return found->second.affectsPixelSize;
+}
+
+} // namespace mm
@@ -0,0 +1,94 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          ConfigPropertyIndex.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Reverse index from device properties to the configuration
+//                groups and pixel size presets that include them
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <boost/unordered_map.hpp>
+
+#include <string>
+#include <vector>
+
+class ConfigGroupCollection;
+class PixelSizeConfigGroup;
+
+
+namespace mm
+{
+
+/**
+ * \brief Maps (device, property) to the config groups and pixel size
+ * presets that contain it.
+ *
+ * Property change notifications need to know which config groups are
+ * affected. Rather than scanning all presets on every notification, the
+ * index is rebuilt from the collections only when their contents have been
+ * changed (as indicated by their generation counters).
+ *
+ * Not thread safe; the caller must synchronize access.
+ */
+class ConfigPropertyIndex /* final */
+{
+   struct Entry
+   {
+      Entry() : affectsPixelSize(false) {}
+      std::vector<std::string> groups;
+      bool affectsPixelSize;
+   };
+   typedef boost::unordered_map<std::string, Entry> EntryMap;
+
+   EntryMap entries_;
+   bool built_;
+   unsigned long groupsGeneration_;
+   unsigned long pixelSizeGeneration_;
+
+   static const std::vector<std::string> emptyGroupList_;
+
+public:
+   ConfigPropertyIndex();
+
+   /**
+    * \brief Rebuild the index if the collections have changed since the
+    * last call.
+    */
+   void Update(const ConfigGroupCollection& configGroups,
+         const PixelSizeConfigGroup& pixelSizeGroup);
+
+   /**
+    * \brief Get the groups that have a preset (with more than one setting)
+    * including the given property.
+    *
+    * Groups whose presets all have a single setting are excluded, matching
+    * the behavior expected by the GUI for onConfigGroupChanged().
+    */
+   const std::vector<std::string>& GetAffectedGroups(const char* device,
+         const char* property) const;
+
+   /**
+    * \brief Return whether any pixel size preset includes the property.
+    */
+   bool IsPixelSizeAffected(const char* device, const char* property) const;
+
+private:
+   void Rebuild(const ConfigGroupCollection& configGroups,
+         const PixelSizeConfigGroup& pixelSizeGroup);
+};
+
+} // namespace mm
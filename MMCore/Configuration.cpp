@@ -27,8 +27,17 @@
 #include <cstring>
 #include <fstream>
 
+#include <boost/unordered_map.hpp>
+
 using namespace std;
 
+
+struct Configuration::Data
+{
+   std::vector<PropertySetting> settings;
+   boost::unordered_map<std::string, size_t> index; // Key to settings index
+};
+
 string PropertySetting::generateKey(const char* device, const char* prop)
 {
    string key(device);
@@ -58,16 +67,43 @@ bool PropertySetting::isEqualTo(const PropertySetting& ps)
 }
 
 
+const PropertySetting* Configuration::Find(const std::string& key) const
+{
+   if (!data_)
+      return 0;
+   boost::unordered_map<std::string, size_t>::const_iterator it =
+      data_->index.find(key);
+   if (it == data_->index.end())
+      return 0;
+   return &data_->settings[it->second];
+}
+
+Configuration::Data& Configuration::MutableData()
+{
+   if (!data_)
+      data_.reset(new Data());
+   else if (!data_.unique())
+      data_.reset(new Data(*data_));
+   return *data_;
+}
+
+/**
+ * Returns the number of settings.
+ */
+size_t Configuration::size() const
+{
+   return data_ ? data_->settings.size() : 0;
+}
+
 /**
   * Returns verbose description of the object's contents.
   */
 std::string Configuration::getVerbose() const
 {
    std::ostringstream txt;
-   std::vector<PropertySetting>::const_iterator it;
    txt << "<html>";
-   for (it=settings_.begin(); it!=settings_.end(); it++)
-      txt << it->getVerbose() << "<br>";
+   for (size_t i = 0; i < size(); i++)
+      txt << data_->settings[i].getVerbose() << "<br>";
    txt << "</html>";
 
    return txt.str();
@@ -78,61 +114,48 @@ std::string Configuration::getVerbose() const
  */
 PropertySetting Configuration::getSetting(size_t index) const throw (CMMError)
 {
-   if (index >= settings_.size())
+   if (index >= size())
    {
       std::ostringstream errTxt;
       errTxt << (unsigned int)index << " - invalid configuration setting index";
       throw CMMError(errTxt.str().c_str(), MMERR_DEVICE_GENERIC);
    }
-   return settings_[index];
+   return data_->settings[index];
 }
 
 /**
   * Checks whether the property is included in the  configuration.
   */
 
-bool Configuration::isPropertyIncluded(const char* device, const char* prop)
+bool Configuration::isPropertyIncluded(const char* device, const char* prop) const
 {
-   map<string, int>::iterator it = index_.find(PropertySetting::generateKey(device, prop));
-   if (it != index_.end())
-      return true;
-   else
-      return false;
+   return Find(PropertySetting::generateKey(device, prop)) != 0;
 }
 
 /**
   * Get the setting with specified device name and property name.
   */
 
-PropertySetting Configuration::getSetting(const char* device, const char* prop)
+PropertySetting Configuration::getSetting(const char* device, const char* prop) const
 {
-   map<string, int>::iterator it = index_.find(PropertySetting::generateKey(device, prop));
-   if (it == index_.end())
+   const PropertySetting* setting = Find(PropertySetting::generateKey(device, prop));
+   if (!setting)
    {
       std::ostringstream errTxt;
       errTxt << "Property " << prop << " not found in device " << device << ".";
       throw CMMError(errTxt.str().c_str(), MMERR_DEVICE_GENERIC);
    }
-   if (((unsigned int) it->second) >= settings_.size()) {
-      std::ostringstream errTxt;
-      errTxt << "Internal Error locating Property " << prop << " in device " << device << ".";
-      throw CMMError(errTxt.str().c_str(), MMERR_DEVICE_GENERIC);
-   }
-
-   return settings_[it->second];
+   return *setting;
 }
 
 /**
   * Checks whether the setting is included in the  configuration.
   */
 
-bool Configuration::isSettingIncluded(const PropertySetting& ps)
+bool Configuration::isSettingIncluded(const PropertySetting& ps) const
 {
-   map<string, int>::iterator it = index_.find(ps.getKey());
-   if (it != index_.end() && settings_[it->second].getPropertyValue().compare(ps.getPropertyValue()) == 0)
-      return true;
-   else
-      return false;
+   const PropertySetting* setting = Find(ps.getKey());
+   return setting && setting->getPropertyValue() == ps.getPropertyValue();
 }
 
 /**
@@ -141,10 +164,14 @@ bool Configuration::isSettingIncluded(const PropertySetting& ps)
   * included and that settings match
   */
 
-bool Configuration::isConfigurationIncluded(const Configuration& cfg)
+bool Configuration::isConfigurationIncluded(const Configuration& cfg) const
 {
-   vector<PropertySetting>::const_iterator it;
-   for (it=cfg.settings_.begin(); it!=cfg.settings_.end(); ++it)
+   // A configuration always includes itself (and its copies)
+   if (!cfg.data_ || cfg.data_ == data_)
+      return true;
+
+   std::vector<PropertySetting>::const_iterator it;
+   for (it=cfg.data_->settings.begin(); it!=cfg.data_->settings.end(); ++it)
       if (!isSettingIncluded(*it))
          return false;
    
@@ -156,17 +183,19 @@ bool Configuration::isConfigurationIncluded(const Configuration& cfg)
  */
 void Configuration::addSetting(const PropertySetting& setting)
 {
-   map<string, int>::iterator it = index_.find(setting.getKey());
-   if (it != index_.end())
+   Data& data = MutableData();
+   boost::unordered_map<std::string, size_t>::iterator it =
+      data.index.find(setting.getKey());
+   if (it != data.index.end())
    {
       // replace
-      settings_[it->second] = setting;
+      data.settings[it->second] = setting;
    }
    else
    {
       // add new
-      index_[setting.getKey()] = (int)settings_.size();
-      settings_.push_back(setting);
+      data.index[setting.getKey()] = data.settings.size();
+      data.settings.push_back(setting);
    }
 }
 
@@ -175,23 +204,23 @@ void Configuration::addSetting(const PropertySetting& setting)
  */
 void Configuration::deleteSetting(const char* device, const char* prop)
 {
-   map<string, int>::iterator it = index_.find(PropertySetting::generateKey(device, prop));
-   if (it == index_.end())
+   if (!isPropertyIncluded(device, prop))
    {
       std::ostringstream errTxt;
       errTxt << "Property " << prop << " not found in device " << device << ".";
       throw CMMError(errTxt.str().c_str(), MMERR_DEVICE_GENERIC);
    }
 
-   settings_.erase(settings_.begin() + it->second); // The argument of erase produces an iterator at the desired position.
+   Data& data = MutableData();
+   const size_t pos = data.index[PropertySetting::generateKey(device, prop)];
+   data.settings.erase(data.settings.begin() + pos);
 
-   // Re-index 
-   index_.clear();
-   for (unsigned int i = 0; i < settings_.size(); i++) 
+   // Re-index the settings that moved
+   data.index.erase(PropertySetting::generateKey(device, prop));
+   for (size_t i = pos; i < data.settings.size(); i++)
    {
-      index_[settings_[i].getKey()] = i;
+      data.index[data.settings[i].getKey()] = i;
    }
-
 }
 
 
@@ -32,6 +32,8 @@
 #include <map>
 #include "Error.h"
 
+#include <boost/shared_ptr.hpp>
+
 
 /**
  * Property setting defined as triplet:
@@ -119,6 +121,10 @@ private:
 /**
  * Encapsulation of the configuration information. Designed to be wrapped
  * by SWIG. A collection of configuration settings.
+ *
+ * Copies share the same (immutable) contents, so that passing and returning
+ * Configuration objects by value does not copy the settings. The contents
+ * are copied only when a shared object is modified (copy-on-write).
  */
 class Configuration
 {
@@ -133,22 +139,26 @@ public:
    void addSetting(const PropertySetting& setting);
    void deleteSetting(const char* device, const char* prop);
 
-   bool isPropertyIncluded(const char* device, const char* property);
-   bool isSettingIncluded(const PropertySetting& ps);
-   bool isConfigurationIncluded(const Configuration& cfg);
+   bool isPropertyIncluded(const char* device, const char* property) const;
+   bool isSettingIncluded(const PropertySetting& ps) const;
+   bool isConfigurationIncluded(const Configuration& cfg) const;
 
    PropertySetting getSetting(size_t index) const throw (CMMError);
-   PropertySetting getSetting(const char* device, const char* prop);
+   PropertySetting getSetting(const char* device, const char* prop) const;
    
    /**
     * Returns the number of settings.
     */
-   size_t size() const {return settings_.size();}
+   size_t size() const;
    std::string getVerbose() const;
  
 private:
-   std::vector<PropertySetting> settings_;
-   std::map<std::string, int> index_;
+   struct Data;
+   // Null when empty. Never modified while shared with another object.
+   boost::shared_ptr<Data> data_;
+
+   const PropertySetting* Find(const std::string& key) const;
+   Data& MutableData();
 };
 
 /**
@@ -28,9 +28,12 @@
 #include "../MMDevice/DeviceThreads.h"
 #include "../MMDevice/DeviceUtils.h"
 #include "../MMDevice/ImgBuffer.h"
+#include "AcquisitionEngine.h"
 #include "CircularBuffer.h"
 #include "CoreCallback.h"
 #include "DeviceManager.h"
+#include "FrameMatcher.h"
+#include "PipelinedSnap.h"
 
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <string>
@@ -205,10 +208,12 @@ CoreCallback::Sleep(const MM::Device*, double intervalMs)
 
 /**
  * Get the metadata tags attached to device caller, and merge them with metadata
- * in pMd (if not null). Returns a metadata object.
+ * in pMd (if not null). Returns a metadata object. nrChannels is the number of
+ * channels that share the metadata (more than one for InsertMultiChannel()).
  */
 Metadata
-CoreCallback::AddCameraMetadata(const MM::Device* caller, const Metadata* pMd)
+CoreCallback::AddCameraMetadata(const MM::Device* caller, const Metadata* pMd,
+      unsigned nrChannels)
 {
    Metadata newMD;
    if (pMd)
@@ -230,16 +235,44 @@ CoreCallback::AddCameraMetadata(const MM::Device* caller, const Metadata* pMd)
    }
    catch (const CMMError&)
    {
-      return newMD;
    }
 
-   Metadata devMD;
-   devMD.Restore(serializedMD.c_str());
-   newMD.Merge(devMD);
+   if (!serializedMD.empty())
+   {
+      Metadata devMD;
+      devMD.Restore(serializedMD.c_str());
+      newMD.Merge(devMD);
+   }
+
+   // Images from a burst of an acquisition plan (after the device tags,
+   // which may give the camera channel)
+   core_->acquisitionEngine_->AddSequencedImageTags(newMD, label, nrChannels);
 
    return newMD;
 }
 
+/**
+ * Images of cameras whose frames are being matched go to the frame matcher,
+ * which inserts them once matched.
+ */
+bool
+CoreCallback::InsertIntoCircularBuffer(const unsigned char* buf,
+      unsigned width, unsigned height, unsigned byteDepth,
+      unsigned nComponents, const Metadata& md)
+{
+   boost::shared_ptr<mm::FrameMatcher> matcher =
+      core_->getRunningFrameMatcher();
+   if (matcher)
+   {
+      int channel = matcher->GetChannel(md.GetSingleTag("Camera").GetValue());
+      if (channel >= 0)
+         return matcher->InsertImage(*core_->cbuf_, channel, buf, width,
+               height, byteDepth, nComponents, md);
+   }
+   return core_->cbuf_->InsertImage(buf, width, height, byteDepth,
+         nComponents, &md);
+}
+
 int CoreCallback::InsertImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, const char* serializedMetadata, const bool doProcess)
 {
    Metadata md;
@@ -251,7 +284,7 @@ int CoreCallback::InsertImage(const MM::Device* caller, const unsigned char* buf
 {
    try 
    {
-      Metadata md = AddCameraMetadata(caller, pMd);
+      Metadata md = AddCameraMetadata(caller, pMd, 1);
 
       if(doProcess)
       {
@@ -261,7 +294,7 @@ int CoreCallback::InsertImage(const MM::Device* caller, const unsigned char* buf
             ip->Process(const_cast<unsigned char*>(buf), width, height, byteDepth);
          }
       }
-      if (core_->cbuf_->InsertImage(buf, width, height, byteDepth, &md))
+      if (InsertIntoCircularBuffer(buf, width, height, byteDepth, 1, md))
          return DEVICE_OK;
       else
          return DEVICE_BUFFER_OVERFLOW;
@@ -283,7 +316,7 @@ int CoreCallback::InsertImage(const MM::Device* caller, const unsigned char* buf
 {
    try 
    {
-      Metadata md = AddCameraMetadata(caller, pMd);
+      Metadata md = AddCameraMetadata(caller, pMd, 1);
 
       if(doProcess)
       {
@@ -293,7 +326,7 @@ int CoreCallback::InsertImage(const MM::Device* caller, const unsigned char* buf
             ip->Process(const_cast<unsigned char*>(buf), width, height, byteDepth);
          }
       }
-      if (core_->cbuf_->InsertImage(buf, width, height, byteDepth, nComponents, &md))
+      if (InsertIntoCircularBuffer(buf, width, height, byteDepth, nComponents, md))
          return DEVICE_OK;
       else
          return DEVICE_BUFFER_OVERFLOW;
@@ -343,7 +376,7 @@ int CoreCallback::InsertMultiChannel(const MM::Device* caller,
 {
    try
    {
-      Metadata md = AddCameraMetadata(caller, pMd);
+      Metadata md = AddCameraMetadata(caller, pMd, numChannels);
 
       MM::ImageProcessor* ip = GetImageProcessor(caller);
       if( NULL != ip)
@@ -469,66 +502,49 @@ int CoreCallback::OnPropertyChanged(const MM::Device* device, const char* propNa
       device->GetLabel(label);
       bool readOnly;
       device->GetPropertyReadOnly(propName, readOnly);
-      const PropertySetting* ps = new PropertySetting(label, propName, value, readOnly);
+      const PropertySetting ps(label, propName, value, readOnly);
       {
          MMThreadGuard scg(core_->stateCacheLock_);
-         core_->stateCache_.addSetting(*ps);
+         core_->stateCache_.Set(ps);
       }
       core_->externalCallback_->onPropertyChanged(label, propName, value);
 
-      // Find all configs that contain this property and callback to indicate 
-      // that the config group changed
-      // TODO: Assess whether performance is better by maintaining a map tying
-      // property to configurations
-      std::vector<std::string> configGroups = 
-         core_->getAvailableConfigGroups ();
-      for (std::vector<std::string>::iterator it = configGroups.begin(); 
-            it != configGroups.end(); ++it) 
+      // Find all configs that contain this property and callback to indicate
+      // that the config group changed. The index is only rebuilt when
+      // config groups or pixel size presets have been modified.
+      configPropertyIndex_.Update(*core_->configGroups_,
+            *core_->pixelSizeGroup_);
+
+      // Copy, since the callbacks below may reenter and update the index
+      const std::vector<std::string> configGroups =
+         configPropertyIndex_.GetAffectedGroups(label, propName);
+      for (std::vector<std::string>::const_iterator it = configGroups.begin();
+            it != configGroups.end(); ++it)
       {
-         std::vector<std::string> configs = 
-            core_->getAvailableConfigs((*it).c_str());
-         bool found = false;
-         for (std::vector<std::string>::iterator itc = configs.begin();
-               itc != configs.end() && !found; itc++) 
-         {
-            Configuration config = 
-               core_->getConfigData((*it).c_str(), (*itc).c_str());
-            // only callback when there is more than 1 property in a group
-            // This is needed, since the UI treats groups with one 
-            // property differently, whereas the core does not....
-            if (config.size() > 1 && config.isPropertyIncluded(label, propName)) {
-               found = true;
-               // If we are part of this configuration, notify that it 
-               // was changed. Get the new config from cache rather 
-               // than by querying the hardware
-               std::string currentConfig = 
-                  core_->getCurrentConfigFromCache( (*it).c_str() );
-               OnConfigGroupChanged((*it).c_str(), currentConfig.c_str());
-            }
-         }
+         // Only groups in which the property appears in a preset with more
+         // than 1 property are indexed. This is needed, since the UI treats
+         // groups with one property differently, whereas the core does
+         // not....
+         // Get the new config from cache rather than by querying the
+         // hardware
+         std::string currentConfig =
+            core_->getCurrentConfigFromCache( (*it).c_str() );
+         OnConfigGroupChanged((*it).c_str(), currentConfig.c_str());
       }
-          
 
       // Check if pixel size was potentially affected.  If so, update from cache
-      std::vector<std::string> pixelSizeConfigs = core_->getAvailablePixelSizeConfigs();
-      bool found = false;
-      for (std::vector<std::string>::iterator itpsc = pixelSizeConfigs.begin();
-            itpsc != pixelSizeConfigs.end() && !found; itpsc++) 
+      if (configPropertyIndex_.IsPixelSizeAffected(label, propName))
       {
-         Configuration pixelSizeConfig = core_->getPixelSizeConfigData( (*itpsc).c_str());
-         if (pixelSizeConfig.isPropertyIncluded(label, propName)) {
-            found = true;
-            double pixSizeUm;
-            try {
-               // update pixel size from cache
-               pixSizeUm = core_->getPixelSizeUm(true);
-               OnPixelSizeAffineChanged(core_->getPixelSizeAffine(true));
-            }
-            catch (CMMError ) {
-               pixSizeUm = 0.0;
-            }
-            OnPixelSizeChanged(pixSizeUm);
+         double pixSizeUm;
+         try {
+            // update pixel size from cache
+            pixSizeUm = core_->getPixelSizeUm(true);
+            OnPixelSizeAffineChanged(core_->getPixelSizeAffine(true));
+         }
+         catch (CMMError ) {
+            pixSizeUm = 0.0;
          }
+         OnPixelSizeChanged(pixSizeUm);
       }
    }
 
@@ -619,6 +635,15 @@ int CoreCallback::OnExposureChanged(const MM::Device* device, double newExposure
    return DEVICE_OK;
 }
 
+/**
+ * Handler for the end of a camera's exposure (during SnapImage())
+ */
+int CoreCallback::OnExposureFinished(const MM::Device* device)
+{
+   core_->pipelinedSnap_->ExposureFinished(device);
+   return DEVICE_OK;
+}
+
 /**
  * Handler for SLM exposure update
  * 
@@ -796,6 +821,46 @@ int CoreCallback::GetSerialAnswer(const MM::Device*, const char* portName, unsig
    return DEVICE_OK;
 }
 
+/**
+ * Sends a batch of commands to the port and receives one answer per command.
+ * Commands are written back-to-back, so that the round trips overlap on
+ * devices that accept several commands in flight.
+ */
+int CoreCallback::SendSerialCommandBatch(const MM::Device* caller,
+      const char* portName, unsigned nrCommands, const char* const* commands,
+      const char* commandTerm, char* answers, unsigned maxAnswerChars,
+      const char* answerTerm, const double* answerTimeoutsMs,
+      unsigned& nrAnswers)
+{
+   nrAnswers = 0;
+   if (!commands || (nrCommands > 0 && !answers))
+      return DEVICE_INVALID_INPUT_PARAM;
+   if (!answerTerm || answerTerm[0] == '\0')
+      return DEVICE_INVALID_INPUT_PARAM; // cannot delimit the answers
+
+   boost::shared_ptr<SerialInstance> pSerial;
+   try
+   {
+      pSerial = core_->deviceManager_->GetDeviceOfType<SerialInstance>(portName);
+   }
+   catch (CMMError& err)
+   {
+      return err.getCode();
+   }
+   catch (...)
+   {
+      return DEVICE_SERIAL_COMMAND_FAILED;
+   }
+
+   // don't allow self reference
+   if (pSerial->GetRawPtr() == caller)
+      return DEVICE_SELF_REFERENCE;
+
+   return pSerial->SendCommandBatch(nrCommands, commands,
+         commandTerm ? commandTerm : "", answers, maxAnswerChars, answerTerm,
+         answerTimeoutsMs, nrAnswers);
+}
+
 const char* CoreCallback::GetImage()
 {
    try
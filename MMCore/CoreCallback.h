@@ -26,6 +26,7 @@
 #define _CORECALLBACK_H_
 
 #include "Devices/DeviceInstances.h"
+#include "ConfigPropertyIndex.h"
 #include "CoreUtils.h"
 #include "MMCore.h"
 #include "MMEventCallback.h"
@@ -76,6 +77,10 @@ public:
    int PurgeSerial(const MM::Device* caller, const char* portName);
    int SetSerialCommand(const MM::Device*, const char* portName, const char* command, const char* term);
    int GetSerialAnswer(const MM::Device*, const char* portName, unsigned long ansLength, char* answerTxt, const char* term);
+   int SendSerialCommandBatch(const MM::Device* caller, const char* portName,
+         unsigned nrCommands, const char* const* commands, const char* commandTerm,
+         char* answers, unsigned maxAnswerChars, const char* answerTerm,
+         const double* answerTimeoutsMs, unsigned& nrAnswers);
 
 	unsigned long GetClockTicksUs(const MM::Device* caller);
 
@@ -120,6 +125,7 @@ public:
    int OnStagePositionChanged(const MM::Device* device, double pos);
    int OnXYStagePositionChanged(const MM::Device* device, double xpos, double ypos);
    int OnExposureChanged(const MM::Device* device, double newExposure);
+   int OnExposureFinished(const MM::Device* device);
    int OnSLMExposureChanged(const MM::Device* device, double newExposure);
    int OnMagnifierChanged(const MM::Device* device);
 
@@ -141,8 +147,13 @@ public:
 private:
    CMMCore* core_;
    MMThreadLock* pValueChangeLock_;
+   mm::ConfigPropertyIndex configPropertyIndex_; // Synchronized by pValueChangeLock_
 
-   Metadata AddCameraMetadata(const MM::Device* caller, const Metadata* pMd);
+   Metadata AddCameraMetadata(const MM::Device* caller, const Metadata* pMd,
+         unsigned nrChannels);
+   bool InsertIntoCircularBuffer(const unsigned char* buf, unsigned width,
+         unsigned height, unsigned byteDepth, unsigned nComponents,
+         const Metadata& md);
 
    int OnConfigGroupChanged(const char* groupName, const char* newConfigName);
    int OnPixelSizeChanged(double newPixelSizeUm);
@@ -25,6 +25,8 @@
 
 #pragma once
 
+#include "LocalClock.h"
+
 #include "../MMDevice/MMDevice.h"
 
 // suppress hideous boost warnings
@@ -41,6 +43,9 @@
 #endif
 
 #include <boost/lexical_cast.hpp>
+#include <iomanip>
+#include <limits>
+#include <sstream>
 #include <string>
 
 
@@ -97,6 +102,50 @@ inline std::string ToQuotedString<const char*>(char const* const& d)
 }
 
 
+// Quote and escape a string for use as a JSON string value or key
+inline std::string ToJSONString(const std::string& s)
+{
+   std::string result;
+   result.reserve(s.size() + 2);
+   result += '"';
+   for (std::string::const_iterator it = s.begin(), end = s.end(); it != end; ++it)
+   {
+      const char ch = *it;
+      switch (ch)
+      {
+         case '"': result += "\\\""; break;
+         case '\\': result += "\\\\"; break;
+         case '\b': result += "\\b"; break;
+         case '\f': result += "\\f"; break;
+         case '\n': result += "\\n"; break;
+         case '\r': result += "\\r"; break;
+         case '\t': result += "\\t"; break;
+         default:
+            if (static_cast<unsigned char>(ch) < 0x20)
+            {
+               const char* const hex = "0123456789abcdef";
+               result += "\\u00";
+               result += hex[(ch >> 4) & 0xf];
+               result += hex[ch & 0xf];
+            }
+            else
+               result += ch;
+      }
+   }
+   result += '"';
+   return result;
+}
+
+// Format a number for JSON (which cannot represent NaN or infinities)
+inline std::string ToJSONNumber(double d)
+{
+   if (!(d == d) || d > (std::numeric_limits<double>::max)() ||
+         d < -(std::numeric_limits<double>::max)())
+      return "0";
+   std::ostringstream oss;
+   oss << std::setprecision(15) << d;
+   return oss.str();
+}
 //NB we are starting the 'epoch' on 2000 01 01
 inline MM::MMTime GetMMTimeNow(boost::posix_time::ptime t0)
 {
@@ -108,6 +157,6 @@ inline MM::MMTime GetMMTimeNow(boost::posix_time::ptime t0)
 //NB we are starting the 'epoch' on 2000 01 01
 inline MM::MMTime GetMMTimeNow()
 {
-   return GetMMTimeNow(boost::posix_time::microsec_clock::local_time());
+   return GetMMTimeNow(mm::LocalTimeNow());
 }
 
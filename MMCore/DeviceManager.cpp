@@ -41,13 +41,10 @@ DeviceManager::LoadDevice(boost::shared_ptr<LoadedDeviceAdapter> module,
       mm::logging::Logger deviceLogger,
       mm::logging::Logger coreLogger)
 {
-   for (DeviceConstIterator it = devices_.begin(), end = devices_.end(); it != end; ++it)
+   if (deviceLabelIndex_.find(label) != deviceLabelIndex_.end())
    {
-      if (it->first == label)
-      {
-         throw CMMError("The specified device label " + ToQuotedString(label) +
-               " is already in use", MMERR_DuplicateLabel);
-      }
+      throw CMMError("The specified device label " + ToQuotedString(label) +
+            " is already in use", MMERR_DuplicateLabel);
    }
 
    boost::shared_ptr<DeviceInstance> device = module->LoadDevice(core,
@@ -73,6 +70,9 @@ DeviceManager::LoadDevice(boost::shared_ptr<LoadedDeviceAdapter> module,
    }
 
    devices_.push_back(std::make_pair(label, device));
+   deviceLabelIndex_.insert(std::make_pair(label, device));
+   deviceTypeIndex_[MM::AnyType].push_back(label);
+   deviceTypeIndex_[device->GetType()].push_back(label);
    deviceRawPtrIndex_.insert(std::make_pair(device->GetRawPtr(), device));
    return device;
 }
@@ -89,6 +89,9 @@ DeviceManager::UnloadDevice(boost::shared_ptr<DeviceInstance> device)
       if (it->second == device)
       {
          device->Shutdown(); // TODO Should be automatic
+         RemoveFromTypeIndex(MM::AnyType, it->first);
+         RemoveFromTypeIndex(device->GetType(), it->first);
+         deviceLabelIndex_.erase(it->first);
          deviceRawPtrIndex_.erase(it->second->GetRawPtr());
          devices_.erase(it);
          break;
@@ -140,6 +143,8 @@ DeviceManager::UnloadAllDevices()
    }
 
    deviceRawPtrIndex_.clear();
+   deviceTypeIndex_.clear();
+   deviceLabelIndex_.clear();
    devices_.clear();
 
    // Now the only remaining references to the device objects should be in
@@ -155,27 +160,26 @@ DeviceManager::UnloadAllDevices()
 }
 
 
-namespace
+void
+DeviceManager::RemoveFromTypeIndex(MM::DeviceType type, const std::string& label)
 {
-   class DevicePairMatcheslabel
-   {
-      std::string s_;
-   public:
-      DevicePairMatcheslabel(const std::string& s) : s_(s) {}
-      bool operator()(const std::pair< std::string,
-            boost::shared_ptr<DeviceInstance> >& p) const
-      { return p.first == s_; }
-   };
-} // anonymous namespace
+   std::map< MM::DeviceType, std::vector<std::string> >::iterator found =
+      deviceTypeIndex_.find(type);
+   if (found == deviceTypeIndex_.end())
+      return;
+
+   std::vector<std::string>& labels = found->second;
+   labels.erase(std::remove(labels.begin(), labels.end(), label), labels.end());
+   if (labels.empty())
+      deviceTypeIndex_.erase(found);
+}
 
 
 boost::shared_ptr<DeviceInstance>
 DeviceManager::GetDevice(const std::string& label) const
 {
-   DeviceConstIterator found =
-      std::find_if(devices_.begin(), devices_.end(),
-            DevicePairMatcheslabel(label));
-   if (found == devices_.end())
+   LabelIndex::const_iterator found = deviceLabelIndex_.find(label);
+   if (found == deviceLabelIndex_.end())
    {
       throw CMMError("No device with label " + ToQuotedString(label));
    }
@@ -208,15 +212,11 @@ DeviceManager::GetDevice(const MM::Device* rawPtr) const
 std::vector<std::string>
 DeviceManager::GetDeviceList(MM::DeviceType type) const
 {
-   std::vector<std::string> labels;
-   for (DeviceConstIterator it = devices_.begin(), end = devices_.end(); it != end; ++it)
-   {
-      if (type == MM::AnyType || it->second->GetType() == type)
-      {
-         labels.push_back(it->first);
-      }
-   }
-   return labels;
+   std::map< MM::DeviceType, std::vector<std::string> >::const_iterator found =
+      deviceTypeIndex_.find(type);
+   if (found == deviceTypeIndex_.end())
+      return std::vector<std::string>();
+   return found->second;
 }
 
 
@@ -277,14 +277,12 @@ DeviceManager::GetParentDevice(boost::shared_ptr<DeviceInstance> device) const
    }
    else
    {
-      for (DeviceConstIterator it = devices_.begin(), end = devices_.end(); it != end; ++it)
+      LabelIndex::const_iterator found = deviceLabelIndex_.find(parentLabel);
+      if (found != deviceLabelIndex_.end() &&
+            found->second->GetType() == MM::HubDevice &&
+            found->second->GetAdapterModule() == device->GetAdapterModule())
       {
-         if (it->first == parentLabel &&
-               it->second->GetType() == MM::HubDevice &&
-               it->second->GetAdapterModule() == device->GetAdapterModule())
-         {
-            return boost::static_pointer_cast<HubInstance>(it->second);
-         }
+         return boost::static_pointer_cast<HubInstance>(found->second);
       }
       // TODO We should probably throw when the parent is missing.
       return boost::shared_ptr<HubInstance>();
@@ -293,8 +291,12 @@ DeviceManager::GetParentDevice(boost::shared_ptr<DeviceInstance> device) const
 
 
 DeviceModuleLockGuard::DeviceModuleLockGuard(boost::shared_ptr<DeviceInstance> device) :
+   waitSpan_(device->GetTraceLabel(), "Wait for module lock",
+         CallTrace::CategoryLockWait),
    g_(device->GetAdapterModule()->GetLock())
-{}
+{
+   waitSpan_.End();
+}
 
 
 } // namespace mm
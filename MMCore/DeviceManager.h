@@ -19,12 +19,14 @@
 
 #include "../MMDevice/MMDevice.h"
 #include "../MMDevice/DeviceThreads.h"
+#include "CallTrace.h"
 #include "CoreUtils.h"
 #include "Devices/DeviceInstance.h"
 #include "Error.h"
 #include "Logging/Logger.h"
 
 #include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
 #include <boost/weak_ptr.hpp>
 
 #include <map>
@@ -41,15 +43,25 @@ namespace mm
 
 class DeviceManager /* final */
 {
-   // Store devices in an ordered container. We could use a map or hash map to
-   // retrieve by name, but the number of devices is so small that it is not
-   // known to be worth it.
+   // Store devices in an ordered container, so that load order is preserved
+   // for listing and unloading.
    std::vector< std::pair<std::string, boost::shared_ptr<DeviceInstance> > > devices_;
    typedef std::vector< std::pair<std::string, boost::shared_ptr<DeviceInstance> > >::const_iterator
       DeviceConstIterator;
    typedef std::vector< std::pair<std::string, boost::shared_ptr<DeviceInstance> > >::iterator
       DeviceIterator;
 
+   // Label lookup is on the path of nearly every Core API call (setProperty,
+   // getProperty, waitForDevice, ...), so keep a hash index in addition to
+   // the ordered list. Must be kept in sync with devices_.
+   typedef boost::unordered_map< std::string, boost::shared_ptr<DeviceInstance> >
+      LabelIndex;
+   LabelIndex deviceLabelIndex_;
+
+   // Labels of loaded devices, by device type, in load order. The entry for
+   // MM::AnyType lists all devices. Must be kept in sync with devices_.
+   std::map< MM::DeviceType, std::vector<std::string> > deviceTypeIndex_;
+
    // Map raw device pointers to DeviceInstance objects, for those few places
    // where we need to retrieve device information from raw pointers.
    std::map< const MM::Device*, boost::weak_ptr<DeviceInstance> > deviceRawPtrIndex_;
@@ -131,12 +143,19 @@ public:
     */
    boost::shared_ptr<HubInstance> GetParentDevice(boost::shared_ptr<DeviceInstance> device) const;
    // TODO GetParentDevice() should be a DeviceInstance method.
+
+private:
+   void RemoveFromTypeIndex(MM::DeviceType type, const std::string& label);
 };
 
 
 // Scoped acquisition of a device's module's lock
+//
+// When tracing (see CallTrace), the time spent waiting for the lock is
+// recorded.
 class DeviceModuleLockGuard
 {
+   CallSpan waitSpan_; // Must be constructed before g_
    MMThreadGuard g_;
 public:
    explicit DeviceModuleLockGuard(boost::shared_ptr<DeviceInstance> device);
@@ -22,13 +22,13 @@
 #include "AutoFocusInstance.h"
 
 
-int AutoFocusInstance::SetContinuousFocusing(bool state) { return GetImpl()->SetContinuousFocusing(state); }
-int AutoFocusInstance::GetContinuousFocusing(bool& state) { return GetImpl()->GetContinuousFocusing(state); }
-bool AutoFocusInstance::IsContinuousFocusLocked() { return GetImpl()->IsContinuousFocusLocked(); }
-int AutoFocusInstance::FullFocus() { return GetImpl()->FullFocus(); }
-int AutoFocusInstance::IncrementalFocus() { return GetImpl()->IncrementalFocus(); }
-int AutoFocusInstance::GetLastFocusScore(double& score) { return GetImpl()->GetLastFocusScore(score); }
-int AutoFocusInstance::GetCurrentFocusScore(double& score) { return GetImpl()->GetCurrentFocusScore(score); }
-int AutoFocusInstance::AutoSetParameters() { return GetImpl()->AutoSetParameters(); }
-int AutoFocusInstance::GetOffset(double &offset) { return GetImpl()->GetOffset(offset); }
-int AutoFocusInstance::SetOffset(double offset) { return GetImpl()->SetOffset(offset); }
+int AutoFocusInstance::SetContinuousFocusing(bool state) { return TracedImpl("SetContinuousFocusing")->SetContinuousFocusing(state); }
+int AutoFocusInstance::GetContinuousFocusing(bool& state) { return TracedImpl("GetContinuousFocusing")->GetContinuousFocusing(state); }
+bool AutoFocusInstance::IsContinuousFocusLocked() { return TracedImpl("IsContinuousFocusLocked")->IsContinuousFocusLocked(); }
+int AutoFocusInstance::FullFocus() { return TracedImpl("FullFocus")->FullFocus(); }
+int AutoFocusInstance::IncrementalFocus() { return TracedImpl("IncrementalFocus")->IncrementalFocus(); }
+int AutoFocusInstance::GetLastFocusScore(double& score) { return TracedImpl("GetLastFocusScore")->GetLastFocusScore(score); }
+int AutoFocusInstance::GetCurrentFocusScore(double& score) { return TracedImpl("GetCurrentFocusScore")->GetCurrentFocusScore(score); }
+int AutoFocusInstance::AutoSetParameters() { return TracedImpl("AutoSetParameters")->AutoSetParameters(); }
+int AutoFocusInstance::GetOffset(double &offset) { return TracedImpl("GetOffset")->GetOffset(offset); }
+int AutoFocusInstance::SetOffset(double offset) { return TracedImpl("SetOffset")->SetOffset(offset); }
@@ -22,51 +22,51 @@
 #include "CameraInstance.h"
 
 
-int CameraInstance::SnapImage() { return GetImpl()->SnapImage(); }
-const unsigned char* CameraInstance::GetImageBuffer() { return GetImpl()->GetImageBuffer(); }
-const unsigned char* CameraInstance::GetImageBuffer(unsigned channelNr) { return GetImpl()->GetImageBuffer(channelNr); }
-const unsigned int* CameraInstance::GetImageBufferAsRGB32() { return GetImpl()->GetImageBufferAsRGB32(); }
-unsigned CameraInstance::GetNumberOfComponents() const { return GetImpl()->GetNumberOfComponents(); }
+int CameraInstance::SnapImage() { return TracedImpl("SnapImage")->SnapImage(); }
+const unsigned char* CameraInstance::GetImageBuffer() { return TracedImpl("GetImageBuffer")->GetImageBuffer(); }
+const unsigned char* CameraInstance::GetImageBuffer(unsigned channelNr) { return TracedImpl("GetImageBuffer")->GetImageBuffer(channelNr); }
+const unsigned int* CameraInstance::GetImageBufferAsRGB32() { return TracedImpl("GetImageBufferAsRGB32")->GetImageBufferAsRGB32(); }
+unsigned CameraInstance::GetNumberOfComponents() const { return TracedImpl("GetNumberOfComponents")->GetNumberOfComponents(); }
 
 std::string CameraInstance::GetComponentName(unsigned component)
 {
    DeviceStringBuffer nameBuf(this, "GetComponentName");
-   int err = GetImpl()->GetComponentName(component, nameBuf.GetBuffer());
+   int err = TracedImpl("GetComponentName")->GetComponentName(component, nameBuf.GetBuffer());
    ThrowIfError(err, "Cannot get component name at index " +
          ToString(component));
    return nameBuf.Get();
 }
 
-int unsigned CameraInstance::GetNumberOfChannels() const { return GetImpl()->GetNumberOfChannels(); }
+int unsigned CameraInstance::GetNumberOfChannels() const { return TracedImpl("GetNumberOfChannels")->GetNumberOfChannels(); }
 
 std::string CameraInstance::GetChannelName(unsigned channel)
 {
    DeviceStringBuffer nameBuf(this, "GetChannelName");
-   int err = GetImpl()->GetChannelName(channel, nameBuf.GetBuffer());
+   int err = TracedImpl("GetChannelName")->GetChannelName(channel, nameBuf.GetBuffer());
    ThrowIfError(err, "Cannot get channel name at index " + ToString(channel));
    return nameBuf.Get();
 }
 
-long CameraInstance::GetImageBufferSize()const { return GetImpl()->GetImageBufferSize(); }
-unsigned CameraInstance::GetImageWidth() const { return GetImpl()->GetImageWidth(); }
-unsigned CameraInstance::GetImageHeight() const { return GetImpl()->GetImageHeight(); }
-unsigned CameraInstance::GetImageBytesPerPixel() const { return GetImpl()->GetImageBytesPerPixel(); }
-unsigned CameraInstance::GetBitDepth() const { return GetImpl()->GetBitDepth(); }
-double CameraInstance::GetPixelSizeUm() const { return GetImpl()->GetPixelSizeUm(); }
-int CameraInstance::GetBinning() const { return GetImpl()->GetBinning(); }
-int CameraInstance::SetBinning(int binSize) { return GetImpl()->SetBinning(binSize); }
-void CameraInstance::SetExposure(double exp_ms) { return GetImpl()->SetExposure(exp_ms); }
-double CameraInstance::GetExposure() const { return GetImpl()->GetExposure(); }
-int CameraInstance::SetROI(unsigned x, unsigned y, unsigned xSize, unsigned ySize) { return GetImpl()->SetROI(x, y, xSize, ySize); }
-int CameraInstance::GetROI(unsigned& x, unsigned& y, unsigned& xSize, unsigned& ySize) { return GetImpl()->GetROI(x, y, xSize, ySize); }
-int CameraInstance::ClearROI() { return GetImpl()->ClearROI(); }
+long CameraInstance::GetImageBufferSize()const { return TracedImpl("GetImageBufferSize")->GetImageBufferSize(); }
+unsigned CameraInstance::GetImageWidth() const { return TracedImpl("GetImageWidth")->GetImageWidth(); }
+unsigned CameraInstance::GetImageHeight() const { return TracedImpl("GetImageHeight")->GetImageHeight(); }
+unsigned CameraInstance::GetImageBytesPerPixel() const { return TracedImpl("GetImageBytesPerPixel")->GetImageBytesPerPixel(); }
+unsigned CameraInstance::GetBitDepth() const { return TracedImpl("GetBitDepth")->GetBitDepth(); }
+double CameraInstance::GetPixelSizeUm() const { return TracedImpl("GetPixelSizeUm")->GetPixelSizeUm(); }
+int CameraInstance::GetBinning() const { return TracedImpl("GetBinning")->GetBinning(); }
+int CameraInstance::SetBinning(int binSize) { return TracedImpl("SetBinning")->SetBinning(binSize); }
+void CameraInstance::SetExposure(double exp_ms) { return TracedImpl("SetExposure")->SetExposure(exp_ms); }
+double CameraInstance::GetExposure() const { return TracedImpl("GetExposure")->GetExposure(); }
+int CameraInstance::SetROI(unsigned x, unsigned y, unsigned xSize, unsigned ySize) { return TracedImpl("SetROI")->SetROI(x, y, xSize, ySize); }
+int CameraInstance::GetROI(unsigned& x, unsigned& y, unsigned& xSize, unsigned& ySize) { return TracedImpl("GetROI")->GetROI(x, y, xSize, ySize); }
+int CameraInstance::ClearROI() { return TracedImpl("ClearROI")->ClearROI(); }
 
 /**
  * Queries if the camera supports multiple simultaneous ROIs.
  */
 bool CameraInstance::SupportsMultiROI()
 {
-   return GetImpl()->SupportsMultiROI();
+   return TracedImpl("SupportsMultiROI")->SupportsMultiROI();
 }
 
 /**
@@ -76,7 +76,7 @@ bool CameraInstance::SupportsMultiROI()
  */
 bool CameraInstance::IsMultiROISet()
 {
-   return GetImpl()->IsMultiROISet();
+   return TracedImpl("IsMultiROISet")->IsMultiROISet();
 }
 
 /**
@@ -85,7 +85,7 @@ bool CameraInstance::IsMultiROISet()
  */
 int CameraInstance::GetMultiROICount(unsigned int& count)
 {
-   return GetImpl()->GetMultiROICount(count);
+   return TracedImpl("GetMultiROICount")->GetMultiROICount(count);
 }
 
 /**
@@ -101,7 +101,7 @@ int CameraInstance::SetMultiROI(const unsigned int* xs, const unsigned int* ys,
       const unsigned* widths, const unsigned int* heights,
       unsigned numROIs)
 {
-   return GetImpl()->SetMultiROI(xs, ys, widths, heights, numROIs);
+   return TracedImpl("SetMultiROI")->SetMultiROI(xs, ys, widths, heights, numROIs);
 }
 
 /**
@@ -117,14 +117,14 @@ int CameraInstance::SetMultiROI(const unsigned int* xs, const unsigned int* ys,
 int CameraInstance::GetMultiROI(unsigned* xs, unsigned* ys, unsigned* widths,
       unsigned* heights, unsigned* length)
 {
-   return GetImpl()->GetMultiROI(xs, ys, widths, heights, length);
+   return TracedImpl("GetMultiROI")->GetMultiROI(xs, ys, widths, heights, length);
 }
 
-int CameraInstance::StartSequenceAcquisition(long numImages, double interval_ms, bool stopOnOverflow) { return GetImpl()->StartSequenceAcquisition(numImages, interval_ms, stopOnOverflow); }
-int CameraInstance::StartSequenceAcquisition(double interval_ms) { return GetImpl()->StartSequenceAcquisition(interval_ms); }
-int CameraInstance::StopSequenceAcquisition() { return GetImpl()->StopSequenceAcquisition(); }
-int CameraInstance::PrepareSequenceAcqusition() { return GetImpl()->PrepareSequenceAcqusition(); }
-bool CameraInstance::IsCapturing() { return GetImpl()->IsCapturing(); }
+int CameraInstance::StartSequenceAcquisition(long numImages, double interval_ms, bool stopOnOverflow) { return TracedImpl("StartSequenceAcquisition")->StartSequenceAcquisition(numImages, interval_ms, stopOnOverflow); }
+int CameraInstance::StartSequenceAcquisition(double interval_ms) { return TracedImpl("StartSequenceAcquisition")->StartSequenceAcquisition(interval_ms); }
+int CameraInstance::StopSequenceAcquisition() { return TracedImpl("StopSequenceAcquisition")->StopSequenceAcquisition(); }
+int CameraInstance::PrepareSequenceAcqusition() { return TracedImpl("PrepareSequenceAcqusition")->PrepareSequenceAcqusition(); }
+bool CameraInstance::IsCapturing() { return TracedImpl("IsCapturing")->IsCapturing(); }
 
 std::string CameraInstance::GetTags()
 {
@@ -133,16 +133,18 @@ std::string CameraInstance::GetTags()
    // (CCameraBase takes no precaution to limit string length; it is an
    // interface bug).
    DeviceStringBuffer serializedMetadataBuf(this, "GetTags");
-   GetImpl()->GetTags(serializedMetadataBuf.GetBuffer());
+   TracedImpl("GetTags")->GetTags(serializedMetadataBuf.GetBuffer());
    return serializedMetadataBuf.Get();
 }
 
-void CameraInstance::AddTag(const char* key, const char* deviceLabel, const char* value) { return GetImpl()->AddTag(key, deviceLabel, value); }
-void CameraInstance::RemoveTag(const char* key) { return GetImpl()->RemoveTag(key); }
-int CameraInstance::IsExposureSequenceable(bool& isSequenceable) const { return GetImpl()->IsExposureSequenceable(isSequenceable); }
-int CameraInstance::GetExposureSequenceMaxLength(long& nrEvents) const { return GetImpl()->GetExposureSequenceMaxLength(nrEvents); }
-int CameraInstance::StartExposureSequence() { return GetImpl()->StartExposureSequence(); }
-int CameraInstance::StopExposureSequence() { return GetImpl()->StopExposureSequence(); }
-int CameraInstance::ClearExposureSequence() { return GetImpl()->ClearExposureSequence(); }
-int CameraInstance::AddToExposureSequence(double exposureTime_ms) { return GetImpl()->AddToExposureSequence(exposureTime_ms); }
-int CameraInstance::SendExposureSequence() const { return GetImpl()->SendExposureSequence(); }
+void CameraInstance::AddTag(const char* key, const char* deviceLabel, const char* value) { return TracedImpl("AddTag")->AddTag(key, deviceLabel, value); }
+void CameraInstance::RemoveTag(const char* key) { return TracedImpl("RemoveTag")->RemoveTag(key); }
+int CameraInstance::IsExposureSequenceable(bool& isSequenceable) const { return TracedImpl("IsExposureSequenceable")->IsExposureSequenceable(isSequenceable); }
+int CameraInstance::GetExposureSequenceMaxLength(long& nrEvents) const { return TracedImpl("GetExposureSequenceMaxLength")->GetExposureSequenceMaxLength(nrEvents); }
+int CameraInstance::StartExposureSequence() { return TracedImpl("StartExposureSequence")->StartExposureSequence(); }
+int CameraInstance::StopExposureSequence() { return TracedImpl("StopExposureSequence")->StopExposureSequence(); }
+int CameraInstance::ClearExposureSequence() { return TracedImpl("ClearExposureSequence")->ClearExposureSequence(); }
+int CameraInstance::AddToExposureSequence(double exposureTime_ms) { return TracedImpl("AddToExposureSequence")->AddToExposureSequence(exposureTime_ms); }
+int CameraInstance::SendExposureSequence() const { return TracedImpl("SendExposureSequence")->SendExposureSequence(); }
+int CameraInstance::LoadExposureSequence(const double* exposureTimes_ms, unsigned long nrExposures)
+{ return TracedImpl("LoadExposureSequence")->LoadExposureSequence(exposureTimes_ms, nrExposures); }
@@ -82,4 +82,5 @@ public:
    int ClearExposureSequence();
    int AddToExposureSequence(double exposureTime_ms);
    int SendExposureSequence() const;
+   int LoadExposureSequence(const double* exposureTimes_ms, unsigned long nrExposures);
 };
@@ -50,6 +50,7 @@ DeviceInstance::DeviceInstance(CMMCore* core,
    core_(core),
    adapter_(adapter),
    label_(label),
+   traceLabel_(mm::CallTrace::InternLabel(label)),
    deleteFunction_(deleteFunction),
    deviceLogger_(deviceLogger),
    coreLogger_(coreLogger)
@@ -143,13 +144,13 @@ DeviceInstance::GetPropertyNames() const
 
 unsigned
 DeviceInstance::GetNumberOfProperties() const
-{ return pImpl_->GetNumberOfProperties(); }
+{ return Traced(pImpl_, "GetNumberOfProperties")->GetNumberOfProperties(); }
 
 std::string
 DeviceInstance::GetProperty(const std::string& name) const
 {
    DeviceStringBuffer valueBuf(this, "GetProperty");
-   int err = pImpl_->GetProperty(name.c_str(), valueBuf.GetBuffer());
+   int err = Traced(pImpl_, "GetProperty")->GetProperty(name.c_str(), valueBuf.GetBuffer());
    ThrowIfError(err, "Cannot get value of property " +
          ToQuotedString(name));
    return valueBuf.Get();
@@ -162,7 +163,7 @@ DeviceInstance::SetProperty(const std::string& name,
    LOG_DEBUG(Logger()) << "Will set property \"" << name << "\" to \"" <<
       value << "\"";
 
-   int err = pImpl_->SetProperty(name.c_str(), value.c_str());
+   int err = Traced(pImpl_, "SetProperty")->SetProperty(name.c_str(), value.c_str());
 
    ThrowIfError(err, "Cannot set property " + ToQuotedString(name) +
          " to " + ToQuotedString(value));
@@ -173,13 +174,13 @@ DeviceInstance::SetProperty(const std::string& name,
 
 bool
 DeviceInstance::HasProperty(const std::string& name) const
-{ return pImpl_->HasProperty(name.c_str()); }
+{ return Traced(pImpl_, "HasProperty")->HasProperty(name.c_str()); }
 
 std::string
 DeviceInstance::GetPropertyName(size_t idx) const
 {
    DeviceStringBuffer nameBuf(this, "GetPropertyName");
-   bool ok = pImpl_->GetPropertyName(static_cast<unsigned>(idx), nameBuf.GetBuffer());
+   bool ok = Traced(pImpl_, "GetPropertyName")->GetPropertyName(static_cast<unsigned>(idx), nameBuf.GetBuffer());
    if (!ok)
       ThrowError("Cannot get property name at index " + ToString(idx));
    return nameBuf.Get();
@@ -189,7 +190,7 @@ bool
 DeviceInstance::GetPropertyReadOnly(const char* name) const
 {
    bool readOnly;
-   ThrowIfError(pImpl_->GetPropertyReadOnly(name, readOnly));
+   ThrowIfError(Traced(pImpl_, "GetPropertyReadOnly")->GetPropertyReadOnly(name, readOnly));
    return readOnly;
 }
 
@@ -197,7 +198,7 @@ bool
 DeviceInstance::GetPropertyInitStatus(const char* name) const
 {
    bool isPreInit;
-   ThrowIfError(pImpl_->GetPropertyInitStatus(name, isPreInit));
+   ThrowIfError(Traced(pImpl_, "GetPropertyInitStatus")->GetPropertyInitStatus(name, isPreInit));
    return isPreInit;
 }
 
@@ -205,7 +206,7 @@ bool
 DeviceInstance::HasPropertyLimits(const char* name) const
 {
    bool hasLimits;
-   ThrowIfError(pImpl_->HasPropertyLimits(name, hasLimits));
+   ThrowIfError(Traced(pImpl_, "HasPropertyLimits")->HasPropertyLimits(name, hasLimits));
    return hasLimits;
 }
 
@@ -213,7 +214,7 @@ double
 DeviceInstance::GetPropertyLowerLimit(const char* name) const
 {
    double lowLimit;
-   ThrowIfError(pImpl_->GetPropertyLowerLimit(name, lowLimit));
+   ThrowIfError(Traced(pImpl_, "GetPropertyLowerLimit")->GetPropertyLowerLimit(name, lowLimit));
    return lowLimit;
 }
 
@@ -221,7 +222,7 @@ double
 DeviceInstance::GetPropertyUpperLimit(const char* name) const
 {
    double highLimit;
-   ThrowIfError(pImpl_->GetPropertyUpperLimit(name, highLimit));
+   ThrowIfError(Traced(pImpl_, "GetPropertyUpperLimit")->GetPropertyUpperLimit(name, highLimit));
    return highLimit;
 }
 
@@ -229,19 +230,19 @@ MM::PropertyType
 DeviceInstance::GetPropertyType(const char* name) const
 {
    MM::PropertyType propType;
-   ThrowIfError(pImpl_->GetPropertyType(name, propType));
+   ThrowIfError(Traced(pImpl_, "GetPropertyType")->GetPropertyType(name, propType));
    return propType;
 }
 
 unsigned
 DeviceInstance::GetNumberOfPropertyValues(const char* propertyName) const
-{ return pImpl_->GetNumberOfPropertyValues(propertyName); }
+{ return Traced(pImpl_, "GetNumberOfPropertyValues")->GetNumberOfPropertyValues(propertyName); }
 
 std::string
 DeviceInstance::GetPropertyValueAt(const std::string& propertyName, unsigned index) const
 {
    DeviceStringBuffer valueBuf(this, "GetPropertyValueAt");
-   bool ok = pImpl_->GetPropertyValueAt(propertyName.c_str(), index,
+   bool ok = Traced(pImpl_, "GetPropertyValueAt")->GetPropertyValueAt(propertyName.c_str(), index,
          valueBuf.GetBuffer());
    if (!ok)
    {
@@ -257,7 +258,7 @@ bool
 DeviceInstance::IsPropertySequenceable(const char* name) const
 {
    bool isSequenceable;
-   ThrowIfError(pImpl_->IsPropertySequenceable(name, isSequenceable));
+   ThrowIfError(Traced(pImpl_, "IsPropertySequenceable")->IsPropertySequenceable(name, isSequenceable));
    return isSequenceable;
 }
 
@@ -265,45 +266,68 @@ long
 DeviceInstance::GetPropertySequenceMaxLength(const char* propertyName) const
 {
    long nrEvents;
-   ThrowIfError(pImpl_->GetPropertySequenceMaxLength(propertyName, nrEvents));
+   ThrowIfError(Traced(pImpl_, "GetPropertySequenceMaxLength")->GetPropertySequenceMaxLength(propertyName, nrEvents));
    return nrEvents;
 }
 
 void
 DeviceInstance::StartPropertySequence(const char* propertyName)
 {
-   ThrowIfError(pImpl_->StartPropertySequence(propertyName));
+   ThrowIfError(Traced(pImpl_, "StartPropertySequence")->StartPropertySequence(propertyName));
 }
 
 void
 DeviceInstance::StopPropertySequence(const char* propertyName)
 {
-   ThrowIfError(pImpl_->StopPropertySequence(propertyName));
+   ThrowIfError(Traced(pImpl_, "StopPropertySequence")->StopPropertySequence(propertyName));
 }
 
 void
 DeviceInstance::ClearPropertySequence(const char* propertyName)
 {
-   ThrowIfError(pImpl_->ClearPropertySequence(propertyName));
+   ThrowIfError(Traced(pImpl_, "ClearPropertySequence")->ClearPropertySequence(propertyName));
 }
 
 void
 DeviceInstance::AddToPropertySequence(const char* propertyName, const char* value)
 {
-   ThrowIfError(pImpl_->AddToPropertySequence(propertyName, value));
+   ThrowIfError(Traced(pImpl_, "AddToPropertySequence")->AddToPropertySequence(propertyName, value));
 }
 
 void
 DeviceInstance::SendPropertySequence(const char* propertyName)
 {
-   ThrowIfError(pImpl_->SendPropertySequence(propertyName));
+   ThrowIfError(Traced(pImpl_, "SendPropertySequence")->SendPropertySequence(propertyName));
+}
+
+void
+DeviceInstance::LoadPropertySequence(const char* propertyName,
+      const std::vector<std::string>& values)
+{
+   std::vector<const char*> valuePtrs;
+   valuePtrs.reserve(values.size());
+   for (std::vector<std::string>::const_iterator it = values.begin(),
+         end = values.end(); it != end; ++it)
+      valuePtrs.push_back(it->c_str());
+   ThrowIfError(Traced(pImpl_, "LoadPropertySequence")->LoadPropertySequence(propertyName,
+            valuePtrs.empty() ? 0 : &valuePtrs[0],
+            static_cast<unsigned long>(valuePtrs.size())));
+}
+
+void
+DeviceInstance::LoadNumericPropertySequence(const char* propertyName,
+      const std::vector<double>& values)
+{
+   ThrowIfError(Traced(pImpl_, "LoadNumericPropertySequence")->LoadNumericPropertySequence(propertyName,
+            values.empty() ? 0 : &values[0],
+            static_cast<unsigned long>(values.size())));
 }
 
 std::string
 DeviceInstance::GetErrorText(int code) const
 {
    DeviceStringBuffer msgBuf(this, "GetErrorText");
-   bool ok = pImpl_->GetErrorText(code, msgBuf.GetBuffer());
+   bool ok = Traced(pImpl_, "GetErrorText")->GetErrorText(code, msgBuf.GetBuffer());
    if (ok)
    {
       std::string msg = msgBuf.Get();
@@ -315,102 +339,102 @@ DeviceInstance::GetErrorText(int code) const
 
 bool
 DeviceInstance::Busy()
-{ return pImpl_->Busy(); }
+{ return Traced(pImpl_, "Busy")->Busy(); }
 
 double
 DeviceInstance::GetDelayMs() const
-{ return pImpl_->GetDelayMs(); }
+{ return Traced(pImpl_, "GetDelayMs")->GetDelayMs(); }
 
 void
 DeviceInstance::SetDelayMs(double delay)
-{ pImpl_->SetDelayMs(delay); }
+{ Traced(pImpl_, "SetDelayMs")->SetDelayMs(delay); }
 
 bool
 DeviceInstance::UsesDelay()
-{ return pImpl_->UsesDelay(); }
+{ return Traced(pImpl_, "UsesDelay")->UsesDelay(); }
 
 void
 DeviceInstance::Initialize()
 {
-   ThrowIfError(pImpl_->Initialize());
+   ThrowIfError(Traced(pImpl_, "Initialize")->Initialize());
 }
 
 void
 DeviceInstance::Shutdown()
 {
-   ThrowIfError(pImpl_->Shutdown());
+   ThrowIfError(Traced(pImpl_, "Shutdown")->Shutdown());
 }
 
 MM::DeviceType
 DeviceInstance::GetType() const
-{ return pImpl_->GetType(); }
+{ return Traced(pImpl_, "GetType")->GetType(); }
 
 std::string
 DeviceInstance::GetName() const
 {
    DeviceStringBuffer nameBuf(this, "GetName");
-   pImpl_->GetName(nameBuf.GetBuffer());
+   Traced(pImpl_, "GetName")->GetName(nameBuf.GetBuffer());
    return nameBuf.Get();
 }
 
 void
 DeviceInstance::SetCallback(MM::Core* callback)
-{ pImpl_->SetCallback(callback); }
+{ Traced(pImpl_, "SetCallback")->SetCallback(callback); }
 
 void
 DeviceInstance::AcqBefore()
 {
-   ThrowIfError(pImpl_->AcqBefore());
+   ThrowIfError(Traced(pImpl_, "AcqBefore")->AcqBefore());
 }
 
 void
 DeviceInstance::AcqAfter()
 {
-   ThrowIfError(pImpl_->AcqAfter());
+   ThrowIfError(Traced(pImpl_, "AcqAfter")->AcqAfter());
 }
 
 void
 DeviceInstance::AcqBeforeFrame()
 {
-   ThrowIfError(pImpl_->AcqBeforeFrame());
+   ThrowIfError(Traced(pImpl_, "AcqBeforeFrame")->AcqBeforeFrame());
 }
 
 void
 DeviceInstance::AcqAfterFrame()
 {
-   ThrowIfError(pImpl_->AcqAfterFrame());
+   ThrowIfError(Traced(pImpl_, "AcqAfterFrame")->AcqAfterFrame());
 }
 
 void
 DeviceInstance::AcqBeforeStack()
 {
-   ThrowIfError(pImpl_->AcqBeforeStack());
+   ThrowIfError(Traced(pImpl_, "AcqBeforeStack")->AcqBeforeStack());
 }
 
 void
 DeviceInstance::AcqAfterStack()
 {
-   ThrowIfError(pImpl_->AcqAfterStack());
+   ThrowIfError(Traced(pImpl_, "AcqAfterStack")->AcqAfterStack());
 }
 
 bool
 DeviceInstance::SupportsDeviceDetection()
 {
-    return pImpl_->SupportsDeviceDetection();
+    return Traced(pImpl_, "SupportsDeviceDetection")->SupportsDeviceDetection();
 }
 
 MM::DeviceDetectionStatus
 DeviceInstance::DetectDevice()
-{ return pImpl_->DetectDevice(); }
+{ return Traced(pImpl_, "DetectDevice")->DetectDevice(); }
 
 void
 DeviceInstance::SetParentID(const char* parentId)
-{ pImpl_->SetParentID(parentId); }
+{ Traced(pImpl_, "SetParentID")->SetParentID(parentId); }
 
 std::string
 DeviceInstance::GetParentID() const
 {
    DeviceStringBuffer nameBuf(this, "GetParentID");
-   pImpl_->GetParentID(nameBuf.GetBuffer());
+   Traced(pImpl_, "GetParentID")->GetParentID(nameBuf.GetBuffer());
    return nameBuf.Get();
 }
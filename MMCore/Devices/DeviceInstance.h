@@ -20,6 +20,7 @@
 #pragma once
 
 #include "../../MMDevice/MMDeviceConstants.h"
+#include "../CallTrace.h"
 #include "../Error.h"
 #include "../Logging/Logger.h"
 
@@ -67,6 +68,7 @@ private:
    CMMCore* core_; // Weak reference
    boost::shared_ptr<LoadedDeviceAdapter> adapter_;
    const std::string label_;
+   const char* traceLabel_; // Interned label_, for CallTrace
    std::string description_;
    DeleteDeviceFunction deleteFunction_;
    mm::logging::Logger deviceLogger_;
@@ -75,6 +77,7 @@ private:
 public:
    boost::shared_ptr<LoadedDeviceAdapter> GetAdapterModule() const /* final */ { return adapter_; }
    std::string GetLabel() const /* final */ { return label_; }
+   const char* GetTraceLabel() const /* final */ { return traceLabel_; }
    std::string GetDescription() const /* final */ { return description_; }
    void SetDescription(const std::string& description) /* final */ { description_ = description; }
 
@@ -104,6 +107,13 @@ protected:
    const mm::logging::Logger& Logger() const
    { return coreLogger_; }
 
+   // Wrap the raw device pointer to record a span for the call made through
+   // it, when tracing (see mm::CallTrace). Usage:
+   //    Traced(pImpl_, "Busy")->Busy()
+   template <typename T>
+   mm::TracedCall<T> Traced(T* impl, const char* function) const
+   { return mm::TracedCall<T>(impl, traceLabel_, function); }
+
    CMMError MakeException() const;
    CMMError MakeExceptionForCode(int code) const;
    void ThrowError(const std::string& message) const;
@@ -194,6 +204,8 @@ public:
    void ClearPropertySequence(const char* propertyName);
    void AddToPropertySequence(const char* propertyName, const char* value);
    void SendPropertySequence(const char* propertyName);
+   void LoadPropertySequence(const char* propertyName, const std::vector<std::string>& values);
+   void LoadNumericPropertySequence(const char* propertyName, const std::vector<double>& values);
    std::string GetErrorText(int code) const;
    bool Busy();
    double GetDelayMs() const;
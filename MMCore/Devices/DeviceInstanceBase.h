@@ -60,4 +60,8 @@ protected:
 
 protected:
    RawDeviceClass* GetImpl() const /* final */ { return static_cast<RawDeviceClass*>(pImpl_); }
+
+   // GetImpl(), recording a span for the call (see DeviceInstance::Traced())
+   mm::TracedCall<RawDeviceClass> TracedImpl(const char* function) const
+   { return Traced(GetImpl(), function); }
 };
@@ -22,27 +22,31 @@
 #include "GalvoInstance.h"
 
 
-int GalvoInstance::PointAndFire(double x, double y, double time_us) { return GetImpl()->PointAndFire(x, y, time_us); }
-int GalvoInstance::SetSpotInterval(double pulseInterval_us) { return GetImpl()->SetSpotInterval(pulseInterval_us); }
-int GalvoInstance::SetPosition(double x, double y) { return GetImpl()->SetPosition(x, y); }
-int GalvoInstance::GetPosition(double& x, double& y) { return GetImpl()->GetPosition(x, y); }
-int GalvoInstance::SetIlluminationState(bool on) { return GetImpl()->SetIlluminationState(on); }
-double GalvoInstance::GetXRange() { return GetImpl()->GetXRange(); }
-double GalvoInstance::GetXMinimum() { return GetImpl()->GetXMinimum(); }
-double GalvoInstance::GetYRange() { return GetImpl()->GetYRange(); }
-double GalvoInstance::GetYMinimum() { return GetImpl()->GetYMinimum(); }
-int GalvoInstance::AddPolygonVertex(int polygonIndex, double x, double y) { return GetImpl()->AddPolygonVertex(polygonIndex, x, y); }
-int GalvoInstance::DeletePolygons() { return GetImpl()->DeletePolygons(); }
-int GalvoInstance::RunSequence() { return GetImpl()->RunSequence(); }
-int GalvoInstance::LoadPolygons() { return GetImpl()->LoadPolygons(); }
-int GalvoInstance::SetPolygonRepetitions(int repetitions) { return GetImpl()->SetPolygonRepetitions(repetitions); }
-int GalvoInstance::RunPolygons() { return GetImpl()->RunPolygons(); }
-int GalvoInstance::StopSequence() { return GetImpl()->StopSequence(); }
+int GalvoInstance::PointAndFire(double x, double y, double time_us) { return TracedImpl("PointAndFire")->PointAndFire(x, y, time_us); }
+int GalvoInstance::SetSpotInterval(double pulseInterval_us) { return TracedImpl("SetSpotInterval")->SetSpotInterval(pulseInterval_us); }
+int GalvoInstance::SetPosition(double x, double y) { return TracedImpl("SetPosition")->SetPosition(x, y); }
+int GalvoInstance::GetPosition(double& x, double& y) { return TracedImpl("GetPosition")->GetPosition(x, y); }
+int GalvoInstance::SetIlluminationState(bool on) { return TracedImpl("SetIlluminationState")->SetIlluminationState(on); }
+double GalvoInstance::GetXRange() { return TracedImpl("GetXRange")->GetXRange(); }
+double GalvoInstance::GetXMinimum() { return TracedImpl("GetXMinimum")->GetXMinimum(); }
+double GalvoInstance::GetYRange() { return TracedImpl("GetYRange")->GetYRange(); }
+double GalvoInstance::GetYMinimum() { return TracedImpl("GetYMinimum")->GetYMinimum(); }
+int GalvoInstance::AddPolygonVertex(int polygonIndex, double x, double y) { return TracedImpl("AddPolygonVertex")->AddPolygonVertex(polygonIndex, x, y); }
+int GalvoInstance::DeletePolygons() { return TracedImpl("DeletePolygons")->DeletePolygons(); }
+int GalvoInstance::RunSequence() { return TracedImpl("RunSequence")->RunSequence(); }
+int GalvoInstance::LoadPolygons() { return TracedImpl("LoadPolygons")->LoadPolygons(); }
+int GalvoInstance::SetPolygonRepetitions(int repetitions) { return TracedImpl("SetPolygonRepetitions")->SetPolygonRepetitions(repetitions); }
+int GalvoInstance::RunPolygons() { return TracedImpl("RunPolygons")->RunPolygons(); }
+int GalvoInstance::StopSequence() { return TracedImpl("StopSequence")->StopSequence(); }
 
 std::string GalvoInstance::GetChannel()
 {
    DeviceStringBuffer nameBuf(this, "GetChannel");
-   int err = GetImpl()->GetChannel(nameBuf.GetBuffer());
+   int err = TracedImpl("GetChannel")->GetChannel(nameBuf.GetBuffer());
    ThrowIfError(err, "Cannot get current channel name");
    return nameBuf.Get();
 }
+
+int GalvoInstance::LoadScanPath(const double* xs, const double* ys,
+      const double* dwellTimes_us, long nrPoints)
+{ return TracedImpl("LoadScanPath")->LoadScanPath(xs, ys, dwellTimes_us, nrPoints); }
@@ -53,4 +53,6 @@ public:
    int RunPolygons();
    int StopSequence();
    std::string GetChannel();
+   int LoadScanPath(const double* xs, const double* ys,
+         const double* dwellTimes_us, long nrPoints);
 };
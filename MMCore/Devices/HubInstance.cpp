@@ -97,18 +97,18 @@ void HubInstance::DetectInstalledDevices()
 
    if (!hasDetectedInstalledDevices_)
    {
-      detectInstalledDevicesStatus_ = GetImpl()->DetectInstalledDevices();
+      detectInstalledDevicesStatus_ = TracedImpl("DetectInstalledDevices")->DetectInstalledDevices();
       hasDetectedInstalledDevices_ = true;
    }
    ThrowIfError(detectInstalledDevicesStatus_,
          "Failed to detect installed peripheral devices");
 }
 
-unsigned HubInstance::GetNumberOfInstalledDevices() { return GetImpl()->GetNumberOfInstalledDevices(); }
+unsigned HubInstance::GetNumberOfInstalledDevices() { return TracedImpl("GetNumberOfInstalledDevices")->GetNumberOfInstalledDevices(); }
 
 MM::Device* HubInstance::GetInstalledDevice(int devIdx)
 {
-   MM::Device* peripheral = GetImpl()->GetInstalledDevice(devIdx);
+   MM::Device* peripheral = TracedImpl("GetInstalledDevice")->GetInstalledDevice(devIdx);
    if (!peripheral)
       throw CMMError("Hub " + ToQuotedString(GetLabel()) +
             " returned a null peripheral at index " + ToString(devIdx));
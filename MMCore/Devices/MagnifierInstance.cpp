@@ -22,4 +22,4 @@
 #include "MagnifierInstance.h"
 
 
-double MagnifierInstance::GetMagnification() { return GetImpl()->GetMagnification(); }
+double MagnifierInstance::GetMagnification() { return TracedImpl("GetMagnification")->GetMagnification(); }
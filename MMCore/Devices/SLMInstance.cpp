@@ -22,26 +22,34 @@
 #include "SLMInstance.h"
 
 
-int SLMInstance::SetImage(unsigned char* pixels) { return GetImpl()->SetImage(pixels); }
-int SLMInstance::SetImage(unsigned int* pixels) { return GetImpl()->SetImage(pixels); }
-int SLMInstance::DisplayImage() { return GetImpl()->DisplayImage(); }
-int SLMInstance::SetPixelsTo(unsigned char intensity) { return GetImpl()->SetPixelsTo(intensity); }
-int SLMInstance::SetPixelsTo(unsigned char red, unsigned char green, unsigned char blue) { return GetImpl()->SetPixelsTo(red, green, blue); }
-int SLMInstance::SetExposure(double interval_ms) { return GetImpl()->SetExposure(interval_ms); }
-double SLMInstance::GetExposure() { return GetImpl()->GetExposure(); }
-unsigned SLMInstance::GetWidth() { return GetImpl()->GetWidth(); }
-unsigned SLMInstance::GetHeight() { return GetImpl()->GetHeight(); }
-unsigned SLMInstance::GetNumberOfComponents() { return GetImpl()->GetNumberOfComponents(); }
-unsigned SLMInstance::GetBytesPerPixel() { return GetImpl()->GetBytesPerPixel(); }
+int SLMInstance::SetImage(unsigned char* pixels) { return TracedImpl("SetImage")->SetImage(pixels); }
+int SLMInstance::SetImage(unsigned int* pixels) { return TracedImpl("SetImage")->SetImage(pixels); }
+int SLMInstance::DisplayImage() { return TracedImpl("DisplayImage")->DisplayImage(); }
+int SLMInstance::SetPixelsTo(unsigned char intensity) { return TracedImpl("SetPixelsTo")->SetPixelsTo(intensity); }
+int SLMInstance::SetPixelsTo(unsigned char red, unsigned char green, unsigned char blue) { return TracedImpl("SetPixelsTo")->SetPixelsTo(red, green, blue); }
+int SLMInstance::SetExposure(double interval_ms) { return TracedImpl("SetExposure")->SetExposure(interval_ms); }
+double SLMInstance::GetExposure() { return TracedImpl("GetExposure")->GetExposure(); }
+unsigned SLMInstance::GetWidth() { return TracedImpl("GetWidth")->GetWidth(); }
+unsigned SLMInstance::GetHeight() { return TracedImpl("GetHeight")->GetHeight(); }
+unsigned SLMInstance::GetNumberOfComponents() { return TracedImpl("GetNumberOfComponents")->GetNumberOfComponents(); }
+unsigned SLMInstance::GetBytesPerPixel() { return TracedImpl("GetBytesPerPixel")->GetBytesPerPixel(); }
 int SLMInstance::IsSLMSequenceable(bool& isSequenceable)
-{ return GetImpl()->IsSLMSequenceable(isSequenceable); }
+{ return TracedImpl("IsSLMSequenceable")->IsSLMSequenceable(isSequenceable); }
 int SLMInstance::GetSLMSequenceMaxLength(long& nrEvents)
-{ return GetImpl()->GetSLMSequenceMaxLength(nrEvents); }
-int SLMInstance::StartSLMSequence() { return GetImpl()->StartSLMSequence(); }
-int SLMInstance::StopSLMSequence() { return GetImpl()->StopSLMSequence(); }
-int SLMInstance::ClearSLMSequence() { return GetImpl()->ClearSLMSequence(); }
+{ return TracedImpl("GetSLMSequenceMaxLength")->GetSLMSequenceMaxLength(nrEvents); }
+int SLMInstance::StartSLMSequence() { return TracedImpl("StartSLMSequence")->StartSLMSequence(); }
+int SLMInstance::StopSLMSequence() { return TracedImpl("StopSLMSequence")->StopSLMSequence(); }
+int SLMInstance::ClearSLMSequence() { return TracedImpl("ClearSLMSequence")->ClearSLMSequence(); }
 int SLMInstance::AddToSLMSequence(const unsigned char * pixels)
-{ return GetImpl()->AddToSLMSequence(pixels); }
+{ return TracedImpl("AddToSLMSequence")->AddToSLMSequence(pixels); }
 int SLMInstance::AddToSLMSequence(const unsigned int * pixels)
-{ return GetImpl()->AddToSLMSequence(pixels); }
-int SLMInstance::SendSLMSequence() { return GetImpl()->SendSLMSequence(); }
+{ return TracedImpl("AddToSLMSequence")->AddToSLMSequence(pixels); }
+int SLMInstance::SendSLMSequence() { return TracedImpl("SendSLMSequence")->SendSLMSequence(); }
+int SLMInstance::PrepareSLMPattern(long patternId, const unsigned char* pixels)
+{ return TracedImpl("PrepareSLMPattern")->PrepareSLMPattern(patternId, pixels); }
+int SLMInstance::ReleaseSLMPattern(long patternId)
+{ return TracedImpl("ReleaseSLMPattern")->ReleaseSLMPattern(patternId); }
+int SLMInstance::SetSLMPattern(long patternId)
+{ return TracedImpl("SetSLMPattern")->SetSLMPattern(patternId); }
+int SLMInstance::AddPatternToSLMSequence(long patternId)
+{ return TracedImpl("AddPatternToSLMSequence")->AddPatternToSLMSequence(patternId); }
@@ -21,6 +21,10 @@
 
 #include "DeviceInstanceBase.h"
 
+#include "../SLMPatternCache.h"
+
+#include <boost/scoped_ptr.hpp>
+
 
 class SLMInstance : public DeviceInstanceBase<MM::SLM>
 {
@@ -55,4 +59,16 @@ public:
    int AddToSLMSequence(const unsigned char * pixels);
    int AddToSLMSequence(const unsigned int * pixels);
    int SendSLMSequence();
+   int PrepareSLMPattern(long patternId, const unsigned char* pixels);
+   int ReleaseSLMPattern(long patternId);
+   int SetSLMPattern(long patternId);
+   int AddPatternToSLMSequence(long patternId);
+
+   // Patterns registered with the device by the Core (null until the first
+   // pattern is added). Access with the module lock held.
+   mm::SLMPatternCache* GetPatternCache() { return patternCache_.get(); }
+   void SetPatternCache(mm::SLMPatternCache* cache) { patternCache_.reset(cache); }
+
+private:
+   boost::scoped_ptr<mm::SLMPatternCache> patternCache_;
 };
@@ -22,9 +22,17 @@
 #include "SerialInstance.h"
 
 
-MM::PortType SerialInstance::GetPortType() const { return GetImpl()->GetPortType(); }
-int SerialInstance::SetCommand(const char* command, const char* term) { return GetImpl()->SetCommand(command, term); }
-int SerialInstance::GetAnswer(char* txt, unsigned maxChars, const char* term) { return GetImpl()->GetAnswer(txt, maxChars, term); }
-int SerialInstance::Write(const unsigned char* buf, unsigned long bufLen) { return GetImpl()->Write(buf, bufLen); }
-int SerialInstance::Read(unsigned char* buf, unsigned long bufLen, unsigned long& charsRead) { return GetImpl()->Read(buf, bufLen, charsRead); }
-int SerialInstance::Purge() { return GetImpl()->Purge(); }
+MM::PortType SerialInstance::GetPortType() const { return TracedImpl("GetPortType")->GetPortType(); }
+int SerialInstance::SetCommand(const char* command, const char* term) { return TracedImpl("SetCommand")->SetCommand(command, term); }
+int SerialInstance::GetAnswer(char* txt, unsigned maxChars, const char* term) { return TracedImpl("GetAnswer")->GetAnswer(txt, maxChars, term); }
+int SerialInstance::Write(const unsigned char* buf, unsigned long bufLen) { return TracedImpl("Write")->Write(buf, bufLen); }
+int SerialInstance::Read(unsigned char* buf, unsigned long bufLen, unsigned long& charsRead) { return TracedImpl("Read")->Read(buf, bufLen, charsRead); }
+int SerialInstance::Purge() { return TracedImpl("Purge")->Purge(); }
+int SerialInstance::SendCommandBatch(unsigned nrCommands,
+      const char* const* commands, const char* commandTerm,
+      char* answers, unsigned maxAnswerChars, const char* answerTerm,
+      const double* answerTimeoutsMs, unsigned& nrAnswers)
+{
+   return TracedImpl("SendCommandBatch")->SendCommandBatch(nrCommands, commands, commandTerm,
+         answers, maxAnswerChars, answerTerm, answerTimeoutsMs, nrAnswers);
+}
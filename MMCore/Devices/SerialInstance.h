@@ -42,4 +42,8 @@ public:
    int Write(const unsigned char* buf, unsigned long bufLen);
    int Read(unsigned char* buf, unsigned long bufLen, unsigned long& charsRead);
    int Purge();
+   int SendCommandBatch(unsigned nrCommands,
+         const char* const* commands, const char* commandTerm,
+         char* answers, unsigned maxAnswerChars, const char* answerTerm,
+         const double* answerTimeoutsMs, unsigned& nrAnswers);
 };
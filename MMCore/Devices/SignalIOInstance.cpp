@@ -22,15 +22,15 @@
 #include "SignalIOInstance.h"
 
 
-int SignalIOInstance::SetGateOpen(bool open) { return GetImpl()->SetGateOpen(open); }
-int SignalIOInstance::GetGateOpen(bool& open) { return GetImpl()->GetGateOpen(open); }
-int SignalIOInstance::SetSignal(double volts) { return GetImpl()->SetSignal(volts); }
-int SignalIOInstance::GetSignal(double& volts) { return GetImpl()->GetSignal(volts); }
-int SignalIOInstance::GetLimits(double& minVolts, double& maxVolts) { return GetImpl()->GetLimits(minVolts, maxVolts); }
-int SignalIOInstance::IsDASequenceable(bool& isSequenceable) const { return GetImpl()->IsDASequenceable(isSequenceable); }
-int SignalIOInstance::GetDASequenceMaxLength(long& nrEvents) const { return GetImpl()->GetDASequenceMaxLength(nrEvents); }
-int SignalIOInstance::StartDASequence() { return GetImpl()->StartDASequence(); }
-int SignalIOInstance::StopDASequence() { return GetImpl()->StopDASequence(); }
-int SignalIOInstance::ClearDASequence() { return GetImpl()->ClearDASequence(); }
-int SignalIOInstance::AddToDASequence(double voltage) { return GetImpl()->AddToDASequence(voltage); }
-int SignalIOInstance::SendDASequence() { return GetImpl()->SendDASequence(); }
+int SignalIOInstance::SetGateOpen(bool open) { return TracedImpl("SetGateOpen")->SetGateOpen(open); }
+int SignalIOInstance::GetGateOpen(bool& open) { return TracedImpl("GetGateOpen")->GetGateOpen(open); }
+int SignalIOInstance::SetSignal(double volts) { return TracedImpl("SetSignal")->SetSignal(volts); }
+int SignalIOInstance::GetSignal(double& volts) { return TracedImpl("GetSignal")->GetSignal(volts); }
+int SignalIOInstance::GetLimits(double& minVolts, double& maxVolts) { return TracedImpl("GetLimits")->GetLimits(minVolts, maxVolts); }
+int SignalIOInstance::IsDASequenceable(bool& isSequenceable) const { return TracedImpl("IsDASequenceable")->IsDASequenceable(isSequenceable); }
+int SignalIOInstance::GetDASequenceMaxLength(long& nrEvents) const { return TracedImpl("GetDASequenceMaxLength")->GetDASequenceMaxLength(nrEvents); }
+int SignalIOInstance::StartDASequence() { return TracedImpl("StartDASequence")->StartDASequence(); }
+int SignalIOInstance::StopDASequence() { return TracedImpl("StopDASequence")->StopDASequence(); }
+int SignalIOInstance::ClearDASequence() { return TracedImpl("ClearDASequence")->ClearDASequence(); }
+int SignalIOInstance::AddToDASequence(double voltage) { return TracedImpl("AddToDASequence")->AddToDASequence(voltage); }
+int SignalIOInstance::SendDASequence() { return TracedImpl("SendDASequence")->SendDASequence(); }
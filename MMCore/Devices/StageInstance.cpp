@@ -22,17 +22,17 @@
 #include "StageInstance.h"
 
 
-int StageInstance::SetPositionUm(double pos) { return GetImpl()->SetPositionUm(pos); }
-int StageInstance::SetRelativePositionUm(double d) { return GetImpl()->SetRelativePositionUm(d); }
-int StageInstance::Move(double velocity) { return GetImpl()->Move(velocity); }
-int StageInstance::Stop() { return GetImpl()->Stop(); }
-int StageInstance::Home() { return GetImpl()->Home(); }
-int StageInstance::SetAdapterOriginUm(double d) { return GetImpl()->SetAdapterOriginUm(d); }
-int StageInstance::GetPositionUm(double& pos) { return GetImpl()->GetPositionUm(pos); }
-int StageInstance::SetPositionSteps(long steps) { return GetImpl()->SetPositionSteps(steps); }
-int StageInstance::GetPositionSteps(long& steps) { return GetImpl()->GetPositionSteps(steps); }
-int StageInstance::SetOrigin() { return GetImpl()->SetOrigin(); }
-int StageInstance::GetLimits(double& lower, double& upper) { return GetImpl()->GetLimits(lower, upper); }
+int StageInstance::SetPositionUm(double pos) { return TracedImpl("SetPositionUm")->SetPositionUm(pos); }
+int StageInstance::SetRelativePositionUm(double d) { return TracedImpl("SetRelativePositionUm")->SetRelativePositionUm(d); }
+int StageInstance::Move(double velocity) { return TracedImpl("Move")->Move(velocity); }
+int StageInstance::Stop() { return TracedImpl("Stop")->Stop(); }
+int StageInstance::Home() { return TracedImpl("Home")->Home(); }
+int StageInstance::SetAdapterOriginUm(double d) { return TracedImpl("SetAdapterOriginUm")->SetAdapterOriginUm(d); }
+int StageInstance::GetPositionUm(double& pos) { return TracedImpl("GetPositionUm")->GetPositionUm(pos); }
+int StageInstance::SetPositionSteps(long steps) { return TracedImpl("SetPositionSteps")->SetPositionSteps(steps); }
+int StageInstance::GetPositionSteps(long& steps) { return TracedImpl("GetPositionSteps")->GetPositionSteps(steps); }
+int StageInstance::SetOrigin() { return TracedImpl("SetOrigin")->SetOrigin(); }
+int StageInstance::GetLimits(double& lower, double& upper) { return TracedImpl("GetLimits")->GetLimits(lower, upper); }
 
 MM::FocusDirection
 StageInstance::GetFocusDirection()
@@ -41,7 +41,7 @@ StageInstance::GetFocusDirection()
    if (!focusDirectionHasBeenSet_)
    {
       MM::FocusDirection direction;
-      int err = GetImpl()->GetFocusDirection(direction);
+      int err = TracedImpl("GetFocusDirection")->GetFocusDirection(direction);
       ThrowIfError(err, "Cannot get focus direction");
 
       focusDirection_ = direction;
@@ -57,14 +57,16 @@ StageInstance::SetFocusDirection(MM::FocusDirection direction)
    focusDirectionHasBeenSet_ = true;
 }
 
-int StageInstance::IsStageSequenceable(bool& isSequenceable) const { return GetImpl()->IsStageSequenceable(isSequenceable); }
-int StageInstance::IsStageLinearSequenceable(bool& isSequenceable) const { return GetImpl()->IsStageLinearSequenceable(isSequenceable); }
-bool StageInstance::IsContinuousFocusDrive() const { return GetImpl()->IsContinuousFocusDrive(); }
-int StageInstance::GetStageSequenceMaxLength(long& nrEvents) const { return GetImpl()->GetStageSequenceMaxLength(nrEvents); }
-int StageInstance::StartStageSequence() { return GetImpl()->StartStageSequence(); }
-int StageInstance::StopStageSequence() { return GetImpl()->StopStageSequence(); }
-int StageInstance::ClearStageSequence() { return GetImpl()->ClearStageSequence(); }
-int StageInstance::AddToStageSequence(double position) { return GetImpl()->AddToStageSequence(position); }
-int StageInstance::SendStageSequence() { return GetImpl()->SendStageSequence(); }
+int StageInstance::IsStageSequenceable(bool& isSequenceable) const { return TracedImpl("IsStageSequenceable")->IsStageSequenceable(isSequenceable); }
+int StageInstance::IsStageLinearSequenceable(bool& isSequenceable) const { return TracedImpl("IsStageLinearSequenceable")->IsStageLinearSequenceable(isSequenceable); }
+bool StageInstance::IsContinuousFocusDrive() const { return TracedImpl("IsContinuousFocusDrive")->IsContinuousFocusDrive(); }
+int StageInstance::GetStageSequenceMaxLength(long& nrEvents) const { return TracedImpl("GetStageSequenceMaxLength")->GetStageSequenceMaxLength(nrEvents); }
+int StageInstance::StartStageSequence() { return TracedImpl("StartStageSequence")->StartStageSequence(); }
+int StageInstance::StopStageSequence() { return TracedImpl("StopStageSequence")->StopStageSequence(); }
+int StageInstance::ClearStageSequence() { return TracedImpl("ClearStageSequence")->ClearStageSequence(); }
+int StageInstance::AddToStageSequence(double position) { return TracedImpl("AddToStageSequence")->AddToStageSequence(position); }
+int StageInstance::SendStageSequence() { return TracedImpl("SendStageSequence")->SendStageSequence(); }
+int StageInstance::LoadStageSequence(const double* positions, unsigned long nrPositions)
+{ return TracedImpl("LoadStageSequence")->LoadStageSequence(positions, nrPositions); }
 int StageInstance::SetStageLinearSequence(double dZ_um, long nSlices)
-{ return GetImpl()->SetStageLinearSequence(dZ_um, nSlices); }
\ No newline at end of file
+{ return TracedImpl("SetStageLinearSequence")->SetStageLinearSequence(dZ_um, nSlices); }
\ No newline at end of file
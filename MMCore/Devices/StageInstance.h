@@ -61,5 +61,6 @@ public:
    int ClearStageSequence();
    int AddToStageSequence(double position);
    int SendStageSequence();
+   int LoadStageSequence(const double* positions, unsigned long nrPositions);
    int SetStageLinearSequence(double dZ_um, long nSlices);
 };
@@ -22,14 +22,14 @@
 #include "StateInstance.h"
 
 
-int StateInstance::SetPosition(long pos) { return GetImpl()->SetPosition(pos); }
-int StateInstance::SetPosition(const char* label) { return GetImpl()->SetPosition(label); }
-int StateInstance::GetPosition(long& pos) const { return GetImpl()->GetPosition(pos); }
+int StateInstance::SetPosition(long pos) { return TracedImpl("SetPosition")->SetPosition(pos); }
+int StateInstance::SetPosition(const char* label) { return TracedImpl("SetPosition")->SetPosition(label); }
+int StateInstance::GetPosition(long& pos) const { return TracedImpl("GetPosition")->GetPosition(pos); }
 
 std::string StateInstance::GetPositionLabel() const
 {
    DeviceStringBuffer labelBuf(this, "GetPosition");
-   int err = GetImpl()->GetPosition(labelBuf.GetBuffer());
+   int err = TracedImpl("GetPosition")->GetPosition(labelBuf.GetBuffer());
    ThrowIfError(err, "Cannot get current position label");
    return labelBuf.Get();
 }
@@ -37,13 +37,13 @@ std::string StateInstance::GetPositionLabel() const
 std::string StateInstance::GetPositionLabel(long pos) const
 {
    DeviceStringBuffer labelBuf(this, "GetPositionLabel");
-   int err = GetImpl()->GetPositionLabel(pos, labelBuf.GetBuffer());
+   int err = TracedImpl("GetPositionLabel")->GetPositionLabel(pos, labelBuf.GetBuffer());
    ThrowIfError(err, "Cannot get position label at index " + ToString(pos));
    return labelBuf.Get();
 }
 
-int StateInstance::GetLabelPosition(const char* label, long& pos) const { return GetImpl()->GetLabelPosition(label, pos); }
-int StateInstance::SetPositionLabel(long pos, const char* label) { return GetImpl()->SetPositionLabel(pos, label); }
-unsigned long StateInstance::GetNumberOfPositions() const { return GetImpl()->GetNumberOfPositions(); }
-int StateInstance::SetGateOpen(bool open) { return GetImpl()->SetGateOpen(open); }
-int StateInstance::GetGateOpen(bool& open) { return GetImpl()->GetGateOpen(open); }
+int StateInstance::GetLabelPosition(const char* label, long& pos) const { return TracedImpl("GetLabelPosition")->GetLabelPosition(label, pos); }
+int StateInstance::SetPositionLabel(long pos, const char* label) { return TracedImpl("SetPositionLabel")->SetPositionLabel(pos, label); }
+unsigned long StateInstance::GetNumberOfPositions() const { return TracedImpl("GetNumberOfPositions")->GetNumberOfPositions(); }
+int StateInstance::SetGateOpen(bool open) { return TracedImpl("SetGateOpen")->SetGateOpen(open); }
+int StateInstance::GetGateOpen(bool& open) { return TracedImpl("GetGateOpen")->GetGateOpen(open); }
@@ -22,27 +22,29 @@
 #include "XYStageInstance.h"
 
 
-int XYStageInstance::SetPositionUm(double x, double y) { return GetImpl()->SetPositionUm(x, y); }
-int XYStageInstance::SetRelativePositionUm(double dx, double dy) { return GetImpl()->SetRelativePositionUm(dx, dy); }
-int XYStageInstance::SetAdapterOriginUm(double x, double y) { return GetImpl()->SetAdapterOriginUm(x, y); }
-int XYStageInstance::GetPositionUm(double& x, double& y) { return GetImpl()->GetPositionUm(x, y); }
-int XYStageInstance::GetLimitsUm(double& xMin, double& xMax, double& yMin, double& yMax) { return GetImpl()->GetLimitsUm(xMin, xMax, yMin, yMax); }
-int XYStageInstance::Move(double vx, double vy) { return GetImpl()->Move(vx, vy); }
-int XYStageInstance::SetPositionSteps(long x, long y) { return GetImpl()->SetPositionSteps(x, y); }
-int XYStageInstance::GetPositionSteps(long& x, long& y) { return GetImpl()->GetPositionSteps(x, y); }
-int XYStageInstance::SetRelativePositionSteps(long x, long y) { return GetImpl()->SetRelativePositionSteps(x, y); }
-int XYStageInstance::Home() { return GetImpl()->Home(); }
-int XYStageInstance::Stop() { return GetImpl()->Stop(); }
-int XYStageInstance::SetOrigin() { return GetImpl()->SetOrigin(); }
-int XYStageInstance::SetXOrigin() { return GetImpl()->SetXOrigin(); }
-int XYStageInstance::SetYOrigin() { return GetImpl()->SetYOrigin(); }
-int XYStageInstance::GetStepLimits(long& xMin, long& xMax, long& yMin, long& yMax) { return GetImpl()->GetStepLimits(xMin, xMax, yMin, yMax); }
-double XYStageInstance::GetStepSizeXUm() { return GetImpl()->GetStepSizeXUm(); }
-double XYStageInstance::GetStepSizeYUm() { return GetImpl()->GetStepSizeYUm(); }
-int XYStageInstance::IsXYStageSequenceable(bool& isSequenceable) const { return GetImpl()->IsXYStageSequenceable(isSequenceable); }
-int XYStageInstance::GetXYStageSequenceMaxLength(long& nrEvents) const { return GetImpl()->GetXYStageSequenceMaxLength(nrEvents); }
-int XYStageInstance::StartXYStageSequence() { return GetImpl()->StartXYStageSequence(); }
-int XYStageInstance::StopXYStageSequence() { return GetImpl()->StopXYStageSequence(); }
-int XYStageInstance::ClearXYStageSequence() { return GetImpl()->ClearXYStageSequence(); }
-int XYStageInstance::AddToXYStageSequence(double positionX, double positionY) { return GetImpl()->AddToXYStageSequence(positionX, positionY); }
-int XYStageInstance::SendXYStageSequence() { return GetImpl()->SendXYStageSequence(); }
+int XYStageInstance::SetPositionUm(double x, double y) { return TracedImpl("SetPositionUm")->SetPositionUm(x, y); }
+int XYStageInstance::SetRelativePositionUm(double dx, double dy) { return TracedImpl("SetRelativePositionUm")->SetRelativePositionUm(dx, dy); }
+int XYStageInstance::SetAdapterOriginUm(double x, double y) { return TracedImpl("SetAdapterOriginUm")->SetAdapterOriginUm(x, y); }
+int XYStageInstance::GetPositionUm(double& x, double& y) { return TracedImpl("GetPositionUm")->GetPositionUm(x, y); }
+int XYStageInstance::GetLimitsUm(double& xMin, double& xMax, double& yMin, double& yMax) { return TracedImpl("GetLimitsUm")->GetLimitsUm(xMin, xMax, yMin, yMax); }
+int XYStageInstance::Move(double vx, double vy) { return TracedImpl("Move")->Move(vx, vy); }
+int XYStageInstance::SetPositionSteps(long x, long y) { return TracedImpl("SetPositionSteps")->SetPositionSteps(x, y); }
+int XYStageInstance::GetPositionSteps(long& x, long& y) { return TracedImpl("GetPositionSteps")->GetPositionSteps(x, y); }
+int XYStageInstance::SetRelativePositionSteps(long x, long y) { return TracedImpl("SetRelativePositionSteps")->SetRelativePositionSteps(x, y); }
+int XYStageInstance::Home() { return TracedImpl("Home")->Home(); }
+int XYStageInstance::Stop() { return TracedImpl("Stop")->Stop(); }
+int XYStageInstance::SetOrigin() { return TracedImpl("SetOrigin")->SetOrigin(); }
+int XYStageInstance::SetXOrigin() { return TracedImpl("SetXOrigin")->SetXOrigin(); }
+int XYStageInstance::SetYOrigin() { return TracedImpl("SetYOrigin")->SetYOrigin(); }
+int XYStageInstance::GetStepLimits(long& xMin, long& xMax, long& yMin, long& yMax) { return TracedImpl("GetStepLimits")->GetStepLimits(xMin, xMax, yMin, yMax); }
+double XYStageInstance::GetStepSizeXUm() { return TracedImpl("GetStepSizeXUm")->GetStepSizeXUm(); }
+double XYStageInstance::GetStepSizeYUm() { return TracedImpl("GetStepSizeYUm")->GetStepSizeYUm(); }
+int XYStageInstance::IsXYStageSequenceable(bool& isSequenceable) const { return TracedImpl("IsXYStageSequenceable")->IsXYStageSequenceable(isSequenceable); }
+int XYStageInstance::GetXYStageSequenceMaxLength(long& nrEvents) const { return TracedImpl("GetXYStageSequenceMaxLength")->GetXYStageSequenceMaxLength(nrEvents); }
+int XYStageInstance::StartXYStageSequence() { return TracedImpl("StartXYStageSequence")->StartXYStageSequence(); }
+int XYStageInstance::StopXYStageSequence() { return TracedImpl("StopXYStageSequence")->StopXYStageSequence(); }
+int XYStageInstance::ClearXYStageSequence() { return TracedImpl("ClearXYStageSequence")->ClearXYStageSequence(); }
+int XYStageInstance::AddToXYStageSequence(double positionX, double positionY) { return TracedImpl("AddToXYStageSequence")->AddToXYStageSequence(positionX, positionY); }
+int XYStageInstance::SendXYStageSequence() { return TracedImpl("SendXYStageSequence")->SendXYStageSequence(); }
+int XYStageInstance::LoadXYStageSequence(const double* positionsX, const double* positionsY, unsigned long nrPositions)
+{ return TracedImpl("LoadXYStageSequence")->LoadXYStageSequence(positionsX, positionsY, nrPositions); }
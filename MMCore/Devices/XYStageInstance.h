@@ -60,4 +60,5 @@ public:
    int ClearXYStageSequence();
    int AddToXYStageSequence(double positionX, double positionY);
    int SendXYStageSequence();
+   int LoadXYStageSequence(const double* positionsX, const double* positionsY, unsigned long nrPositions);
 };
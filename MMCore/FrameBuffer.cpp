@@ -18,6 +18,7 @@
 
 #include "FrameBuffer.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 
@@ -154,6 +155,14 @@ bool FrameBuffer::SetPixels(unsigned channel, const unsigned char* pixels)
    return true;
 }
 
+void FrameBuffer::Swap(FrameBuffer& other)
+{
+   channels_.swap(other.channels_);
+   std::swap(width_, other.width_);
+   std::swap(height_, other.height_);
+   std::swap(depth_, other.depth_);
+}
+
 const unsigned char* FrameBuffer::GetPixels(unsigned channel) const
 {
    ImgBuffer* img = FindImage(channel);
@@ -78,6 +78,11 @@ public:
    unsigned Width() const {return width_;}
    unsigned Height() const {return height_;}
    unsigned Depth() const {return depth_;}
+   // Including unallocated channels below the highest allocated one
+   unsigned NumberOfChannels() const {return static_cast<unsigned>(channels_.size());}
+
+   // Exchange images and dimensions with other (no pixels are copied)
+   void Swap(FrameBuffer& other);
 
 private:
    // The following line should be uncommented once we upgrade to
@@ -0,0 +1,293 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FrameMatcher.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Groups the images of concurrently running cameras into
+//                multi-channel frames
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "FrameMatcher.h"
+
+#include "CircularBuffer.h"
+#include "ErrorCodes.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include <cmath>
+#include <limits>
+
+namespace mm
+{
+
+namespace
+{
+
+const char* const g_CompleteTag = "FrameMatchComplete";
+
+} // anonymous namespace
+
+
+FrameMatcher::FrameMatcher(const std::vector<std::string>& cameras,
+      const std::string& keyTag, double tolerance, bool dropUnmatched,
+      std::size_t maxOpenFrames) :
+   cameras_(cameras),
+   keyTag_(keyTag),
+   tolerance_(tolerance),
+   dropUnmatched_(dropUnmatched),
+   maxOpenFrames_(maxOpenFrames),
+   nComponents_(1),
+   lastKeys_(cameras.size(), -std::numeric_limits<double>::max()),
+   imageCounts_(cameras.size(), 0)
+{
+}
+
+
+int
+FrameMatcher::GetChannel(const std::string& camera) const
+{
+   for (std::size_t i = 0; i < cameras_.size(); ++i)
+   {
+      if (cameras_[i] == camera)
+         return static_cast<int>(i);
+   }
+   return -1;
+}
+
+
+bool
+FrameMatcher::InsertImage(CircularBuffer& buffer, unsigned channel,
+      const unsigned char* pixels, unsigned width, unsigned height,
+      unsigned byteDepth, unsigned nComponents, const Metadata& md)
+   throw (CMMError)
+{
+   MMThreadGuard guard(lock_);
+
+   ++statistics_.imagesReceived;
+   nComponents_ = nComponents;
+
+   double key = static_cast<double>(imageCounts_[channel]++);
+   bool hasKey = true;
+   if (!keyTag_.empty())
+   {
+      try
+      {
+         key = boost::lexical_cast<double>(
+               md.GetSingleTag(keyTag_.c_str()).GetValue());
+      }
+      catch (const MetadataKeyError&)
+      {
+         hasKey = false;
+      }
+      catch (const boost::bad_lexical_cast&)
+      {
+         hasKey = false;
+      }
+   }
+
+   boost::shared_ptr<OpenFrame> frame;
+   if (hasKey)
+      frame = FindFrame(channel, key);
+   if (!frame)
+   {
+      frame = NewFrame(key, width, height, byteDepth);
+      // An image without a key cannot be matched
+      frame->expired = !hasKey;
+      openFrames_.push_back(frame);
+   }
+   else if (width != frame->frame.Width() ||
+         height != frame->frame.Height() ||
+         byteDepth != frame->frame.Depth())
+   {
+      throw CMMError("Cameras with different image sizes cannot be matched",
+            MMERR_CircularBufferIncompatibleImage);
+   }
+
+   frame->frame.SetPixels(channel, pixels);
+   Metadata tagged(md);
+   tagged.PutImageTag(g_CompleteTag, 1);
+   frame->frame.FindImage(channel)->SetMetadata(tagged);
+   frame->received[channel] = true;
+   ++frame->nrReceived;
+   if (hasKey)
+      lastKeys_[channel] = key;
+
+   ExpireFrames();
+   return InsertReadyFrames(buffer, false);
+}
+
+
+bool
+FrameMatcher::Flush(CircularBuffer& buffer) throw (CMMError)
+{
+   MMThreadGuard guard(lock_);
+   return InsertReadyFrames(buffer, true);
+}
+
+
+FrameMatchStatistics
+FrameMatcher::GetStatistics() const
+{
+   MMThreadGuard guard(lock_);
+   return statistics_;
+}
+
+
+boost::shared_ptr<FrameMatcher::OpenFrame>
+FrameMatcher::NewFrame(double key, unsigned width, unsigned height,
+      unsigned byteDepth)
+{
+   boost::shared_ptr<OpenFrame> frame;
+   if (spareFrames_.empty())
+   {
+      frame.reset(new OpenFrame());
+   }
+   else
+   {
+      frame = spareFrames_.back();
+      spareFrames_.pop_back();
+   }
+
+   if (width != frame->frame.Width() || height != frame->frame.Height() ||
+         byteDepth != frame->frame.Depth())
+      frame->frame.Resize(width, height, byteDepth);
+   frame->key = key;
+   frame->received.assign(cameras_.size(), false);
+   frame->nrReceived = 0;
+   frame->expired = false;
+   return frame;
+}
+
+
+boost::shared_ptr<FrameMatcher::OpenFrame>
+FrameMatcher::FindFrame(unsigned channel, double key) const
+{
+   for (std::deque< boost::shared_ptr<OpenFrame> >::const_iterator
+         it = openFrames_.begin(), end = openFrames_.end(); it != end; ++it)
+   {
+      const OpenFrame& frame = **it;
+      if (!frame.expired && !frame.received[channel] &&
+            std::fabs(frame.key - key) <= tolerance_)
+         return *it;
+   }
+   return boost::shared_ptr<OpenFrame>();
+}
+
+
+/**
+ * A frame expires when a camera it lacks has already sent an image beyond the
+ * frame's key, or when too many frames are open.
+ */
+void
+FrameMatcher::ExpireFrames()
+{
+   for (std::deque< boost::shared_ptr<OpenFrame> >::iterator
+         it = openFrames_.begin(), end = openFrames_.end(); it != end; ++it)
+   {
+      OpenFrame& frame = **it;
+      if (frame.expired)
+         continue;
+      for (std::size_t i = 0; i < cameras_.size(); ++i)
+      {
+         if (!frame.received[i] && lastKeys_[i] > frame.key + tolerance_)
+         {
+            frame.expired = true;
+            break;
+         }
+      }
+   }
+
+   if (openFrames_.size() > maxOpenFrames_)
+      openFrames_.front()->expired = true;
+}
+
+
+/**
+ * Insert frames in order, as long as the oldest open frame is complete or
+ * expired (or if flushing)
+ */
+bool
+FrameMatcher::InsertReadyFrames(CircularBuffer& buffer, bool flush)
+   throw (CMMError)
+{
+   bool ok = true;
+   while (!openFrames_.empty())
+   {
+      boost::shared_ptr<OpenFrame> frame = openFrames_.front();
+      const bool complete = (frame->nrReceived == cameras_.size());
+      if (!complete && !frame->expired && !flush)
+         break;
+
+      openFrames_.pop_front();
+      spareFrames_.push_back(frame);
+
+      if (complete)
+      {
+         ++statistics_.matchedFrames;
+         ok = InsertFrame(buffer, *frame) && ok;
+         continue;
+      }
+
+      ++statistics_.unmatchedFrames;
+      if (dropUnmatched_)
+      {
+         statistics_.droppedImages += frame->nrReceived;
+         continue;
+      }
+
+      // Blank the missing channels, and flag all of them
+      for (std::size_t i = 0; i < cameras_.size(); ++i)
+      {
+         if (frame->received[i])
+         {
+            ImgBuffer* img = frame->frame.FindImage(static_cast<unsigned>(i));
+            Metadata md = img->GetMetadata();
+            md.PutImageTag(g_CompleteTag, 0);
+            img->SetMetadata(md);
+         }
+      }
+      std::vector<unsigned char> blank(static_cast<std::size_t>(
+               frame->frame.Width()) * frame->frame.Height() *
+            frame->frame.Depth(), 0);
+      for (std::size_t i = 0; i < cameras_.size(); ++i)
+      {
+         if (frame->received[i])
+            continue;
+         const unsigned channel = static_cast<unsigned>(i);
+         frame->frame.SetPixels(channel, &blank[0]);
+         // Only what is known about the missing image; tags such as
+         // timestamps of another camera's image would be misleading
+         Metadata md;
+         md.put("Camera", cameras_[i]);
+         md.PutImageTag(g_CompleteTag, 0);
+         frame->frame.FindImage(channel)->SetMetadata(md);
+      }
+      ok = InsertFrame(buffer, *frame) && ok;
+   }
+   return ok;
+}
+
+
+bool
+FrameMatcher::InsertFrame(CircularBuffer& buffer, OpenFrame& frame)
+   throw (CMMError)
+{
+   if (buffer.InsertFrame(frame.frame, nComponents_))
+      return true;
+   statistics_.droppedImages += frame.nrReceived;
+   return false;
+}
+
+} // namespace mm
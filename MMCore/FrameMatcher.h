@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FrameMatcher.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Groups the images of concurrently running cameras into
+//                multi-channel frames
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "Error.h"
+#include "FrameBuffer.h"
+
+#include "../MMDevice/DeviceThreads.h"
+#include "../MMDevice/ImageMetadata.h"
+
+#include <boost/shared_ptr.hpp>
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+class CircularBuffer;
+
+namespace mm
+{
+
+struct FrameMatchStatistics
+{
+   long imagesReceived;
+   // Frames inserted with an image from every camera
+   long matchedFrames;
+   // Frames that were missing images from some camera
+   long unmatchedFrames;
+   // Images discarded because their frame was unmatched (when dropping) or
+   // because the circular buffer was full
+   long droppedImages;
+
+   FrameMatchStatistics() :
+      imagesReceived(0), matchedFrames(0), unmatchedFrames(0),
+      droppedImages(0)
+   {}
+};
+
+
+/**
+ * Matches the images of a set of cameras and inserts each match into the
+ * circular buffer as one multi-channel frame, with the cameras as channels
+ * in the order given.
+ *
+ * Images are matched on a key: the numeric value of a metadata tag (such as
+ * a hardware timestamp or frame counter supplied by the cameras), or, if no
+ * tag is given, the number of images received from each camera so far.
+ * Images whose keys differ by at most the tolerance belong to the same frame.
+ * The keys of all cameras must share a time base, and must increase from
+ * image to image of a camera.
+ *
+ * Each image is copied once, directly into the frame it belongs to; complete
+ * frames are then exchanged with a free frame of the circular buffer without
+ * copying. A frame that can no longer be completed (because each missing
+ * camera has moved past its key, or because too many frames are open) is
+ * either dropped or inserted with the missing channels blank; the images of
+ * inserted frames are tagged "FrameMatchComplete" with 1 or 0.
+ *
+ * Thread-safe: cameras insert from their own threads.
+ */
+class FrameMatcher
+{
+public:
+   FrameMatcher(const std::vector<std::string>& cameras,
+         const std::string& keyTag, double tolerance, bool dropUnmatched,
+         std::size_t maxOpenFrames = 32);
+
+   // The channel of a camera, or -1 if it is not matched
+   int GetChannel(const std::string& camera) const;
+
+   // Returns false if the circular buffer is full; throws if the image does
+   // not fit the circular buffer
+   bool InsertImage(CircularBuffer& buffer, unsigned channel,
+         const unsigned char* pixels, unsigned width, unsigned height,
+         unsigned byteDepth, unsigned nComponents, const Metadata& md)
+      throw (CMMError);
+
+   // Insert or drop all open frames, complete or not
+   bool Flush(CircularBuffer& buffer) throw (CMMError);
+
+   FrameMatchStatistics GetStatistics() const;
+
+private:
+   struct OpenFrame
+   {
+      double key;
+      FrameBuffer frame;
+      std::vector<bool> received;
+      unsigned nrReceived;
+      bool expired;
+   };
+
+   boost::shared_ptr<OpenFrame> NewFrame(double key, unsigned width,
+         unsigned height, unsigned byteDepth);
+   boost::shared_ptr<OpenFrame> FindFrame(unsigned channel, double key) const;
+   void ExpireFrames();
+   bool InsertReadyFrames(CircularBuffer& buffer, bool flush)
+      throw (CMMError);
+   bool InsertFrame(CircularBuffer& buffer, OpenFrame& frame)
+      throw (CMMError);
+
+   const std::vector<std::string> cameras_;
+   const std::string keyTag_;
+   const double tolerance_;
+   const bool dropUnmatched_;
+   const std::size_t maxOpenFrames_;
+   unsigned nComponents_;
+
+   std::deque< boost::shared_ptr<OpenFrame> > openFrames_;
+   // Frames whose images can be reused
+   std::vector< boost::shared_ptr<OpenFrame> > spareFrames_;
+   // Key of the last image of each camera
+   std::vector<double> lastKeys_;
+   std::vector<long> imageCounts_;
+   FrameMatchStatistics statistics_;
+
+   mutable MMThreadLock lock_;
+};
+
+} // namespace mm
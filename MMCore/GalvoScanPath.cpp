@@ -0,0 +1,321 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          GalvoScanPath.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Compiles sets of galvo ROIs into a single scan path
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "GalvoScanPath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace mm
+{
+
+namespace
+{
+
+// So that sizes that are a multiple of the spacing are not rounded down
+const double roundingTolerance = 1e-9;
+
+
+double
+Distance(double x0, double y0, double x1, double y1)
+{
+   const double dx = x1 - x0;
+   const double dy = y1 - y0;
+   return std::sqrt(dx * dx + dy * dy);
+}
+
+
+void
+RasterizeSegment(double x0, double y0, double x1, double y1, double spacing,
+      std::vector<double>& xs, std::vector<double>& ys)
+{
+   const long nrSteps = std::max(1L, static_cast<long>(
+            std::ceil(Distance(x0, y0, x1, y1) / spacing)));
+   for (long i = 0; i <= nrSteps; ++i)
+   {
+      const double t = static_cast<double>(i) / nrSteps;
+      xs.push_back(x0 + t * (x1 - x0));
+      ys.push_back(y0 + t * (y1 - y0));
+   }
+}
+
+
+void
+RasterizePolygon(const std::vector<double>& vxs, const std::vector<double>& vys,
+      double spacing, std::vector<double>& xs, std::vector<double>& ys)
+{
+   const std::size_t nrVertices = vxs.size();
+   const double yMin = *std::min_element(vys.begin(), vys.end());
+   const double yMax = *std::max_element(vys.begin(), vys.end());
+
+   // Scan lines through the middle of each band of height spacing
+   const long nrLines = static_cast<long>(
+         std::floor((yMax - yMin) / spacing + roundingTolerance));
+   const double yFirst = nrLines > 0 ?
+      yMin + 0.5 * (yMax - yMin - (nrLines - 1) * spacing) :
+      0.5 * (yMin + yMax);
+
+   const std::size_t firstPoint = xs.size();
+   std::vector<double> crossings;
+   std::vector<double> line;
+   bool leftToRight = true;
+   for (long k = 0; k < std::max(1L, nrLines); ++k)
+   {
+      const double y = yFirst + k * spacing;
+
+      crossings.clear();
+      for (std::size_t i = 0, j = nrVertices - 1; i < nrVertices; j = i++)
+      {
+         if ((vys[i] <= y && y < vys[j]) || (vys[j] <= y && y < vys[i]))
+            crossings.push_back(vxs[i] + (y - vys[i]) *
+                  (vxs[j] - vxs[i]) / (vys[j] - vys[i]));
+      }
+      std::sort(crossings.begin(), crossings.end());
+
+      line.clear();
+      for (std::size_t c = 0; c + 1 < crossings.size(); c += 2)
+      {
+         const double xStart = crossings[c];
+         const double xEnd = crossings[c + 1];
+         const long nrPoints = static_cast<long>(
+               std::floor((xEnd - xStart) / spacing + roundingTolerance));
+         if (nrPoints == 0)
+         {
+            line.push_back(0.5 * (xStart + xEnd));
+            continue;
+         }
+         const double xFirst =
+            xStart + 0.5 * (xEnd - xStart - (nrPoints - 1) * spacing);
+         for (long p = 0; p < nrPoints; ++p)
+            line.push_back(xFirst + p * spacing);
+      }
+      if (line.empty())
+         continue;
+
+      if (!leftToRight)
+         std::reverse(line.begin(), line.end());
+      leftToRight = !leftToRight;
+      xs.insert(xs.end(), line.begin(), line.end());
+      ys.insert(ys.end(), line.size(), y);
+   }
+
+   // Degenerate (e.g. zero-area) polygons
+   if (xs.size() == firstPoint)
+   {
+      xs.insert(xs.end(), vxs.begin(), vxs.end());
+      ys.insert(ys.end(), vys.begin(), vys.end());
+   }
+}
+
+} // anonymous namespace
+
+
+double
+GalvoScanPath::GetTravelDistance(double startX, double startY) const
+{
+   double distance = 0.0;
+   double x = startX;
+   double y = startY;
+   for (std::size_t i = 0; i < xs.size(); ++i)
+   {
+      distance += Distance(x, y, xs[i], ys[i]);
+      x = xs[i];
+      y = ys[i];
+   }
+   return distance;
+}
+
+
+void
+RasterizeGalvoROI(const GalvoROI& roi, double spacing,
+      std::vector<double>& xs, std::vector<double>& ys)
+{
+   switch (roi.xs.size())
+   {
+      case 0:
+         break;
+      case 1:
+         xs.push_back(roi.xs[0]);
+         ys.push_back(roi.ys[0]);
+         break;
+      case 2:
+         RasterizeSegment(roi.xs[0], roi.ys[0], roi.xs[1], roi.ys[1],
+               spacing, xs, ys);
+         break;
+      default:
+         RasterizePolygon(roi.xs, roi.ys, spacing, xs, ys);
+         break;
+   }
+}
+
+
+std::vector<std::size_t>
+OrderGalvoROIs(const std::vector<double>& firstXs,
+      const std::vector<double>& firstYs,
+      const std::vector<double>& lastXs, const std::vector<double>& lastYs,
+      double startX, double startY, std::vector<bool>& reversed)
+{
+   const std::size_t n = firstXs.size();
+   std::vector<std::size_t> order;
+   order.reserve(n);
+   reversed.assign(n, false);
+
+   // Nearest neighbor, entering each ROI at whichever end is closer
+   std::vector<bool> visited(n, false);
+   double x = startX;
+   double y = startY;
+   for (std::size_t step = 0; step < n; ++step)
+   {
+      std::size_t best = n;
+      bool bestReversed = false;
+      double bestDistance = std::numeric_limits<double>::max();
+      for (std::size_t i = 0; i < n; ++i)
+      {
+         if (visited[i])
+            continue;
+         const double forward = Distance(x, y, firstXs[i], firstYs[i]);
+         const double backward = Distance(x, y, lastXs[i], lastYs[i]);
+         if (forward < bestDistance)
+         {
+            best = i;
+            bestReversed = false;
+            bestDistance = forward;
+         }
+         if (backward < bestDistance)
+         {
+            best = i;
+            bestReversed = true;
+            bestDistance = backward;
+         }
+      }
+      visited[best] = true;
+      reversed[best] = bestReversed;
+      order.push_back(best);
+      x = bestReversed ? firstXs[best] : lastXs[best];
+      y = bestReversed ? firstYs[best] : lastYs[best];
+   }
+
+   // 2-opt: reversing a run of the order also reverses each of its ROIs
+   const int maxPasses = 50;
+   for (int pass = 0; pass < maxPasses; ++pass)
+   {
+      bool improved = false;
+      for (std::size_t i = 0; i < n; ++i)
+      {
+         double prevX = startX;
+         double prevY = startY;
+         if (i > 0)
+         {
+            const std::size_t r = order[i - 1];
+            prevX = reversed[r] ? firstXs[r] : lastXs[r];
+            prevY = reversed[r] ? firstYs[r] : lastYs[r];
+         }
+         const std::size_t ri = order[i];
+         const double entryIX = reversed[ri] ? lastXs[ri] : firstXs[ri];
+         const double entryIY = reversed[ri] ? lastYs[ri] : firstYs[ri];
+         const double before = Distance(prevX, prevY, entryIX, entryIY);
+
+         for (std::size_t j = i; j < n; ++j)
+         {
+            const std::size_t rj = order[j];
+            const double exitJX = reversed[rj] ? firstXs[rj] : lastXs[rj];
+            const double exitJY = reversed[rj] ? firstYs[rj] : lastYs[rj];
+            double oldCost = before;
+            double newCost = Distance(prevX, prevY, exitJX, exitJY);
+            if (j + 1 < n)
+            {
+               const std::size_t rk = order[j + 1];
+               const double entryKX = reversed[rk] ? lastXs[rk] : firstXs[rk];
+               const double entryKY = reversed[rk] ? lastYs[rk] : firstYs[rk];
+               oldCost += Distance(exitJX, exitJY, entryKX, entryKY);
+               newCost += Distance(entryIX, entryIY, entryKX, entryKY);
+            }
+            if (newCost < oldCost - 1e-9 * (oldCost + 1.0))
+            {
+               std::reverse(order.begin() + i, order.begin() + j + 1);
+               for (std::size_t k = i; k <= j; ++k)
+                  reversed[order[k]] = !reversed[order[k]];
+               improved = true;
+               break;
+            }
+         }
+      }
+      if (!improved)
+         break;
+   }
+   return order;
+}
+
+
+GalvoScanPath
+CompileGalvoScanPath(const std::vector<GalvoROI>& rois, double spacing,
+      double startX, double startY)
+{
+   // Rasterize once per ROI; ROIs without points are left out
+   std::vector<std::size_t> indices;
+   std::vector< std::vector<double> > rasterXs, rasterYs;
+   std::vector<double> firstXs, firstYs, lastXs, lastYs;
+   for (std::size_t i = 0; i < rois.size(); ++i)
+   {
+      if (rois[i].repetitions < 1)
+         continue;
+      std::vector<double> xs, ys;
+      RasterizeGalvoROI(rois[i], spacing, xs, ys);
+      if (xs.empty())
+         continue;
+      indices.push_back(i);
+      firstXs.push_back(xs.front());
+      firstYs.push_back(ys.front());
+      lastXs.push_back(xs.back());
+      lastYs.push_back(ys.back());
+      rasterXs.push_back(xs);
+      rasterYs.push_back(ys);
+   }
+
+   std::vector<bool> reversed;
+   const std::vector<std::size_t> order = OrderGalvoROIs(firstXs, firstYs,
+         lastXs, lastYs, startX, startY, reversed);
+
+   GalvoScanPath path;
+   for (std::size_t k = 0; k < order.size(); ++k)
+   {
+      const std::size_t r = order[k];
+      const GalvoROI& roi = rois[indices[r]];
+      std::vector<double>& xs = rasterXs[r];
+      std::vector<double>& ys = rasterYs[r];
+      if (reversed[r])
+      {
+         std::reverse(xs.begin(), xs.end());
+         std::reverse(ys.begin(), ys.end());
+      }
+      for (long rep = 0; rep < roi.repetitions; ++rep)
+      {
+         path.xs.insert(path.xs.end(), xs.begin(), xs.end());
+         path.ys.insert(path.ys.end(), ys.begin(), ys.end());
+      }
+      path.dwellTimes_us.insert(path.dwellTimes_us.end(),
+            xs.size() * roi.repetitions, roi.dwellTime_us);
+      path.roiOrder.push_back(indices[r]);
+   }
+   return path;
+}
+
+} // namespace mm
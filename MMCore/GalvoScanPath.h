@@ -0,0 +1,93 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          GalvoScanPath.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Compiles sets of galvo ROIs into a single scan path
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace mm
+{
+
+/**
+ * A region to be illuminated, in galvo units. One vertex is a point, two
+ * are a line segment, and more are a polygon (filled by the even-odd rule).
+ */
+struct GalvoROI
+{
+   std::vector<double> xs;
+   std::vector<double> ys;
+   long repetitions;
+   double dwellTime_us;
+
+   GalvoROI() : repetitions(1), dwellTime_us(0.0) {}
+};
+
+
+/**
+ * Points to visit in order, with the time to spend at each.
+ */
+struct GalvoScanPath
+{
+   std::vector<double> xs;
+   std::vector<double> ys;
+   std::vector<double> dwellTimes_us;
+   // Indices of the ROIs in the order they are visited
+   std::vector<std::size_t> roiOrder;
+
+   std::size_t GetNumberOfPoints() const { return xs.size(); }
+
+   /**
+    * Total distance traveled, starting from (startX, startY).
+    */
+   double GetTravelDistance(double startX, double startY) const;
+};
+
+
+/**
+ * Sample the points covering roi once, spacing apart: a boustrophedon raster
+ * of horizontal lines for polygons, evenly spaced points including the ends
+ * for line segments. Polygons too small to contain a raster point are
+ * represented by their vertices.
+ */
+void RasterizeGalvoROI(const GalvoROI& roi, double spacing,
+      std::vector<double>& xs, std::vector<double>& ys);
+
+/**
+ * Rasterize each ROI (repeated as many times as requested) and join them,
+ * starting from (startX, startY), in an order that keeps the travel between
+ * ROIs short. Each ROI's raster may be run backwards.
+ *
+ * The order is found by nearest-neighbor search refined by 2-opt moves.
+ */
+GalvoScanPath CompileGalvoScanPath(const std::vector<GalvoROI>& rois,
+      double spacing, double startX, double startY);
+
+/**
+ * Order the ROIs as CompileGalvoScanPath() would, given the first and last
+ * point of each ROI's path. Returns the ROI indices in visit order, with
+ * reversed[i] set for ROIs to be run from their last point.
+ */
+std::vector<std::size_t> OrderGalvoROIs(
+      const std::vector<double>& firstXs, const std::vector<double>& firstYs,
+      const std::vector<double>& lastXs, const std::vector<double>& lastYs,
+      double startX, double startY, std::vector<bool>& reversed);
+
+} // namespace mm
@@ -0,0 +1,181 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          LocalClock.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Fast local time and timestamp formatting
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "LocalClock.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+#include <boost/atomic.hpp>
+#include <boost/date_time/c_local_time_adjustor.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+namespace mm
+{
+
+namespace
+{
+
+const boost::int64_t usPerMinute = 60 * 1000000LL;
+const boost::int64_t usPerHour = 60 * usPerMinute;
+
+const boost::posix_time::ptime& Epoch()
+{
+   static const boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+   return epoch;
+}
+
+// The UTC offset (in seconds) for a given minute (since the epoch), packed
+// into a single word so that it can be read and updated atomically:
+// (minute << 32) | (offset + offsetBias). Zero means no cached value.
+const boost::int64_t offsetBias = 1 << 30;
+boost::atomic<boost::uint64_t> g_cachedOffset(0);
+
+boost::int64_t UTCOffsetSecondsForMinute(boost::int64_t minute)
+{
+   boost::uint64_t cached = g_cachedOffset.load(boost::memory_order_relaxed);
+   if (cached != 0 && static_cast<boost::int64_t>(cached >> 32) == minute)
+      return static_cast<boost::int64_t>(cached & 0xffffffffu) - offsetBias;
+
+   // UTC offsets only ever change at minute boundaries, so the offset at the
+   // start of the minute applies to the whole minute.
+   typedef boost::date_time::c_local_adjustor<boost::posix_time::ptime>
+      LocalAdjustor;
+   const boost::posix_time::ptime utc =
+      PtimeFromUTCMicroseconds(minute * usPerMinute);
+   const boost::int64_t offset =
+      (LocalAdjustor::utc_to_local(utc) - utc).total_seconds();
+
+   g_cachedOffset.store((static_cast<boost::uint64_t>(minute) << 32) |
+         static_cast<boost::uint64_t>(offset + offsetBias),
+         boost::memory_order_relaxed);
+   return offset;
+}
+
+void AppendTwoDigits(std::string& dest, unsigned n)
+{
+   dest += static_cast<char>('0' + n / 10);
+   dest += static_cast<char>('0' + n % 10);
+}
+
+} // anonymous namespace
+
+
+boost::int64_t
+UTCMicrosecondsNow()
+{
+#ifdef _WIN32
+   FILETIME ft;
+   ::GetSystemTimeAsFileTime(&ft);
+   boost::int64_t ticks = (static_cast<boost::int64_t>(ft.dwHighDateTime) << 32) |
+      ft.dwLowDateTime;
+   // FILETIME counts 100 ns intervals since 1601-01-01
+   return (ticks - 116444736000000000LL) / 10;
+#else
+   timeval tv;
+   ::gettimeofday(&tv, 0);
+   return static_cast<boost::int64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+#endif
+}
+
+
+// Avoid constructing durations from values that overflow a 32-bit long (as
+// on Windows); an hour is already 3.6e9 microseconds.
+boost::posix_time::ptime
+PtimeFromUTCMicroseconds(boost::int64_t us)
+{
+   return Epoch() +
+      boost::posix_time::hours(static_cast<long>(us / usPerHour)) +
+      boost::posix_time::seconds(static_cast<long>((us % usPerHour) / 1000000)) +
+      boost::posix_time::microseconds(static_cast<long>(us % 1000000));
+}
+
+
+boost::posix_time::ptime
+LocalTimeNow()
+{
+   const boost::int64_t utcUs = UTCMicrosecondsNow();
+   const boost::int64_t offset = UTCOffsetSecondsForMinute(utcUs / usPerMinute);
+   return PtimeFromUTCMicroseconds(utcUs + offset * 1000000);
+}
+
+
+TimestampFormatter::TimestampFormatter(char dateTimeSeparator,
+      FractionMode fractionMode) :
+   separator_(dateTimeSeparator),
+   fractionMode_(fractionMode),
+   prefixMinute_(-1)
+{
+}
+
+
+void
+TimestampFormatter::Append(std::string& dest, boost::posix_time::ptime t)
+{
+   if (t.is_special())
+   {
+      dest += boost::posix_time::to_simple_string(t);
+      return;
+   }
+
+   const boost::int64_t us = (t - Epoch()).total_microseconds();
+   const boost::int64_t minute = us / usPerMinute;
+   if (minute != prefixMinute_)
+   {
+      // "YYYY-MM-DDTHH:MM:SS"
+      std::string full = boost::posix_time::to_iso_extended_string(
+            PtimeFromUTCMicroseconds(minute * usPerMinute));
+      prefix_.assign(full, 0, 17);
+      prefix_[10] = separator_;
+      prefixMinute_ = minute;
+   }
+   dest += prefix_;
+
+   const unsigned seconds = static_cast<unsigned>((us / 1000000) % 60);
+   AppendTwoDigits(dest, seconds);
+
+   unsigned fraction = static_cast<unsigned>(us % 1000000);
+   if (fraction == 0 && fractionMode_ == FractionIfNonZero)
+      return;
+   char digits[7];
+   for (int i = 5; i >= 0; --i)
+   {
+      digits[i] = static_cast<char>('0' + fraction % 10);
+      fraction /= 10;
+   }
+   digits[6] = '\0';
+   dest += '.';
+   dest += digits;
+}
+
+
+std::string
+TimestampFormatter::Format(boost::posix_time::ptime t)
+{
+   std::string result;
+   Append(result, t);
+   return result;
+}
+
+} // namespace mm
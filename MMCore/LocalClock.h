@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          LocalClock.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Fast local time and timestamp formatting
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <boost/cstdint.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include <string>
+
+namespace mm
+{
+
+/**
+ * Return the current local time, with microsecond resolution.
+ *
+ * This gives the same result as microsec_clock::local_time(), but the system
+ * UTC clock is read directly and converted with a cached UTC offset. The C
+ * library (localtime_r() or localtime()) is only called once per minute, to
+ * update the offset. Thread-safe.
+ */
+boost::posix_time::ptime LocalTimeNow();
+
+
+/**
+ * Return the number of microseconds since the Unix epoch, UTC.
+ */
+boost::int64_t UTCMicrosecondsNow();
+
+
+/**
+ * Convert a number of microseconds since the Unix epoch to a ptime, without
+ * any time zone conversion.
+ */
+boost::posix_time::ptime PtimeFromUTCMicroseconds(boost::int64_t us);
+
+
+/**
+ * Formatter for timestamps, caching the date, hour, and minute.
+ *
+ * Timestamps are formatted as "YYYY-MM-DD<sep>HH:MM:SS.ffffff". Only the
+ * seconds and microseconds are formatted for each call, as long as
+ * consecutive timestamps fall within the same minute.
+ *
+ * An instance must not be used by more than one thread at a time.
+ */
+class TimestampFormatter
+{
+public:
+   enum FractionMode
+   {
+      // As in the output of to_iso_extended_string()
+      FractionIfNonZero,
+      // As in the output of time_facet's "%s"
+      FractionAlways
+   };
+
+   TimestampFormatter(char dateTimeSeparator, FractionMode fractionMode);
+
+   // Append the formatted timestamp to dest
+   void Append(std::string& dest, boost::posix_time::ptime t);
+
+   std::string Format(boost::posix_time::ptime t);
+
+private:
+   char separator_;
+   FractionMode fractionMode_;
+   boost::int64_t prefixMinute_; // Minute of prefix_, since the epoch
+   std::string prefix_; // "YYYY-MM-DD<sep>HH:MM:"
+};
+
+} // namespace mm
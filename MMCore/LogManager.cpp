@@ -38,6 +38,9 @@ LogManager::LogManager() :
    internalLogger_(loggingCore_->NewLogger("LogManager")),
    primaryLogLevel_(LogLevelInfo),
    usingStdErr_(false),
+   primaryMaxBytes_(0),
+   primaryMaxAgeMinutes_(0),
+   primaryMaxOldFiles_(0),
    nextSecondaryHandle_(0)
 {}
 
@@ -104,7 +107,7 @@ LogManager::SetPrimaryLogFilename(const std::string& filename, bool truncate)
    boost::shared_ptr<LogSink> newSink;
    try
    {
-      newSink = boost::make_shared<FileLogSink>(primaryFilename_, !truncate);
+      newSink = NewPrimaryFileSink(!truncate);
    }
    catch (const CannotOpenFileException&)
    {
@@ -120,8 +123,6 @@ LogManager::SetPrimaryLogFilename(const std::string& filename, bool truncate)
       throw CMMError("Cannot open file " + ToQuotedString(filename));
    }
 
-   newSink->SetFilter(boost::make_shared<LevelFilter>(primaryLogLevel_));
-
    if (!primaryFileSink_)
    {
       loggingCore_->AddSink(newSink, PrimarySinkMode);
@@ -131,26 +132,107 @@ LogManager::SetPrimaryLogFilename(const std::string& filename, bool truncate)
    }
    else
    {
-      // We will use atomic swapping so that no entries get lost between the
-      // two files. This makes it possible to use this function for log
-      // rotation.
-
       LOG_INFO(internalLogger_) << "Switching primary log file";
-      std::vector< std::pair<boost::shared_ptr<LogSink>, SinkMode> > toRemove;
-      std::vector< std::pair<boost::shared_ptr<LogSink>, SinkMode> > toAdd;
-      toRemove.push_back(
-            std::make_pair(primaryFileSink_, PrimarySinkMode));
-      toAdd.push_back(std::make_pair(newSink, PrimarySinkMode));
-
-      loggingCore_->AtomicSwapSinks(toRemove.begin(), toRemove.end(),
-            toAdd.begin(), toAdd.end());
-      primaryFileSink_ = newSink;
+      SwapPrimaryFileSink(newSink);
       LOG_INFO(internalLogger_) << "Switched primary log file to " <<
          primaryFilename_;
    }
 }
 
 
+void
+LogManager::SetPrimaryLogRollover(std::size_t maxBytes, int maxAgeMinutes,
+      std::size_t maxOldFiles)
+{
+   boost::lock_guard<boost::mutex> lock(mutex_);
+
+   primaryMaxBytes_ = maxBytes;
+   primaryMaxAgeMinutes_ = maxAgeMinutes > 0 ? maxAgeMinutes : 0;
+   primaryMaxOldFiles_ = maxOldFiles;
+
+   LOG_INFO(internalLogger_) << "Set primary log file rollover at " <<
+      maxBytes << " bytes or " << maxAgeMinutes << " minutes (0 = never), " <<
+      "keeping " << maxOldFiles << " old files (0 = all)";
+
+   if (!primaryFileSink_)
+      return;
+
+   // Continue the current file with the new settings
+   boost::shared_ptr<LogSink> newSink;
+   try
+   {
+      newSink = NewPrimaryFileSink(true);
+   }
+   catch (const CannotOpenFileException&)
+   {
+      LOG_ERROR(internalLogger_) << "Failed to reopen primary log file " <<
+         primaryFilename_ << "; rollover settings apply to the next file";
+      return;
+   }
+   SwapPrimaryFileSink(newSink);
+}
+
+
+std::size_t
+LogManager::GetPrimaryLogRolloverSize() const
+{
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   return primaryMaxBytes_;
+}
+
+
+int
+LogManager::GetPrimaryLogRolloverAge() const
+{
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   return primaryMaxAgeMinutes_;
+}
+
+
+std::size_t
+LogManager::GetPrimaryLogMaxOldFiles() const
+{
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   return primaryMaxOldFiles_;
+}
+
+
+boost::shared_ptr<LogSink>
+LogManager::NewPrimaryFileSink(bool append)
+{
+   boost::shared_ptr<LogSink> sink;
+   if (primaryMaxBytes_ == 0 && primaryMaxAgeMinutes_ == 0)
+   {
+      sink = boost::make_shared<FileLogSink>(primaryFilename_, append);
+   }
+   else
+   {
+      sink = boost::make_shared<RotatingFileLogSink>(primaryFilename_, append,
+            primaryMaxBytes_, boost::posix_time::minutes(primaryMaxAgeMinutes_),
+            primaryMaxOldFiles_);
+   }
+   sink->SetFilter(boost::make_shared<LevelFilter>(primaryLogLevel_));
+   return sink;
+}
+
+
+void
+LogManager::SwapPrimaryFileSink(boost::shared_ptr<LogSink> newSink)
+{
+   // We will use atomic swapping so that no entries get lost between the
+   // two files. This makes it possible to use this function for log
+   // rotation.
+   std::vector< std::pair<boost::shared_ptr<LogSink>, SinkMode> > toRemove;
+   std::vector< std::pair<boost::shared_ptr<LogSink>, SinkMode> > toAdd;
+   toRemove.push_back(std::make_pair(primaryFileSink_, PrimarySinkMode));
+   toAdd.push_back(std::make_pair(newSink, PrimarySinkMode));
+
+   loggingCore_->AtomicSwapSinks(toRemove.begin(), toRemove.end(),
+         toAdd.begin(), toAdd.end());
+   primaryFileSink_ = newSink;
+}
+
+
 std::string
 LogManager::GetPrimaryLogFilename() const
 {
@@ -218,6 +300,51 @@ LogManager::GetPrimaryLogLevel() const
 }
 
 
+void
+LogManager::SetAsyncFlushInterval(int milliseconds)
+{
+   loggingCore_->SetAsyncFlushInterval(
+         boost::posix_time::milliseconds(milliseconds));
+   LOG_INFO(internalLogger_) << "Set log flush interval to " <<
+      milliseconds << " ms";
+}
+
+
+int
+LogManager::GetAsyncFlushInterval() const
+{
+   return static_cast<int>(
+         loggingCore_->GetAsyncFlushInterval().total_milliseconds());
+}
+
+
+void
+LogManager::SetAsyncQueueCapacity(std::size_t maxLines, bool blockWhenFull)
+{
+   loggingCore_->SetAsyncQueueCapacity(maxLines, blockWhenFull);
+   if (maxLines == 0)
+      LOG_INFO(internalLogger_) << "Removed log queue limit";
+   else
+      LOG_INFO(internalLogger_) << "Set log queue limit to " << maxLines <<
+         " lines (" << (blockWhenFull ? "blocking" : "dropping oldest") <<
+         " when full)";
+}
+
+
+std::size_t
+LogManager::GetAsyncQueueCapacity() const
+{
+   return loggingCore_->GetAsyncQueueCapacity();
+}
+
+
+bool
+LogManager::GetAsyncQueueBlocksWhenFull() const
+{
+   return loggingCore_->GetAsyncQueueBlocksWhenFull();
+}
+
+
 LogManager::LogFileHandle
 LogManager::AddSecondaryLogFile(LogLevel level,
       const std::string& filename, bool truncate, SinkMode mode)
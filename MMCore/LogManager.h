@@ -4,6 +4,7 @@
 
 #include <boost/thread/mutex.hpp>
 
+#include <cstddef>
 #include <map>
 #include <string>
 
@@ -31,6 +32,10 @@ private:
 
    std::string primaryFilename_;
    boost::shared_ptr<logging::LogSink> primaryFileSink_;
+   // Primary log file rollover (0 = no limit)
+   std::size_t primaryMaxBytes_;
+   int primaryMaxAgeMinutes_;
+   std::size_t primaryMaxOldFiles_;
 
    LogFileHandle nextSecondaryHandle_;
    struct LogFileInfo
@@ -65,6 +70,18 @@ public:
    void SetPrimaryLogLevel(logging::LogLevel level);
    logging::LogLevel GetPrimaryLogLevel() const;
 
+   void SetPrimaryLogRollover(std::size_t maxBytes, int maxAgeMinutes,
+         std::size_t maxOldFiles);
+   std::size_t GetPrimaryLogRolloverSize() const;
+   int GetPrimaryLogRolloverAge() const;
+   std::size_t GetPrimaryLogMaxOldFiles() const;
+
+   void SetAsyncFlushInterval(int milliseconds);
+   int GetAsyncFlushInterval() const;
+   void SetAsyncQueueCapacity(std::size_t maxLines, bool blockWhenFull);
+   std::size_t GetAsyncQueueCapacity() const;
+   bool GetAsyncQueueBlocksWhenFull() const;
+
    LogFileHandle AddSecondaryLogFile(logging::LogLevel level,
          const std::string& filename, bool truncate = true,
          logging::SinkMode mode = logging::SinkModeAsynchronous);
@@ -73,6 +90,11 @@ public:
    // nice for log rotation, but we don't need it now.
 
    logging::Logger NewLogger(const std::string& label);
+
+private:
+   // Call with mutex_ held; throws CannotOpenFileException
+   boost::shared_ptr<logging::LogSink> NewPrimaryFileSink(bool append);
+   void SwapPrimaryFileSink(boost::shared_ptr<logging::LogSink> newSink);
 };
 
 } // namespace mm
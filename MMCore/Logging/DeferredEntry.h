@@ -0,0 +1,242 @@
+// COPYRIGHT:     University of California, San Francisco, 2014,
+//                All Rights reserved
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+//
+// AUTHOR:        Mark Tsuchida
+
+#pragma once
+
+#include <boost/cstdint.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+
+namespace mm
+{
+namespace logging
+{
+namespace internal
+{
+
+
+/**
+ * Unformatted log entry: a format string and the raw values of its arguments
+ *
+ * This allows the text of an entry to be produced on the thread of the
+ * asynchronous sinks, so that the logging thread only copies a few values.
+ * Each occurrence of "{}" in the format is replaced by the next argument,
+ * formatted as by std::ostream's operator<<().
+ *
+ * The format must be a string literal (or otherwise outlive the entry); only
+ * the pointer is recorded. String arguments are copied into a fixed-size
+ * buffer, and are truncated if it becomes full. Arguments beyond MaxArgs are
+ * not recorded; their placeholders are output as "{?}".
+ */
+class DeferredEntry
+{
+public:
+   static const std::size_t MaxArgs = 8;
+   static const std::size_t StringStorageLen = 255;
+
+private:
+   enum ArgType
+   {
+      ArgTypeSigned,
+      ArgTypeUnsigned,
+      ArgTypeDouble,
+      ArgTypeBool,
+      ArgTypeChar,
+      ArgTypeString
+   };
+
+   struct Arg
+   {
+      ArgType type;
+      union
+      {
+         boost::int64_t i;
+         boost::uint64_t u;
+         double d;
+         struct
+         {
+            std::size_t offset; // Into strings_
+            std::size_t length;
+            bool truncated;
+         } s;
+      } value;
+   };
+
+   const char* format_;
+   std::size_t nrArgs_;
+   std::size_t stringsUsed_;
+   Arg args_[MaxArgs];
+   char strings_[StringStorageLen];
+
+public:
+   explicit DeferredEntry(const char* format) :
+      format_(format),
+      nrArgs_(0),
+      stringsUsed_(0)
+   {}
+
+   // Copy only the used part of the buffers; entries are copied once on the
+   // logging thread.
+   DeferredEntry(const DeferredEntry& other) :
+      format_(other.format_),
+      nrArgs_(other.nrArgs_),
+      stringsUsed_(other.stringsUsed_)
+   {
+      std::copy(other.args_, other.args_ + nrArgs_, args_);
+      std::memcpy(strings_, other.strings_, stringsUsed_);
+   }
+
+   DeferredEntry& operator=(const DeferredEntry& other)
+   {
+      format_ = other.format_;
+      nrArgs_ = other.nrArgs_;
+      stringsUsed_ = other.stringsUsed_;
+      std::copy(other.args_, other.args_ + nrArgs_, args_);
+      std::memcpy(strings_, other.strings_, stringsUsed_);
+      return *this;
+   }
+
+   const char* GetFormat() const { return format_; }
+   std::size_t GetNrArgs() const { return nrArgs_; }
+
+   void AddArg(int v) { AddSigned(v); }
+   void AddArg(long v) { AddSigned(v); }
+   void AddArg(boost::long_long_type v) { AddSigned(v); }
+   void AddArg(unsigned v) { AddUnsigned(v); }
+   void AddArg(unsigned long v) { AddUnsigned(v); }
+   void AddArg(boost::ulong_long_type v) { AddUnsigned(v); }
+
+   void AddArg(double v)
+   {
+      if (Arg* arg = NextArg(ArgTypeDouble))
+         arg->value.d = v;
+   }
+
+   void AddArg(bool v)
+   {
+      if (Arg* arg = NextArg(ArgTypeBool))
+         arg->value.i = v;
+   }
+
+   void AddArg(char v)
+   {
+      if (Arg* arg = NextArg(ArgTypeChar))
+         arg->value.i = v;
+   }
+
+   void AddArg(const char* v)
+   { AddString(v ? v : "(null)", v ? std::strlen(v) : 6); }
+
+   void AddArg(const std::string& v)
+   { AddString(v.data(), v.size()); }
+
+   /**
+    * Write the formatted entry text to stream.
+    */
+   void Format(std::ostream& stream) const
+   {
+      std::size_t argIndex = 0;
+      const char* p = format_;
+      for (;;)
+      {
+         const char* placeholder = std::strstr(p, "{}");
+         if (!placeholder)
+         {
+            stream << p;
+            return;
+         }
+         stream.write(p, placeholder - p);
+         p = placeholder + 2;
+
+         if (argIndex < nrArgs_)
+            FormatArg(stream, args_[argIndex++]);
+         else
+            stream << "{?}";
+      }
+   }
+
+private:
+   Arg* NextArg(ArgType type)
+   {
+      if (nrArgs_ == MaxArgs)
+         return 0;
+      Arg* arg = &args_[nrArgs_++];
+      arg->type = type;
+      return arg;
+   }
+
+   void AddSigned(boost::int64_t v)
+   {
+      if (Arg* arg = NextArg(ArgTypeSigned))
+         arg->value.i = v;
+   }
+
+   void AddUnsigned(boost::uint64_t v)
+   {
+      if (Arg* arg = NextArg(ArgTypeUnsigned))
+         arg->value.u = v;
+   }
+
+   void AddString(const char* s, std::size_t len)
+   {
+      Arg* arg = NextArg(ArgTypeString);
+      if (!arg)
+         return;
+      const std::size_t room = StringStorageLen - stringsUsed_;
+      arg->value.s.offset = stringsUsed_;
+      arg->value.s.length = std::min(len, room);
+      arg->value.s.truncated = (len > room);
+      std::memcpy(strings_ + stringsUsed_, s, arg->value.s.length);
+      stringsUsed_ += arg->value.s.length;
+   }
+
+   void FormatArg(std::ostream& stream, const Arg& arg) const
+   {
+      switch (arg.type)
+      {
+         case ArgTypeSigned:
+            stream << arg.value.i;
+            break;
+         case ArgTypeUnsigned:
+            stream << arg.value.u;
+            break;
+         case ArgTypeDouble:
+            stream << arg.value.d;
+            break;
+         case ArgTypeBool:
+            stream << (arg.value.i != 0);
+            break;
+         case ArgTypeChar:
+            stream << static_cast<char>(arg.value.i);
+            break;
+         case ArgTypeString:
+            stream.write(strings_ + arg.value.s.offset, arg.value.s.length);
+            if (arg.value.s.truncated)
+               stream << "[...]";
+            break;
+      }
+   }
+};
+
+
+} // namespace internal
+} // namespace logging
+} // namespace mm
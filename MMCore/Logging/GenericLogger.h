@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include "DeferredEntry.h"
+
 #include <boost/function.hpp>
 #include <boost/utility.hpp>
 
@@ -35,6 +37,7 @@ template <typename TEntryData>
 class GenericLogger
 {
    boost::function<void (TEntryData, const char*)> impl_;
+   boost::function<void (TEntryData, const DeferredEntry&)> deferredImpl_;
 
 public:
    typedef TEntryData EntryDataType;
@@ -43,11 +46,31 @@ public:
       impl_(f)
    {}
 
+   GenericLogger(boost::function<void (TEntryData, const char*)> f,
+         boost::function<void (TEntryData, const DeferredEntry&)> deferredF) :
+      impl_(f),
+      deferredImpl_(deferredF)
+   {}
+
    void operator()(TEntryData entryData, const char* message) const
    { impl_(entryData, message); }
 
    void operator()(TEntryData entryData, const std::string& message) const
    { impl_(entryData, message.c_str()); }
+
+   // Log an entry whose text is to be formatted later, if supported by the
+   // implementation (otherwise it is formatted now).
+   void operator()(TEntryData entryData, const DeferredEntry& entry) const
+   {
+      if (deferredImpl_)
+      {
+         deferredImpl_(entryData, entry);
+         return;
+      }
+      std::ostringstream strm;
+      entry.Format(strm);
+      impl_(entryData, strm.str().c_str());
+   }
 };
 
 
@@ -81,6 +104,44 @@ public:
    }
 };
 
+
+/**
+ * Log a deferred entry upon destruction.
+ *
+ * Arguments are added with operator%(); see DeferredEntry for the format.
+ */
+template <class TLogger>
+class GenericDeferredLogStream : boost::noncopyable
+{
+public:
+   typedef typename TLogger::EntryDataType EntryDataType;
+
+private:
+   const TLogger& logger_;
+   EntryDataType level_;
+   DeferredEntry entry_;
+
+public:
+   GenericDeferredLogStream(const TLogger& logger, EntryDataType level,
+         const char* format) :
+      logger_(logger),
+      level_(level),
+      entry_(format)
+   {}
+
+   template <typename T>
+   GenericDeferredLogStream& operator%(const T& arg)
+   {
+      entry_.AddArg(arg);
+      return *this;
+   }
+
+   ~GenericDeferredLogStream()
+   {
+      logger_(level_, entry_);
+   }
+};
+
 } // namespace internal
 } // namespace logging
 } // namespace mm
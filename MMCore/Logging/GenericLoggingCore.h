@@ -22,12 +22,14 @@
 #include "GenericPacketQueue.h"
 #include "GenericSink.h"
 
+#include <boost/atomic.hpp>
 #include <boost/bind.hpp>
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
 
 #include <algorithm>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -68,6 +70,8 @@ private:
 
    boost::mutex syncSinksMutex_; // Protect all access to synchronousSinks_
    std::vector< boost::shared_ptr<SinkType> > synchronousSinks_;
+   // Allows skipping syncSinksMutex_ when logging; set with it held
+   boost::atomic<bool> haveSynchronousSinks_;
 
    boost::mutex asyncQueueMutex_; // Protect start/stop and sinks change
    internal::GenericPacketQueue<TMetadata> asyncQueue_;
@@ -76,7 +80,8 @@ private:
    std::vector< boost::shared_ptr<SinkType> > asynchronousSinks_;
 
 public:
-   GenericLoggingCore() { StartAsyncReceiveLoop(); }
+   GenericLoggingCore() : haveSynchronousSinks_(false)
+   { StartAsyncReceiveLoop(); }
    ~GenericLoggingCore() { StopAsyncReceiveLoop(); }
 
    /**
@@ -90,6 +95,8 @@ public:
       // guaranteed to be safe to call at any time.
       return internal::GenericLogger<EntryDataType>(
             boost::bind(&GenericLoggingCore::SendEntryToShared,
+               this->shared_from_this(), metadata, _1, _2),
+            boost::bind(&GenericLoggingCore::SendDeferredEntryToShared,
                this->shared_from_this(), metadata, _1, _2));
    }
 
@@ -104,6 +111,7 @@ public:
          {
             boost::lock_guard<boost::mutex> lock(syncSinksMutex_);
             synchronousSinks_.push_back(sink);
+            haveSynchronousSinks_ = true;
             break;
          }
          case SinkModeAsynchronous:
@@ -135,6 +143,7 @@ public:
                      sink);
             if (it != synchronousSinks_.end())
                synchronousSinks_.erase(it);
+            haveSynchronousSinks_ = !synchronousSinks_.empty();
             break;
          }
          case SinkModeAsynchronous:
@@ -169,9 +178,9 @@ public:
          SinkModePairIterator lastToAdd)
    {
       // Lock both sink lists in the designated order. Since locking
-      // syncSinksMutex_ causes logging to block, subsequently draining the
-      // async queue by stopping the receive loop causes all sinks to
-      // synchronize (emit up to the same log entry).
+      // syncSinksMutex_ causes logging to block (if there are synchronous
+      // sinks), subsequently draining the async queue by stopping the receive
+      // loop causes all sinks to synchronize (emit up to the same log entry).
       boost::lock_guard<boost::mutex> lockSyncs(syncSinksMutex_);
       boost::lock_guard<boost::mutex> lockAsyncQ(asyncQueueMutex_);
       StopAsyncReceiveLoop();
@@ -209,6 +218,7 @@ public:
          }
       }
 
+      haveSynchronousSinks_ = !synchronousSinks_.empty();
       StartAsyncReceiveLoop();
    }
 
@@ -256,6 +266,31 @@ public:
       StartAsyncReceiveLoop();
    }
 
+   /**
+    * Set the interval at which entries are collected for asynchronous sinks.
+    */
+   void SetAsyncFlushInterval(boost::posix_time::time_duration interval)
+   { asyncQueue_.SetFlushInterval(interval); }
+
+   boost::posix_time::time_duration GetAsyncFlushInterval()
+   { return asyncQueue_.GetFlushInterval(); }
+
+   /**
+    * Limit the number of lines waiting for asynchronous sinks.
+    *
+    * When the limit is reached, logging either blocks until the lines have
+    * been consumed, or discards the oldest waiting lines. A limit of 0 means
+    * no limit.
+    */
+   void SetAsyncQueueCapacity(std::size_t maxLines, bool blockWhenFull)
+   { asyncQueue_.SetCapacity(maxLines, blockWhenFull); }
+
+   std::size_t GetAsyncQueueCapacity() const
+   { return asyncQueue_.GetCapacity(); }
+
+   bool GetAsyncQueueBlocksWhenFull() const
+   { return asyncQueue_.GetBlockWhenFull(); }
+
 private:
    // Static wrapper allowing the use of a shared_ptr for the target instance
    static void
@@ -264,15 +299,48 @@ private:
          const char* entryText)
    { self->SendEntry(loggerData, entryData, entryText); }
 
+   static void
+   SendDeferredEntryToShared(boost::shared_ptr<GenericLoggingCore> self,
+         LoggerDataType loggerData, EntryDataType entryData,
+         const DeferredEntry& entry)
+   { self->SendDeferredEntry(loggerData, entryData, entry); }
+
    void SendEntry(LoggerDataType loggerData, EntryDataType entryData,
          const char* entryText)
    {
       StampDataType stampData;
       stampData.Stamp();
+      SendStampedEntry(loggerData, entryData, stampData, entryText);
+   }
+
+   void SendDeferredEntry(LoggerDataType loggerData, EntryDataType entryData,
+         const DeferredEntry& entry)
+   {
+      StampDataType stampData;
+      stampData.Stamp();
 
+      // Synchronous sinks need the text now, so there is no point in
+      // deferring the formatting.
+      if (haveSynchronousSinks_)
+      {
+         std::ostringstream strm;
+         entry.Format(strm);
+         SendStampedEntry(loggerData, entryData, stampData,
+               strm.str().c_str());
+         return;
+      }
+
+      asyncQueue_.SendDeferredEntry(
+            TMetadata(loggerData, entryData, stampData), entry);
+   }
+
+   void SendStampedEntry(LoggerDataType loggerData, EntryDataType entryData,
+         StampDataType stampData, const char* entryText)
+   {
       PacketArrayType packets;
       packets.AppendEntry(loggerData, entryData, stampData, entryText);
 
+      if (haveSynchronousSinks_)
       {
          boost::lock_guard<boost::mutex> lock(syncSinksMutex_);
 
@@ -283,7 +351,7 @@ private:
             (*it)->Consume(packets);
          }
       }
-      asyncQueue_.SendPackets(packets.Begin(), packets.End());
+      asyncQueue_.SendPackets(packets);
    }
 
    // Called on the receive thread of GenericPacketQueue
@@ -51,6 +51,7 @@ public:
    void Append(TPacketIter first, TPacketIter last)
    { std::copy(first, last, std::back_inserter(packets_)); }
    bool IsEmpty() const { return packets_.empty(); }
+   std::size_t Size() const { return packets_.size(); }
    void Clear() { packets_.clear(); }
    void Swap(GenericPacketArray& other) { packets_.swap(other.packets_); }
    IteratorType Begin() { return packets_.begin(); }
@@ -16,11 +16,21 @@
 
 #pragma once
 
+#include "DeferredEntry.h"
+#include "GenericPacketArray.h"
+
+#include <boost/atomic.hpp>
 #include <boost/bind.hpp>
 #include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <boost/function.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/optional.hpp>
 #include <boost/thread.hpp>
 
+#include <cstddef>
+#include <sstream>
+#include <string>
+
 
 namespace mm
 {
@@ -34,17 +44,56 @@ class GenericPacketQueue
 {
    typedef GenericPacketArray<TMetadata> PacketArrayType;
 
+   // An entry's packets, staged by the sending thread and then linked into
+   // the queue as a unit. Alternatively, an entry yet to be formatted (which
+   // is converted to packets by the receiving thread).
+   struct Node
+   {
+      PacketArrayType packets;
+      boost::optional<TMetadata> deferredMetadata;
+      boost::optional<DeferredEntry> deferredEntry;
+      std::size_t nrPackets; // Counted as 1 for a deferred entry
+      std::size_t nrDropped; // Lines dropped, if this is a notice thereof
+      Node* next;
+
+      const TMetadata& FirstMetadata() const
+      {
+         if (deferredMetadata)
+            return *deferredMetadata;
+         return packets.Begin()->GetMetadataConstRef();
+      }
+   };
+
 private:
-   // The "queue" for asynchronous sinks.
-   boost::mutex mutex_;
-   boost::condition_variable condVar_;
-   PacketArrayType queue_;
+   // The "queue" for asynchronous sinks: a stack of sent nodes, most recent
+   // first. Senders push with compare-and-swap, without taking a lock. Nodes
+   // are only ever removed by taking the whole stack (exchange with null), so
+   // there is no ABA problem.
+   boost::atomic<Node*> head_;
+   boost::atomic<std::size_t> pendingPackets_;
 
-   // Swapped with queue_ and accessed from receiving thread.
-   PacketArrayType received_;
+   // Maximum of pendingPackets_ (0 = unlimited), and whether senders block
+   // (rather than discard the pending packets) when it would be exceeded.
+   boost::atomic<std::size_t> capacity_;
+   boost::atomic<bool> blockWhenFull_;
 
+   // Set by the receiving thread while waiting for data without a timeout;
+   // senders only take mutex_ (to notify) when they clear this flag.
+   boost::atomic<bool> receiverWaiting_;
+   // True while the receive loop runs; senders never block otherwise.
+   boost::atomic<bool> receiving_;
+
+   boost::mutex mutex_;
+   boost::condition_variable condVar_; // Receiving thread waits on this
+   boost::condition_variable spaceCondVar_; // Blocked senders wait on this
+   boost::posix_time::time_duration flushInterval_; // Protected by mutex_
+   bool wakeRequested_; // Protected by mutex_
    bool shutdownRequested_; // Protected by mutex_
 
+   // Accessed from receiving thread.
+   PacketArrayType received_;
+   std::ostringstream formatStream_; // For deferred entries
+
    // threadMutex_ protects the start/stop of loopThread_; it must be acquired
    // before mutex_.
    boost::mutex threadMutex_;
@@ -52,15 +101,96 @@ private:
 
 public:
    GenericPacketQueue() :
+      head_(0),
+      pendingPackets_(0),
+      capacity_(0),
+      blockWhenFull_(false),
+      receiverWaiting_(false),
+      receiving_(false),
+      flushInterval_(boost::posix_time::milliseconds(10)),
+      wakeRequested_(false),
       shutdownRequested_(false)
    {}
 
-   template <typename TPacketIter>
-   void SendPackets(TPacketIter first, TPacketIter last)
+   ~GenericPacketQueue()
+   {
+      Node* node = head_.exchange(0);
+      while (node)
+      {
+         Node* next = node->next;
+         delete node;
+         node = next;
+      }
+   }
+
+   /**
+    * Set the interval at which the receiving thread collects packets while
+    * logging is active.
+    *
+    * A longer interval results in larger batches (and fewer flushes of the
+    * sinks) at the cost of a longer delay before entries are written.
+    */
+   void SetFlushInterval(boost::posix_time::time_duration interval)
    {
       boost::lock_guard<boost::mutex> lock(mutex_);
-      queue_.Append(first, last);
-      condVar_.notify_one();
+      flushInterval_ = interval;
+   }
+
+   boost::posix_time::time_duration GetFlushInterval()
+   {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      return flushInterval_;
+   }
+
+   /**
+    * Limit the number of packets waiting for the receiving thread.
+    *
+    * When the limit would be exceeded, senders either block until the
+    * receiving thread has caught up, or discard the oldest pending packets
+    * (which are replaced by a single entry stating the number of lines
+    * dropped). A capacity of 0 means no limit.
+    */
+   void SetCapacity(std::size_t maxPackets, bool blockWhenFull)
+   {
+      capacity_ = maxPackets;
+      blockWhenFull_ = blockWhenFull;
+
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      spaceCondVar_.notify_all();
+   }
+
+   std::size_t GetCapacity() const { return capacity_; }
+   bool GetBlockWhenFull() const { return blockWhenFull_; }
+
+   /**
+    * Send the packets of an entry to the receiving thread.
+    *
+    * The packets are moved out of the given array, which is left empty.
+    */
+   void SendPackets(PacketArrayType& packets)
+   {
+      if (packets.IsEmpty())
+         return;
+
+      Node* node = new Node;
+      node->packets.Swap(packets);
+      node->nrPackets = node->packets.Size();
+      node->nrDropped = 0;
+      Send(node);
+   }
+
+   /**
+    * Send an entry whose text is to be formatted by the receiving thread.
+    */
+   void SendDeferredEntry(const TMetadata& metadata,
+         const DeferredEntry& entry)
+   {
+      Node* node = new Node;
+      node->deferredMetadata = metadata;
+      node->deferredEntry = entry;
+      node->nrPackets = 1;
+      node->nrDropped = 0;
+      Send(node);
    }
 
    void RunReceiveLoop(boost::function<void (PacketArrayType&)>
@@ -82,6 +212,7 @@ public:
       boost::thread t(boost::bind(&GenericPacketQueue::ReceiveLoop,
                this, consume));
       boost::swap(loopThread_, t);
+      receiving_ = true;
    }
 
    void ShutdownReceiveLoop()
@@ -93,6 +224,8 @@ public:
 
       {
          boost::lock_guard<boost::mutex> lock(mutex_);
+         receiving_ = false;
+         spaceCondVar_.notify_all();
          shutdownRequested_ = true;
          condVar_.notify_one();
       }
@@ -103,14 +236,153 @@ public:
    }
 
 private:
+   void Send(Node* node)
+   {
+      const std::size_t capacity = capacity_.load(boost::memory_order_relaxed);
+      if (capacity > 0 && pendingPackets_ + node->nrPackets > capacity)
+      {
+         if (blockWhenFull_.load(boost::memory_order_relaxed))
+            WaitForSpace(node->nrPackets);
+         else
+            DropPending();
+      }
+
+      Push(node);
+   }
+
+   void Push(Node* node)
+   {
+      pendingPackets_ += node->nrPackets;
+
+      // The expected value must not be node->next itself: the exchange
+      // may store to it even on success, after the receiving thread has
+      // taken (and relinked) the node.
+      Node* expected = head_.load(boost::memory_order_relaxed);
+      do
+         node->next = expected;
+      while (!head_.compare_exchange_weak(expected, node));
+
+      // Only the first sender after the receiving thread started waiting
+      // needs to wake it up.
+      if (receiverWaiting_.load() && receiverWaiting_.exchange(false))
+      {
+         boost::lock_guard<boost::mutex> lock(mutex_);
+         condVar_.notify_one();
+      }
+   }
+
+   // Returns the pending nodes, oldest first.
+   Node* TakePending()
+   {
+      Node* node = head_.exchange(0);
+      Node* reversed = 0;
+      while (node)
+      {
+         Node* next = node->next;
+         node->next = reversed;
+         reversed = node;
+         node = next;
+      }
+      return reversed;
+   }
+
+   void WaitForSpace(std::size_t nrPackets)
+   {
+      const std::size_t capacity = capacity_;
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      wakeRequested_ = true;
+      condVar_.notify_one();
+      // An entry larger than the capacity is sent once the queue is empty
+      while (receiving_ && blockWhenFull_ && pendingPackets_ > 0 &&
+            pendingPackets_ + nrPackets > capacity)
+         spaceCondVar_.wait(lock);
+   }
+
+   // Discard all pending packets, replacing them with an entry stating the
+   // number of lines dropped. This entry takes its metadata from the oldest
+   // discarded entry. Earlier such entries are included in the count.
+   void DropPending()
+   {
+      Node* oldest = TakePending();
+      if (!oldest)
+         return;
+
+      std::size_t nrPackets = 0;
+      std::size_t nrDropped = 0;
+      for (Node* node = oldest; node; node = node->next)
+      {
+         nrPackets += node->nrPackets;
+         nrDropped += (node->nrDropped > 0 ? node->nrDropped : node->nrPackets);
+      }
+
+      const TMetadata& metadata = oldest->FirstMetadata();
+      Node* notice = new Node;
+      notice->packets.AppendEntry(metadata.GetLoggerData(),
+            metadata.GetEntryData(), metadata.GetStampData(),
+            ("(" + boost::lexical_cast<std::string>(nrDropped) +
+             " log lines dropped because the log queue was full)").c_str());
+      notice->nrPackets = notice->packets.Size();
+      notice->nrDropped = nrDropped;
+
+      while (oldest)
+      {
+         Node* next = oldest->next;
+         delete oldest;
+         oldest = next;
+      }
+      pendingPackets_ -= nrPackets;
+
+      Push(notice);
+   }
+
+   // Move the pending packets to received_; returns the number of packets
+   std::size_t ReceivePending()
+   {
+      std::size_t nrPackets = 0;
+      Node* node = TakePending();
+      while (node)
+      {
+         if (node->deferredEntry)
+         {
+            formatStream_.str(std::string());
+            node->deferredEntry->Format(formatStream_);
+            const TMetadata& metadata = *node->deferredMetadata;
+            received_.AppendEntry(metadata.GetLoggerData(),
+                  metadata.GetEntryData(), metadata.GetStampData(),
+                  formatStream_.str().c_str());
+         }
+         else if (received_.IsEmpty())
+            received_.Swap(node->packets);
+         else
+            received_.Append(node->packets.Begin(), node->packets.End());
+         nrPackets += node->nrPackets;
+
+         Node* next = node->next;
+         delete node;
+         node = next;
+      }
+
+      if (nrPackets > 0)
+      {
+         pendingPackets_ -= nrPackets;
+         if (capacity_ > 0)
+         {
+            boost::lock_guard<boost::mutex> lock(mutex_);
+            spaceCondVar_.notify_all();
+         }
+      }
+      return nrPackets;
+   }
+
    void ReceiveLoop(boost::function<void (PacketArrayType&)> consume)
    {
       // The loop operates in one of two modes: timed wait and untimed wait.
       //
-      // When in timed wait mode, the loop unconditionally waits for a fixed
-      // interval before checking for data. If data is available, it is
-      // processed and the loop repeats an unconditional wait. If no data is
-      // available, the loop switches to untimed wait mode.
+      // When in timed wait mode, the loop waits for the flush interval before
+      // checking for data (unless woken by a sender blocked on a full queue).
+      // If data is available, it is processed and the loop repeats a timed
+      // wait. If no data is available, the loop switches to untimed wait
+      // mode.
       //
       // In untimed wait mode, the loop waits on a condition variable until
       // notification from the frontend. Once data is available, the loop
@@ -118,62 +390,60 @@ private:
       //
       // This way, data is processed in batches when logging occurs at high
       // frequency, preventing thrashing between the frontend and backend
-      // threads and limiting the frequency of stream flushing.
+      // threads and limiting the frequency of stream flushing. Senders only
+      // take the mutex when the loop is in untimed wait mode (once per switch
+      // to that mode) or when the queue is full.
 
       bool timedWaitMode = true;
       bool shuttingDown = false;
 
       for (;;)
       {
-         if (timedWaitMode)
          {
-            // TODO Make interval configurable
-            boost::this_thread::sleep(boost::posix_time::milliseconds(10));
-
+            boost::unique_lock<boost::mutex> lock(mutex_);
+            if (timedWaitMode)
             {
-               boost::lock_guard<boost::mutex> lock(mutex_);
-               if (shutdownRequested_)
-               {
-                  shutdownRequested_ = false; // Allow for restarting
-                  shuttingDown = true;
-               }
-               if (!shuttingDown && queue_.IsEmpty())
+               const boost::system_time deadline =
+                  boost::get_system_time() + flushInterval_;
+               while (!shutdownRequested_ && !wakeRequested_)
                {
-                  timedWaitMode = false;
-                  continue;
+                  if (!condVar_.timed_wait(lock, deadline))
+                     break;
                }
-               queue_.Swap(received_);
             }
-            consume(received_);
-            received_.Clear();
-
-            if (shuttingDown)
-               return;
-         }
-         else // untimed wait mode
-         {
+            else // untimed wait mode
             {
-               boost::unique_lock<boost::mutex> lock(mutex_);
-               while (queue_.IsEmpty())
+               for (;;)
                {
-                  condVar_.wait(lock);
-                  if (shutdownRequested_)
-                  {
-                     shutdownRequested_ = false; // Allow for restarting
-                     shuttingDown = true;
+                  receiverWaiting_ = true;
+                  if (shutdownRequested_ || wakeRequested_ || head_.load())
                      break;
-                  }
+                  condVar_.wait(lock);
                }
-               queue_.Swap(received_);
+               receiverWaiting_ = false;
             }
-            consume(received_);
-            received_.Clear();
 
-            if (shuttingDown)
-               return;
+            wakeRequested_ = false;
+            if (shutdownRequested_)
+            {
+               shutdownRequested_ = false; // Allow for restarting
+               shuttingDown = true;
+            }
+         }
 
+         if (ReceivePending() > 0)
+         {
+            consume(received_);
+            received_.Clear();
             timedWaitMode = true;
          }
+         else
+         {
+            timedWaitMode = false;
+         }
+
+         if (shuttingDown)
+            return;
       }
    }
 };
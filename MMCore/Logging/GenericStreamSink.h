@@ -17,13 +17,20 @@
 #pragma once
 
 #include "GenericSink.h"
+#include "LogSegments.h"
 
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/utility.hpp>
 
+#include <cstddef>
+#include <cstdio>
+#include <deque>
 #include <exception>
 #include <iostream>
 #include <fstream>
+#include <string>
+#include <vector>
 
 
 namespace mm
@@ -165,6 +172,161 @@ public:
 };
 
 
+
+/**
+ * File sink that starts a new file when the current one gets too large or
+ * too old.
+ *
+ * The current entries are always written to the given filename. When a
+ * limit is reached, the file is closed and renamed to "<stem>.<N><ext>"
+ * (e.g. CoreLog.txt becomes CoreLog.1.txt, CoreLog.2.txt, ...; N increases
+ * with each rollover), and a new file is started. Rollover happens between
+ * batches of packets, so an entry is never split across files. Numbering
+ * continues after any segments already present (e.g. from a previous
+ * session). Optionally, only the most recent segments, including those
+ * already present, are kept.
+ */
+template <class TMetadata, class UFormatter>
+class GenericRotatingFileLogSink : public GenericSink<TMetadata>,
+   boost::noncopyable
+{
+   std::string filename_;
+   std::size_t maxBytes_; // 0 = no limit
+   boost::posix_time::time_duration maxAge_; // Zero = no limit
+   std::size_t maxOldFiles_; // 0 = keep all
+
+   std::ofstream fileStream_;
+   boost::posix_time::ptime fileStartTime_;
+   unsigned nextSegmentNumber_;
+   std::deque<std::string> oldFiles_; // Oldest first
+   bool hadError_;
+
+public:
+   typedef GenericSink<TMetadata> Super;
+   typedef typename Super::PacketArrayType PacketArrayType;
+
+   GenericRotatingFileLogSink(const std::string& filename, bool append,
+         std::size_t maxBytes, boost::posix_time::time_duration maxAge,
+         std::size_t maxOldFiles) :
+      filename_(filename),
+      maxBytes_(maxBytes),
+      maxAge_(maxAge),
+      maxOldFiles_(maxOldFiles),
+      nextSegmentNumber_(1),
+      hadError_(false)
+   {
+      // Continue after files left by a previous session (or sink), and
+      // count them towards maxOldFiles
+      std::vector<unsigned> existing = FindLogSegments(filename_);
+      for (std::vector<unsigned>::const_iterator it = existing.begin(),
+            end = existing.end(); it != end; ++it)
+         oldFiles_.push_back(SegmentFilename(*it));
+      if (!existing.empty())
+         nextSegmentNumber_ = existing.back() + 1;
+
+      if (!Open(append))
+         throw CannotOpenFileException();
+   }
+
+   virtual void Consume(const PacketArrayType& packets)
+   {
+      if (NeedsRollover())
+         Rollover();
+      if (!fileStream_.is_open())
+         return;
+
+      WritePacketsToStream<UFormatter>(fileStream_,
+            packets.Begin(), packets.End(), this->GetFilter());
+      try
+      {
+         fileStream_.flush();
+      }
+      catch (const std::ios_base::failure& e)
+      {
+         ReportError(e.what());
+      }
+   }
+
+   // Name of the file that the current file will be renamed to on rollover
+   std::string NextSegmentFilename() const
+   { return SegmentFilename(nextSegmentNumber_); }
+
+private:
+   std::string SegmentFilename(unsigned n) const
+   { return LogSegmentFilename(filename_, n); }
+
+   bool Open(bool append)
+   {
+      std::ios_base::openmode mode = std::ios_base::out;
+      mode |= (append ? std::ios_base::app : std::ios_base::trunc);
+      fileStream_.clear();
+      fileStream_.open(filename_.c_str(), mode);
+      fileStartTime_ = boost::posix_time::microsec_clock::universal_time();
+      return fileStream_.is_open();
+   }
+
+   bool NeedsRollover()
+   {
+      if (!fileStream_.is_open())
+         return true; // Retry after a failed rollover
+      if (maxBytes_ > 0)
+      {
+         std::streamoff size = fileStream_.tellp();
+         if (size >= 0 && static_cast<std::size_t>(size) >= maxBytes_)
+            return true;
+      }
+      if (maxAge_ > boost::posix_time::time_duration() &&
+            boost::posix_time::microsec_clock::universal_time() -
+            fileStartTime_ >= maxAge_)
+         return true;
+      return false;
+   }
+
+   void Rollover()
+   {
+      if (!fileStream_.is_open())
+      {
+         // The file may still hold entries that were not renamed, so never
+         // truncate it here
+         if (!Open(true))
+            ReportError("cannot reopen file");
+         return;
+      }
+
+      fileStream_.close();
+      const std::string segment = SegmentFilename(nextSegmentNumber_++);
+      if (std::rename(filename_.c_str(), segment.c_str()) != 0)
+      {
+         ReportError("cannot rename to " + segment);
+         // Keep appending to the current file
+         if (!Open(true))
+            ReportError("cannot reopen file");
+         return;
+      }
+      oldFiles_.push_back(segment);
+
+      while (maxOldFiles_ > 0 && oldFiles_.size() > maxOldFiles_)
+      {
+         std::remove(oldFiles_.front().c_str());
+         oldFiles_.pop_front();
+      }
+
+      if (!Open(false))
+         ReportError("cannot open new file");
+   }
+
+   void ReportError(const std::string& what)
+   {
+      if (!hadError_)
+      {
+         hadError_ = true;
+         std::cerr << "Logging: cannot write to file " << filename_ <<
+            ": " << what << '\n';
+      }
+   }
+};
+
+
 } // namespace internal
 } // namespace logging
 } // namespace mm
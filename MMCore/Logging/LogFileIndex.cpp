@@ -0,0 +1,684 @@
+// COPYRIGHT:     University of California, San Francisco, 2014,
+//                All Rights reserved
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "LogFileIndex.h"
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+
+namespace mm
+{
+namespace logging
+{
+
+namespace
+{
+
+const char sidecarMagic[8] = { 'M', 'M', 'L', 'O', 'G', 'I', 'X', '1' };
+const std::size_t maxFilePrefixLength = 256;
+
+// Days since 1970-01-01 of a date in the proleptic Gregorian calendar
+boost::int64_t DaysFromCivil(int y, int m, int d)
+{
+   y -= (m <= 2);
+   const int era = (y >= 0 ? y : y - 399) / 400;
+   const int yoe = y - era * 400;
+   const int doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+   const int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+   return era * 146097LL + doe - 719468;
+}
+
+bool ParseDigits(const char* p, int nrDigits, int& value)
+{
+   value = 0;
+   for (int i = 0; i < nrDigits; ++i)
+   {
+      if (p[i] < '0' || p[i] > '9')
+         return false;
+      value = value * 10 + (p[i] - '0');
+   }
+   return true;
+}
+
+const char* FindLineEnd(const char* p, const char* end)
+{
+   const void* nl = std::memchr(p, '\n', end - p);
+   return nl ? static_cast<const char*>(nl) : 0;
+}
+
+bool ContainsText(const char* begin, const char* end, const std::string& text)
+{
+   if (text.empty())
+      return true;
+   return std::search(begin, end, text.begin(), text.end()) != end;
+}
+
+void WriteU32(std::ostream& s, boost::uint32_t v)
+{
+   char b[4];
+   for (int i = 0; i < 4; ++i)
+      b[i] = static_cast<char>((v >> (8 * i)) & 0xff);
+   s.write(b, 4);
+}
+
+void WriteU64(std::ostream& s, boost::uint64_t v)
+{
+   WriteU32(s, static_cast<boost::uint32_t>(v & 0xffffffffu));
+   WriteU32(s, static_cast<boost::uint32_t>(v >> 32));
+}
+
+void WriteString(std::ostream& s, const std::string& str)
+{
+   WriteU32(s, static_cast<boost::uint32_t>(str.size()));
+   s.write(str.data(), str.size());
+}
+
+bool ReadU32(std::istream& s, boost::uint32_t& v)
+{
+   unsigned char b[4];
+   if (!s.read(reinterpret_cast<char*>(b), 4))
+      return false;
+   v = b[0] | (b[1] << 8) | (b[2] << 16) |
+      (static_cast<boost::uint32_t>(b[3]) << 24);
+   return true;
+}
+
+bool ReadU64(std::istream& s, boost::uint64_t& v)
+{
+   boost::uint32_t lo, hi;
+   if (!ReadU32(s, lo) || !ReadU32(s, hi))
+      return false;
+   v = (static_cast<boost::uint64_t>(hi) << 32) | lo;
+   return true;
+}
+
+bool ReadString(std::istream& s, std::string& str)
+{
+   boost::uint32_t length;
+   if (!ReadU32(s, length) || length > (1u << 20))
+      return false;
+   str.resize(length);
+   return length == 0 || s.read(&str[0], length);
+}
+
+} // anonymous namespace
+
+
+std::size_t
+ParseLogTimestamp(const char* begin, const char* end,
+      boost::int64_t& timestamp)
+{
+   // YYYY-MM-DDTHH:MM:SS
+   if (end - begin < 19)
+      return 0;
+   int year, month, day, hour, minute, second;
+   if (!ParseDigits(begin, 4, year) || begin[4] != '-' ||
+         !ParseDigits(begin + 5, 2, month) || begin[7] != '-' ||
+         !ParseDigits(begin + 8, 2, day) ||
+         (begin[10] != 'T' && begin[10] != ' ') ||
+         !ParseDigits(begin + 11, 2, hour) || begin[13] != ':' ||
+         !ParseDigits(begin + 14, 2, minute) || begin[16] != ':' ||
+         !ParseDigits(begin + 17, 2, second))
+      return 0;
+   if (month < 1 || month > 12 || day < 1 || day > 31)
+      return 0;
+
+   boost::int64_t us = 0;
+   const char* p = begin + 19;
+   if (p < end && *p == '.')
+   {
+      ++p;
+      int nrDigits = 0;
+      for (; p < end && *p >= '0' && *p <= '9' && nrDigits < 6;
+            ++p, ++nrDigits)
+         us = us * 10 + (*p - '0');
+      if (nrDigits == 0)
+         return 0;
+      for (; nrDigits < 6; ++nrDigits)
+         us *= 10;
+   }
+
+   timestamp = ((DaysFromCivil(year, month, day) * 24 + hour) * 60 +
+         minute) * 60 + second;
+   timestamp = timestamp * 1000000 + us;
+   return p - begin;
+}
+
+
+bool
+ParseLogLevel(const std::string& s, LogLevel& level)
+{
+   std::string lower(s);
+   for (std::string::iterator it = lower.begin(); it != lower.end(); ++it)
+      *it = static_cast<char>(std::tolower(static_cast<unsigned char>(*it)));
+
+   if (lower == "trc") level = LogLevelTrace;
+   else if (lower == "dbg") level = LogLevelDebug;
+   else if (lower == "ifo") level = LogLevelInfo;
+   else if (lower == "wrn") level = LogLevelWarning;
+   else if (lower == "err") level = LogLevelError;
+   else if (lower == "ftl") level = LogLevelFatal;
+   else return false;
+   return true;
+}
+
+
+bool
+ParseLogLineHeader(const char* begin, const char* end, LogLineHeader& header)
+{
+   std::size_t timestampLength =
+      ParseLogTimestamp(begin, end, header.timestamp);
+   if (timestampLength == 0)
+      return false;
+
+   const char* p = begin + timestampLength;
+   if (end - p < 4 || std::memcmp(p, " tid", 4) != 0)
+      return false;
+   p += 4;
+   while (p < end && *p != ' ')
+      ++p;
+
+   // " [LVL,"
+   if (end - p < 6 || p[1] != '[' || p[5] != ',')
+      return false;
+   if (!ParseLogLevel(std::string(p + 2, 3), header.level))
+      return false;
+   p += 6;
+
+   const char* close = static_cast<const char*>(std::memchr(p, ']', end - p));
+   if (!close)
+      return false;
+   header.component = p;
+   header.componentLength = close - p;
+   return true;
+}
+
+
+bool
+LogQuery::MatchesHeader(const LogLineHeader& header) const
+{
+   if (!(levelMask & (1u << header.level)))
+      return false;
+   if (!components.empty())
+   {
+      bool found = false;
+      for (std::vector<std::string>::const_iterator it = components.begin(),
+            end = components.end(); it != end && !found; ++it)
+      {
+         found = (it->size() == header.componentLength &&
+               std::memcmp(it->data(), header.component,
+                  header.componentLength) == 0);
+      }
+      if (!found)
+         return false;
+   }
+   if (since && header.timestamp < *since)
+      return false;
+   if (until && header.timestamp > *until)
+      return false;
+   return true;
+}
+
+
+LogFileIndex::LogFileIndex() :
+   indexedLength_(0)
+{
+}
+
+
+void
+LogFileIndex::Clear()
+{
+   indexedLength_ = 0;
+   filePrefix_.clear();
+   componentNames_.clear();
+   componentIds_.clear();
+   blocks_.clear();
+}
+
+
+bool
+LogFileIndex::IsValidFor(const char* data, std::size_t size) const
+{
+   if (size < indexedLength_ || size < filePrefix_.size())
+      return false;
+   if (filePrefix_.size() < std::min<boost::uint64_t>(indexedLength_,
+            maxFilePrefixLength))
+      return false;
+   return std::memcmp(data, filePrefix_.data(), filePrefix_.size()) == 0;
+}
+
+
+boost::uint32_t
+LogFileIndex::ComponentId(const char* name, std::size_t length)
+{
+   const std::string key(name, length);
+   std::map<std::string, boost::uint32_t>::const_iterator found =
+      componentIds_.find(key);
+   if (found != componentIds_.end())
+      return found->second;
+
+   boost::uint32_t id = static_cast<boost::uint32_t>(componentNames_.size());
+   componentNames_.push_back(key);
+   componentIds_.insert(std::make_pair(key, id));
+   return id;
+}
+
+
+void
+LogFileIndex::Update(const char* data, std::size_t size)
+{
+   // The last block may have been cut short by the end of the data, so
+   // index it again.
+   boost::uint64_t start = indexedLength_;
+   if (!blocks_.empty())
+   {
+      start = blocks_.back().begin;
+      blocks_.pop_back();
+   }
+
+   const char* const end = data + size;
+   const char* p = data + start;
+   Block* block = 0; // Earlier blocks are complete; always start a new one
+
+   const char* lineEnd;
+   while (p < end && (lineEnd = FindLineEnd(p, end)) != 0)
+   {
+      LogLineHeader header;
+      if (ParseLogLineHeader(p, lineEnd, header))
+      {
+         if (!block || block->nrEntries >= MaxEntriesPerBlock ||
+               (p - data) - block->begin >= MaxBytesPerBlock)
+         {
+            if (block)
+               block->end = p - data;
+            blocks_.push_back(Block());
+            block = &blocks_.back();
+            block->begin = p - data;
+            block->minTimestamp = header.timestamp;
+            block->maxTimestamp = header.timestamp;
+            block->nrEntries = 0;
+            block->levelMask = 0;
+         }
+
+         ++block->nrEntries;
+         block->minTimestamp = std::min(block->minTimestamp, header.timestamp);
+         block->maxTimestamp = std::max(block->maxTimestamp, header.timestamp);
+         block->levelMask |= 1u << header.level;
+         const boost::uint32_t id =
+            ComponentId(header.component, header.componentLength);
+         std::vector<boost::uint32_t>::iterator it = std::lower_bound(
+               block->components.begin(), block->components.end(), id);
+         if (it == block->components.end() || *it != id)
+            block->components.insert(it, id);
+      }
+      // Other lines are continuations of the current entry (or precede the
+      // first entry, in which case they are not indexed).
+      p = lineEnd + 1;
+   }
+
+   indexedLength_ = p - data;
+   if (block)
+      block->end = indexedLength_;
+   if (filePrefix_.size() < maxFilePrefixLength)
+      filePrefix_.assign(data, static_cast<std::size_t>(
+               std::min<boost::uint64_t>(indexedLength_, maxFilePrefixLength)));
+}
+
+
+bool
+LogFileIndex::BlockMayMatch(const Block& block, const LogQuery& query,
+      const std::vector<boost::uint32_t>& componentIds) const
+{
+   if (!(block.levelMask & query.levelMask))
+      return false;
+   if (query.since && block.maxTimestamp < *query.since)
+      return false;
+   if (query.until && block.minTimestamp > *query.until)
+      return false;
+   if (query.components.empty())
+      return true;
+   for (std::vector<boost::uint32_t>::const_iterator it = componentIds.begin(),
+         end = componentIds.end(); it != end; ++it)
+   {
+      if (std::binary_search(block.components.begin(),
+               block.components.end(), *it))
+         return true;
+   }
+   return false;
+}
+
+
+std::size_t
+LogFileIndex::Query(const char* data, std::size_t size,
+      const LogQuery& query, std::ostream& out) const
+{
+   std::vector<boost::uint32_t> componentIds;
+   for (std::vector<std::string>::const_iterator it = query.components.begin(),
+         end = query.components.end(); it != end; ++it)
+   {
+      std::map<std::string, boost::uint32_t>::const_iterator found =
+         componentIds_.find(*it);
+      if (found != componentIds_.end())
+         componentIds.push_back(found->second);
+   }
+   if (!query.components.empty() && componentIds.empty())
+      return 0;
+
+   std::size_t nrMatches = 0;
+   for (std::vector<Block>::const_iterator it = blocks_.begin(),
+         blockEnd = blocks_.end(); it != blockEnd; ++it)
+   {
+      if (it->end > size || !BlockMayMatch(*it, query, componentIds))
+         continue;
+
+      const char* const end = data + it->end;
+      const char* p = data + it->begin;
+      const char* entryBegin = 0; // Start of current entry if it matches
+      while (p < end)
+      {
+         // Blocks end at line boundaries
+         const char* lineEnd = FindLineEnd(p, end);
+
+         LogLineHeader header;
+         if (ParseLogLineHeader(p, lineEnd, header))
+         {
+            if (entryBegin && ContainsText(entryBegin, p, query.text))
+            {
+               out.write(entryBegin, p - entryBegin);
+               ++nrMatches;
+            }
+            entryBegin = query.MatchesHeader(header) ? p : 0;
+         }
+         p = lineEnd + 1;
+      }
+      if (entryBegin && ContainsText(entryBegin, end, query.text))
+      {
+         out.write(entryBegin, end - entryBegin);
+         ++nrMatches;
+      }
+   }
+   return nrMatches;
+}
+
+
+void
+LogFileIndex::Save(std::ostream& stream) const
+{
+   stream.write(sidecarMagic, sizeof(sidecarMagic));
+   WriteU64(stream, indexedLength_);
+   WriteString(stream, filePrefix_);
+
+   WriteU32(stream, static_cast<boost::uint32_t>(componentNames_.size()));
+   for (std::vector<std::string>::const_iterator it = componentNames_.begin(),
+         end = componentNames_.end(); it != end; ++it)
+      WriteString(stream, *it);
+
+   WriteU32(stream, static_cast<boost::uint32_t>(blocks_.size()));
+   for (std::vector<Block>::const_iterator it = blocks_.begin(),
+         end = blocks_.end(); it != end; ++it)
+   {
+      WriteU64(stream, it->begin);
+      WriteU64(stream, it->end);
+      WriteU64(stream, static_cast<boost::uint64_t>(it->minTimestamp));
+      WriteU64(stream, static_cast<boost::uint64_t>(it->maxTimestamp));
+      WriteU32(stream, it->nrEntries);
+      WriteU32(stream, it->levelMask);
+      WriteU32(stream, static_cast<boost::uint32_t>(it->components.size()));
+      for (std::size_t i = 0; i < it->components.size(); ++i)
+         WriteU32(stream, it->components[i]);
+   }
+}
+
+
+bool
+LogFileIndex::Load(std::istream& stream)
+{
+   Clear();
+
+   char magic[sizeof(sidecarMagic)];
+   if (!stream.read(magic, sizeof(magic)) ||
+         std::memcmp(magic, sidecarMagic, sizeof(magic)) != 0)
+      return false;
+
+   boost::uint32_t nrComponents, nrBlocks;
+   if (!ReadU64(stream, indexedLength_) || !ReadString(stream, filePrefix_) ||
+         !ReadU32(stream, nrComponents))
+   {
+      Clear();
+      return false;
+   }
+   for (boost::uint32_t i = 0; i < nrComponents; ++i)
+   {
+      std::string name;
+      if (!ReadString(stream, name))
+      {
+         Clear();
+         return false;
+      }
+      componentIds_.insert(std::make_pair(name, i));
+      componentNames_.push_back(name);
+   }
+
+   if (!ReadU32(stream, nrBlocks))
+   {
+      Clear();
+      return false;
+   }
+   for (boost::uint32_t i = 0; i < nrBlocks; ++i)
+   {
+      Block block;
+      boost::uint64_t minTimestamp, maxTimestamp;
+      boost::uint32_t levelMask, nrBlockComponents;
+      if (!ReadU64(stream, block.begin) || !ReadU64(stream, block.end) ||
+            !ReadU64(stream, minTimestamp) || !ReadU64(stream, maxTimestamp) ||
+            !ReadU32(stream, block.nrEntries) || !ReadU32(stream, levelMask) ||
+            !ReadU32(stream, nrBlockComponents) ||
+            nrBlockComponents > nrComponents)
+      {
+         Clear();
+         return false;
+      }
+      block.minTimestamp = static_cast<boost::int64_t>(minTimestamp);
+      block.maxTimestamp = static_cast<boost::int64_t>(maxTimestamp);
+      block.levelMask = levelMask;
+      block.components.resize(nrBlockComponents);
+      for (boost::uint32_t j = 0; j < nrBlockComponents; ++j)
+      {
+         if (!ReadU32(stream, block.components[j]))
+         {
+            Clear();
+            return false;
+         }
+      }
+      blocks_.push_back(block);
+   }
+   return true;
+}
+
+
+class IndexedLogFile::MappedFile
+{
+   boost::interprocess::file_mapping mapping_;
+   boost::interprocess::mapped_region region_;
+
+public:
+   MappedFile(const std::string& filename, std::size_t size) :
+      mapping_(filename.c_str(), boost::interprocess::read_only),
+      region_(mapping_, boost::interprocess::read_only, 0, size)
+   {}
+
+   const char* Data() const
+   { return static_cast<const char*>(region_.get_address()); }
+   std::size_t Size() const { return region_.get_size(); }
+};
+
+
+IndexedLogFile::IndexedLogFile(const std::string& filename,
+      bool useSidecar) :
+   filename_(filename)
+{
+   std::ifstream probe(filename.c_str(),
+         std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+   if (!probe.is_open())
+      throw std::runtime_error("Cannot open log file " + filename);
+   const std::streamoff size = probe.tellg();
+   probe.close();
+
+   // A mapping cannot be empty; an empty file has an empty index.
+   if (size <= 0)
+      return;
+   file_.reset(new MappedFile(filename, static_cast<std::size_t>(size)));
+
+   const std::string sidecar = SidecarFilename(filename);
+   if (useSidecar)
+   {
+      std::ifstream in(sidecar.c_str(),
+            std::ios_base::in | std::ios_base::binary);
+      if (in.is_open())
+         index_.Load(in);
+   }
+   if (!index_.IsValidFor(file_->Data(), file_->Size()))
+      index_.Clear();
+
+   const boost::uint64_t previousLength = index_.GetIndexedLength();
+   index_.Update(file_->Data(), file_->Size());
+
+   if (useSidecar && (index_.GetIndexedLength() != previousLength ||
+            previousLength == 0))
+   {
+      std::ofstream out(sidecar.c_str(), std::ios_base::out |
+            std::ios_base::binary | std::ios_base::trunc);
+      if (out.is_open())
+         index_.Save(out);
+   }
+}
+
+
+IndexedLogFile::~IndexedLogFile()
+{
+}
+
+
+std::size_t
+IndexedLogFile::Query(const LogQuery& query, std::ostream& out) const
+{
+   if (!file_)
+      return 0;
+   return index_.Query(file_->Data(), file_->Size(), query, out);
+}
+
+
+LogFollower::LogFollower(const std::string& filename, const LogQuery& query,
+      boost::uint64_t startOffset) :
+   filename_(filename),
+   query_(query),
+   offset_(startOffset),
+   pendingHasHeader_(false),
+   pendingMatches_(false)
+{
+}
+
+
+std::size_t
+LogFollower::Poll(std::ostream& out)
+{
+   std::size_t nrWritten = 0;
+
+   std::ifstream file(filename_.c_str(),
+         std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+   if (!file.is_open())
+      return 0;
+   const std::streamoff size = file.tellg();
+   if (size < 0)
+      return 0;
+   if (static_cast<boost::uint64_t>(size) < offset_)
+   {
+      // Replaced by a new file
+      offset_ = 0;
+      partialLine_.clear();
+      FlushEntry(out, nrWritten);
+   }
+   if (static_cast<boost::uint64_t>(size) == offset_)
+      return nrWritten;
+
+   file.seekg(static_cast<std::streamoff>(offset_));
+   std::vector<char> buffer(static_cast<std::size_t>(size - offset_));
+   file.read(&buffer[0], buffer.size());
+   const std::size_t nrRead = static_cast<std::size_t>(file.gcount());
+   offset_ += nrRead;
+
+   const char* p = &buffer[0];
+   const char* const end = p + nrRead;
+   const char* lineEnd;
+   while (p < end && (lineEnd = FindLineEnd(p, end)) != 0)
+   {
+      partialLine_.append(p, lineEnd + 1);
+      AddLine(partialLine_, out, nrWritten);
+      partialLine_.clear();
+      p = lineEnd + 1;
+   }
+   partialLine_.append(p, end);
+
+   // Sinks write each entry in one go, so an entry is complete once no
+   // partial line remains.
+   if (partialLine_.empty())
+      FlushEntry(out, nrWritten);
+   out.flush();
+   return nrWritten;
+}
+
+
+void
+LogFollower::AddLine(const std::string& line, std::ostream& out,
+      std::size_t& nrWritten)
+{
+   LogLineHeader header;
+   const char* begin = line.data();
+   if (ParseLogLineHeader(begin, begin + line.size(), header))
+   {
+      FlushEntry(out, nrWritten);
+      pendingHasHeader_ = true;
+      pendingMatches_ = query_.MatchesHeader(header);
+   }
+   if (pendingMatches_)
+      pendingEntry_ += line;
+}
+
+
+void
+LogFollower::FlushEntry(std::ostream& out, std::size_t& nrWritten)
+{
+   if (pendingHasHeader_ && pendingMatches_ &&
+         ContainsText(pendingEntry_.data(),
+            pendingEntry_.data() + pendingEntry_.size(), query_.text))
+   {
+      out << pendingEntry_;
+      ++nrWritten;
+   }
+   pendingEntry_.clear();
+   pendingHasHeader_ = false;
+   pendingMatches_ = false;
+}
+
+
+} // namespace logging
+} // namespace mm
@@ -0,0 +1,244 @@
+// COPYRIGHT:     University of California, San Francisco, 2014,
+//                All Rights reserved
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "Metadata.h"
+
+#include <boost/cstdint.hpp>
+#include <boost/optional.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/utility.hpp>
+
+#include <cstddef>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+namespace mm
+{
+namespace logging
+{
+
+
+/**
+ * The metadata prefix of the first line of a log entry, as written by
+ * MetadataFormatter: "YYYY-MM-DDTHH:MM:SS[.ffffff] tid<N> [LVL,component]".
+ */
+struct LogLineHeader
+{
+   // Local time as written in the log, in microseconds since
+   // 1970-01-01T00:00:00 (no time zone conversion is done)
+   boost::int64_t timestamp;
+   LogLevel level;
+   const char* component; // Points into the parsed line
+   std::size_t componentLength;
+};
+
+
+/**
+ * Parse the metadata prefix of a log line.
+ *
+ * Returns false if the line does not start with a metadata prefix (i.e. it is
+ * a continuation line or not from a Micro-Manager log).
+ */
+bool ParseLogLineHeader(const char* begin, const char* end,
+      LogLineHeader& header);
+
+/**
+ * Parse a timestamp in the log format ("YYYY-MM-DDTHH:MM:SS[.ffffff]"; a
+ * space may be used instead of the 'T').
+ *
+ * Returns the number of characters consumed, or 0 on error.
+ */
+std::size_t ParseLogTimestamp(const char* begin, const char* end,
+      boost::int64_t& timestamp);
+
+/**
+ * Parse a level as written in the log ("trc", "dbg", "IFO", "WRN", "ERR",
+ * "FTL"; case insensitive).
+ */
+bool ParseLogLevel(const std::string& s, LogLevel& level);
+
+
+/**
+ * Criteria for selecting log entries. Default-constructed, it matches all
+ * entries.
+ */
+struct LogQuery
+{
+   unsigned levelMask; // Bit (1 << level) set for each level to include
+   std::vector<std::string> components; // Any of these; empty matches all
+   boost::optional<boost::int64_t> since; // Inclusive
+   boost::optional<boost::int64_t> until; // Inclusive
+   std::string text; // Substring of the entry; empty matches all
+
+   LogQuery() : levelMask(~0u) {}
+
+   void SetMinimumLevel(LogLevel level)
+   { levelMask = ~0u << level; }
+
+   // Add the components of a device ("dev:<label>" and "Core:dev:<label>")
+   void AddDevice(const std::string& label)
+   {
+      components.push_back("dev:" + label);
+      components.push_back("Core:dev:" + label);
+   }
+
+   bool MatchesHeader(const LogLineHeader& header) const;
+};
+
+
+/**
+ * Index of a log file, for answering queries without reading the whole file.
+ *
+ * The file is divided into blocks of consecutive entries; for each block, the
+ * index records its byte range, its time range, and the levels and components
+ * of its entries. A query only reads the blocks that may contain matches.
+ *
+ * The index can be saved to a sidecar file and later updated incrementally as
+ * the log grows. Lines that precede the first entry header in the log are
+ * not indexed.
+ */
+class LogFileIndex
+{
+public:
+   static const std::size_t MaxEntriesPerBlock = 1024;
+   static const std::size_t MaxBytesPerBlock = 256 * 1024;
+
+   struct Block
+   {
+      boost::uint64_t begin;
+      boost::uint64_t end;
+      boost::int64_t minTimestamp;
+      boost::int64_t maxTimestamp;
+      boost::uint32_t nrEntries;
+      unsigned levelMask;
+      std::vector<boost::uint32_t> components; // Sorted ids
+   };
+
+private:
+   boost::uint64_t indexedLength_; // Always at a line boundary
+   std::string filePrefix_; // First bytes of the file, to detect replacement
+   std::vector<std::string> componentNames_;
+   std::map<std::string, boost::uint32_t> componentIds_;
+   std::vector<Block> blocks_;
+
+public:
+   LogFileIndex();
+
+   /**
+    * Return true if the index describes a prefix of the given log contents.
+    */
+   bool IsValidFor(const char* data, std::size_t size) const;
+
+   /**
+    * Index the part of the log that is not yet indexed.
+    *
+    * The log contents must be those that the index is valid for, possibly
+    * with data appended; otherwise call Clear() first. Only complete lines
+    * are indexed.
+    */
+   void Update(const char* data, std::size_t size);
+
+   void Clear();
+
+   boost::uint64_t GetIndexedLength() const { return indexedLength_; }
+   const std::vector<Block>& GetBlocks() const { return blocks_; }
+
+   /**
+    * Write the entries in the indexed part of the log that match query to
+    * out. Returns the number of matching entries.
+    */
+   std::size_t Query(const char* data, std::size_t size,
+         const LogQuery& query, std::ostream& out) const;
+
+   void Save(std::ostream& stream) const;
+   bool Load(std::istream& stream);
+
+private:
+   boost::uint32_t ComponentId(const char* name, std::size_t length);
+   bool BlockMayMatch(const Block& block, const LogQuery& query,
+         const std::vector<boost::uint32_t>& componentIds) const;
+};
+
+
+/**
+ * A log file mapped into memory, together with its index.
+ *
+ * On construction, the sidecar index ("<filename>.idx") is loaded if it is
+ * valid for the file, and is updated and saved if the file has grown. If the
+ * sidecar cannot be written, the index is only kept in memory.
+ */
+class IndexedLogFile : boost::noncopyable
+{
+   class MappedFile;
+
+   std::string filename_;
+   boost::scoped_ptr<MappedFile> file_;
+   LogFileIndex index_;
+
+public:
+   explicit IndexedLogFile(const std::string& filename,
+         bool useSidecar = true);
+   ~IndexedLogFile();
+
+   const LogFileIndex& GetIndex() const { return index_; }
+
+   std::size_t Query(const LogQuery& query, std::ostream& out) const;
+
+   static std::string SidecarFilename(const std::string& filename)
+   { return filename + ".idx"; }
+};
+
+
+/**
+ * Follows a log file as it is written (like tail -f), writing the new
+ * entries that match a query.
+ *
+ * If the file shrinks (e.g. because it was rolled over to a new file), it
+ * is read again from the beginning.
+ */
+class LogFollower : boost::noncopyable
+{
+   std::string filename_;
+   LogQuery query_;
+   boost::uint64_t offset_;
+   std::string partialLine_;
+   std::string pendingEntry_;
+   bool pendingHasHeader_;
+   bool pendingMatches_;
+
+public:
+   LogFollower(const std::string& filename, const LogQuery& query,
+         boost::uint64_t startOffset);
+
+   /**
+    * Read what has been appended to the file and write matching entries to
+    * out. Returns the number of entries written.
+    */
+   std::size_t Poll(std::ostream& out);
+
+private:
+   void AddLine(const std::string& line, std::ostream& out,
+         std::size_t& nrWritten);
+   void FlushEntry(std::ostream& out, std::size_t& nrWritten);
+};
+
+
+} // namespace logging
+} // namespace mm
@@ -0,0 +1,148 @@
+// COPYRIGHT:     University of California, San Francisco, 2014,
+//                All Rights reserved
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "LogSegments.h"
+
+#ifdef WIN32
+   #include <io.h>
+#else
+   #include <sys/types.h>
+   #include <dirent.h>
+#endif // WIN32
+
+#include <boost/lexical_cast.hpp>
+
+#include <algorithm>
+#include <cctype>
+
+
+namespace mm
+{
+namespace logging
+{
+namespace internal
+{
+
+namespace
+{
+
+// Split filename into the part before the segment number (including the
+// dot) and the extension
+void SplitLogFilename(const std::string& filename,
+      std::string& prefix, std::string& extension)
+{
+   // The number goes before the extension, if any (but not before a dot in
+   // a directory name or at the start of the filename).
+   std::string::size_type dot = filename.rfind('.');
+   std::string::size_type sep = filename.find_last_of("/\\");
+   if (dot == std::string::npos || dot == 0 ||
+         (sep != std::string::npos && dot <= sep + 1))
+      dot = filename.size();
+   prefix = filename.substr(0, dot) + ".";
+   extension = filename.substr(dot);
+}
+
+// List the names (without directory) of the files in dir
+std::vector<std::string> ListDirectory(const std::string& dir)
+{
+   std::vector<std::string> names;
+#ifdef WIN32
+   std::string pattern = dir + "\\*";
+   struct _finddata_t file;
+   intptr_t hSearch = _findfirst(pattern.c_str(), &file);
+   if (hSearch != -1L)
+   {
+      do {
+         names.push_back(file.name);
+      } while (_findnext(hSearch, &file) == 0);
+      _findclose(hSearch);
+   }
+#else // UNIX
+   DIR* dp = opendir(dir.c_str());
+   if (dp)
+   {
+      struct dirent* dirp;
+      while ((dirp = readdir(dp)) != NULL)
+         names.push_back(dirp->d_name);
+      closedir(dp);
+   }
+#endif // UNIX
+   return names;
+}
+
+} // anonymous namespace
+
+
+std::string
+LogSegmentFilename(const std::string& filename, unsigned n)
+{
+   std::string prefix, extension;
+   SplitLogFilename(filename, prefix, extension);
+   return prefix + boost::lexical_cast<std::string>(n) + extension;
+}
+
+
+std::vector<unsigned>
+FindLogSegments(const std::string& filename)
+{
+   std::string prefix, extension;
+   SplitLogFilename(filename, prefix, extension);
+
+   std::string dir = ".";
+   std::string::size_type sep = prefix.find_last_of("/\\");
+   if (sep != std::string::npos)
+   {
+      dir = prefix.substr(0, sep + 1);
+      prefix = prefix.substr(sep + 1);
+   }
+
+   std::vector<unsigned> numbers;
+   std::vector<std::string> names = ListDirectory(dir);
+   for (std::vector<std::string>::const_iterator it = names.begin(),
+         end = names.end(); it != end; ++it)
+   {
+      if (it->size() <= prefix.size() + extension.size() ||
+            it->compare(0, prefix.size(), prefix) != 0 ||
+            it->compare(it->size() - extension.size(), extension.size(),
+               extension) != 0)
+         continue;
+      const std::string number = it->substr(prefix.size(),
+            it->size() - prefix.size() - extension.size());
+      // Only names as written by LogSegmentFilename() (no leading zeros)
+      bool valid = (number[0] != '0');
+      for (std::string::const_iterator c = number.begin();
+            c != number.end(); ++c)
+      {
+         if (!std::isdigit(static_cast<unsigned char>(*c)))
+            valid = false;
+      }
+      if (!valid)
+         continue;
+      try
+      {
+         numbers.push_back(boost::lexical_cast<unsigned>(number));
+      }
+      catch (const boost::bad_lexical_cast&)
+      {
+         // Out of range; not one of ours
+      }
+   }
+   std::sort(numbers.begin(), numbers.end());
+   return numbers;
+}
+
+
+} // namespace internal
+} // namespace logging
+} // namespace mm
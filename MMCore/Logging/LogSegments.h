@@ -0,0 +1,44 @@
+// COPYRIGHT:     University of California, San Francisco, 2014,
+//                All Rights reserved
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+
+namespace mm
+{
+namespace logging
+{
+namespace internal
+{
+
+
+/**
+ * Name of segment n of a rotated log file: "<stem>.<n><ext>" (e.g. segment 2
+ * of CoreLog.txt is CoreLog.2.txt).
+ */
+std::string LogSegmentFilename(const std::string& filename, unsigned n);
+
+/**
+ * Numbers of the existing segments of a rotated log file, in increasing
+ * order.
+ */
+std::vector<unsigned> FindLogSegments(const std::string& filename);
+
+
+} // namespace internal
+} // namespace logging
+} // namespace mm
@@ -27,6 +27,7 @@ namespace logging
 
 typedef internal::GenericLogger<EntryData> Logger;
 typedef internal::GenericLogStream<Logger> LogStream;
+typedef internal::GenericDeferredLogStream<Logger> DeferredLogStream;
 
 } // namespace logging
 } // namespace mm
@@ -60,3 +61,24 @@ typedef internal::GenericLogStream<Logger> LogStream;
 #define LOG_WARNING(logger) LOG_WITH_LEVEL((logger), ::mm::logging::LogLevelWarning)
 #define LOG_ERROR(logger) LOG_WITH_LEVEL((logger), ::mm::logging::LogLevelError)
 #define LOG_FATAL(logger) LOG_WITH_LEVEL((logger), ::mm::logging::LogLevelFatal)
+
+
+// Deferred-formatting variants, for frequently executed code
+//
+// Usage:
+//
+//     LOG_DEBUG_DEFERRED(myLogger, "Moved {} to {} um") % label % position;
+//
+// Only the format pointer and the argument values are recorded when logging;
+// the text is produced on the logging backend thread (see DeferredEntry). The
+// format must be a string literal.
+
+#define LOG_DEFERRED_WITH_LEVEL(logger, level, format) \
+   ::mm::logging::DeferredLogStream((logger), (level), ("" format ""))
+
+#define LOG_TRACE_DEFERRED(logger, format) \
+   LOG_DEFERRED_WITH_LEVEL((logger), ::mm::logging::LogLevelTrace, format)
+#define LOG_DEBUG_DEFERRED(logger, format) \
+   LOG_DEFERRED_WITH_LEVEL((logger), ::mm::logging::LogLevelDebug, format)
+#define LOG_INFO_DEFERRED(logger, format) \
+   LOG_DEFERRED_WITH_LEVEL((logger), ::mm::logging::LogLevelInfo, format)
@@ -39,6 +39,9 @@ typedef internal::GenericStdErrLogSink<Metadata, internal::MetadataFormatter>
    StdErrLogSink;
 typedef internal::GenericFileLogSink<Metadata, internal::MetadataFormatter>
    FileLogSink;
+typedef internal::GenericRotatingFileLogSink<Metadata,
+        internal::MetadataFormatter>
+   RotatingFileLogSink;
 
 
 typedef internal::GenericEntryFilter<Metadata> EntryFilter;
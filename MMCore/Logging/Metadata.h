@@ -18,6 +18,8 @@
 
 #include "GenericMetadata.h"
 
+#include "../LocalClock.h"
+
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -39,13 +41,13 @@ namespace internal
 
 typedef boost::posix_time::ptime TimestampType;
 
-// Note: Boost's local_time() internally calls the C library function
-// localtime_r() or localtime(). On the platforms we are interested in, either
-// the thread-safe localtime_r() is provided (OS X, Linux), or localtime() is
-// made thread-safe by using thread-local storage (Windows).
+// Note: LocalTimeNow() occasionally calls the C library function localtime_r()
+// or localtime(). On the platforms we are interested in, either the
+// thread-safe localtime_r() is provided (OS X, Linux), or localtime() is made
+// thread-safe by using thread-local storage (Windows).
 inline TimestampType
 Now()
-{ return boost::posix_time::microsec_clock::local_time(); }
+{ return ::mm::LocalTimeNow(); }
 
 
 #ifdef _WIN32
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include "../LocalClock.h"
+
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 #include <cstring>
@@ -54,11 +56,16 @@ class MetadataFormatter
    // Reuse buffers for efficiency
    std::string buf_;
    std::ostringstream sstrm_;
+   ::mm::TimestampFormatter timestampFormatter_;
    size_t openBracketCol_;
    size_t closeBracketCol_;
 
 public:
-   MetadataFormatter() : openBracketCol_(0), closeBracketCol_(0) {}
+   MetadataFormatter() :
+      timestampFormatter_('T', ::mm::TimestampFormatter::FractionIfNonZero),
+      openBracketCol_(0),
+      closeBracketCol_(0)
+   {}
 
    // Format the line prefix for the first line of an entry
    void FormatLinePrefix(std::ostream& stream, const Metadata& metadata);
@@ -74,8 +81,8 @@ MetadataFormatter::FormatLinePrefix(std::ostream& stream,
 {
    // Pre-forming string is more efficient than writing bit by bit to stream.
 
-   buf_ = boost::posix_time::to_iso_extended_string(
-         metadata.GetStampData().GetTimestamp());
+   buf_.clear();
+   timestampFormatter_.Append(buf_, metadata.GetStampData().GetTimestamp());
    buf_ += " tid";
    sstrm_.str(std::string());
    sstrm_ << metadata.GetStampData().GetThreadId();
@@ -42,6 +42,8 @@
 #include "../MMDevice/DeviceUtils.h"
 #include "../MMDevice/ImageMetadata.h"
 #include "../MMDevice/ModuleInterface.h"
+#include "AcquisitionEngine.h"
+#include "CallTrace.h"
 #include "CircularBuffer.h"
 #include "ConfigGroup.h"
 #include "Configuration.h"
@@ -50,10 +52,13 @@
 #include "CoreUtils.h"
 #include "DeviceManager.h"
 #include "Devices/DeviceInstances.h"
+#include "FrameMatcher.h"
+#include "GalvoScanPath.h"
 #include "Host.h"
 #include "LogManager.h"
 #include "MMCore.h"
 #include "MMEventCallback.h"
+#include "PipelinedSnap.h"
 #include "PluginManager.h"
 
 #include <boost/date_time/posix_time/posix_time.hpp>
@@ -61,6 +66,7 @@
 #include <algorithm>
 #include <assert.h>
 #include <fstream>
+#include <limits>
 #include <set>
 #include <sstream>
 #include <vector>
@@ -113,7 +119,7 @@ using namespace std;
  * (Keep the 3 numbers on one line to make it easier to look at diffs when
  * merging/rebasing.)
  */
-const int MMCore_versionMajor = 10, MMCore_versionMinor = 1, MMCore_versionPatch = 1;
+const int MMCore_versionMajor = 10, MMCore_versionMinor = 12, MMCore_versionPatch = 0;
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -139,6 +145,7 @@ CMMCore::CMMCore() :
    externalCallback_(0),
    pixelSizeGroup_(0),
    cbuf_(0),
+   frameMatchingRunning_(false),
    pluginManager_(new CPluginManager()),
    deviceManager_(new mm::DeviceManager()),
    pPostedErrorsLock_(NULL)
@@ -153,6 +160,8 @@ CMMCore::CMMCore() :
 
    const unsigned seqBufMegabytes = (sizeof(void*) > 4) ? 250 : 25;
    cbuf_ = new CircularBuffer(seqBufMegabytes);
+   acquisitionEngine_.reset(new mm::AcquisitionEngine(*this));
+   pipelinedSnap_.reset(new mm::PipelinedSnap());
 
    nullAffine_ = new std::vector<double>(6);
    for (int i = 0; i < 6; i++) {
@@ -170,6 +179,10 @@ CMMCore::~CMMCore()
 {
    try
    {
+      acquisitionEngine_->Stop();
+      boost::shared_ptr<CameraInstance> snappedCamera;
+      pipelinedSnap_->Wait(snappedCamera);
+
       // TODO We should attempt to continue cleanup beyond the first device
       // that throws an error.
       reset();
@@ -212,6 +225,64 @@ std::string CMMCore::getPrimaryLogFile() const
    return logManager_->GetPrimaryLogFilename();
 }
 
+/**
+ * Start a new primary log file when the current one gets too large or too
+ * old.
+ *
+ * Entries are always written to the file set with setPrimaryLogFile(). Upon
+ * rollover, that file is renamed by inserting a number before the extension
+ * (e.g. CoreLog.txt becomes CoreLog.1.txt, then CoreLog.2.txt at the next
+ * rollover), and a new file is started. No entries are lost or split across
+ * files.
+ *
+ * The settings apply to the current primary log file, if any, and to
+ * subsequently set ones. By default, there is no rollover.
+ *
+ * @param maxSizeMB Size (in MB) at which to roll over; 0 for no limit.
+ * @param maxAgeMinutes Age of the file (in minutes) at which to roll over; 0
+ * for no limit.
+ * @param maxOldFiles The number of rolled-over files to keep; older ones are
+ * deleted. 0 to keep all. Only files rolled over during this session are
+ * deleted.
+ */
+void CMMCore::setPrimaryLogRollover(int maxSizeMB, int maxAgeMinutes,
+      int maxOldFiles) throw (CMMError)
+{
+   if (maxSizeMB < 0 || maxAgeMinutes < 0 || maxOldFiles < 0)
+      throw CMMError("Log rollover settings must not be negative");
+   // The size in bytes must fit in size_t (which may be 32 bits)
+   if (static_cast<std::size_t>(maxSizeMB) >
+         ((std::numeric_limits<std::size_t>::max)() >> 20))
+      throw CMMError("Log rollover size is too large");
+   logManager_->SetPrimaryLogRollover(
+         static_cast<std::size_t>(maxSizeMB) << 20, maxAgeMinutes,
+         static_cast<std::size_t>(maxOldFiles));
+}
+
+/**
+ * Returns the primary log file rollover size in MB (0 if unlimited).
+ */
+int CMMCore::getPrimaryLogRolloverSizeMB() const
+{
+   return static_cast<int>(logManager_->GetPrimaryLogRolloverSize() >> 20);
+}
+
+/**
+ * Returns the primary log file rollover age in minutes (0 if unlimited).
+ */
+int CMMCore::getPrimaryLogRolloverAgeMinutes() const
+{
+   return logManager_->GetPrimaryLogRolloverAge();
+}
+
+/**
+ * Returns the number of rolled-over primary log files kept (0 if all).
+ */
+int CMMCore::getPrimaryLogMaxOldFiles() const
+{
+   return static_cast<int>(logManager_->GetPrimaryLogMaxOldFiles());
+}
+
 /**
  * Record text message in the log file.
  */
@@ -267,6 +338,74 @@ bool CMMCore::stderrLogEnabled()
 }
 
 
+/**
+ * Set the interval at which log entries are written out while logging is
+ * active.
+ *
+ * Log files (and stderr) are written on a background thread, which collects
+ * entries for this interval before writing them, so that frequent logging
+ * (e.g. debug logging during acquisition) results in few, large writes.
+ * The default is 10 ms.
+ *
+ * @param milliseconds The interval; 0 to write entries as soon as possible.
+ */
+void CMMCore::setLogFlushInterval(int milliseconds) throw (CMMError)
+{
+   if (milliseconds < 0)
+      throw CMMError("Log flush interval must not be negative");
+   logManager_->SetAsyncFlushInterval(milliseconds);
+}
+
+/**
+ * Returns the log flush interval in milliseconds.
+ */
+int CMMCore::getLogFlushInterval() const
+{
+   return logManager_->GetAsyncFlushInterval();
+}
+
+/**
+ * Limit the memory used by log entries waiting to be written.
+ *
+ * When the limit is reached (because entries are logged faster than they can
+ * be written), logging calls either block until the background thread has
+ * caught up, or discard the oldest waiting lines and record the number of
+ * lines dropped in their place. The default is no limit.
+ *
+ * Synchronous secondary log files are not affected.
+ *
+ * @param maxLines The maximum number of waiting lines; 0 for no limit.
+ * @param blockWhenFull If true, block when the limit is reached; otherwise
+ * drop the oldest lines.
+ */
+void CMMCore::setLogQueueCapacity(int maxLines, bool blockWhenFull)
+   throw (CMMError)
+{
+   if (maxLines < 0)
+      throw CMMError("Log queue capacity must not be negative");
+   logManager_->SetAsyncQueueCapacity(static_cast<std::size_t>(maxLines),
+         blockWhenFull);
+}
+
+/**
+ * Returns the maximum number of log lines waiting to be written (0 if
+ * unlimited).
+ */
+int CMMCore::getLogQueueCapacity() const
+{
+   return static_cast<int>(logManager_->GetAsyncQueueCapacity());
+}
+
+/**
+ * Returns whether logging blocks (rather than drops lines) when the log queue
+ * capacity is reached.
+ */
+bool CMMCore::getLogQueueBlocksWhenFull() const
+{
+   return logManager_->GetAsyncQueueBlocksWhenFull();
+}
+
+
 /**
  * Start capturing logging output into an additional file.
  *
@@ -310,6 +449,58 @@ void CMMCore::stopSecondaryLogFile(int handle) throw (CMMError)
 }
 
 
+/**
+ * Start recording the timing of device calls.
+ *
+ * While the trace is running, every call to a device (property access, busy
+ * checks, stage moves, image snaps, etc.) is recorded with its start time,
+ * duration, and calling thread, as is the time spent waiting for the device
+ * adapter module's lock. Use stopTrace() to write the result to a file.
+ *
+ * Each thread keeps the most recent 65536 entries; older entries are
+ * discarded. The trace covers all Core instances in the process. Starting a
+ * trace while one is running discards the entries recorded so far.
+ */
+void CMMCore::startTrace()
+{
+   mm::CallTrace::Start();
+}
+
+/**
+ * Stop recording device call timing and save the trace.
+ *
+ * The file is written in the Chrome trace event format (JSON), which can be
+ * viewed with chrome://tracing or the Perfetto UI (ui.perfetto.dev). Nothing
+ * is written if no trace is running. If the file cannot be opened, an
+ * exception is thrown and the trace continues.
+ *
+ * @param filename The file to write the trace to (overwritten if it exists)
+ */
+void CMMCore::stopTrace(const char* filename) throw (CMMError)
+{
+   if (!filename)
+      throw CMMError("Filename is null");
+   if (!mm::CallTrace::IsRunning())
+      return;
+
+   std::ofstream os(filename, ios_base::out | ios_base::trunc);
+   if (!os.is_open())
+   {
+      throw CMMError(ToQuotedString(filename) + ": " +
+            getCoreErrorText(MMERR_FileOpenFailed), MMERR_FileOpenFailed);
+   }
+   mm::CallTrace::Stop(os);
+}
+
+/**
+ * Returns whether device call timing is being recorded.
+ */
+bool CMMCore::isTraceRunning() const
+{
+   return mm::CallTrace::IsRunning();
+}
+
+
 /*!
  Displays current user name.
  */
@@ -482,7 +673,60 @@ Configuration CMMCore::getSystemState()
 Configuration CMMCore::getSystemStateCache() const
 {
    MMThreadGuard scg(stateCacheLock_);
-   return stateCache_;
+   return stateCache_.GetAll();
+}
+
+/**
+ * Returns the current version of the system state cache.
+ *
+ * The version is incremented whenever a cached property value is added,
+ * changed, or removed. Setting a property to its current value does not
+ * change the version.
+ *
+ * @return the cache version (0 for an empty cache)
+ */
+long long CMMCore::getSystemStateCacheVersion() const
+{
+   MMThreadGuard scg(stateCacheLock_);
+   return stateCache_.GetVersion();
+}
+
+/**
+ * Returns the settings in the system state cache that were added or changed
+ * after the given version.
+ *
+ * This allows clients that need to track the full system state (e.g. for
+ * image metadata) to retrieve only what has changed. Call
+ * getSystemStateCacheVersion() before this function and pass the value to
+ * the next call; some changes may be reported twice, but none will be
+ * missed.
+ *
+ * Settings are removed from the cache only by updateSystemStateCache(), for
+ * properties that no longer exist (e.g. for unloaded devices). If that
+ * happened after the given version, the entire cache is returned, and the
+ * caller should discard its previous copy. This condition can be detected by
+ * comparing the version with getSystemStateCacheResetVersion().
+ *
+ * @param version   a version previously obtained from
+ *                  getSystemStateCacheVersion(), or 0
+ * @return  the changed settings
+ */
+Configuration CMMCore::getSystemStateCacheChangesSince(long long version) const
+{
+   MMThreadGuard scg(stateCacheLock_);
+   return stateCache_.GetChangesSince(version);
+}
+
+/**
+ * Returns the system state cache version at which settings were last
+ * removed from the cache.
+ *
+ * @see getSystemStateCacheChangesSince()
+ */
+long long CMMCore::getSystemStateCacheResetVersion() const
+{
+   MMThreadGuard scg(stateCacheLock_);
+   return stateCache_.GetResetVersion();
 }
 
 /**
@@ -783,6 +1027,10 @@ void CMMCore::unloadDevice(const char* label///< the name of the device to unloa
 {
    boost::shared_ptr<DeviceInstance> pDevice = deviceManager_->GetDevice(label);
 
+   // The device may be the camera of a pending snap
+   boost::shared_ptr<CameraInstance> snappedCamera;
+   pipelinedSnap_->Wait(snappedCamera);
+
    try {
       mm::DeviceModuleLockGuard guard(pDevice);
       LOG_DEBUG(coreLogger_) << "Will unload device " << label;
@@ -802,6 +1050,10 @@ void CMMCore::unloadDevice(const char* label///< the name of the device to unloa
 void CMMCore::unloadAllDevices() throw (CMMError)
 {
    try {
+      acquisitionEngine_->Stop();
+      boost::shared_ptr<CameraInstance> snappedCamera;
+      pipelinedSnap_->Wait(snappedCamera);
+
       configGroups_->Clear();
 
       //selected channel group is no longer valid
@@ -961,6 +1213,10 @@ void CMMCore::initializeDevice(const char* label ///< the device to initialize
 
 /**
  * Updates the state of the entire hardware.
+ *
+ * The cache is updated in place: only values that differ from the cached
+ * values are changed (and advance the cache version), and properties that
+ * no longer exist are removed.
  */
 void CMMCore::updateSystemStateCache()
 {
@@ -968,7 +1224,7 @@ void CMMCore::updateSystemStateCache()
    Configuration wk = getSystemState();
    {
       MMThreadGuard scg(stateCacheLock_);
-      stateCache_ = wk;
+      stateCache_.Update(wk);
    }
    LOG_INFO(coreLogger_) << "Did update system state cache";
 }
@@ -1200,7 +1456,8 @@ void CMMCore::waitForDevice(const char* label) throw (CMMError)
  */
 void CMMCore::waitForDevice(boost::shared_ptr<DeviceInstance> pDev) throw (CMMError)
 {
-   LOG_DEBUG(coreLogger_) << "Waiting for device " << pDev->GetLabel() << "...";
+   LOG_DEBUG_DEFERRED(coreLogger_, "Waiting for device {}...") %
+      pDev->GetLabel();
 
    MM::TimeoutMs timeout(GetMMTimeNow(),timeoutMs_);
 
@@ -1227,7 +1484,8 @@ void CMMCore::waitForDevice(boost::shared_ptr<DeviceInstance> pDev) throw (CMMEr
 
      sleep(pollingIntervalMs_);
    }
-   LOG_DEBUG(coreLogger_) << "Finished waiting for device " << pDev->GetLabel();
+   LOG_DEBUG_DEFERRED(coreLogger_, "Finished waiting for device {}") %
+      pDev->GetLabel();
 }
 
 /**
@@ -2066,22 +2324,271 @@ void CMMCore::loadExposureSequence(const char* cameraLabel, std::vector<double>
 
    mm::DeviceModuleLockGuard guard(pCamera);
 
-   int ret;
-   ret = pCamera->ClearExposureSequence();
+   int ret = pCamera->LoadExposureSequence(
+         exposureTime_ms.empty() ? 0 : &exposureTime_ms[0],
+         static_cast<unsigned long>(exposureTime_ms.size()));
    if (ret != DEVICE_OK)
       throw CMMError(getDeviceErrorText(ret, pCamera));
+}
 
-   std::vector<double>::iterator it;
-   for ( it=exposureTime_ms.begin() ; it < exposureTime_ms.end(); it++ )
+/**
+ * Starts running an acquisition plan on a Core thread.
+ *
+ * The events of the plan are run in order: the settings of each event are
+ * applied, an image is snapped with the current camera and inserted into the
+ * circular buffer, with the event indices in its metadata. The images can be
+ * retrieved with popNextImageMD() while the plan runs. When the buffer is
+ * full, the plan waits for images to be removed.
+ *
+ * This command does not block the calling thread for the duration of the
+ * acquisition.
+ * @param plan   the events to run
+ */
+void CMMCore::startAcquisitionPlan(const AcquisitionPlan& plan) throw (CMMError)
+{
+   boost::shared_ptr<CameraInstance> camera = currentCameraDevice_.lock();
+   if (!camera)
+      throw CMMError(getCoreErrorText(MMERR_CameraNotAvailable).c_str(), MMERR_CameraNotAvailable);
+   if (acquisitionEngine_->IsRunning())
    {
-      ret = pCamera->AddToExposureSequence(*it);
-      if (ret != DEVICE_OK)
-         throw CMMError(getDeviceErrorText(ret, pCamera));
+      throw CMMError("An acquisition plan is already running",
+            MMERR_NotAllowedDuringSequenceAcquisition);
    }
+   // The circular buffer is set up for the matched cameras
+   if (isCameraFrameMatchingRunning())
+      throw CMMError(getCoreErrorText(
+         MMERR_NotAllowedDuringSequenceAcquisition).c_str(),
+         MMERR_NotAllowedDuringSequenceAcquisition);
 
-   ret = pCamera->SendExposureSequence();
-   if (ret != DEVICE_OK)
-      throw CMMError(getDeviceErrorText(ret, pCamera));
+   {
+      mm::DeviceModuleLockGuard guard(camera);
+      if (camera->IsCapturing())
+      {
+         throw CMMError(getCoreErrorText(
+            MMERR_NotAllowedDuringSequenceAcquisition).c_str()
+            ,MMERR_NotAllowedDuringSequenceAcquisition);
+      }
+
+      if (!cbuf_->Initialize(camera->GetNumberOfChannels(), camera->GetImageWidth(), camera->GetImageHeight(), camera->GetImageBytesPerPixel()))
+      {
+         logError(getDeviceName(camera).c_str(), getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str());
+         throw CMMError(getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str(), MMERR_CircularBufferFailedToInitialize);
+      }
+      cbuf_->Clear();
+   }
+
+   acquisitionEngine_->Start(plan);
+}
+
+/**
+ * Stops the running acquisition plan after the current event, and waits for
+ * it to stop. Does nothing if no plan is running.
+ */
+void CMMCore::stopAcquisitionPlan()
+{
+   acquisitionEngine_->Stop();
+}
+
+/**
+ * Waits for the acquisition plan to finish.
+ * Throws the error that stopped the plan, if any.
+ */
+void CMMCore::waitForAcquisitionPlan() throw (CMMError)
+{
+   acquisitionEngine_->Wait();
+}
+
+/**
+ * Returns true while an acquisition plan is running.
+ */
+bool CMMCore::isAcquisitionPlanRunning() const
+{
+   return acquisitionEngine_->IsRunning();
+}
+
+/**
+ * Returns the number of events of the current (or last) acquisition plan
+ * whose images have been inserted into the circular buffer.
+ */
+long CMMCore::getAcquisitionPlanEventsDone() const
+{
+   return acquisitionEngine_->GetNumberOfEventsDone();
+}
+
+
+/**
+ * Start matching the images of concurrently running cameras.
+ *
+ * From now on, the images of the given cameras are grouped into
+ * multi-channel frames in the circular buffer, with the cameras as channels
+ * in the order given, instead of being inserted one by one in the order they
+ * arrive. Images belong to the same frame if their keys differ by at most
+ * tolerance. The key is the numeric value of the metadata tag keyTag (e.g. a
+ * hardware timestamp or frame counter supplied by the cameras, which must
+ * share a time base), or, if keyTag is empty, the number of images received
+ * from each camera since matching started.
+ *
+ * Frames that cannot be completed are dropped if dropUnmatched is true, or
+ * else inserted with the missing channels blank. All images of inserted
+ * frames carry the tag "FrameMatchComplete" (1 or 0). The blank images carry
+ * only that tag and "Camera".
+ *
+ * The circular buffer is initialized for frames of one channel per camera;
+ * all cameras must have the same image size. Then start the cameras with
+ * startSequenceAcquisition(cameraLabel, ...), and stop them before calling
+ * stopCameraFrameMatching(). While matching is running, calls that would
+ * reinitialize or replace the circular buffer (such as
+ * startSequenceAcquisition() for the current camera or
+ * startAcquisitionPlan()) throw. Matching cannot start while an acquisition
+ * plan is running.
+ *
+ * @param cameraLabels   the cameras to match
+ * @param keyTag         the metadata tag to match on, or empty
+ * @param tolerance      the largest key difference within a frame
+ * @param dropUnmatched  whether to drop frames that lack images
+ */
+void CMMCore::startCameraFrameMatching(std::vector<std::string> cameraLabels,
+      const char* keyTag, double tolerance, bool dropUnmatched)
+   throw (CMMError)
+{
+   if (cameraLabels.empty())
+      throw CMMError("No cameras given for frame matching");
+   if (!(tolerance >= 0.0))
+      throw CMMError("Frame matching tolerance must not be negative");
+   if (isCameraFrameMatchingRunning())
+      throw CMMError("Frame matching is already running");
+   // The plan inserts the current camera's images into the circular buffer
+   if (acquisitionEngine_->IsRunning())
+      throw CMMError("Frame matching cannot start while an acquisition plan is running",
+            MMERR_NotAllowedDuringSequenceAcquisition);
+
+   unsigned width = 0, height = 0, bytesPerPixel = 0;
+   for (std::vector<std::string>::iterator it = cameraLabels.begin(),
+         end = cameraLabels.end(); it != end; ++it)
+   {
+      if (std::find(cameraLabels.begin(), it, *it) != it)
+         throw CMMError("Camera " + ToQuotedString(*it) +
+               " is listed more than once for frame matching");
+
+      boost::shared_ptr<CameraInstance> camera =
+         deviceManager_->GetDeviceOfType<CameraInstance>(*it);
+      mm::DeviceModuleLockGuard guard(camera);
+      if (camera->IsCapturing())
+      {
+         throw CMMError(getCoreErrorText(
+            MMERR_NotAllowedDuringSequenceAcquisition).c_str()
+            ,MMERR_NotAllowedDuringSequenceAcquisition);
+      }
+      if (it == cameraLabels.begin())
+      {
+         width = camera->GetImageWidth();
+         height = camera->GetImageHeight();
+         bytesPerPixel = camera->GetImageBytesPerPixel();
+      }
+      else if (camera->GetImageWidth() != width ||
+            camera->GetImageHeight() != height ||
+            camera->GetImageBytesPerPixel() != bytesPerPixel)
+      {
+         throw CMMError("Camera " + ToQuotedString(*it) +
+               " differs in image size from " +
+               ToQuotedString(cameraLabels.front()));
+      }
+   }
+
+   if (!cbuf_->Initialize(static_cast<unsigned>(cameraLabels.size()),
+            width, height, bytesPerPixel))
+   {
+      throw CMMError(getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str(), MMERR_CircularBufferFailedToInitialize);
+   }
+   cbuf_->Clear();
+
+   boost::shared_ptr<mm::FrameMatcher> matcher(new mm::FrameMatcher(
+            cameraLabels, keyTag ? keyTag : "", tolerance, dropUnmatched));
+   MMThreadGuard guard(frameMatcherLock_);
+   frameMatcher_ = matcher;
+   frameMatchingRunning_ = true;
+   LOG_DEBUG(coreLogger_) << "Started matching frames of " <<
+      cameraLabels.size() << " cameras";
+}
+
+
+/**
+ * Stop matching camera images, inserting (or dropping) the frames that are
+ * still incomplete. The statistics remain available until matching is
+ * started again.
+ */
+void CMMCore::stopCameraFrameMatching() throw (CMMError)
+{
+   boost::shared_ptr<mm::FrameMatcher> matcher;
+   {
+      MMThreadGuard guard(frameMatcherLock_);
+      if (!frameMatchingRunning_)
+         return;
+      frameMatchingRunning_ = false;
+      matcher = frameMatcher_;
+   }
+
+   matcher->Flush(*cbuf_);
+   mm::FrameMatchStatistics statistics = matcher->GetStatistics();
+   LOG_DEBUG(coreLogger_) << "Stopped matching frames: " <<
+      statistics.matchedFrames << " matched, " <<
+      statistics.unmatchedFrames << " unmatched, " <<
+      statistics.droppedImages << " images dropped";
+}
+
+
+bool CMMCore::isCameraFrameMatchingRunning() const
+{
+   MMThreadGuard guard(frameMatcherLock_);
+   return frameMatchingRunning_;
+}
+
+
+/**
+ * The number of frames inserted with an image from every camera by the
+ * current or last frame matching.
+ */
+long CMMCore::getMatchedCameraFrameCount() const
+{
+   MMThreadGuard guard(frameMatcherLock_);
+   if (!frameMatcher_)
+      return 0;
+   return frameMatcher_->GetStatistics().matchedFrames;
+}
+
+
+/**
+ * The number of frames that lacked images from some camera (whether dropped
+ * or inserted) in the current or last frame matching.
+ */
+long CMMCore::getUnmatchedCameraFrameCount() const
+{
+   MMThreadGuard guard(frameMatcherLock_);
+   if (!frameMatcher_)
+      return 0;
+   return frameMatcher_->GetStatistics().unmatchedFrames;
+}
+
+
+/**
+ * The number of camera images discarded by the current or last frame
+ * matching, because they were unmatched or the circular buffer was full.
+ */
+long CMMCore::getDroppedCameraImageCount() const
+{
+   MMThreadGuard guard(frameMatcherLock_);
+   if (!frameMatcher_)
+      return 0;
+   return frameMatcher_->GetStatistics().droppedImages;
+}
+
+
+boost::shared_ptr<mm::FrameMatcher> CMMCore::getRunningFrameMatcher() const
+{
+   MMThreadGuard guard(frameMatcherLock_);
+   if (!frameMatchingRunning_)
+      return boost::shared_ptr<mm::FrameMatcher>();
+   return frameMatcher_;
 }
 
 
@@ -2193,20 +2700,9 @@ void CMMCore::loadStageSequence(const char* label, std::vector<double> positionS
 
    mm::DeviceModuleLockGuard guard(pStage);
 
-   int ret;
-   ret = pStage->ClearStageSequence();
-   if (ret != DEVICE_OK)
-      throw CMMError(getDeviceErrorText(ret, pStage));
-
-   std::vector<double>::iterator it;
-   for ( it=positionSequence.begin() ; it < positionSequence.end(); it++ )
-   {
-      ret = pStage->AddToStageSequence(*it);
-      if (ret != DEVICE_OK)
-         throw CMMError(getDeviceErrorText(ret, pStage));
-   }
-
-   ret = pStage->SendStageSequence();
+   int ret = pStage->LoadStageSequence(
+         positionSequence.empty() ? 0 : &positionSequence[0],
+         static_cast<unsigned long>(positionSequence.size()));
    if (ret != DEVICE_OK)
       throw CMMError(getDeviceErrorText(ret, pStage));
 }
@@ -2328,21 +2824,11 @@ void CMMCore::loadXYStageSequence(const char* label,
 
    mm::DeviceModuleLockGuard guard(pStage);
 
-   int ret;
-   ret = pStage->ClearXYStageSequence();
-   if (ret != DEVICE_OK)
-      throw CMMError(getDeviceErrorText(ret, pStage));
-
-   std::vector<double>::iterator itx, ity;
-   for ( itx=xSequence.begin(), ity=ySequence.begin() ;
-         (itx < xSequence.end()) && (ity < ySequence.end()); itx++, ity++)
-   {
-      ret = pStage->AddToXYStageSequence(*itx, *ity);
-      if (ret != DEVICE_OK)
-         throw CMMError(getDeviceErrorText(ret, pStage));
-   }
-
-   ret = pStage->SendXYStageSequence();
+   // Extra positions in the longer sequence are ignored
+   const std::size_t length = (std::min)(xSequence.size(), ySequence.size());
+   int ret = pStage->LoadXYStageSequence(
+         length == 0 ? 0 : &xSequence[0], length == 0 ? 0 : &ySequence[0],
+         static_cast<unsigned long>(length));
    if (ret != DEVICE_OK)
       throw CMMError(getDeviceErrorText(ret, pStage));
 }
@@ -2354,6 +2840,8 @@ void CMMCore::loadXYStageSequence(const char* label,
  */
 void CMMCore::snapImage() throw (CMMError)
 {
+   finishPendingSnap();
+
    boost::shared_ptr<CameraInstance> camera = currentCameraDevice_.lock();
    if (camera)
    {
@@ -2386,11 +2874,11 @@ void CMMCore::snapImage() throw (CMMError)
             waitForDevice(shutter);
          }
 
-         LOG_DEBUG(coreLogger_) << "Will snap image from current camera";
+         LOG_DEBUG_DEFERRED(coreLogger_, "Will snap image from current camera");
          ret = camera->SnapImage();
          if (ret == DEVICE_OK)
          {
-            LOG_DEBUG(coreLogger_) << "Did snap image from current camera";
+            LOG_DEBUG_DEFERRED(coreLogger_, "Did snap image from current camera");
          }
          else
          {
@@ -2426,7 +2914,103 @@ void CMMCore::snapImage() throw (CMMError)
    }
    else
    {
-      throw CMMError(getCoreErrorText(MMERR_CameraNotAvailable).c_str(), MMERR_CameraNotAvailable);
+      throw CMMError(getCoreErrorText(MMERR_CameraNotAvailable).c_str(), MMERR_CameraNotAvailable);
+   }
+}
+
+/**
+ * Starts acquiring a single image with current settings, and returns as soon
+ * as the exposure has ended.
+ *
+ * The camera reads out the image in the background, so that the caller can
+ * meanwhile prepare the next image, for example by starting to move a stage.
+ * getImage() (or waitForSnapImage()) waits for the readout to finish. The
+ * next snap waits for the devices in the image synchronization list (see
+ * assignImageSynchro()) as usual, so that moves started during the readout
+ * are complete before the next exposure.
+ *
+ * The end of the exposure is known early only for cameras that signal it
+ * (see MM::Core::OnExposureFinished()). For other cameras, this returns when
+ * the camera's snap returns, like snapImage(). Either way, the shutter is
+ * closed (if auto-shutter is on) before this function returns.
+ *
+ * Note that devices in the same device adapter module as the camera are
+ * locked until the readout has finished.
+ */
+void CMMCore::startSnapImage() throw (CMMError)
+{
+   finishPendingSnap();
+
+   boost::shared_ptr<CameraInstance> camera = currentCameraDevice_.lock();
+   if (!camera)
+      throw CMMError(getCoreErrorText(MMERR_CameraNotAvailable).c_str(), MMERR_CameraNotAvailable);
+
+   if (camera->IsCapturing())
+   {
+      throw CMMError(getCoreErrorText(
+         MMERR_NotAllowedDuringSequenceAcquisition).c_str()
+         ,MMERR_NotAllowedDuringSequenceAcquisition);
+   }
+
+   waitForImageSynchro();
+
+   boost::shared_ptr<ShutterInstance> shutter = currentShutterDevice_.lock();
+   if (autoShutter_ && shutter)
+   {
+      int ret;
+      {
+         mm::DeviceModuleLockGuard guard(shutter);
+         ret = shutter->SetOpen(true);
+      }
+      if (ret != DEVICE_OK)
+      {
+         logError("CMMCore::startSnapImage", getDeviceErrorText(ret, shutter).c_str());
+         throw CMMError(getDeviceErrorText(ret, shutter).c_str(), MMERR_DEVICE_GENERIC);
+      }
+      waitForDevice(shutter);
+   }
+
+   LOG_DEBUG_DEFERRED(coreLogger_, "Will start pipelined snap from current camera");
+   pipelinedSnap_->Start(camera);
+   everSnapped_ = true;
+   pipelinedSnap_->WaitForExposure();
+   LOG_DEBUG_DEFERRED(coreLogger_, "Exposure of pipelined snap has ended");
+
+   if (autoShutter_ && shutter)
+   {
+      int ret;
+      {
+         mm::DeviceModuleLockGuard guard(shutter);
+         ret = shutter->SetOpen(false);
+      }
+      if (ret != DEVICE_OK)
+      {
+         logError("CMMCore::startSnapImage", getDeviceErrorText(ret, shutter).c_str());
+         throw CMMError(getDeviceErrorText(ret, shutter).c_str(), MMERR_DEVICE_GENERIC);
+      }
+      waitForDevice(shutter);
+   }
+}
+
+/**
+ * Waits for the image started with startSnapImage() to be read out.
+ *
+ * Throws the camera's error if the snap failed. Does nothing if no snap is
+ * pending.
+ */
+void CMMCore::waitForSnapImage() throw (CMMError)
+{
+   finishPendingSnap();
+}
+
+void CMMCore::finishPendingSnap() throw (CMMError)
+{
+   boost::shared_ptr<CameraInstance> camera;
+   int ret = pipelinedSnap_->Wait(camera);
+   if (ret != DEVICE_OK && camera)
+   {
+      logError("CMMCore::startSnapImage", getDeviceErrorText(ret, camera).c_str());
+      throw CMMError(getDeviceErrorText(ret, camera).c_str(), MMERR_DEVICE_GENERIC);
    }
 }
 
@@ -2501,7 +3085,7 @@ void CMMCore::setAutoShutter(bool state)
    autoShutter_ = state;
    {
       MMThreadGuard scg(stateCacheLock_);
-      stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreAutoShutter, state ? "1" : "0"));
+      stateCache_.Set(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreAutoShutter, state ? "1" : "0"));
    }
    LOG_DEBUG(coreLogger_) << "Autoshutter turned " << (state ? "on" : "off");
 }
@@ -2536,7 +3120,7 @@ void CMMCore::setShutterOpen(const char* shutterLabel, bool state) throw (CMMErr
       {
          {
             MMThreadGuard scg(stateCacheLock_);
-            stateCache_.addSetting(PropertySetting(shutterLabel, MM::g_Keyword_State, CDeviceUtils::ConvertToString(state)));
+            stateCache_.Set(PropertySetting(shutterLabel, MM::g_Keyword_State, CDeviceUtils::ConvertToString(state)));
          }
       }
    }
@@ -2604,6 +3188,8 @@ void* CMMCore::getImage() throw (CMMError)
       throw CMMError(getCoreErrorText(MMERR_CameraNotAvailable).c_str(), MMERR_CameraNotAvailable);
    else
    {
+      finishPendingSnap();
+
 		if( ! everSnapped_)
 		{
          logError("CMMCore::getImage()", getCoreErrorText(MMERR_InvalidImageSequence).c_str());
@@ -2670,6 +3256,8 @@ void* CMMCore::getImage(unsigned channelNr) throw (CMMError)
       throw CMMError(getCoreErrorText(MMERR_CameraNotAvailable).c_str(), MMERR_CameraNotAvailable);
    else
    {
+      finishPendingSnap();
+
       void* pBuf(0);
       try {
          mm::DeviceModuleLockGuard guard(camera);
@@ -2726,6 +3314,12 @@ long CMMCore::getImageBufferSize()
  */
 void CMMCore::startSequenceAcquisition(long numImages, double intervalMs, bool stopOnOverflow) throw (CMMError)
 {
+   // The circular buffer is set up for the matched cameras
+   if (isCameraFrameMatchingRunning())
+      throw CMMError(getCoreErrorText(
+         MMERR_NotAllowedDuringSequenceAcquisition).c_str(),
+         MMERR_NotAllowedDuringSequenceAcquisition);
+
    // scope for the thread guard
    {
       MMThreadGuard g(*pPostedErrorsLock_);
@@ -2828,6 +3422,12 @@ void CMMCore::prepareSequenceAcquisition(const char* label) throw (CMMError)
  */
 void CMMCore::initializeCircularBuffer() throw (CMMError)
 {
+   // The circular buffer is set up for the matched cameras
+   if (isCameraFrameMatchingRunning())
+      throw CMMError(getCoreErrorText(
+         MMERR_NotAllowedDuringSequenceAcquisition).c_str(),
+         MMERR_NotAllowedDuringSequenceAcquisition);
+
    boost::shared_ptr<CameraInstance> camera = currentCameraDevice_.lock();
    if (camera)
    {
@@ -2873,6 +3473,12 @@ void CMMCore::stopSequenceAcquisition(const char* label) throw (CMMError)
  */
 void CMMCore::startContinuousSequenceAcquisition(double intervalMs) throw (CMMError)
 {
+   // The circular buffer is set up for the matched cameras
+   if (isCameraFrameMatchingRunning())
+      throw CMMError(getCoreErrorText(
+         MMERR_NotAllowedDuringSequenceAcquisition).c_str(),
+         MMERR_NotAllowedDuringSequenceAcquisition);
+
    boost::shared_ptr<CameraInstance> camera = currentCameraDevice_.lock();
    if (camera)
    {
@@ -3066,6 +3672,27 @@ void* CMMCore::popNextImageMD(unsigned channel, unsigned slice, Metadata& md) th
       throw CMMError(getCoreErrorText(MMERR_CircularBufferEmpty).c_str(), MMERR_CircularBufferEmpty);
 }
 
+/**
+ * Gets the next image (and metadata) of the given channel, without removing
+ * it from the circular buffer. This allows reading all channels of a
+ * multi-channel frame before popping it.
+ */
+void* CMMCore::peekNextImageMD(unsigned channel, unsigned slice, Metadata& md) const throw (CMMError)
+{
+   // Slices have never been implemented on the device interface side
+   if (slice != 0)
+      throw CMMError("Slice must be 0");
+
+   const mm::ImgBuffer* pBuf = cbuf_->PeekNextImageBuffer(channel);
+   if (pBuf != 0)
+   {
+      md = pBuf->GetMetadata();
+      return const_cast<unsigned char*>(pBuf->GetPixels());
+   }
+   else
+      throw CMMError(getCoreErrorText(MMERR_CircularBufferEmpty).c_str(), MMERR_CircularBufferEmpty);
+}
+
 /**
  * Gets and removes the next image (and metadata) from the circular buffer
  */
@@ -3074,6 +3701,190 @@ void* CMMCore::popNextImageMD(Metadata& md) throw (CMMError)
    return popNextImageMD(0, 0, md);
 }
 
+/**
+ * Returns the complete set of tags for a TaggedImage, serialized as a JSON
+ * object.
+ *
+ * The tags consist of the image metadata (single-valued tags only), the
+ * contents of the system state cache (keyed by "<device>-<property>"), and
+ * summary information about the current camera and pixel size, as well as
+ * default values for the acquisition indices (frame, position, slice,
+ * channel).
+ *
+ * The whole tag set is built natively, from a snapshot of the system state
+ * cache that is shared between calls until the cache changes, so that
+ * language bindings need only a single call per image.
+ *
+ * @param md   the metadata returned together with the image
+ * @return  a JSON object (as a string) containing all tags
+ */
+std::string CMMCore::getTaggedImageTags(const Metadata& md) throw (CMMError)
+{
+   return getTaggedImageTags(md, false, 0);
+}
+
+/**
+ * Returns the complete set of tags for a TaggedImage from a multi-channel
+ * camera, serialized as a JSON object.
+ *
+ * In addition to the tags returned by getTaggedImageTags(const Metadata&),
+ * the camera channel index is added (as "CameraChannelIndex" and
+ * "ChannelIndex") unless it is already set in the metadata, and the
+ * physical camera for the channel is added (as "Camera" and "Channel"),
+ * unless the metadata already contains a "Camera" tag.
+ *
+ * @param md                   the metadata returned together with the image
+ * @param cameraChannelIndex   the channel index of the image
+ * @return  a JSON object (as a string) containing all tags
+ */
+std::string CMMCore::getTaggedImageTags(const Metadata& md,
+      unsigned cameraChannelIndex) throw (CMMError)
+{
+   return getTaggedImageTags(md, true, cameraChannelIndex);
+}
+
+std::string CMMCore::getTaggedImageTags(const Metadata& md,
+      bool hasCameraChannelIndex, unsigned cameraChannelIndex) throw (CMMError)
+{
+   boost::shared_ptr<const Configuration> state;
+   {
+      MMThreadGuard scg(stateCacheLock_);
+      state = stateCache_.GetSnapshot();
+   }
+
+   // Values are stored JSON-encoded; later entries replace earlier ones.
+   std::map<std::string, std::string> tags;
+
+   std::vector<std::string> mdKeys = md.GetKeys();
+   for (std::vector<std::string>::const_iterator it = mdKeys.begin(),
+         end = mdKeys.end(); it != end; ++it)
+   {
+      // Array tags have no single value and are left out
+      const MetadataSingleTag* tag = md.FindTag(it->c_str())->ToSingleTag();
+      if (tag)
+         tags[*it] = ToJSONString(tag->GetValue());
+   }
+
+   for (size_t i = 0; i < state->size(); ++i)
+   {
+      const PropertySetting setting = state->getSetting(i);
+      tags[setting.getKey()] = ToJSONString(setting.getPropertyValue());
+   }
+
+   tags["BitDepth"] = ToString(getImageBitDepth());
+   tags["PixelSizeUm"] = ToJSONNumber(getPixelSizeUm(true));
+
+   std::vector<double> affine = getPixelSizeAffine(true);
+   std::string affineString;
+   if (affine.size() == 6)
+   {
+      for (size_t i = 0; i < affine.size(); ++i)
+      {
+         if (i > 0)
+            affineString += ";";
+         affineString += ToJSONNumber(affine[i]);
+      }
+   }
+   tags["PixelSizeAffine"] = ToJSONString(affineString);
+
+   int x, y, xSize, ySize;
+   getROI(x, y, xSize, ySize);
+   tags["ROI"] = ToJSONString(ToString(x) + "-" + ToString(y) + "-" +
+         ToString(xSize) + "-" + ToString(ySize));
+
+   tags["Width"] = ToString(getImageWidth());
+   tags["Height"] = ToString(getImageHeight());
+
+   std::string pixelType;
+   switch (getBytesPerPixel())
+   {
+      case 1: pixelType = "GRAY8"; break;
+      case 2: pixelType = "GRAY16"; break;
+      case 4: pixelType = (getNumberOfComponents() == 1) ? "GRAY32" : "RGB32"; break;
+      case 8: pixelType = "RGB64"; break;
+   }
+   tags["PixelType"] = ToJSONString(pixelType);
+
+   tags["Frame"] = "0";
+   tags["FrameIndex"] = "0";
+   tags["Position"] = ToJSONString("Default");
+   tags["PositionIndex"] = "0";
+   tags["Slice"] = "0";
+   tags["SliceIndex"] = "0";
+
+   std::string channel = getCurrentConfigFromCache(channelGroup_.c_str());
+   if (channel.empty())
+      channel = "Default";
+   tags["Channel"] = ToJSONString(channel);
+   tags["ChannelIndex"] = "0";
+
+   // Prefer the cached binning; only query the camera if it is not cached.
+   const std::string camera = getCameraDevice();
+   if (!camera.empty())
+   {
+      if (state->isPropertyIncluded(camera.c_str(), MM::g_Keyword_Binning))
+      {
+         tags["Binning"] = ToJSONString(state->getSetting(camera.c_str(),
+                  MM::g_Keyword_Binning).getPropertyValue());
+      }
+      else
+      {
+         try
+         {
+            tags["Binning"] = ToJSONString(getProperty(camera.c_str(),
+                     MM::g_Keyword_Binning));
+         }
+         catch (const CMMError&)
+         {
+            // Camera has no binning property
+         }
+      }
+   }
+
+   if (hasCameraChannelIndex)
+   {
+      if (mdKeys.end() == std::find(mdKeys.begin(), mdKeys.end(),
+               std::string("CameraChannelIndex")))
+      {
+         tags["CameraChannelIndex"] = ToString(cameraChannelIndex);
+         tags["ChannelIndex"] = ToString(cameraChannelIndex);
+      }
+      if (mdKeys.end() == std::find(mdKeys.begin(), mdKeys.end(),
+               std::string("Camera")) &&
+            state->isPropertyIncluded(MM::g_Keyword_CoreDevice,
+               MM::g_Keyword_CoreCamera))
+      {
+         const std::string coreCamera = state->getSetting(
+               MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreCamera).
+            getPropertyValue();
+         const std::string physCamProp = "Physical Camera " +
+            ToString(cameraChannelIndex + 1);
+         if (state->isPropertyIncluded(coreCamera.c_str(), physCamProp.c_str()))
+         {
+            const std::string physCam = ToJSONString(state->getSetting(
+                     coreCamera.c_str(), physCamProp.c_str()).getPropertyValue());
+            tags["Camera"] = physCam;
+            tags["Channel"] = physCam;
+         }
+      }
+   }
+
+   std::string json;
+   json.reserve(64 * tags.size());
+   json += "{";
+   for (std::map<std::string, std::string>::const_iterator it = tags.begin(),
+         end = tags.end(); it != end; ++it)
+   {
+      if (it != tags.begin())
+         json += ",";
+      json += ToJSONString(it->first);
+      json += ":";
+      json += it->second;
+   }
+   json += "}";
+   return json;
+}
+
 /**
  * Removes all images from the circular buffer.
  *
@@ -3091,6 +3902,12 @@ void CMMCore::clearCircularBuffer() throw (CMMError)
 void CMMCore::setCircularBufferMemoryFootprint(unsigned sizeMB ///< n megabytes
                                                ) throw (CMMError)
 {
+   // The circular buffer is set up for the matched cameras
+   if (isCameraFrameMatchingRunning())
+      throw CMMError(getCoreErrorText(
+         MMERR_NotAllowedDuringSequenceAcquisition).c_str(),
+         MMERR_NotAllowedDuringSequenceAcquisition);
+
    delete cbuf_; // discard old buffer
    LOG_DEBUG(coreLogger_) << "Will set circular buffer size to " <<
       sizeMB << " MB";
@@ -3280,7 +4097,7 @@ void CMMCore::setAutoFocusDevice(const char* autofocusLabel) throw (CMMError)
    std::string newAutofocusLabel = getAutoFocusDevice();
    {
       MMThreadGuard scg(stateCacheLock_);
-      stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreAutoFocus, newAutofocusLabel.c_str()));
+      stateCache_.Set(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreAutoFocus, newAutofocusLabel.c_str()));
    }
 }
 
@@ -3347,7 +4164,7 @@ void CMMCore::setImageProcessorDevice(const char* procLabel) throw (CMMError)
    std::string newProcLabel = getImageProcessorDevice();
    {
       MMThreadGuard scg(stateCacheLock_);
-      stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreImageProcessor, newProcLabel.c_str()));
+      stateCache_.Set(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreImageProcessor, newProcLabel.c_str()));
    }
 }
 
@@ -3371,7 +4188,7 @@ void CMMCore::setSLMDevice(const char* slmLabel) throw (CMMError)
    std::string newSLMLabel = getSLMDevice();
    {
       MMThreadGuard scg(stateCacheLock_);
-      stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreSLM, newSLMLabel.c_str()));
+      stateCache_.Set(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreSLM, newSLMLabel.c_str()));
    }
 }
 
@@ -3396,7 +4213,7 @@ void CMMCore::setGalvoDevice(const char* galvoLabel) throw (CMMError)
    std::string newGalvoLabel = getGalvoDevice();
    {
       MMThreadGuard scg(stateCacheLock_);
-      stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreGalvo, newGalvoLabel.c_str()));
+      stateCache_.Set(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreGalvo, newGalvoLabel.c_str()));
    }
 }
 
@@ -3423,7 +4240,7 @@ void CMMCore::setChannelGroup(const char* chGroup) throw (CMMError)
 
    {
       MMThreadGuard scg(stateCacheLock_);
-      stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreChannelGroup, channelGroup_.c_str()));
+      stateCache_.Set(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreChannelGroup, channelGroup_.c_str()));
    }
    if (externalCallback_ != 0) 
    {
@@ -3485,7 +4302,7 @@ void CMMCore::setShutterDevice(const char* shutterLabel) throw (CMMError)
    std::string newShutterLabel = getShutterDevice();
    {
       MMThreadGuard scg(stateCacheLock_);
-      stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreShutter, newShutterLabel.c_str()));
+      stateCache_.Set(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreShutter, newShutterLabel.c_str()));
    }
 }
 
@@ -3510,7 +4327,7 @@ void CMMCore::setFocusDevice(const char* focusLabel) throw (CMMError)
    std::string newFocusLabel = getFocusDevice();
    {
       MMThreadGuard scg(stateCacheLock_);
-      stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreFocus, newFocusLabel.c_str()));
+      stateCache_.Set(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreFocus, newFocusLabel.c_str()));
    }
 }
 
@@ -3533,7 +4350,7 @@ void CMMCore::setXYStageDevice(const char* xyDeviceLabel) throw (CMMError)
    std::string newXYStageLabel = getXYStageDevice();
    {
       MMThreadGuard scg(stateCacheLock_);
-      stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreXYStage, newXYStageLabel.c_str()));
+      stateCache_.Set(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreXYStage, newXYStageLabel.c_str()));
    }
 }
 
@@ -3572,7 +4389,7 @@ void CMMCore::setCameraDevice(const char* cameraLabel) throw (CMMError)
    std::string newCameraLabel = getCameraDevice();
    {
       MMThreadGuard scg(stateCacheLock_);
-      stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreCamera, newCameraLabel.c_str()));
+      stateCache_.Set(PropertySetting(MM::g_Keyword_CoreDevice, MM::g_Keyword_CoreCamera, newCameraLabel.c_str()));
    }
 }
 
@@ -3676,7 +4493,7 @@ string CMMCore::getProperty(const char* label, const char* propName) throw (CMME
    PropertySetting s(label, propName, value.c_str());
    {
       MMThreadGuard scg(stateCacheLock_);
-      stateCache_.addSetting(s);
+      stateCache_.Set(s);
    }
 
    return value;
@@ -3698,12 +4515,7 @@ string CMMCore::getPropertyFromCache(const char* label, const char* propName) co
 
    {
       MMThreadGuard scg(stateCacheLock_);
-      if (!stateCache_.isPropertyIncluded(label, propName))
-         throw CMMError("Property " + ToQuotedString(propName) + " of device " +
-               ToQuotedString(label) + " not found in cache",
-               MMERR_PropertyNotInCache);
-      PropertySetting s = stateCache_.getSetting(label, propName);
-      return s.getPropertyValue();
+      return stateCache_.Get(label, propName).getPropertyValue();
    }
 }
 
@@ -3729,7 +4541,7 @@ void CMMCore::setProperty(const char* label, const char* propName,
       properties_->Execute(propName, propValue);
       {
          MMThreadGuard scg(stateCacheLock_);
-         stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, propName, propValue));
+         stateCache_.Set(PropertySetting(MM::g_Keyword_CoreDevice, propName, propValue));
       }
 
       LOG_DEBUG(coreLogger_) << "Did set Core property: " <<
@@ -3745,7 +4557,7 @@ void CMMCore::setProperty(const char* label, const char* propName,
 
       {
          MMThreadGuard scg(stateCacheLock_);
-         stateCache_.addSetting(PropertySetting(label, propName, propValue));
+         stateCache_.Set(PropertySetting(label, propName, propValue));
       }
    }
 }
@@ -3983,19 +4795,40 @@ void CMMCore::loadPropertySequence(const char* label, const char* propName, std:
    boost::shared_ptr<DeviceInstance> pDevice = deviceManager_->GetDevice(label);
    CheckPropertyName(propName);
 
-   mm::DeviceModuleLockGuard guard(pDevice);
-   pDevice->ClearPropertySequence(propName);
-
-   std::vector<std::string>::iterator it;
    for (std::vector<std::string>::const_iterator it = eventSequence.begin(),
          end = eventSequence.end();
          it < end; ++it)
-   {
       CheckPropertyValue(it->c_str());
-      pDevice->AddToPropertySequence(propName, it->c_str());
-   }
 
-   pDevice->SendPropertySequence(propName);
+   mm::DeviceModuleLockGuard guard(pDevice);
+   pDevice->LoadPropertySequence(propName, eventSequence);
+}
+
+/**
+ * Transfer a sequence of numeric values to a Float or Integer property.
+ *
+ * Equivalent to the string version, but the values are passed to the device
+ * as numbers. Devices that load them as numbers skip the conversion to and
+ * from text, which makes this the faster way to load long sequences such as
+ * analog output waveforms; other devices receive them formatted as text. The
+ * values are checked against the property's limits and allowed values by the
+ * device.
+ *
+ * @param label      the device name
+ * @param propName   the property label
+ * @param values     the sequence of values that the device will step through
+ *                   in response to external triggers
+ */
+void CMMCore::loadPropertySequence(const char* label, const char* propName, std::vector<double> values) throw (CMMError)
+{
+   if (IsCoreDeviceLabel(label))
+      // XXX Should be a throw
+      return;
+   boost::shared_ptr<DeviceInstance> pDevice = deviceManager_->GetDevice(label);
+   CheckPropertyName(propName);
+
+   mm::DeviceModuleLockGuard guard(pDevice);
+   pDevice->LoadNumericPropertySequence(propName, values);
 }
 
 /**
@@ -4170,7 +5003,7 @@ void CMMCore::setExposure(const char* label, double dExp) throw (CMMError)
       {
          {
             MMThreadGuard scg(stateCacheLock_);
-            stateCache_.addSetting(PropertySetting(label, MM::g_Keyword_Exposure, CDeviceUtils::ConvertToString(dExp)));
+            stateCache_.Set(PropertySetting(label, MM::g_Keyword_Exposure, CDeviceUtils::ConvertToString(dExp)));
          }
       }
    }
@@ -4553,7 +5386,7 @@ void CMMCore::setState(const char* deviceLabel, long state) throw (CMMError)
    {
       {
          MMThreadGuard scg(stateCacheLock_);
-         stateCache_.addSetting(PropertySetting(deviceLabel, MM::g_Keyword_State, CDeviceUtils::ConvertToString(state)));
+         stateCache_.Set(PropertySetting(deviceLabel, MM::g_Keyword_State, CDeviceUtils::ConvertToString(state)));
       }
    }
    if (pStateDev->HasProperty(MM::g_Keyword_Label))
@@ -4562,7 +5395,7 @@ void CMMCore::setState(const char* deviceLabel, long state) throw (CMMError)
 
       {
          MMThreadGuard scg(stateCacheLock_);
-         stateCache_.addSetting(PropertySetting(deviceLabel, MM::g_Keyword_Label, posLbl.c_str()));
+         stateCache_.Set(PropertySetting(deviceLabel, MM::g_Keyword_Label, posLbl.c_str()));
       }
    }
 
@@ -4624,7 +5457,7 @@ void CMMCore::setStateLabel(const char* deviceLabel, const char* stateLabel) thr
    {
       {
          MMThreadGuard scg(stateCacheLock_);
-         stateCache_.addSetting(PropertySetting(deviceLabel, MM::g_Keyword_Label, stateLabel));
+         stateCache_.Set(PropertySetting(deviceLabel, MM::g_Keyword_Label, stateLabel));
       }
    }
    if (pStateDev->HasProperty(MM::g_Keyword_State))
@@ -4632,7 +5465,7 @@ void CMMCore::setStateLabel(const char* deviceLabel, const char* stateLabel) thr
       long state = getStateFromLabel(deviceLabel, stateLabel);
       {
          MMThreadGuard scg(stateCacheLock_);
-         stateCache_.addSetting(PropertySetting(deviceLabel, MM::g_Keyword_State,
+         stateCache_.Set(PropertySetting(deviceLabel, MM::g_Keyword_State,
                   CDeviceUtils::ConvertToString(state)));
       }
    }
@@ -5325,7 +6158,7 @@ string CMMCore::getCurrentPixelSizeConfig(bool cached) throw (CMMError)
 				else
 				{
                MMThreadGuard scg(stateCacheLock_);
-               value = stateCache_.getSetting(cs.getDeviceLabel().c_str(), cs.getPropertyName().c_str()).getPropertyValue();
+               value = stateCache_.Get(cs.getDeviceLabel().c_str(), cs.getPropertyName().c_str()).getPropertyValue();
 				}
                PropertySetting ss(cs.getDeviceLabel().c_str(), cs.getPropertyName().c_str(), value.c_str()); // state setting
                curState.addSetting(ss);
@@ -6032,6 +6865,217 @@ void CMMCore::loadSLMSequence(const char* deviceLabel, std::vector<unsigned char
       throw CMMError(getDeviceErrorText(ret, pSLM));
 }
 
+/**
+ * Add an 8-bit monochrome image (of the size passed to setSLMImage()) to the
+ * SLM's pattern cache, so that it can be displayed or sequenced by id.
+ *
+ * If an identical pattern has already been added, its id is returned and
+ * nothing is sent to the device. Otherwise the pattern is registered with
+ * the device (if it supports patterns), which may convert it to its native
+ * format ahead of time. Protocols that cycle through a set of images should
+ * add each image once and refer to it by id thereafter.
+ *
+ * The cache is dropped if the SLM's width or height has changed since the
+ * last pattern was added.
+ *
+ * @param deviceLabel name of the SLM
+ * @param pixels the pattern
+ * @return the pattern's id
+ */
+long CMMCore::addSLMPattern(const char* deviceLabel, unsigned char* pixels) throw (CMMError)
+{
+   boost::shared_ptr<SLMInstance> pSLM =
+      deviceManager_->GetDeviceOfType<SLMInstance>(deviceLabel);
+   if (!pixels)
+      throw CMMError("Null image");
+
+   mm::DeviceModuleLockGuard guard(pSLM);
+   const std::size_t patternBytes =
+      static_cast<std::size_t>(pSLM->GetWidth()) * pSLM->GetHeight();
+   mm::SLMPatternCache* cache = pSLM->GetPatternCache();
+   if (!cache)
+   {
+      cache = new mm::SLMPatternCache(patternBytes);
+      pSLM->SetPatternCache(cache);
+   }
+   else if (cache->GetPatternBytes() != patternBytes)
+   {
+      releaseSLMPatterns(pSLM);
+      cache->Reset(patternBytes);
+   }
+
+   bool added;
+   const long id = cache->Add(pixels, added);
+   if (!added)
+      return id;
+
+   int ret = pSLM->PrepareSLMPattern(id, cache->GetPixels(id));
+   if (ret == DEVICE_OK)
+      cache->SetPreparedInDevice(id, true);
+   else if (ret != DEVICE_UNSUPPORTED_COMMAND)
+   {
+      cache->Remove(id);
+      logError(deviceLabel, getDeviceErrorText(ret, pSLM).c_str());
+      throw CMMError(getDeviceErrorText(ret, pSLM));
+   }
+   return id;
+}
+
+/**
+ * Write a pattern previously added with addSLMPattern() to the SLM, as
+ * setSLMImage() does. Call displaySLMImage() to display it.
+ *
+ * @param deviceLabel name of the SLM
+ * @param patternId id returned by addSLMPattern()
+ */
+void CMMCore::setSLMPattern(const char* deviceLabel, long patternId) throw (CMMError)
+{
+   boost::shared_ptr<SLMInstance> pSLM =
+      deviceManager_->GetDeviceOfType<SLMInstance>(deviceLabel);
+
+   mm::DeviceModuleLockGuard guard(pSLM);
+   const unsigned char* pixels = getSLMPatternPixels(pSLM, patternId);
+   int ret;
+   if (pSLM->GetPatternCache()->IsPreparedInDevice(patternId))
+      ret = pSLM->SetSLMPattern(patternId);
+   else
+      // SetImage() does not modify the pixels it is given
+      ret = pSLM->SetImage(const_cast<unsigned char*>(pixels));
+   if (ret != DEVICE_OK)
+   {
+      logError(deviceLabel, getDeviceErrorText(ret, pSLM).c_str());
+      throw CMMError(getDeviceErrorText(ret, pSLM));
+   }
+}
+
+/**
+ * Load a sequence of patterns previously added with addSLMPattern() into the
+ * SLM, as loadSLMSequence() does. The same pattern may appear any number of
+ * times.
+ *
+ * @param deviceLabel name of the SLM
+ * @param patternIds ids returned by addSLMPattern()
+ */
+void CMMCore::loadSLMPatternSequence(const char* deviceLabel, std::vector<long> patternIds) throw (CMMError)
+{
+   boost::shared_ptr<SLMInstance> pSLM =
+      deviceManager_->GetDeviceOfType<SLMInstance>(deviceLabel);
+
+   mm::DeviceModuleLockGuard guard(pSLM);
+   // Check all ids before touching the device's sequence
+   std::vector<const unsigned char*> pixels;
+   pixels.reserve(patternIds.size());
+   for (std::vector<long>::const_iterator it = patternIds.begin(),
+         end = patternIds.end(); it != end; ++it)
+      pixels.push_back(getSLMPatternPixels(pSLM, *it));
+
+   int ret = pSLM->ClearSLMSequence();
+   if (ret != DEVICE_OK)
+      throw CMMError(getDeviceErrorText(ret, pSLM));
+
+   const mm::SLMPatternCache* cache = pSLM->GetPatternCache();
+   for (std::size_t i = 0; i < patternIds.size(); ++i)
+   {
+      if (cache->IsPreparedInDevice(patternIds[i]))
+         ret = pSLM->AddPatternToSLMSequence(patternIds[i]);
+      else
+         ret = pSLM->AddToSLMSequence(pixels[i]);
+      if (ret != DEVICE_OK)
+         throw CMMError(getDeviceErrorText(ret, pSLM));
+   }
+
+   ret = pSLM->SendSLMSequence();
+   if (ret != DEVICE_OK)
+      throw CMMError(getDeviceErrorText(ret, pSLM));
+}
+
+/**
+ * Remove a pattern from the SLM's pattern cache (and from the device).
+ *
+ * @param deviceLabel name of the SLM
+ * @param patternId id returned by addSLMPattern()
+ */
+void CMMCore::removeSLMPattern(const char* deviceLabel, long patternId) throw (CMMError)
+{
+   boost::shared_ptr<SLMInstance> pSLM =
+      deviceManager_->GetDeviceOfType<SLMInstance>(deviceLabel);
+
+   mm::DeviceModuleLockGuard guard(pSLM);
+   getSLMPatternPixels(pSLM, patternId);
+   mm::SLMPatternCache* cache = pSLM->GetPatternCache();
+   if (cache->IsPreparedInDevice(patternId))
+   {
+      int ret = pSLM->ReleaseSLMPattern(patternId);
+      if (ret != DEVICE_OK)
+         logError(deviceLabel, getDeviceErrorText(ret, pSLM).c_str());
+   }
+   cache->Remove(patternId);
+}
+
+/**
+ * Remove all patterns from the SLM's pattern cache (and from the device).
+ *
+ * @param deviceLabel name of the SLM
+ */
+void CMMCore::clearSLMPatterns(const char* deviceLabel) throw (CMMError)
+{
+   boost::shared_ptr<SLMInstance> pSLM =
+      deviceManager_->GetDeviceOfType<SLMInstance>(deviceLabel);
+
+   mm::DeviceModuleLockGuard guard(pSLM);
+   mm::SLMPatternCache* cache = pSLM->GetPatternCache();
+   if (!cache)
+      return;
+   releaseSLMPatterns(pSLM);
+   cache->Reset(cache->GetPatternBytes());
+}
+
+/**
+ * Get the ids of the patterns in the SLM's pattern cache.
+ *
+ * @param deviceLabel name of the SLM
+ */
+std::vector<long> CMMCore::getSLMPatterns(const char* deviceLabel) throw (CMMError)
+{
+   boost::shared_ptr<SLMInstance> pSLM =
+      deviceManager_->GetDeviceOfType<SLMInstance>(deviceLabel);
+
+   mm::DeviceModuleLockGuard guard(pSLM);
+   const mm::SLMPatternCache* cache = pSLM->GetPatternCache();
+   if (!cache)
+      return std::vector<long>();
+   return cache->GetIds();
+}
+
+// Must be called with the SLM's module lock held
+const unsigned char* CMMCore::getSLMPatternPixels(boost::shared_ptr<SLMInstance> pSLM, long patternId) throw (CMMError)
+{
+   const mm::SLMPatternCache* cache = pSLM->GetPatternCache();
+   const unsigned char* pixels = cache ? cache->GetPixels(patternId) : 0;
+   if (!pixels)
+      throw CMMError("No pattern " + ToString(patternId) + " in SLM " +
+            ToQuotedString(pSLM->GetLabel()));
+   return pixels;
+}
+
+// Must be called with the SLM's module lock held. Errors are logged only, as
+// the patterns are going away regardless.
+void CMMCore::releaseSLMPatterns(boost::shared_ptr<SLMInstance> pSLM)
+{
+   const mm::SLMPatternCache* cache = pSLM->GetPatternCache();
+   const std::vector<long> ids = cache->GetIds();
+   for (std::vector<long>::const_iterator it = ids.begin(), end = ids.end();
+         it != end; ++it)
+   {
+      if (!cache->IsPreparedInDevice(*it))
+         continue;
+      int ret = pSLM->ReleaseSLMPattern(*it);
+      if (ret != DEVICE_OK)
+         logError(pSLM->GetLabel().c_str(),
+               getDeviceErrorText(ret, pSLM).c_str());
+   }
+}
+
 /* GALVO CODE */
 
 /**
@@ -6305,6 +7349,119 @@ string CMMCore::getGalvoChannel(const char* deviceLabel) throw (CMMError)
    return pGalvo->GetChannel();
 }
 
+/**
+ * Load a set of ROIs into the galvo device in one go, replacing any polygons
+ * loaded before. Run them with runGalvoPolygons().
+ *
+ * The ROIs are given as flat arrays: ROI i has vertexCounts[i] vertices,
+ * which follow those of ROI i - 1 in xs and ys. An ROI with one vertex is a
+ * point, one with two vertices a line segment, and one with more a (filled)
+ * polygon.
+ *
+ * The Core rasterizes each ROI into points spacing apart, repeats it
+ * repetitions[i] times with dwellTimes_us[i] at each point, and joins the
+ * ROIs, starting from the galvo's current position, in an order that keeps
+ * the travel between them short. Devices that accept scan paths receive the
+ * whole path in a single call. Other devices receive the ROIs as polygons,
+ * in the same order (each added repetitions[i] times); these require all
+ * dwell times to be equal, and use them as the spot interval.
+ *
+ * @param galvoLabel the galvo device
+ * @param vertexCounts number of vertices of each ROI
+ * @param xs vertex X positions in galvo units
+ * @param ys vertex Y positions in galvo units
+ * @param repetitions number of times to run each ROI
+ * @param dwellTimes_us time to spend at each point of each ROI
+ * @param spacing distance between raster points, in galvo units
+ */
+void CMMCore::loadGalvoROIs(const char* galvoLabel,
+      std::vector<long> vertexCounts, std::vector<double> xs,
+      std::vector<double> ys, std::vector<long> repetitions,
+      std::vector<double> dwellTimes_us, double spacing) throw (CMMError)
+{
+   boost::shared_ptr<GalvoInstance> pGalvo =
+      deviceManager_->GetDeviceOfType<GalvoInstance>(galvoLabel);
+
+   const std::size_t nrROIs = vertexCounts.size();
+   if (repetitions.size() != nrROIs || dwellTimes_us.size() != nrROIs)
+      throw CMMError("Galvo ROIs need one repetition count and dwell time each");
+   if (xs.size() != ys.size())
+      throw CMMError("Galvo ROI vertex X and Y counts differ");
+   if (!(spacing > 0.0))
+      throw CMMError("Galvo ROI spacing must be positive");
+
+   std::vector<mm::GalvoROI> rois(nrROIs);
+   std::size_t vertex = 0;
+   bool uniformDwellTime = true;
+   for (std::size_t i = 0; i < nrROIs; ++i)
+   {
+      if (vertexCounts[i] < 1 || vertexCounts[i] > static_cast<long>(xs.size() - vertex))
+         throw CMMError("Galvo ROI vertex counts do not match the vertices");
+      if (repetitions[i] < 0 || !(dwellTimes_us[i] >= 0.0))
+         throw CMMError("Galvo ROI repetitions and dwell times must not be negative");
+      rois[i].xs.assign(xs.begin() + vertex, xs.begin() + vertex + vertexCounts[i]);
+      rois[i].ys.assign(ys.begin() + vertex, ys.begin() + vertex + vertexCounts[i]);
+      rois[i].repetitions = repetitions[i];
+      rois[i].dwellTime_us = dwellTimes_us[i];
+      vertex += vertexCounts[i];
+      if (dwellTimes_us[i] != dwellTimes_us[0])
+         uniformDwellTime = false;
+   }
+   if (vertex != xs.size())
+      throw CMMError("Galvo ROI vertex counts do not match the vertices");
+
+   mm::DeviceModuleLockGuard guard(pGalvo);
+
+   double startX, startY;
+   if (pGalvo->GetPosition(startX, startY) != DEVICE_OK)
+   {
+      startX = pGalvo->GetXMinimum();
+      startY = pGalvo->GetYMinimum();
+   }
+   const mm::GalvoScanPath path =
+      mm::CompileGalvoScanPath(rois, spacing, startX, startY);
+   LOG_DEBUG(coreLogger_) << "Compiled " << nrROIs << " galvo ROIs into " <<
+      path.GetNumberOfPoints() << " points";
+
+   const long nrPoints = static_cast<long>(path.GetNumberOfPoints());
+   int ret = pGalvo->LoadScanPath(nrPoints ? &path.xs[0] : 0,
+         nrPoints ? &path.ys[0] : 0,
+         nrPoints ? &path.dwellTimes_us[0] : 0, nrPoints);
+   if (ret == DEVICE_UNSUPPORTED_COMMAND)
+   {
+      if (!uniformDwellTime)
+         throw CMMError("Galvo device " + ToQuotedString(galvoLabel) +
+               " does not support scan paths, and cannot run ROIs with "
+               "different dwell times");
+
+      ret = pGalvo->DeletePolygons();
+      if (ret == DEVICE_OK && nrROIs > 0)
+         ret = pGalvo->SetSpotInterval(dwellTimes_us[0]);
+      int polygonIndex = 0;
+      for (std::vector<std::size_t>::const_iterator it = path.roiOrder.begin(),
+            end = path.roiOrder.end(); ret == DEVICE_OK && it != end; ++it)
+      {
+         const mm::GalvoROI& roi = rois[*it];
+         for (long rep = 0; ret == DEVICE_OK && rep < roi.repetitions; ++rep)
+         {
+            for (std::size_t v = 0; ret == DEVICE_OK && v < roi.xs.size(); ++v)
+               ret = pGalvo->AddPolygonVertex(polygonIndex, roi.xs[v], roi.ys[v]);
+            ++polygonIndex;
+         }
+      }
+      if (ret == DEVICE_OK)
+         ret = pGalvo->SetPolygonRepetitions(1);
+      if (ret == DEVICE_OK)
+         ret = pGalvo->LoadPolygons();
+   }
+
+   if (ret != DEVICE_OK)
+   {
+      logError(galvoLabel, getDeviceErrorText(ret, pGalvo).c_str());
+      throw CMMError(getDeviceErrorText(ret, pGalvo));
+   }
+}
+
 /* SYSTEM STATE */
 
 
@@ -7358,7 +8515,7 @@ void CMMCore::applyConfiguration(const Configuration& config) throw (CMMError)
          properties_->Execute(setting.getPropertyName().c_str(), setting.getPropertyValue().c_str());
          {
             MMThreadGuard scg(stateCacheLock_);
-            stateCache_.addSetting(PropertySetting(MM::g_Keyword_CoreDevice, setting.getPropertyName().c_str(), setting.getPropertyValue().c_str()));
+            stateCache_.Set(PropertySetting(MM::g_Keyword_CoreDevice, setting.getPropertyName().c_str(), setting.getPropertyValue().c_str()));
          }
       }
       else
@@ -7374,7 +8531,7 @@ void CMMCore::applyConfiguration(const Configuration& config) throw (CMMError)
 
             {
                MMThreadGuard scg(stateCacheLock_);
-               stateCache_.addSetting(setting);
+               stateCache_.Set(setting);
             }
          }
          catch (const CMMError&)
@@ -7421,7 +8578,7 @@ int CMMCore::applyProperties(vector<PropertySetting>& props, string& lastError)
 
          {
             MMThreadGuard scg(stateCacheLock_);
-            stateCache_.addSetting(props[i]);
+            stateCache_.Set(props[i]);
          }
       }
       catch (const CMMError& e)
@@ -56,12 +56,15 @@
 #include "../MMDevice/DeviceThreads.h"
 #include "../MMDevice/MMDevice.h"
 #include "../MMDevice/MMDeviceConstants.h"
+#include "AcquisitionPlan.h"
 #include "Configuration.h"
 #include "CoreUtils.h"
 #include "Error.h"
 #include "ErrorCodes.h"
 #include "Logging/Logger.h"
+#include "StateCache.h"
 
+#include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/weak_ptr.hpp>
 
@@ -108,8 +111,11 @@ class XYStageInstance;
 class CMMCore;
 
 namespace mm {
+   class AcquisitionEngine;
    class DeviceManager;
+   class FrameMatcher;
    class LogManager;
+   class PipelinedSnap;
 } // namespace mm
 
 typedef unsigned int* imgRGB32;
@@ -128,6 +134,7 @@ class CMMCore
 {
    friend class CoreCallback;
    friend class CorePropertyCollection;
+   friend class mm::AcquisitionEngine;
 
 public:
    CMMCore();
@@ -174,6 +181,11 @@ public:
    ///@{
    void setPrimaryLogFile(const char* filename, bool truncate = false) throw (CMMError);
    std::string getPrimaryLogFile() const;
+   void setPrimaryLogRollover(int maxSizeMB, int maxAgeMinutes,
+         int maxOldFiles) throw (CMMError);
+   int getPrimaryLogRolloverSizeMB() const;
+   int getPrimaryLogRolloverAgeMinutes() const;
+   int getPrimaryLogMaxOldFiles() const;
 
    void logMessage(const char* msg);
    void logMessage(const char* msg, bool debugOnly);
@@ -181,11 +193,20 @@ public:
    bool debugLogEnabled();
    void enableStderrLog(bool enable);
    bool stderrLogEnabled();
+   void setLogFlushInterval(int milliseconds) throw (CMMError);
+   int getLogFlushInterval() const;
+   void setLogQueueCapacity(int maxLines, bool blockWhenFull) throw (CMMError);
+   int getLogQueueCapacity() const;
+   bool getLogQueueBlocksWhenFull() const;
 
    int startSecondaryLogFile(const char* filename, bool enableDebug,
          bool truncate = true, bool synchronous = false) throw (CMMError);
    void stopSecondaryLogFile(int handle) throw (CMMError);
 
+   void startTrace();
+   void stopTrace(const char* filename) throw (CMMError);
+   bool isTraceRunning() const;
+
    ///@}
 
    /** \name Device listing. */
@@ -236,6 +257,7 @@ public:
    void stopPropertySequence(const char* label, const char* propName) throw (CMMError);
    long getPropertySequenceMaxLength(const char* label, const char* propName) throw (CMMError);
    void loadPropertySequence(const char* label, const char* propName, std::vector<std::string> eventSequence) throw (CMMError);
+   void loadPropertySequence(const char* label, const char* propName, std::vector<double> values) throw (CMMError);
 
    bool deviceBusy(const char* label) throw (CMMError);
    void waitForDevice(const char* label) throw (CMMError);
@@ -285,6 +307,9 @@ public:
     */
    ///@{
    Configuration getSystemStateCache() const;
+   long long getSystemStateCacheVersion() const;
+   Configuration getSystemStateCacheChangesSince(long long version) const;
+   long long getSystemStateCacheResetVersion() const;
    void updateSystemStateCache();
    std::string getPropertyFromCache(const char* deviceLabel,
          const char* propName) const throw (CMMError);
@@ -374,6 +399,8 @@ public:
    double getExposure(const char* label) throw (CMMError);
 
    void snapImage() throw (CMMError);
+   void startSnapImage() throw (CMMError);
+   void waitForSnapImage() throw (CMMError);
    void* getImage() throw (CMMError);
    void* getImage(unsigned numChannel) throw (CMMError);
 
@@ -414,10 +441,15 @@ public:
       const throw (CMMError);
    void* popNextImageMD(unsigned channel, unsigned slice, Metadata& md)
       throw (CMMError);
+   void* peekNextImageMD(unsigned channel, unsigned slice, Metadata& md)
+      const throw (CMMError);
    void* getLastImageMD(Metadata& md) const throw (CMMError);
    void* getNBeforeLastImageMD(unsigned long n, Metadata& md)
       const throw (CMMError);
    void* popNextImageMD(Metadata& md) throw (CMMError);
+   std::string getTaggedImageTags(const Metadata& md) throw (CMMError);
+   std::string getTaggedImageTags(const Metadata& md,
+         unsigned cameraChannelIndex) throw (CMMError);
 
    long getRemainingImageCount();
    long getBufferTotalCapacity();
@@ -436,6 +468,27 @@ public:
          std::vector<double> exposureSequence_ms) throw (CMMError);
    ///@}
 
+   /** \name Acquisition plans (multi-dimensional acquisition run by the Core). */
+   ///@{
+   void startAcquisitionPlan(const AcquisitionPlan& plan) throw (CMMError);
+   void stopAcquisitionPlan();
+   void waitForAcquisitionPlan() throw (CMMError);
+   bool isAcquisitionPlanRunning() const;
+   long getAcquisitionPlanEventsDone() const;
+   ///@}
+
+   /** \name Multi-camera frame matching. */
+   ///@{
+   void startCameraFrameMatching(std::vector<std::string> cameraLabels,
+         const char* keyTag, double tolerance, bool dropUnmatched)
+      throw (CMMError);
+   void stopCameraFrameMatching() throw (CMMError);
+   bool isCameraFrameMatchingRunning() const;
+   long getMatchedCameraFrameCount() const;
+   long getUnmatchedCameraFrameCount() const;
+   long getDroppedCameraImageCount() const;
+   ///@}
+
    /** \name Autofocus control. */
    ///@{
    double getLastFocusScore();
@@ -579,6 +632,16 @@ public:
    void stopSLMSequence(const char* slmLabel) throw (CMMError);
    void loadSLMSequence(const char* slmLabel,
          std::vector<unsigned char*> imageSequence) throw (CMMError);
+
+   long addSLMPattern(const char* slmLabel,
+         unsigned char* pixels) throw (CMMError);
+   void setSLMPattern(const char* slmLabel, long patternId) throw (CMMError);
+   void loadSLMPatternSequence(const char* slmLabel,
+         std::vector<long> patternIds) throw (CMMError);
+   void removeSLMPattern(const char* slmLabel, long patternId)
+      throw (CMMError);
+   void clearSLMPatterns(const char* slmLabel) throw (CMMError);
+   std::vector<long> getSLMPatterns(const char* slmLabel) throw (CMMError);
    ///@}
 
    /** \name Galvo control.
@@ -609,6 +672,10 @@ public:
    void runGalvoPolygons(const char* galvoLabel) throw (CMMError);
    void runGalvoSequence(const char* galvoLabel) throw (CMMError);
    std::string getGalvoChannel(const char* galvoLabel) throw (CMMError);
+   void loadGalvoROIs(const char* galvoLabel, std::vector<long> vertexCounts,
+         std::vector<double> xs, std::vector<double> ys,
+         std::vector<long> repetitions, std::vector<double> dwellTimes_us,
+         double spacing) throw (CMMError);
    ///@}
 
    /** \name Device discovery. */
@@ -672,6 +739,12 @@ private:
    MMEventCallback* externalCallback_;  // notification hook to the higher layer (e.g. GUI)
    PixelSizeConfigGroup* pixelSizeGroup_;
    CircularBuffer* cbuf_;
+   boost::scoped_ptr<mm::AcquisitionEngine> acquisitionEngine_;
+   boost::scoped_ptr<mm::PipelinedSnap> pipelinedSnap_;
+   // The current or last frame matcher (kept for its statistics)
+   boost::shared_ptr<mm::FrameMatcher> frameMatcher_;
+   bool frameMatchingRunning_; // Synchronized by frameMatcherLock_
+   mutable MMThreadLock frameMatcherLock_;
 
    std::vector< boost::weak_ptr<DeviceInstance> > imageSynchroDevices_;
    boost::shared_ptr<CPluginManager> pluginManager_;
@@ -682,7 +755,7 @@ private:
    // Must be unlocked when calling MMEventCallback or calling device methods
    // or acquiring a module lock
    mutable MMThreadLock stateCacheLock_;
-   mutable Configuration stateCache_; // Synchronized by stateCacheLock_
+   mutable mm::StateCache stateCache_; // Synchronized by stateCacheLock_
 
    MMThreadLock* pPostedErrorsLock_;
    mutable std::deque<std::pair< int, std::string> > postedErrors_;
@@ -704,6 +777,11 @@ private:
    void applyConfiguration(const Configuration& config) throw (CMMError);
    int applyProperties(std::vector<PropertySetting>& props, std::string& lastError);
    void waitForDevice(boost::shared_ptr<DeviceInstance> pDev) throw (CMMError);
+   void finishPendingSnap() throw (CMMError);
+   boost::shared_ptr<mm::FrameMatcher> getRunningFrameMatcher() const;
+   const unsigned char* getSLMPatternPixels(boost::shared_ptr<SLMInstance> pSLM,
+         long patternId) throw (CMMError);
+   void releaseSLMPatterns(boost::shared_ptr<SLMInstance> pSLM);
    Configuration getConfigGroupState(const char* group, bool fromCache) throw (CMMError);
    std::string getDeviceErrorText(int deviceCode, boost::shared_ptr<DeviceInstance> pDevice);
    std::string getDeviceName(boost::shared_ptr<DeviceInstance> pDev);
@@ -712,6 +790,8 @@ private:
    void assignDefaultRole(boost::shared_ptr<DeviceInstance> pDev);
    void updateCoreProperty(const char* propName, MM::DeviceType devType) throw (CMMError);
    void loadSystemConfigurationImpl(const char* fileName) throw (CMMError);
+   std::string getTaggedImageTags(const Metadata& md,
+         bool hasCameraChannelIndex, unsigned cameraChannelIndex) throw (CMMError);
 };
 
 #endif //_MMCORE_H_
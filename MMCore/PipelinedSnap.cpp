@@ -0,0 +1,133 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          PipelinedSnap.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Snaps an image on a separate thread, signaling the end of
+//                the exposure before the image has been read out
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "PipelinedSnap.h"
+
+#include "../MMDevice/MMDeviceConstants.h"
+#include "DeviceManager.h"
+#include "Devices/CameraInstance.h"
+
+#include <boost/bind.hpp>
+
+namespace mm
+{
+
+PipelinedSnap::PipelinedSnap() :
+   exposureFinished_(false),
+   snapFinished_(false),
+   result_(DEVICE_OK)
+{
+}
+
+
+PipelinedSnap::~PipelinedSnap()
+{
+   boost::shared_ptr<CameraInstance> camera;
+   Wait(camera);
+}
+
+
+void
+PipelinedSnap::Start(boost::shared_ptr<CameraInstance> camera)
+{
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   camera_ = camera;
+   exposureFinished_ = false;
+   snapFinished_ = false;
+   result_ = DEVICE_OK;
+   thread_.reset(new boost::thread(boost::bind(&PipelinedSnap::Run,
+               this, camera)));
+}
+
+
+void
+PipelinedSnap::WaitForExposure()
+{
+   boost::unique_lock<boost::mutex> lock(mutex_);
+   while (thread_ && !exposureFinished_)
+      condVar_.wait(lock);
+}
+
+
+int
+PipelinedSnap::Wait(boost::shared_ptr<CameraInstance>& camera)
+{
+   boost::scoped_ptr<boost::thread> thread;
+   {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      thread.swap(thread_);
+   }
+   if (!thread)
+   {
+      camera.reset();
+      return DEVICE_OK;
+   }
+
+   thread->join();
+
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   camera.swap(camera_);
+   camera_.reset();
+   return result_;
+}
+
+
+bool
+PipelinedSnap::IsPending() const
+{
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   return thread_.get() != 0;
+}
+
+
+void
+PipelinedSnap::ExposureFinished(const MM::Device* caller)
+{
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   if (!camera_ || snapFinished_ || camera_->GetRawPtr() != caller)
+      return;
+   exposureFinished_ = true;
+   condVar_.notify_all();
+}
+
+
+void
+PipelinedSnap::Run(boost::shared_ptr<CameraInstance> camera)
+{
+   int ret;
+   try
+   {
+      mm::DeviceModuleLockGuard guard(camera);
+      ret = camera->SnapImage();
+   }
+   catch (...)
+   {
+      ret = DEVICE_ERR;
+   }
+
+   boost::lock_guard<boost::mutex> lock(mutex_);
+   result_ = ret;
+   snapFinished_ = true;
+   exposureFinished_ = true;
+   condVar_.notify_all();
+}
+
+} // namespace mm
@@ -0,0 +1,96 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          PipelinedSnap.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Snaps an image on a separate thread, signaling the end of
+//                the exposure before the image has been read out
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/utility.hpp>
+
+class CameraInstance;
+
+namespace MM
+{
+   class Device;
+} // namespace MM
+
+namespace mm
+{
+
+/**
+ * Runs a camera's SnapImage() on its own thread, holding the camera's module
+ * lock, so that the caller can go on (e.g. start moving stages) while the
+ * image is read out.
+ *
+ * The exposure is taken to have ended when the camera calls
+ * MM::Core::OnExposureFinished() from within SnapImage(), or else when
+ * SnapImage() returns.
+ */
+class PipelinedSnap : boost::noncopyable
+{
+public:
+   PipelinedSnap();
+   // Waits for any pending snap (ignoring its result)
+   ~PipelinedSnap();
+
+   /**
+    * Start a snap. Any previous snap must have been waited for with Wait().
+    */
+   void Start(boost::shared_ptr<CameraInstance> camera);
+
+   /**
+    * Wait until the exposure of the pending snap has ended. Returns
+    * immediately if no snap is pending.
+    */
+   void WaitForExposure();
+
+   /**
+    * Wait for the pending snap to finish, and return the result of
+    * SnapImage() (DEVICE_OK if no snap was pending). The camera that was
+    * snapped is returned in camera (null if no snap was pending).
+    */
+   int Wait(boost::shared_ptr<CameraInstance>& camera);
+
+   bool IsPending() const;
+
+   /**
+    * Called (from the camera's thread, through the Core callback) when a
+    * camera signals the end of its exposure. Ignored unless caller is the
+    * camera of the pending snap.
+    */
+   void ExposureFinished(const MM::Device* caller);
+
+private:
+   void Run(boost::shared_ptr<CameraInstance> camera);
+
+   mutable boost::mutex mutex_;
+   boost::condition_variable condVar_;
+   boost::scoped_ptr<boost::thread> thread_;
+   boost::shared_ptr<CameraInstance> camera_;
+   bool exposureFinished_;
+   bool snapFinished_;
+   int result_;
+};
+
+} // namespace mm
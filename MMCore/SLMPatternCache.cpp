@@ -0,0 +1,189 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          SLMPatternCache.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Deduplicated store of the 8-bit patterns registered with an
+//                SLM
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "SLMPatternCache.h"
+
+#include <cstring>
+#include <utility>
+
+namespace mm
+{
+
+class SLMPatternCache::Pattern : boost::noncopyable
+{
+   std::vector<unsigned char> storage_;
+   unsigned char* pixels_;
+
+public:
+   const boost::uint64_t hash;
+   bool preparedInDevice;
+
+   Pattern(const unsigned char* pixels, std::size_t size,
+         boost::uint64_t contentHash) :
+      storage_(size + Alignment - 1),
+      hash(contentHash),
+      preparedInDevice(false)
+   {
+      unsigned char* begin = &storage_[0];
+      const std::size_t misalignment =
+         reinterpret_cast<std::size_t>(begin) % Alignment;
+      pixels_ = misalignment ? begin + (Alignment - misalignment) : begin;
+      std::memcpy(pixels_, pixels, size);
+   }
+
+   const unsigned char* GetPixels() const { return pixels_; }
+};
+
+
+SLMPatternCache::SLMPatternCache(std::size_t patternBytes) :
+   patternBytes_(patternBytes),
+   nextId_(0)
+{
+}
+
+
+SLMPatternCache::~SLMPatternCache()
+{
+}
+
+
+long
+SLMPatternCache::Add(const unsigned char* pixels, bool& added)
+{
+   const boost::uint64_t hash = Hash(pixels, patternBytes_);
+   std::pair<HashIndex::const_iterator, HashIndex::const_iterator> sameHash =
+      idsByHash_.equal_range(hash);
+   for (HashIndex::const_iterator it = sameHash.first;
+         it != sameHash.second; ++it)
+   {
+      const Pattern& pattern = *patterns_.find(it->second)->second;
+      if (std::memcmp(pattern.GetPixels(), pixels, patternBytes_) == 0)
+      {
+         added = false;
+         return it->second;
+      }
+   }
+
+   const long id = nextId_++;
+   patterns_.insert(std::make_pair(id,
+            boost::shared_ptr<Pattern>(new Pattern(pixels, patternBytes_, hash))));
+   idsByHash_.insert(std::make_pair(hash, id));
+   added = true;
+   return id;
+}
+
+
+bool
+SLMPatternCache::Remove(long id)
+{
+   PatternMap::iterator found = patterns_.find(id);
+   if (found == patterns_.end())
+      return false;
+
+   std::pair<HashIndex::iterator, HashIndex::iterator> sameHash =
+      idsByHash_.equal_range(found->second->hash);
+   for (HashIndex::iterator it = sameHash.first; it != sameHash.second; ++it)
+   {
+      if (it->second == id)
+      {
+         idsByHash_.erase(it);
+         break;
+      }
+   }
+   patterns_.erase(found);
+   return true;
+}
+
+
+void
+SLMPatternCache::Reset(std::size_t patternBytes)
+{
+   patterns_.clear();
+   idsByHash_.clear();
+   patternBytes_ = patternBytes;
+}
+
+
+std::vector<long>
+SLMPatternCache::GetIds() const
+{
+   std::vector<long> ids;
+   ids.reserve(patterns_.size());
+   for (PatternMap::const_iterator it = patterns_.begin(),
+         end = patterns_.end(); it != end; ++it)
+      ids.push_back(it->first);
+   return ids;
+}
+
+
+const unsigned char*
+SLMPatternCache::GetPixels(long id) const
+{
+   PatternMap::const_iterator found = patterns_.find(id);
+   if (found == patterns_.end())
+      return 0;
+   return found->second->GetPixels();
+}
+
+
+bool
+SLMPatternCache::IsPreparedInDevice(long id) const
+{
+   PatternMap::const_iterator found = patterns_.find(id);
+   return found != patterns_.end() && found->second->preparedInDevice;
+}
+
+
+void
+SLMPatternCache::SetPreparedInDevice(long id, bool prepared)
+{
+   PatternMap::iterator found = patterns_.find(id);
+   if (found != patterns_.end())
+      found->second->preparedInDevice = prepared;
+}
+
+
+boost::uint64_t
+SLMPatternCache::Hash(const unsigned char* data, std::size_t size)
+{
+   // FNV-1a over 64-bit words, followed by a final mix so that all bits of
+   // the words affect the low bits of the result
+   const boost::uint64_t prime = 0x100000001b3ULL;
+   boost::uint64_t hash = 0xcbf29ce484222325ULL;
+
+   std::size_t i = 0;
+   for (; i + 8 <= size; i += 8)
+   {
+      boost::uint64_t word;
+      std::memcpy(&word, data + i, 8);
+      hash = (hash ^ word) * prime;
+   }
+   for (; i < size; ++i)
+      hash = (hash ^ data[i]) * prime;
+
+   hash ^= size;
+   hash ^= hash >> 33;
+   hash *= 0xff51afd7ed558ccdULL;
+   hash ^= hash >> 33;
+   return hash;
+}
+
+} // namespace mm
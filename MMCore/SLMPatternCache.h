@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          SLMPatternCache.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Deduplicated store of the 8-bit patterns registered with an
+//                SLM
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+namespace mm
+{
+
+/**
+ * The patterns of one SLM, keyed by id. Adding a pattern whose pixels are
+ * identical to those of a pattern already in the cache returns the existing
+ * id, so that the pattern is only sent to the device once.
+ *
+ * Pixels are copied into buffers aligned to Alignment bytes, which stay at
+ * the same address until the pattern is removed (devices may keep pointers
+ * to them).
+ *
+ * Not thread safe; the Core only accesses it with the SLM's module lock held.
+ */
+class SLMPatternCache : boost::noncopyable
+{
+public:
+   static const std::size_t Alignment = 64;
+
+   explicit SLMPatternCache(std::size_t patternBytes);
+   ~SLMPatternCache();
+
+   std::size_t GetPatternBytes() const { return patternBytes_; }
+   std::size_t GetNumberOfPatterns() const { return patterns_.size(); }
+
+   /**
+    * Add a pattern of GetPatternBytes() bytes, unless an identical one is
+    * present. Returns the pattern's id and sets added to whether the pattern
+    * is new. Ids are never reused by the same cache.
+    */
+   long Add(const unsigned char* pixels, bool& added);
+
+   /**
+    * Remove a pattern. Returns false if there is no such pattern.
+    */
+   bool Remove(long id);
+
+   /**
+    * Remove all patterns and change the pattern size.
+    */
+   void Reset(std::size_t patternBytes);
+
+   std::vector<long> GetIds() const;
+
+   /**
+    * Returns null if there is no such pattern.
+    */
+   const unsigned char* GetPixels(long id) const;
+
+   /**
+    * Whether the device has accepted the pattern with PrepareSLMPattern()
+    * (false for unknown ids).
+    */
+   bool IsPreparedInDevice(long id) const;
+   void SetPreparedInDevice(long id, bool prepared);
+
+   /**
+    * Content hash used for deduplication. Consumes 8 bytes at a time.
+    */
+   static boost::uint64_t Hash(const unsigned char* data, std::size_t size);
+
+private:
+   class Pattern;
+   typedef std::map< long, boost::shared_ptr<Pattern> > PatternMap;
+   typedef std::multimap<boost::uint64_t, long> HashIndex;
+
+   std::size_t patternBytes_;
+   long nextId_;
+   PatternMap patterns_;
+   HashIndex idsByHash_;
+};
+
+} // namespace mm
@@ -0,0 +1,276 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          SequencePlanner.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Partitions acquisition plans into hardware-sequenced bursts
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "SequencePlanner.h"
+
+#include "MMCore.h"
+
+#include <set>
+
+namespace mm
+{
+
+namespace
+{
+
+typedef SequenceCapabilities::Key Key;
+
+long
+MaxLength(const std::map<Key, long>& maxLengths, const Key& key)
+{
+   std::map<Key, long>::const_iterator it = maxLengths.find(key);
+   if (it == maxLengths.end())
+      return 0;
+   return it->second;
+}
+
+
+Configuration
+PresetSettings(const SequenceCapabilities& capabilities,
+      const AcquisitionEvent& event)
+{
+   std::map<Key, Configuration>::const_iterator it =
+      capabilities.presets.find(Key(event.getConfigGroup(),
+               event.getConfigPreset()));
+   if (it == capabilities.presets.end())
+      return Configuration();
+   return it->second;
+}
+
+
+bool
+SetsSameKinds(const AcquisitionEvent& a, const AcquisitionEvent& b)
+{
+   return a.hasZPosition() == b.hasZPosition() &&
+      a.hasXYPosition() == b.hasXYPosition() &&
+      a.hasExposure() == b.hasExposure() &&
+      a.getConfigGroup() == b.getConfigGroup();
+}
+
+} // anonymous namespace
+
+
+SequenceCapabilities
+QuerySequenceCapabilities(CMMCore& core,
+      const std::vector<AcquisitionEvent>& events)
+{
+   bool usesZ = false;
+   bool usesXY = false;
+   bool usesExposure = false;
+   std::set<Key> presetKeys;
+   for (std::vector<AcquisitionEvent>::const_iterator it = events.begin(),
+         end = events.end(); it != end; ++it)
+   {
+      usesZ = usesZ || it->hasZPosition();
+      usesXY = usesXY || it->hasXYPosition();
+      usesExposure = usesExposure || it->hasExposure();
+      if (it->hasConfig())
+         presetKeys.insert(Key(it->getConfigGroup(), it->getConfigPreset()));
+   }
+
+   SequenceCapabilities capabilities;
+   try
+   {
+      const std::string focus = core.getFocusDevice();
+      if (usesZ && !focus.empty() && core.isStageSequenceable(focus.c_str()))
+         capabilities.zMaxLength =
+            core.getStageSequenceMaxLength(focus.c_str());
+   }
+   catch (const CMMError&)
+   {
+   }
+   try
+   {
+      const std::string xyStage = core.getXYStageDevice();
+      if (usesXY && !xyStage.empty() &&
+            core.isXYStageSequenceable(xyStage.c_str()))
+         capabilities.xyMaxLength =
+            core.getXYStageSequenceMaxLength(xyStage.c_str());
+   }
+   catch (const CMMError&)
+   {
+   }
+   try
+   {
+      const std::string camera = core.getCameraDevice();
+      if (usesExposure && !camera.empty() &&
+            core.isExposureSequenceable(camera.c_str()))
+         capabilities.exposureMaxLength =
+            core.getExposureSequenceMaxLength(camera.c_str());
+   }
+   catch (const CMMError&)
+   {
+   }
+
+   std::set<Key> queriedProperties;
+   for (std::set<Key>::const_iterator it = presetKeys.begin(),
+         end = presetKeys.end(); it != end; ++it)
+   {
+      Configuration settings;
+      try
+      {
+         settings = core.getConfigData(it->first.c_str(), it->second.c_str());
+      }
+      catch (const CMMError&)
+      {
+         continue;
+      }
+      capabilities.presets[*it] = settings;
+
+      for (size_t i = 0; i < settings.size(); ++i)
+      {
+         const PropertySetting setting = settings.getSetting(i);
+         const Key property(setting.getDeviceLabel(),
+               setting.getPropertyName());
+         if (!queriedProperties.insert(property).second)
+            continue;
+         try
+         {
+            if (core.isPropertySequenceable(property.first.c_str(),
+                     property.second.c_str()))
+               capabilities.propertyMaxLengths[property] =
+                  core.getPropertySequenceMaxLength(property.first.c_str(),
+                        property.second.c_str());
+         }
+         catch (const CMMError&)
+         {
+         }
+      }
+   }
+   return capabilities;
+}
+
+
+std::vector<SequenceBurst>
+PlanSequenceBursts(const std::vector<AcquisitionEvent>& events,
+      const SequenceCapabilities& capabilities)
+{
+   std::vector<SequenceBurst> bursts;
+   std::size_t i = 0;
+   while (i < events.size())
+   {
+      const AcquisitionEvent& first = events[i];
+      SequenceBurst burst(i);
+
+      // The properties set by the first event's preset, with their values
+      // for each event of the burst
+      std::vector<PropertySetting> firstSettings;
+      std::vector< std::vector<std::string> > values;
+      std::vector<bool> varying;
+      if (first.hasConfig())
+      {
+         const Configuration settings = PresetSettings(capabilities, first);
+         for (size_t k = 0; k < settings.size(); ++k)
+         {
+            firstSettings.push_back(settings.getSetting(k));
+            values.push_back(std::vector<std::string>(1,
+                     firstSettings.back().getPropertyValue()));
+         }
+         varying.resize(firstSettings.size(), false);
+      }
+
+      for (std::size_t j = i + 1; j < events.size(); ++j)
+      {
+         const AcquisitionEvent& event = events[j];
+         const long length = static_cast<long>(j - i + 1);
+         if (length > capabilities.cameraMaxLength)
+            break;
+         if (!SetsSameKinds(first, event) ||
+               event.getMinimumStartTime() > first.getMinimumStartTime())
+            break;
+
+         const bool z = burst.sequenceZ ||
+            (event.hasZPosition() &&
+             event.getZPosition() != first.getZPosition());
+         if (z && length > capabilities.zMaxLength)
+            break;
+         const bool xy = burst.sequenceXY ||
+            (event.hasXYPosition() &&
+             (event.getXPosition() != first.getXPosition() ||
+              event.getYPosition() != first.getYPosition()));
+         if (xy && length > capabilities.xyMaxLength)
+            break;
+         const bool exposure = burst.sequenceExposure ||
+            (event.hasExposure() &&
+             event.getExposure() != first.getExposure());
+         if (exposure && length > capabilities.exposureMaxLength)
+            break;
+
+         std::vector<std::string> eventValues;
+         std::vector<bool> eventVarying(varying);
+         if (event.hasConfig())
+         {
+            // The preset must set the same properties as the first one, and
+            // those that vary must be sequenceable
+            const Configuration settings = PresetSettings(capabilities, event);
+            if (settings.size() != firstSettings.size())
+               break;
+            bool sequenceable = true;
+            for (size_t k = 0; sequenceable && k < firstSettings.size(); ++k)
+            {
+               const std::string device = firstSettings[k].getDeviceLabel();
+               const std::string property =
+                  firstSettings[k].getPropertyName();
+               if (!settings.isPropertyIncluded(device.c_str(),
+                        property.c_str()))
+               {
+                  sequenceable = false;
+                  break;
+               }
+               eventValues.push_back(settings.getSetting(device.c_str(),
+                        property.c_str()).getPropertyValue());
+               if (eventValues.back() != firstSettings[k].getPropertyValue())
+                  eventVarying[k] = true;
+               if (eventVarying[k] && length >
+                     MaxLength(capabilities.propertyMaxLengths,
+                        Key(device, property)))
+                  sequenceable = false;
+            }
+            if (!sequenceable)
+               break;
+         }
+
+         burst.nrEvents = static_cast<std::size_t>(length);
+         burst.sequenceZ = z;
+         burst.sequenceXY = xy;
+         burst.sequenceExposure = exposure;
+         varying = eventVarying;
+         for (size_t k = 0; k < eventValues.size(); ++k)
+            values[k].push_back(eventValues[k]);
+      }
+
+      for (size_t k = 0; k < firstSettings.size(); ++k)
+      {
+         if (!varying[k])
+            continue;
+         PropertySequence sequence;
+         sequence.device = firstSettings[k].getDeviceLabel();
+         sequence.property = firstSettings[k].getPropertyName();
+         sequence.values = values[k];
+         burst.properties.push_back(sequence);
+      }
+
+      bursts.push_back(burst);
+      i += burst.nrEvents;
+   }
+   return bursts;
+}
+
+} // namespace mm
@@ -0,0 +1,115 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          SequencePlanner.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Partitions acquisition plans into hardware-sequenced bursts
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "AcquisitionPlan.h"
+#include "Configuration.h"
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+class CMMCore;
+
+namespace mm
+{
+
+/**
+ * What the current devices can sequence, as far as a given plan is
+ * concerned. Maximum lengths are 0 for devices that cannot be sequenced.
+ */
+struct SequenceCapabilities
+{
+   typedef std::pair<std::string, std::string> Key;
+
+   long zMaxLength;
+   long xyMaxLength;
+   long exposureMaxLength;
+   // Longest camera sequence (e.g. limited by the circular buffer); 0 if the
+   // camera cannot be used for bursts at all
+   long cameraMaxLength;
+   // Sequenceable properties, keyed by device label and property name
+   std::map<Key, long> propertyMaxLengths;
+   // Settings of the presets used by the plan, keyed by group and preset
+   std::map<Key, Configuration> presets;
+
+   SequenceCapabilities() :
+      zMaxLength(0), xyMaxLength(0), exposureMaxLength(0), cameraMaxLength(0)
+   {}
+};
+
+
+struct PropertySequence
+{
+   std::string device;
+   std::string property;
+   std::vector<std::string> values;
+};
+
+
+/**
+ * A run of consecutive events. Bursts of more than one event are run as a
+ * single camera sequence, with the settings that vary between the events
+ * loaded into the devices as hardware sequences beforehand. The settings of
+ * the first event are applied in software.
+ */
+struct SequenceBurst
+{
+   std::size_t firstEvent;
+   std::size_t nrEvents;
+   bool sequenceZ;
+   bool sequenceXY;
+   bool sequenceExposure;
+   // Only the properties whose values vary within the burst
+   std::vector<PropertySequence> properties;
+
+   SequenceBurst(std::size_t first) :
+      firstEvent(first), nrEvents(1),
+      sequenceZ(false), sequenceXY(false), sequenceExposure(false)
+   {}
+
+   bool IsHardwareSequenced() const { return nrEvents > 1; }
+};
+
+
+/**
+ * Query the current focus stage, XY stage, camera and the properties in the
+ * presets used by events. Devices that fail to answer are treated as not
+ * sequenceable. cameraMaxLength is left at 0 for the caller to fill in.
+ */
+SequenceCapabilities QuerySequenceCapabilities(CMMCore& core,
+      const std::vector<AcquisitionEvent>& events);
+
+/**
+ * Partition events into maximal bursts, in order.
+ *
+ * Consecutive events are merged into a burst as long as every setting that
+ * varies within the burst can be sequenced for the length of the burst, the
+ * events set the same kinds of settings (and the same config group), and no
+ * event has a later minimum start time than the first one.
+ */
+std::vector<SequenceBurst> PlanSequenceBursts(
+      const std::vector<AcquisitionEvent>& events,
+      const SequenceCapabilities& capabilities);
+
+} // namespace mm
@@ -0,0 +1,156 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          StateCache.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Versioned cache of device property values
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "StateCache.h"
+
+#include "CoreUtils.h"
+#include "ErrorCodes.h"
+
+#include <boost/make_shared.hpp>
+#include <boost/unordered_set.hpp>
+
+namespace mm
+{
+
+StateCache::StateCache() :
+   version_(0),
+   resetVersion_(0),
+   snapshotVersion_(-1)
+{
+}
+
+
+void
+StateCache::Set(const PropertySetting& setting)
+{
+   const std::string key = setting.getKey();
+   boost::unordered_map<std::string, size_t>::const_iterator found =
+      index_.find(key);
+   if (found == index_.end())
+   {
+      index_.insert(std::make_pair(key, entries_.size()));
+      entries_.push_back(Entry(setting, ++version_));
+      return;
+   }
+
+   Entry& entry = entries_[found->second];
+   if (entry.setting.getPropertyValue() == setting.getPropertyValue() &&
+         entry.setting.getReadOnly() == setting.getReadOnly())
+      return;
+   entry.setting = setting;
+   entry.version = ++version_;
+}
+
+
+void
+StateCache::Update(const Configuration& state)
+{
+   boost::unordered_set<std::string> keys;
+   for (size_t i = 0; i < state.size(); ++i)
+   {
+      const PropertySetting setting = state.getSetting(i);
+      keys.insert(setting.getKey());
+      Set(setting);
+   }
+
+   bool removed = false;
+   for (size_t i = entries_.size(); i > 0; --i)
+   {
+      if (keys.find(entries_[i - 1].setting.getKey()) == keys.end())
+      {
+         Remove(i - 1);
+         removed = true;
+      }
+   }
+   if (removed)
+      resetVersion_ = ++version_;
+}
+
+
+void
+StateCache::Remove(size_t index)
+{
+   index_.erase(entries_[index].setting.getKey());
+   if (index + 1 < entries_.size())
+   {
+      entries_[index] = entries_.back();
+      index_[entries_[index].setting.getKey()] = index;
+   }
+   entries_.pop_back();
+}
+
+
+bool
+StateCache::Has(const char* device, const char* prop) const
+{
+   return index_.find(PropertySetting::generateKey(device, prop)) !=
+      index_.end();
+}
+
+
+PropertySetting
+StateCache::Get(const char* device, const char* prop) const throw (CMMError)
+{
+   boost::unordered_map<std::string, size_t>::const_iterator found =
+      index_.find(PropertySetting::generateKey(device, prop));
+   if (found == index_.end())
+      throw CMMError("Property " + ToQuotedString(prop) + " of device " +
+            ToQuotedString(device) + " not found in cache",
+            MMERR_PropertyNotInCache);
+   return entries_[found->second].setting;
+}
+
+
+boost::shared_ptr<const Configuration>
+StateCache::GetSnapshot() const
+{
+   if (!snapshot_ || snapshotVersion_ != version_)
+   {
+      boost::shared_ptr<Configuration> config =
+         boost::make_shared<Configuration>();
+      for (std::vector<Entry>::const_iterator it = entries_.begin(),
+            end = entries_.end(); it != end; ++it)
+      {
+         config->addSetting(it->setting);
+      }
+      snapshot_ = config;
+      snapshotVersion_ = version_;
+   }
+   return snapshot_;
+}
+
+
+Configuration
+StateCache::GetChangesSince(long long version) const
+{
+   if (version < resetVersion_)
+      return GetAll();
+
+   Configuration config;
+   for (std::vector<Entry>::const_iterator it = entries_.begin(),
+         end = entries_.end(); it != end; ++it)
+   {
+      if (it->version > version)
+         config.addSetting(it->setting);
+   }
+   return config;
+}
+
+} // namespace mm
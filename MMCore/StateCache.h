@@ -0,0 +1,122 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          StateCache.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Versioned cache of device property values
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "Configuration.h"
+#include "Error.h"
+
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <string>
+#include <vector>
+
+
+namespace mm
+{
+
+/**
+ * \brief The system state cache.
+ *
+ * Holds the last-set or last-read value of each device property. Every
+ * entry records the cache version at which it was last changed, so that
+ * clients can retrieve only the settings that changed since they last
+ * looked. Setting an entry to its current value does not change the
+ * version.
+ *
+ * Not thread safe; the caller must synchronize access.
+ */
+class StateCache /* final */
+{
+   struct Entry
+   {
+      Entry(const PropertySetting& s, long long v) : setting(s), version(v) {}
+      PropertySetting setting;
+      long long version;
+   };
+
+   std::vector<Entry> entries_;
+   boost::unordered_map<std::string, size_t> index_; // Key -> entries_ index
+   long long version_;
+   long long resetVersion_;
+
+   mutable boost::shared_ptr<const Configuration> snapshot_;
+   mutable long long snapshotVersion_;
+
+public:
+   StateCache();
+
+   /**
+    * \brief Add or update a single setting.
+    */
+   void Set(const PropertySetting& setting);
+
+   /**
+    * \brief Update the cache to match a complete system state.
+    *
+    * Only settings whose values differ are updated. Settings absent from
+    * state are removed, which sets the reset version.
+    */
+   void Update(const Configuration& state);
+
+   bool Has(const char* device, const char* prop) const;
+   PropertySetting Get(const char* device, const char* prop) const throw (CMMError);
+
+   /**
+    * \brief Return all settings.
+    */
+   Configuration GetAll() const { return *GetSnapshot(); }
+
+   /**
+    * \brief Return an immutable snapshot of all settings.
+    *
+    * The snapshot is shared between callers until the cache is next
+    * modified, so that obtaining it is cheap when nothing has changed. It
+    * remains valid (and unchanged) after the cache is modified, and can be
+    * read without holding the lock that guards the cache.
+    */
+   boost::shared_ptr<const Configuration> GetSnapshot() const;
+
+   /**
+    * \brief Return the settings added or changed after the given version.
+    *
+    * If any settings were removed after version, all settings are returned.
+    */
+   Configuration GetChangesSince(long long version) const;
+
+   /**
+    * \brief Return the current version.
+    *
+    * The version is incremented whenever a setting is added, changed, or
+    * removed. The initial (empty) cache has version 0.
+    */
+   long long GetVersion() const { return version_; }
+
+   /**
+    * \brief Return the version at which settings were last removed.
+    */
+   long long GetResetVersion() const { return resetVersion_; }
+
+private:
+   void Remove(size_t index);
+};
+
+} // namespace mm
@@ -0,0 +1,205 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          mmlogquery.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Command-line tool to query (and follow) CoreLog files
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "../Logging/LogFileIndex.h"
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+
+namespace
+{
+
+void PrintUsage(std::ostream& out)
+{
+   out <<
+      "Usage: mmlogquery [options] LOGFILE\n"
+      "\n"
+      "Print the entries of a Micro-Manager CoreLog file that match all of\n"
+      "the given criteria (-c and -d may be repeated to match any of several\n"
+      "components). An index is kept in LOGFILE.idx so that repeated\n"
+      "queries do not need to read the whole file.\n"
+      "\n"
+      "Options:\n"
+      "  -l, --level LVL[,LVL...]  Include only these levels (trc, dbg, IFO,\n"
+      "                            WRN, ERR, FTL); LVL+ includes LVL and\n"
+      "                            higher levels\n"
+      "  -c, --component LABEL     Include only entries from this component\n"
+      "                            (e.g. Core, App, dev:<device label>)\n"
+      "  -d, --device LABEL        Include only entries from or about this\n"
+      "                            device\n"
+      "  -s, --since TIME          Include only entries at or after TIME\n"
+      "  -u, --until TIME          Include only entries at or before TIME\n"
+      "                            (TIME is YYYY-MM-DDTHH:MM:SS[.ffffff])\n"
+      "  -g, --grep TEXT           Include only entries containing TEXT\n"
+      "  -f, --follow              Keep printing entries as they are logged\n"
+      "  -n, --count               Print only the number of matching entries\n"
+      "      --no-index            Do not read or write LOGFILE.idx\n"
+      "  -h, --help                Show this help\n";
+}
+
+
+bool ParseLevels(const std::string& arg, mm::logging::LogQuery& query)
+{
+   query.levelMask = 0;
+   std::string::size_type start = 0;
+   while (start <= arg.size())
+   {
+      std::string::size_type comma = arg.find(',', start);
+      if (comma == std::string::npos)
+         comma = arg.size();
+      std::string item = arg.substr(start, comma - start);
+      bool andHigher = false;
+      if (!item.empty() && item[item.size() - 1] == '+')
+      {
+         andHigher = true;
+         item.erase(item.size() - 1);
+      }
+
+      mm::logging::LogLevel level;
+      if (!mm::logging::ParseLogLevel(item, level))
+         return false;
+      query.levelMask |= andHigher ? (~0u << level) : (1u << level);
+      start = comma + 1;
+   }
+   return true;
+}
+
+
+bool ParseTime(const std::string& arg, boost::int64_t& timestamp)
+{
+   const char* begin = arg.c_str();
+   const char* end = begin + arg.size();
+   return mm::logging::ParseLogTimestamp(begin, end, timestamp) == arg.size();
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char** argv)
+{
+   mm::logging::LogQuery query;
+   bool follow = false;
+   bool countOnly = false;
+   bool useIndex = true;
+   std::string filename;
+
+   for (int i = 1; i < argc; ++i)
+   {
+      const std::string arg(argv[i]);
+      const bool hasValue = (i + 1 < argc);
+      if (arg == "-h" || arg == "--help")
+      {
+         PrintUsage(std::cout);
+         return 0;
+      }
+      else if (arg == "-f" || arg == "--follow")
+         follow = true;
+      else if (arg == "-n" || arg == "--count")
+         countOnly = true;
+      else if (arg == "--no-index")
+         useIndex = false;
+      else if ((arg == "-l" || arg == "--level") && hasValue)
+      {
+         if (!ParseLevels(argv[++i], query))
+         {
+            std::cerr << "mmlogquery: invalid level: " << argv[i] << '\n';
+            return 2;
+         }
+      }
+      else if ((arg == "-c" || arg == "--component") && hasValue)
+         query.components.push_back(argv[++i]);
+      else if ((arg == "-d" || arg == "--device") && hasValue)
+         query.AddDevice(argv[++i]);
+      else if ((arg == "-s" || arg == "--since") && hasValue)
+      {
+         boost::int64_t t;
+         if (!ParseTime(argv[++i], t))
+         {
+            std::cerr << "mmlogquery: invalid time: " << argv[i] << '\n';
+            return 2;
+         }
+         query.since = t;
+      }
+      else if ((arg == "-u" || arg == "--until") && hasValue)
+      {
+         boost::int64_t t;
+         if (!ParseTime(argv[++i], t))
+         {
+            std::cerr << "mmlogquery: invalid time: " << argv[i] << '\n';
+            return 2;
+         }
+         query.until = t;
+      }
+      else if ((arg == "-g" || arg == "--grep") && hasValue)
+         query.text = argv[++i];
+      else if (!arg.empty() && arg[0] != '-' && filename.empty())
+         filename = arg;
+      else
+      {
+         PrintUsage(std::cerr);
+         return 2;
+      }
+   }
+
+   if (filename.empty() || (follow && countOnly))
+   {
+      PrintUsage(std::cerr);
+      return 2;
+   }
+
+   try
+   {
+      boost::uint64_t endOffset;
+      {
+         mm::logging::IndexedLogFile logFile(filename, useIndex);
+         if (countOnly)
+         {
+            std::ostream discard(0);
+            std::cout << logFile.Query(query, discard) << '\n';
+            return 0;
+         }
+         logFile.Query(query, std::cout);
+         endOffset = logFile.GetIndex().GetIndexedLength();
+      }
+      std::cout.flush();
+
+      if (follow)
+      {
+         mm::logging::LogFollower follower(filename, query, endOffset);
+         for (;;)
+         {
+            follower.Poll(std::cout);
+            boost::this_thread::sleep(boost::posix_time::milliseconds(250));
+         }
+      }
+   }
+   catch (const std::exception& e)
+   {
+      std::cerr << "mmlogquery: " << e.what() << '\n';
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,278 @@
+#include <gtest/gtest.h>
+
+#include "AcquisitionPlan.h"
+#include "MMCore.h"
+#include "MockDeviceFixture.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include <string>
+#include <vector>
+
+
+class AcquisitionEngineTests : public MockDeviceTest
+{
+protected:
+   virtual void SetUp()
+   {
+      LoadMockDevice("Camera", "MockCamera");
+      LoadMockDevice("Z", "MockStage");
+      LoadMockDevice("XY", "MockXYStage");
+      LoadMockDevice("Filter", "MockGeneric");
+      core_.initializeAllDevices();
+      core_.setCameraDevice("Camera");
+      core_.setFocusDevice("Z");
+      core_.setXYStageDevice("XY");
+
+      core_.defineConfig("Channel", "DAPI", "Filter", "Value", "1");
+      core_.defineConfig("Channel", "GFP", "Filter", "Value", "2");
+   }
+
+   // Frames x positions x channels x slices, in that nesting order
+   AcquisitionPlan MakePlan(int nrFrames, int nrPositions, int nrSlices)
+   {
+      const char* channels[] = { "DAPI", "GFP" };
+      AcquisitionPlan plan;
+      for (int t = 0; t < nrFrames; ++t)
+         for (int p = 0; p < nrPositions; ++p)
+            for (int c = 0; c < 2; ++c)
+               for (int z = 0; z < nrSlices; ++z)
+               {
+                  AcquisitionEvent event(t, p, c, z);
+                  event.setXYPosition(100.0 * p, 50.0 * p);
+                  event.setZPosition(1.5 * z);
+                  event.setConfig("Channel", channels[c]);
+                  event.setExposure(c == 0 ? 5.0 : 7.0);
+                  plan.addEvent(event);
+               }
+      return plan;
+   }
+
+   std::string Tag(Metadata& md, const std::string& key)
+   {
+      return md.GetSingleTag(key.c_str()).GetValue();
+   }
+};
+
+
+TEST_F(AcquisitionEngineTests, RunsAllEventsInOrder)
+{
+   AcquisitionPlan plan = MakePlan(2, 2, 3);
+   ASSERT_EQ(24, plan.getNumberOfEvents());
+
+   core_.startAcquisitionPlan(plan);
+   core_.waitForAcquisitionPlan();
+   EXPECT_FALSE(core_.isAcquisitionPlanRunning());
+   EXPECT_EQ(24, core_.getAcquisitionPlanEventsDone());
+   ASSERT_EQ(24, core_.getRemainingImageCount());
+
+   for (long i = 0; i < plan.getNumberOfEvents(); ++i)
+   {
+      const AcquisitionEvent event = plan.getEvent(i);
+      Metadata md;
+      const unsigned short* pixels =
+         static_cast<const unsigned short*>(core_.popNextImageMD(md));
+      EXPECT_EQ(i + 1, pixels[0]);
+      EXPECT_EQ(boost::lexical_cast<std::string>(i),
+            Tag(md, "AcquisitionEventIndex"));
+      EXPECT_EQ(boost::lexical_cast<std::string>(event.getFrameIndex()),
+            Tag(md, "FrameIndex"));
+      EXPECT_EQ(boost::lexical_cast<std::string>(event.getPositionIndex()),
+            Tag(md, "PositionIndex"));
+      EXPECT_EQ(boost::lexical_cast<std::string>(event.getChannelIndex()),
+            Tag(md, "ChannelIndex"));
+      EXPECT_EQ(boost::lexical_cast<std::string>(event.getSliceIndex()),
+            Tag(md, "SliceIndex"));
+      EXPECT_EQ(event.getConfigPreset(), Tag(md, "Channel"));
+      EXPECT_EQ("Camera", Tag(md, "Camera"));
+   }
+
+   // The last event's settings remain applied
+   EXPECT_EQ("GFP", core_.getCurrentConfig("Channel"));
+   EXPECT_DOUBLE_EQ(7.0, core_.getExposure());
+   EXPECT_DOUBLE_EQ(3.0, core_.getPosition());
+   EXPECT_DOUBLE_EQ(100.0, core_.getXPosition());
+   EXPECT_DOUBLE_EQ(50.0, core_.getYPosition());
+}
+
+
+TEST_F(AcquisitionEngineTests, WithoutOverlapGivesSameResult)
+{
+   AcquisitionPlan plan = MakePlan(1, 3, 2);
+   plan.setOverlapMovesWithReadout(false);
+   core_.startAcquisitionPlan(plan);
+   core_.waitForAcquisitionPlan();
+   ASSERT_EQ(12, core_.getRemainingImageCount());
+   EXPECT_DOUBLE_EQ(200.0, core_.getXPosition());
+}
+
+
+TEST_F(AcquisitionEngineTests, RunsZStacksAsHardwareSequences)
+{
+   AcquisitionPlan plan = MakePlan(2, 2, 3);
+   core_.startAcquisitionPlan(plan);
+   core_.waitForAcquisitionPlan();
+   // One sequence per frame, position and channel
+   EXPECT_EQ("8", core_.getProperty("Z", "SequenceStarts"));
+   EXPECT_EQ(24, core_.getRemainingImageCount());
+
+   plan.setUseHardwareSequencing(false);
+   core_.startAcquisitionPlan(plan);
+   core_.waitForAcquisitionPlan();
+   EXPECT_EQ("8", core_.getProperty("Z", "SequenceStarts"));
+   EXPECT_EQ(24, core_.getRemainingImageCount());
+}
+
+
+TEST_F(AcquisitionEngineTests, InterleavesSequenceableChannels)
+{
+   core_.defineConfig("Laser", "Blue", "Filter", "Number", "1");
+   core_.defineConfig("Laser", "Green", "Filter", "Number", "2");
+   const char* channels[] = { "Blue", "Green" };
+   AcquisitionPlan plan;
+   for (int z = 0; z < 4; ++z)
+      for (int c = 0; c < 2; ++c)
+      {
+         AcquisitionEvent event(0, 0, c, z);
+         event.setZPosition(z);
+         event.setConfig("Laser", channels[c]);
+         plan.addEvent(event);
+      }
+
+   core_.startAcquisitionPlan(plan);
+   core_.waitForAcquisitionPlan();
+   EXPECT_EQ("1", core_.getProperty("Filter", "NumberSequenceStarts"));
+   EXPECT_EQ("1", core_.getProperty("Z", "SequenceStarts"));
+   EXPECT_EQ(8, core_.getAcquisitionPlanEventsDone());
+   ASSERT_EQ(8, core_.getRemainingImageCount());
+   for (long i = 0; i < 8; ++i)
+   {
+      Metadata md;
+      core_.popNextImageMD(md);
+      EXPECT_EQ(boost::lexical_cast<std::string>(i % 2),
+            Tag(md, "ChannelIndex"));
+      EXPECT_EQ(boost::lexical_cast<std::string>(i / 2),
+            Tag(md, "SliceIndex"));
+      EXPECT_EQ(channels[i % 2], Tag(md, "Laser"));
+   }
+}
+
+
+TEST_F(AcquisitionEngineTests, TagsBurstsFromMultiChannelCamera)
+{
+   core_.setProperty("Camera", "Channels", "2");
+   AcquisitionPlan plan;
+   for (int z = 0; z < 4; ++z)
+   {
+      AcquisitionEvent event(0, 0, 0, z);
+      event.setZPosition(z);
+      plan.addEvent(event);
+   }
+
+   core_.startAcquisitionPlan(plan);
+   ASSERT_NO_THROW(core_.waitForAcquisitionPlan());
+   EXPECT_EQ("1", core_.getProperty("Z", "SequenceStarts"));
+   EXPECT_EQ(4, core_.getAcquisitionPlanEventsDone());
+   ASSERT_EQ(4, core_.getRemainingImageCount());
+   for (long i = 0; i < 4; ++i)
+   {
+      // Both channels of each event are inserted as one frame
+      for (unsigned ch = 0; ch < 2; ++ch)
+      {
+         Metadata md;
+         const unsigned short* pixels = static_cast<const unsigned short*>(
+               core_.peekNextImageMD(ch, 0, md));
+         EXPECT_EQ(i + 1 + 1000 * ch, pixels[0]);
+         EXPECT_EQ(boost::lexical_cast<std::string>(i),
+               Tag(md, "SliceIndex"));
+         EXPECT_EQ(boost::lexical_cast<std::string>(ch),
+               Tag(md, "CameraChannelIndex"));
+      }
+      core_.popNextImage();
+   }
+}
+
+
+TEST_F(AcquisitionEngineTests, TagsBurstChannelsInsertedOutOfOrder)
+{
+   core_.setProperty("Camera", "Channels", "2");
+   core_.setProperty("Camera", "InsertChannelsSeparately", "Yes");
+   AcquisitionPlan plan;
+   for (int z = 0; z < 4; ++z)
+   {
+      AcquisitionEvent event(0, 0, 0, z);
+      event.setZPosition(z);
+      plan.addEvent(event);
+   }
+
+   core_.startAcquisitionPlan(plan);
+   ASSERT_NO_THROW(core_.waitForAcquisitionPlan());
+   EXPECT_EQ(4, core_.getAcquisitionPlanEventsDone());
+   ASSERT_EQ(8, core_.getRemainingImageCount());
+   for (long i = 0; i < 8; ++i)
+   {
+      // The camera inserts channel 1 before channel 0
+      const long ch = 1 - i % 2;
+      Metadata md;
+      const unsigned short* pixels =
+         static_cast<const unsigned short*>(core_.popNextImageMD(md));
+      EXPECT_EQ(i / 2 + 1 + 1000 * ch, pixels[0]);
+      EXPECT_EQ(boost::lexical_cast<std::string>(i / 2),
+            Tag(md, "SliceIndex"));
+      EXPECT_EQ(boost::lexical_cast<std::string>(ch),
+            Tag(md, "CameraChannelIndex"));
+   }
+}
+
+
+TEST_F(AcquisitionEngineTests, StopsOnRequest)
+{
+   AcquisitionPlan plan;
+   for (int t = 0; t < 100; ++t)
+   {
+      AcquisitionEvent event(t, 0, 0, 0);
+      event.setMinimumStartTime(50.0 * t);
+      plan.addEvent(event);
+   }
+   core_.startAcquisitionPlan(plan);
+   EXPECT_TRUE(core_.isAcquisitionPlanRunning());
+   EXPECT_THROW(core_.startAcquisitionPlan(plan), CMMError);
+
+   core_.stopAcquisitionPlan();
+   EXPECT_FALSE(core_.isAcquisitionPlanRunning());
+   EXPECT_LT(core_.getAcquisitionPlanEventsDone(), 100);
+   EXPECT_EQ(core_.getAcquisitionPlanEventsDone(),
+         core_.getRemainingImageCount());
+   EXPECT_NO_THROW(core_.waitForAcquisitionPlan());
+}
+
+
+TEST_F(AcquisitionEngineTests, ReportsErrors)
+{
+   AcquisitionPlan plan;
+   AcquisitionEvent good(0, 0, 0, 0);
+   good.setConfig("Channel", "DAPI");
+   plan.addEvent(good);
+   AcquisitionEvent bad(1, 0, 0, 0);
+   bad.setConfig("Channel", "NoSuchPreset");
+   plan.addEvent(bad);
+
+   core_.startAcquisitionPlan(plan);
+   EXPECT_THROW(core_.waitForAcquisitionPlan(), CMMError);
+   EXPECT_EQ(1, core_.getAcquisitionPlanEventsDone());
+   EXPECT_EQ(1, core_.getRemainingImageCount());
+
+   // A new plan can be started after the error
+   plan.clear();
+   plan.addEvent(good);
+   core_.startAcquisitionPlan(plan);
+   EXPECT_NO_THROW(core_.waitForAcquisitionPlan());
+   EXPECT_EQ(1, core_.getRemainingImageCount());
+}
+
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
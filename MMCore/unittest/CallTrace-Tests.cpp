@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+
+#include "CallTrace.h"
+#include "MockDeviceFixture.h"
+
+#include <boost/thread.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+using mm::CallTrace;
+using mm::CallSpan;
+
+
+static size_t CountOccurrences(const std::string& s, const std::string& sub)
+{
+   size_t count = 0;
+   for (size_t pos = s.find(sub); pos != std::string::npos;
+         pos = s.find(sub, pos + 1))
+      ++count;
+   return count;
+}
+
+
+static void RecordSpans(const char* device, unsigned n)
+{
+   for (unsigned i = 0; i < n; ++i)
+      CallSpan span(device, "Busy");
+}
+
+
+TEST(CallTraceTests, NothingRecordedWhenNotRunning)
+{
+   EXPECT_FALSE(CallTrace::IsRunning());
+   RecordSpans("Dev", 10);
+
+   std::ostringstream json;
+   CallTrace::Stop(json);
+   EXPECT_TRUE(json.str().empty());
+}
+
+
+TEST(CallTraceTests, RecordsSpansFromAllThreads)
+{
+   const char* devA = CallTrace::InternLabel("DevA");
+   const char* devB = CallTrace::InternLabel("DevB");
+   EXPECT_EQ(devA, CallTrace::InternLabel(std::string("DevA")));
+
+   CallTrace::Start();
+   EXPECT_TRUE(CallTrace::IsRunning());
+   boost::thread t(RecordSpans, devB, 5);
+   RecordSpans(devA, 3);
+   {
+      CallSpan wait(devA, "Wait for module lock", CallTrace::CategoryLockWait);
+   }
+   t.join();
+
+   std::ostringstream json;
+   CallTrace::Stop(json);
+   EXPECT_FALSE(CallTrace::IsRunning());
+
+   const std::string s = json.str();
+   EXPECT_EQ(0u, s.find("{\"traceEvents\":["));
+   EXPECT_EQ(9u, CountOccurrences(s, "\"ph\":\"X\""));
+   // 3 calls and the lock wait
+   EXPECT_EQ(4u, CountOccurrences(s, "{\"device\":\"DevA\"}}"));
+   EXPECT_EQ(5u, CountOccurrences(s, "{\"device\":\"DevB\"}}"));
+   EXPECT_EQ(1u, CountOccurrences(s, "\"cat\":\"lock\""));
+   EXPECT_NE(std::string::npos, s.find("\"droppedEvents\":0"));
+}
+
+
+TEST(CallTraceTests, KeepsMostRecentSpansPerThread)
+{
+   CallTrace::Start(4);
+   RecordSpans("Dev", 10);
+   std::ostringstream json;
+   CallTrace::Stop(json);
+
+   const std::string s = json.str();
+   EXPECT_EQ(4u, CountOccurrences(s, "\"ph\":\"X\""));
+   EXPECT_NE(std::string::npos, s.find("\"droppedEvents\":6"));
+}
+
+
+TEST(CallTraceTests, RestartDiscardsPreviousSpans)
+{
+   CallTrace::Start();
+   RecordSpans("Dev", 10);
+   CallTrace::Start();
+   RecordSpans("Dev", 2);
+   std::ostringstream json;
+   CallTrace::Stop(json);
+
+   EXPECT_EQ(2u, CountOccurrences(json.str(), "\"ph\":\"X\""));
+}
+
+
+class CoreTraceTests : public MockDeviceTest
+{
+protected:
+   virtual void SetUp()
+   {
+      LoadMockDevice("Generic0", "MockGeneric");
+      LoadMockDevice("Shutter0", "MockShutter");
+      core_.initializeAllDevices();
+   }
+};
+
+
+TEST_F(CoreTraceTests, RecordsDeviceCalls)
+{
+   const std::string filename = "CoreTraceTests-trace.json";
+   EXPECT_FALSE(core_.isTraceRunning());
+   core_.startTrace();
+   EXPECT_TRUE(core_.isTraceRunning());
+   core_.setProperty("Generic0", "Value", "42");
+   core_.setShutterOpen("Shutter0", true);
+   core_.stopTrace(filename.c_str());
+   EXPECT_FALSE(core_.isTraceRunning());
+
+   std::ifstream file(filename.c_str());
+   std::string json((std::istreambuf_iterator<char>(file)),
+         std::istreambuf_iterator<char>());
+   file.close();
+   std::remove(filename.c_str());
+
+   EXPECT_NE(std::string::npos, json.find(
+            "{\"name\":\"SetProperty\",\"cat\":\"device\""));
+   EXPECT_NE(std::string::npos, json.find("{\"device\":\"Generic0\"}"));
+   EXPECT_NE(std::string::npos, json.find(
+            "{\"name\":\"SetOpen\",\"cat\":\"device\""));
+   EXPECT_NE(std::string::npos, json.find(
+            "{\"name\":\"Wait for module lock\",\"cat\":\"lock\""));
+}
+
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
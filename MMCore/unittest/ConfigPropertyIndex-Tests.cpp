@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include "ConfigGroup.h"
+#include "ConfigPropertyIndex.h"
+
+#include <string>
+#include <vector>
+
+using mm::ConfigPropertyIndex;
+
+
+TEST(ConfigPropertyIndexTests, EmptyCollections)
+{
+   ConfigGroupCollection groups;
+   PixelSizeConfigGroup pixelSizes;
+   ConfigPropertyIndex index;
+   index.Update(groups, pixelSizes);
+   EXPECT_TRUE(index.GetAffectedGroups("Dev", "Prop").empty());
+   EXPECT_FALSE(index.IsPixelSizeAffected("Dev", "Prop"));
+}
+
+
+TEST(ConfigPropertyIndexTests, SingleSettingPresetsAreNotIndexed)
+{
+   ConfigGroupCollection groups;
+   PixelSizeConfigGroup pixelSizes;
+   groups.Define("Single", "A", "Dev", "Prop", "1");
+   groups.Define("Single", "B", "Dev", "Prop", "2");
+
+   ConfigPropertyIndex index;
+   index.Update(groups, pixelSizes);
+   EXPECT_TRUE(index.GetAffectedGroups("Dev", "Prop").empty());
+}
+
+
+TEST(ConfigPropertyIndexTests, TracksChangesToCollections)
+{
+   ConfigGroupCollection groups;
+   PixelSizeConfigGroup pixelSizes;
+   groups.Define("Channel", "DAPI", "Wheel", "State", "0");
+   groups.Define("Channel", "DAPI", "Shutter", "State", "1");
+   groups.Define("Other", "X", "Wheel", "State", "1");
+   groups.Define("Other", "X", "Stage", "Position", "10");
+
+   ConfigPropertyIndex index;
+   index.Update(groups, pixelSizes);
+   std::vector<std::string> affected = index.GetAffectedGroups("Wheel", "State");
+   ASSERT_EQ(2u, affected.size());
+   EXPECT_EQ("Channel", affected[0]);
+   EXPECT_EQ("Other", affected[1]);
+   EXPECT_EQ(1u, index.GetAffectedGroups("Shutter", "State").size());
+   EXPECT_FALSE(index.IsPixelSizeAffected("Wheel", "State"));
+
+   groups.Delete("Other");
+   index.Update(groups, pixelSizes);
+   affected = index.GetAffectedGroups("Wheel", "State");
+   ASSERT_EQ(1u, affected.size());
+   EXPECT_EQ("Channel", affected[0]);
+   EXPECT_TRUE(index.GetAffectedGroups("Stage", "Position").empty());
+
+   groups.RenameGroup("Channel", "Filter");
+   index.Update(groups, pixelSizes);
+   affected = index.GetAffectedGroups("Wheel", "State");
+   ASSERT_EQ(1u, affected.size());
+   EXPECT_EQ("Filter", affected[0]);
+
+   pixelSizes.DefinePixelSize("Res10x", "Objective", "State", "1", 0.65);
+   index.Update(groups, pixelSizes);
+   EXPECT_TRUE(index.IsPixelSizeAffected("Objective", "State"));
+   pixelSizes.Delete("Res10x");
+   index.Update(groups, pixelSizes);
+   EXPECT_FALSE(index.IsPixelSizeAffected("Objective", "State"));
+}
+
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include "Configuration.h"
+
+
+TEST(ConfigurationTests, CopiesAreIndependent)
+{
+   Configuration a;
+   a.addSetting(PropertySetting("Dev", "A", "1"));
+   a.addSetting(PropertySetting("Dev", "B", "2"));
+
+   Configuration b = a;
+   EXPECT_TRUE(b.isConfigurationIncluded(a));
+   EXPECT_TRUE(a.isConfigurationIncluded(b));
+
+   b.addSetting(PropertySetting("Dev", "A", "3"));
+   b.addSetting(PropertySetting("Dev", "C", "4"));
+   EXPECT_EQ("1", a.getSetting("Dev", "A").getPropertyValue());
+   EXPECT_EQ("3", b.getSetting("Dev", "A").getPropertyValue());
+   EXPECT_EQ(2u, a.size());
+   EXPECT_EQ(3u, b.size());
+   EXPECT_FALSE(a.isPropertyIncluded("Dev", "C"));
+   EXPECT_FALSE(b.isConfigurationIncluded(a));
+   EXPECT_FALSE(a.isConfigurationIncluded(b));
+
+   Configuration c = b;
+   c.deleteSetting("Dev", "A");
+   EXPECT_EQ(3u, b.size());
+   EXPECT_TRUE(b.isPropertyIncluded("Dev", "A"));
+   ASSERT_EQ(2u, c.size());
+   EXPECT_FALSE(c.isPropertyIncluded("Dev", "A"));
+   EXPECT_TRUE(b.isConfigurationIncluded(c));
+}
+
+
+TEST(ConfigurationTests, DeleteKeepsOrderAndIndex)
+{
+   Configuration a;
+   a.addSetting(PropertySetting("Dev", "A", "1"));
+   a.addSetting(PropertySetting("Dev", "B", "2"));
+   a.addSetting(PropertySetting("Dev", "C", "3"));
+   a.deleteSetting("Dev", "A");
+
+   ASSERT_EQ(2u, a.size());
+   EXPECT_EQ("B", a.getSetting(0).getPropertyName());
+   EXPECT_EQ("C", a.getSetting(1).getPropertyName());
+   EXPECT_EQ("3", a.getSetting("Dev", "C").getPropertyValue());
+   EXPECT_THROW(a.deleteSetting("Dev", "A"), CMMError);
+   EXPECT_THROW(a.getSetting(2), CMMError);
+
+   a.addSetting(PropertySetting("Dev", "C", "4"));
+   EXPECT_EQ(2u, a.size());
+   EXPECT_EQ("4", a.getSetting(1).getPropertyValue());
+}
+
+
+TEST(ConfigurationTests, EmptyConfiguration)
+{
+   Configuration empty;
+   Configuration a;
+   a.addSetting(PropertySetting("Dev", "A", "1"));
+
+   EXPECT_EQ(0u, empty.size());
+   EXPECT_FALSE(empty.isPropertyIncluded("Dev", "A"));
+   EXPECT_THROW(empty.getSetting("Dev", "A"), CMMError);
+   EXPECT_TRUE(a.isConfigurationIncluded(empty));
+   EXPECT_FALSE(empty.isConfigurationIncluded(a));
+}
+
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
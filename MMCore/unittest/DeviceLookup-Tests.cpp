@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include "MMCore.h"
+#include "MockDeviceFixture.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <string>
+#include <vector>
+
+
+class DeviceLookupTests : public MockDeviceTest
+{
+protected:
+   void LoadMockDevices(unsigned nrGeneric, unsigned nrShutters)
+   {
+      for (unsigned i = 0; i < nrGeneric; ++i)
+      {
+         std::string label = "Generic" + boost::lexical_cast<std::string>(i);
+         LoadMockDevice(label.c_str(), "MockGeneric");
+      }
+      for (unsigned i = 0; i < nrShutters; ++i)
+      {
+         std::string label = "Shutter" + boost::lexical_cast<std::string>(i);
+         LoadMockDevice(label.c_str(), "MockShutter");
+      }
+      core_.initializeAllDevices();
+   }
+};
+
+
+TEST_F(DeviceLookupTests, DeviceListsFollowLoadAndUnload)
+{
+   LoadMockDevices(3, 2);
+
+   std::vector<std::string> generic = core_.getLoadedDevicesOfType(MM::GenericDevice);
+   ASSERT_EQ(3u, generic.size());
+   EXPECT_EQ("Generic0", generic[0]);
+   EXPECT_EQ("Generic2", generic[2]);
+   ASSERT_EQ(2u, core_.getLoadedDevicesOfType(MM::ShutterDevice).size());
+   EXPECT_EQ(0u, core_.getLoadedDevicesOfType(MM::CameraDevice).size());
+
+   core_.unloadDevice("Generic1");
+   generic = core_.getLoadedDevicesOfType(MM::GenericDevice);
+   ASSERT_EQ(2u, generic.size());
+   EXPECT_EQ("Generic0", generic[0]);
+   EXPECT_EQ("Generic2", generic[1]);
+   EXPECT_THROW(core_.getProperty("Generic1", "Value"), CMMError);
+
+   // The label can be reused once the device is unloaded
+   core_.loadDevice("Generic1", "MockDeviceAdapter", "MockGeneric");
+   EXPECT_EQ("Generic1", core_.getLoadedDevicesOfType(MM::GenericDevice).back());
+   EXPECT_THROW(core_.loadDevice("Generic1", "MockDeviceAdapter", "MockGeneric"),
+         CMMError);
+
+   core_.unloadAllDevices();
+   EXPECT_EQ(0u, core_.getLoadedDevicesOfType(MM::GenericDevice).size());
+   EXPECT_THROW(core_.getProperty("Generic0", "Value"), CMMError);
+}
+
+
+TEST_F(DeviceLookupTests, PropertyAccessThroughputWith50Devices)
+{
+   LoadMockDevices(45, 5);
+
+   const unsigned nrIterations = 20000;
+   boost::posix_time::ptime start =
+      boost::posix_time::microsec_clock::universal_time();
+   for (unsigned i = 0; i < nrIterations; ++i)
+   {
+      // Use the most recently loaded devices, which were worst-case for a
+      // linear search by label.
+      core_.setProperty("Generic44", "Value", "42");
+      ASSERT_EQ("42", core_.getProperty("Generic44", "Value"));
+      ASSERT_FALSE(core_.deviceTypeBusy(MM::ShutterDevice));
+   }
+   boost::posix_time::time_duration elapsed =
+      boost::posix_time::microsec_clock::universal_time() - start;
+
+   // Recorded in the test report (--gtest_output=xml) rather than checked,
+   // since it depends on the machine
+   RecordProperty("ElapsedUs",
+         static_cast<int>(elapsed.total_microseconds()));
+}
+
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,278 @@
+#include <gtest/gtest.h>
+
+#include "AcquisitionPlan.h"
+#include "CircularBuffer.h"
+#include "FrameMatcher.h"
+#include "MMCore.h"
+#include "MockDeviceFixture.h"
+
+#include "../MMDevice/DeviceUtils.h"
+
+#include <string>
+#include <vector>
+
+
+class FrameMatcherTests : public ::testing::Test
+{
+protected:
+   static const unsigned width_ = 4;
+   static const unsigned height_ = 2;
+
+   CircularBuffer buffer_;
+   std::vector<std::string> cameras_;
+
+   FrameMatcherTests() : buffer_(1)
+   {
+      cameras_.push_back("A");
+      cameras_.push_back("B");
+   }
+
+   virtual void SetUp()
+   {
+      ASSERT_TRUE(buffer_.Initialize(2, width_, height_, 1));
+      buffer_.Clear();
+   }
+
+   // Insert an image whose pixels all have the given value, optionally with
+   // a "Time" tag
+   bool Insert(mm::FrameMatcher& matcher, unsigned channel,
+         unsigned char value, const std::string& time = "")
+   {
+      std::vector<unsigned char> pixels(width_ * height_, value);
+      Metadata md;
+      md.put("Camera", cameras_[channel]);
+      if (!time.empty())
+         md.put("Time", time);
+      return matcher.InsertImage(buffer_, channel, &pixels[0], width_,
+            height_, 1, 1, md);
+   }
+
+   unsigned char PeekPixel(unsigned channel)
+   {
+      const mm::ImgBuffer* img = buffer_.PeekNextImageBuffer(channel);
+      return img ? img->GetPixels()[0] : 255;
+   }
+
+   std::string PeekTag(unsigned channel, const char* tag)
+   {
+      return buffer_.PeekNextImageBuffer(channel)->GetMetadata().
+         GetSingleTag(tag).GetValue();
+   }
+
+   void Pop()
+   {
+      buffer_.GetNextImageBuffer(0);
+   }
+};
+
+
+TEST_F(FrameMatcherTests, MatchesByImageCount)
+{
+   mm::FrameMatcher matcher(cameras_, "", 0.0, true);
+   EXPECT_EQ(0, matcher.GetChannel("A"));
+   EXPECT_EQ(1, matcher.GetChannel("B"));
+   EXPECT_EQ(-1, matcher.GetChannel("C"));
+
+   EXPECT_TRUE(Insert(matcher, 0, 10));
+   EXPECT_TRUE(Insert(matcher, 0, 11));
+   EXPECT_EQ(0u, buffer_.GetRemainingImageCount());
+   EXPECT_TRUE(Insert(matcher, 1, 20));
+   EXPECT_TRUE(Insert(matcher, 1, 21));
+   ASSERT_EQ(2u, buffer_.GetRemainingImageCount());
+
+   EXPECT_EQ(10, PeekPixel(0));
+   EXPECT_EQ(20, PeekPixel(1));
+   EXPECT_EQ("A", PeekTag(0, "Camera"));
+   EXPECT_EQ("B", PeekTag(1, "Camera"));
+   EXPECT_EQ("1", PeekTag(1, "FrameMatchComplete"));
+   Pop();
+   EXPECT_EQ(11, PeekPixel(0));
+   EXPECT_EQ(21, PeekPixel(1));
+   EXPECT_EQ("1", PeekTag(0, MM::g_Keyword_Metadata_ImageNumber));
+   Pop();
+   EXPECT_EQ(0u, buffer_.GetRemainingImageCount());
+
+   mm::FrameMatchStatistics statistics = matcher.GetStatistics();
+   EXPECT_EQ(4, statistics.imagesReceived);
+   EXPECT_EQ(2, statistics.matchedFrames);
+   EXPECT_EQ(0, statistics.unmatchedFrames);
+   EXPECT_EQ(0, statistics.droppedImages);
+}
+
+
+TEST_F(FrameMatcherTests, DropsFramesMissingAnImage)
+{
+   mm::FrameMatcher matcher(cameras_, "Time", 0.5, true);
+
+   // B misses the image at 2.0; its image at 3.1 expires that frame
+   Insert(matcher, 0, 10, "1.0");
+   Insert(matcher, 1, 20, "1.2");
+   Insert(matcher, 0, 11, "2.0");
+   Insert(matcher, 0, 12, "3.0");
+   Insert(matcher, 1, 22, "3.1");
+
+   ASSERT_EQ(2u, buffer_.GetRemainingImageCount());
+   EXPECT_EQ(10, PeekPixel(0));
+   EXPECT_EQ(20, PeekPixel(1));
+   Pop();
+   EXPECT_EQ(12, PeekPixel(0));
+   EXPECT_EQ(22, PeekPixel(1));
+
+   mm::FrameMatchStatistics statistics = matcher.GetStatistics();
+   EXPECT_EQ(2, statistics.matchedFrames);
+   EXPECT_EQ(1, statistics.unmatchedFrames);
+   EXPECT_EQ(1, statistics.droppedImages);
+}
+
+
+TEST_F(FrameMatcherTests, FlagsFramesMissingAnImage)
+{
+   mm::FrameMatcher matcher(cameras_, "Time", 0.5, false);
+
+   Insert(matcher, 0, 10, "1.0");
+   Insert(matcher, 1, 20, "1.2");
+   Insert(matcher, 0, 11, "2.0");
+   Insert(matcher, 0, 12, "3.0");
+   Insert(matcher, 1, 22, "3.1");
+
+   ASSERT_EQ(3u, buffer_.GetRemainingImageCount());
+   Pop();
+   EXPECT_EQ(11, PeekPixel(0));
+   EXPECT_EQ(0, PeekPixel(1));
+   EXPECT_EQ("0", PeekTag(0, "FrameMatchComplete"));
+   EXPECT_EQ("0", PeekTag(1, "FrameMatchComplete"));
+   EXPECT_EQ("B", PeekTag(1, "Camera"));
+   // The blank image does not get the other camera's tags
+   EXPECT_EQ("2.0", PeekTag(0, "Time"));
+   Metadata blankMD = buffer_.PeekNextImageBuffer(1)->GetMetadata();
+   EXPECT_FALSE(blankMD.HasTag("Time"));
+   Pop();
+   EXPECT_EQ("1", PeekTag(1, "FrameMatchComplete"));
+
+   mm::FrameMatchStatistics statistics = matcher.GetStatistics();
+   EXPECT_EQ(2, statistics.matchedFrames);
+   EXPECT_EQ(1, statistics.unmatchedFrames);
+   EXPECT_EQ(0, statistics.droppedImages);
+}
+
+
+TEST_F(FrameMatcherTests, FlushInsertsOpenFrames)
+{
+   mm::FrameMatcher matcher(cameras_, "", 0.0, false);
+   Insert(matcher, 0, 10);
+   Insert(matcher, 0, 11);
+   EXPECT_EQ(0u, buffer_.GetRemainingImageCount());
+
+   EXPECT_TRUE(matcher.Flush(buffer_));
+   EXPECT_EQ(2u, buffer_.GetRemainingImageCount());
+   EXPECT_EQ(2, matcher.GetStatistics().unmatchedFrames);
+}
+
+
+TEST_F(FrameMatcherTests, RejectsMismatchedImageSizes)
+{
+   mm::FrameMatcher matcher(cameras_, "", 0.0, true);
+   Insert(matcher, 0, 10);
+
+   std::vector<unsigned char> pixels(2 * width_ * height_);
+   Metadata md;
+   md.put("Camera", "B");
+   EXPECT_THROW(matcher.InsertImage(buffer_, 1, &pixels[0], width_,
+            height_, 2, 1, md), CMMError);
+}
+
+
+TEST_F(FrameMatcherTests, CountsOverflowAsDropped)
+{
+   mm::FrameMatcher matcher(cameras_, "", 0.0, true);
+   const unsigned long capacity = buffer_.GetSize();
+   for (unsigned long i = 0; i < capacity; ++i)
+   {
+      EXPECT_TRUE(Insert(matcher, 0, 1));
+      EXPECT_TRUE(Insert(matcher, 1, 2));
+   }
+   Insert(matcher, 0, 1);
+   EXPECT_FALSE(Insert(matcher, 1, 2));
+   EXPECT_EQ(2, matcher.GetStatistics().droppedImages);
+}
+
+
+class FrameMatchingCoreTests : public MockDeviceTest
+{
+};
+
+
+TEST_F(FrameMatchingCoreTests, MatchesTwoCameras)
+{
+   LoadMockDevice("Cam1", "MockCamera");
+   LoadMockDevice("Cam2", "MockCamera");
+   core_.initializeAllDevices();
+
+   std::vector<std::string> cameras;
+   cameras.push_back("Cam1");
+   cameras.push_back("Cam2");
+   core_.startCameraFrameMatching(cameras, "", 0.0, true);
+   EXPECT_TRUE(core_.isCameraFrameMatchingRunning());
+   EXPECT_THROW(core_.startCameraFrameMatching(cameras, "", 0.0, true),
+         CMMError);
+
+   // The circular buffer must not be reinitialized while matching
+   core_.setCameraDevice("Cam1");
+   EXPECT_THROW(core_.startSequenceAcquisition(5, 0.0, true), CMMError);
+   EXPECT_THROW(core_.startContinuousSequenceAcquisition(0.0), CMMError);
+   EXPECT_THROW(core_.initializeCircularBuffer(), CMMError);
+   EXPECT_THROW(core_.setCircularBufferMemoryFootprint(10), CMMError);
+   AcquisitionPlan plan;
+   plan.addEvent(AcquisitionEvent(0, 0, 0, 0));
+   EXPECT_THROW(core_.startAcquisitionPlan(plan), CMMError);
+   EXPECT_FALSE(core_.isAcquisitionPlanRunning());
+
+   core_.startSequenceAcquisition("Cam1", 5, 0.0, true);
+   core_.startSequenceAcquisition("Cam2", 5, 0.0, true);
+   while (core_.isSequenceRunning("Cam1") || core_.isSequenceRunning("Cam2"))
+      CDeviceUtils::SleepMs(10);
+   core_.stopCameraFrameMatching();
+   EXPECT_FALSE(core_.isCameraFrameMatchingRunning());
+
+   EXPECT_EQ(5, core_.getMatchedCameraFrameCount());
+   EXPECT_EQ(0, core_.getUnmatchedCameraFrameCount());
+   ASSERT_EQ(5, core_.getRemainingImageCount());
+
+   Metadata md;
+   core_.peekNextImageMD(1, 0, md);
+   EXPECT_EQ("Cam2", md.GetSingleTag("Camera").GetValue());
+   core_.popNextImageMD(0, 0, md);
+   EXPECT_EQ("Cam1", md.GetSingleTag("Camera").GetValue());
+   EXPECT_EQ(4, core_.getRemainingImageCount());
+
+   // Nor may matching take over the buffer from a running plan
+   AcquisitionEvent later(1, 0, 0, 0);
+   later.setMinimumStartTime(60000.0);
+   plan.addEvent(later);
+   core_.startAcquisitionPlan(plan);
+   EXPECT_THROW(core_.startCameraFrameMatching(cameras, "", 0.0, true),
+         CMMError);
+   EXPECT_FALSE(core_.isCameraFrameMatchingRunning());
+   core_.stopAcquisitionPlan();
+}
+
+
+TEST_F(FrameMatchingCoreTests, RejectsDuplicateCameras)
+{
+   LoadMockDevice("Cam1", "MockCamera");
+   core_.initializeAllDevices();
+
+   std::vector<std::string> cameras;
+   cameras.push_back("Cam1");
+   cameras.push_back("Cam1");
+   EXPECT_THROW(core_.startCameraFrameMatching(cameras, "", 0.0, true),
+         CMMError);
+   EXPECT_FALSE(core_.isCameraFrameMatchingRunning());
+}
+
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,271 @@
+#include <gtest/gtest.h>
+
+#include "GalvoScanPath.h"
+#include "MMCore.h"
+#include "MockDeviceFixture.h"
+
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using namespace mm;
+
+
+static GalvoROI Rectangle(double x, double y, double w, double h)
+{
+   GalvoROI roi;
+   roi.xs.push_back(x);     roi.ys.push_back(y);
+   roi.xs.push_back(x + w); roi.ys.push_back(y);
+   roi.xs.push_back(x + w); roi.ys.push_back(y + h);
+   roi.xs.push_back(x);     roi.ys.push_back(y + h);
+   return roi;
+}
+
+
+static GalvoROI Point(double x, double y)
+{
+   GalvoROI roi;
+   roi.xs.push_back(x);
+   roi.ys.push_back(y);
+   return roi;
+}
+
+
+TEST(GalvoScanPathTests, RasterizesPolygonsInSerpentine)
+{
+   std::vector<double> xs, ys;
+   RasterizeGalvoROI(Rectangle(0.0, 0.0, 4.0, 3.0), 1.0, xs, ys);
+   ASSERT_EQ(12u, xs.size());
+   ASSERT_EQ(12u, ys.size());
+   EXPECT_DOUBLE_EQ(0.5, xs[0]);
+   EXPECT_DOUBLE_EQ(0.5, ys[0]);
+   EXPECT_DOUBLE_EQ(3.5, xs[3]);
+   // The second line runs right to left
+   EXPECT_DOUBLE_EQ(3.5, xs[4]);
+   EXPECT_DOUBLE_EQ(1.5, ys[4]);
+   EXPECT_DOUBLE_EQ(0.5, xs[7]);
+   EXPECT_DOUBLE_EQ(0.5, xs[8]);
+   EXPECT_DOUBLE_EQ(2.5, ys[11]);
+
+   // A triangle's lines get shorter
+   GalvoROI triangle;
+   triangle.xs.push_back(0.0); triangle.ys.push_back(0.0);
+   triangle.xs.push_back(8.0); triangle.ys.push_back(0.0);
+   triangle.xs.push_back(0.0); triangle.ys.push_back(8.0);
+   xs.clear();
+   ys.clear();
+   RasterizeGalvoROI(triangle, 1.0, xs, ys);
+   for (std::size_t i = 0; i < xs.size(); ++i)
+      EXPECT_LT(xs[i] + ys[i], 8.0);
+   EXPECT_EQ(7u + 6u + 5u + 4u + 3u + 2u + 1u + 1u, xs.size());
+}
+
+
+TEST(GalvoScanPathTests, RasterizesPointsAndSegments)
+{
+   std::vector<double> xs, ys;
+   RasterizeGalvoROI(Point(3.0, 4.0), 1.0, xs, ys);
+   ASSERT_EQ(1u, xs.size());
+   EXPECT_DOUBLE_EQ(3.0, xs[0]);
+
+   GalvoROI segment = Point(0.0, 0.0);
+   segment.xs.push_back(3.0);
+   segment.ys.push_back(4.0);
+   xs.clear();
+   ys.clear();
+   RasterizeGalvoROI(segment, 1.0, xs, ys);
+   ASSERT_EQ(6u, xs.size());
+   EXPECT_DOUBLE_EQ(3.0, xs[5]);
+   EXPECT_DOUBLE_EQ(4.0, ys[5]);
+
+   // Too small for the spacing
+   xs.clear();
+   ys.clear();
+   RasterizeGalvoROI(Rectangle(0.0, 0.0, 0.5, 0.5), 1.0, xs, ys);
+   ASSERT_EQ(1u, xs.size());
+   EXPECT_DOUBLE_EQ(0.25, xs[0]);
+}
+
+
+TEST(GalvoScanPathTests, OrdersROIsByProximity)
+{
+   const double positions[] = { 7.0, 2.0, 9.0, 0.0, 5.0, 1.0 };
+   std::vector<GalvoROI> rois;
+   for (int i = 0; i < 6; ++i)
+      rois.push_back(Point(positions[i], 0.0));
+
+   GalvoScanPath path = CompileGalvoScanPath(rois, 1.0, 0.0, 0.0);
+   ASSERT_EQ(6u, path.GetNumberOfPoints());
+   const std::size_t expected[] = { 3, 5, 1, 4, 0, 2 };
+   EXPECT_EQ(std::vector<std::size_t>(expected, expected + 6), path.roiOrder);
+   EXPECT_DOUBLE_EQ(9.0, path.GetTravelDistance(0.0, 0.0));
+}
+
+
+TEST(GalvoScanPathTests, RunsROIsBackwardsWhenShorter)
+{
+   // Two horizontal segments, end to end, given in the wrong order
+   GalvoROI right = Point(10.0, 0.0);
+   right.xs.push_back(20.0);
+   right.ys.push_back(0.0);
+   GalvoROI left = Point(0.0, 0.0);
+   left.xs.push_back(10.0);
+   left.ys.push_back(0.0);
+   std::vector<GalvoROI> rois;
+   rois.push_back(right);
+   rois.push_back(left);
+
+   // Starting from the right end, both are run right to left
+   GalvoScanPath path = CompileGalvoScanPath(rois, 5.0, 20.0, 0.0);
+   ASSERT_EQ(2u, path.roiOrder.size());
+   EXPECT_EQ(0u, path.roiOrder[0]);
+   EXPECT_DOUBLE_EQ(20.0, path.xs.front());
+   EXPECT_DOUBLE_EQ(0.0, path.xs.back());
+   EXPECT_DOUBLE_EQ(20.0, path.GetTravelDistance(20.0, 0.0));
+}
+
+
+TEST(GalvoScanPathTests, RepeatsROIs)
+{
+   std::vector<GalvoROI> rois;
+   rois.push_back(Rectangle(0.0, 0.0, 2.0, 2.0));
+   rois[0].repetitions = 3;
+   rois[0].dwellTime_us = 10.0;
+   rois.push_back(Point(5.0, 5.0));
+   rois[1].dwellTime_us = 20.0;
+   rois.push_back(Point(6.0, 6.0));
+   rois[2].repetitions = 0;
+
+   GalvoScanPath path = CompileGalvoScanPath(rois, 1.0, 0.0, 0.0);
+   ASSERT_EQ(13u, path.GetNumberOfPoints());
+   ASSERT_EQ(13u, path.dwellTimes_us.size());
+   EXPECT_DOUBLE_EQ(10.0, path.dwellTimes_us[11]);
+   EXPECT_DOUBLE_EQ(20.0, path.dwellTimes_us[12]);
+   // Each repetition runs the same way
+   EXPECT_DOUBLE_EQ(path.xs[0], path.xs[4]);
+   EXPECT_DOUBLE_EQ(path.ys[3], path.ys[7]);
+   EXPECT_EQ(2u, path.roiOrder.size());
+}
+
+
+TEST(GalvoScanPathTests, CompileBenchmark)
+{
+   // Hundreds of small ROIs scattered over the field, in arbitrary order
+   std::vector<GalvoROI> rois;
+   unsigned long seed = 12345;
+   for (int i = 0; i < 400; ++i)
+   {
+      seed = (seed * 1103515245UL + 12345UL) % 2147483648UL;
+      const double x = static_cast<double>(seed % 1000) / 10.0;
+      seed = (seed * 1103515245UL + 12345UL) % 2147483648UL;
+      const double y = static_cast<double>(seed % 1000) / 10.0;
+      rois.push_back(Rectangle(x, y, 2.0, 2.0));
+   }
+
+   GalvoScanPath path = CompileGalvoScanPath(rois, 0.25, 0.0, 0.0);
+
+   // Travel if the ROIs were run in the order given
+   double givenOrderTravel = 0.0;
+   double x = 0.0, y = 0.0;
+   for (std::size_t i = 0; i < rois.size(); ++i)
+   {
+      std::vector<double> xs, ys;
+      RasterizeGalvoROI(rois[i], 0.25, xs, ys);
+      for (std::size_t j = 0; j < xs.size(); ++j)
+      {
+         givenOrderTravel += std::sqrt((xs[j] - x) * (xs[j] - x) +
+               (ys[j] - y) * (ys[j] - y));
+         x = xs[j];
+         y = ys[j];
+      }
+   }
+   const double travel = path.GetTravelDistance(0.0, 0.0);
+   EXPECT_EQ(400u * 64u, path.GetNumberOfPoints());
+   EXPECT_LT(travel, givenOrderTravel);
+}
+
+
+class GalvoROITests : public MockDeviceTest
+{
+protected:
+   std::vector<long> vertexCounts_;
+   std::vector<double> xs_;
+   std::vector<double> ys_;
+   std::vector<long> repetitions_;
+   std::vector<double> dwellTimes_us_;
+
+   virtual void SetUp()
+   {
+      LoadMockDevice("Galvo", "MockGalvo");
+      core_.initializeAllDevices();
+
+      // A 4x4 square far away, and two points near the origin
+      AddROI(Rectangle(50.0, 50.0, 4.0, 4.0), 2, 10.0);
+      AddROI(Point(2.0, 0.0), 1, 10.0);
+      AddROI(Point(1.0, 0.0), 1, 10.0);
+   }
+
+   void AddROI(const GalvoROI& roi, long repetitions, double dwellTime_us)
+   {
+      vertexCounts_.push_back(static_cast<long>(roi.xs.size()));
+      xs_.insert(xs_.end(), roi.xs.begin(), roi.xs.end());
+      ys_.insert(ys_.end(), roi.ys.begin(), roi.ys.end());
+      repetitions_.push_back(repetitions);
+      dwellTimes_us_.push_back(dwellTime_us);
+   }
+
+   void Load()
+   {
+      core_.loadGalvoROIs("Galvo", vertexCounts_, xs_, ys_, repetitions_,
+            dwellTimes_us_, 1.0);
+   }
+};
+
+
+TEST_F(GalvoROITests, LoadsScanPath)
+{
+   Load();
+   EXPECT_EQ("34", core_.getProperty("Galvo", "ScanPathPoints"));
+   EXPECT_EQ("340.0000", core_.getProperty("Galvo", "ScanPathTime"));
+   EXPECT_EQ("0", core_.getProperty("Galvo", "Polygons"));
+}
+
+
+TEST_F(GalvoROITests, FallsBackToPolygons)
+{
+   core_.setProperty("Galvo", "ScanPaths", "0");
+   Load();
+   EXPECT_EQ("0", core_.getProperty("Galvo", "ScanPathPoints"));
+   // The square is added once per repetition, after the points
+   EXPECT_EQ("4", core_.getProperty("Galvo", "Polygons"));
+   EXPECT_EQ("1.00,2.00,50.00,50.00",
+         core_.getProperty("Galvo", "PolygonFirstXs"));
+   EXPECT_EQ("10.0000", core_.getProperty("Galvo", "SpotInterval"));
+
+   dwellTimes_us_[1] = 20.0;
+   EXPECT_THROW(Load(), CMMError);
+}
+
+
+TEST_F(GalvoROITests, ChecksArguments)
+{
+   vertexCounts_[0] = 5;
+   EXPECT_THROW(Load(), CMMError);
+   vertexCounts_[0] = 4;
+   repetitions_.pop_back();
+   EXPECT_THROW(Load(), CMMError);
+   repetitions_.push_back(-1);
+   EXPECT_THROW(Load(), CMMError);
+   repetitions_.back() = 1;
+   EXPECT_THROW(core_.loadGalvoROIs("Galvo", vertexCounts_, xs_, ys_,
+            repetitions_, dwellTimes_us_, 0.0), CMMError);
+   EXPECT_NO_THROW(Load());
+}
+
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include "LocalClock.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <locale>
+#include <sstream>
+#include <string>
+
+using namespace boost::posix_time;
+
+
+TEST(LocalClockTests, AgreesWithBoostLocalTime)
+{
+   ptime before = microsec_clock::local_time();
+   ptime now = mm::LocalTimeNow();
+   ptime after = microsec_clock::local_time();
+   EXPECT_LE(before, now);
+   EXPECT_LE(now, after);
+}
+
+
+TEST(LocalClockTests, ConvertsMicrosecondsSinceEpoch)
+{
+   const ptime epoch(boost::gregorian::date(1970, 1, 1));
+   EXPECT_EQ(epoch, mm::PtimeFromUTCMicroseconds(0));
+
+   // More than 2^31 microseconds (about 35.8 minutes) into the hour
+   ptime t(boost::gregorian::date(2014, 12, 31),
+         hours(23) + minutes(59) + seconds(30) + microseconds(123456));
+   EXPECT_EQ(t, mm::PtimeFromUTCMicroseconds((t - epoch).total_microseconds()));
+   t = ptime(boost::gregorian::date(2038, 1, 19),
+         hours(3) + minutes(36) + seconds(59) + microseconds(999999));
+   EXPECT_EQ(t, mm::PtimeFromUTCMicroseconds((t - epoch).total_microseconds()));
+}
+
+
+static std::string FormatWithFacet(ptime t)
+{
+   std::ostringstream strm;
+   strm.imbue(std::locale(strm.getloc(),
+            new time_facet("%Y-%m-%d %H:%M:%s")));
+   strm << t;
+   return strm.str();
+}
+
+
+TEST(LocalClockTests, FormatterMatchesBoostFormatting)
+{
+   mm::TimestampFormatter iso('T', mm::TimestampFormatter::FractionIfNonZero);
+   mm::TimestampFormatter facet(' ', mm::TimestampFormatter::FractionAlways);
+
+   ptime base(boost::gregorian::date(2014, 12, 31), hours(23) + minutes(59));
+   const time_duration offsets[] = {
+      microseconds(0),
+      microseconds(1),
+      seconds(7) + microseconds(123456),
+      seconds(59) + microseconds(999999),
+      seconds(60), // Next year
+      seconds(61) + microseconds(500),
+      seconds(3) + microseconds(10), // Back to the earlier minute
+   };
+   for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); ++i)
+   {
+      ptime t = base + offsets[i];
+      EXPECT_EQ(to_iso_extended_string(t), iso.Format(t));
+      EXPECT_EQ(FormatWithFacet(t), facet.Format(t));
+   }
+}
+
+
+TEST(LocalClockTests, FormatterAppends)
+{
+   mm::TimestampFormatter fmt('T', mm::TimestampFormatter::FractionAlways);
+   std::string s = "at ";
+   fmt.Append(s, ptime(boost::gregorian::date(2014, 1, 2),
+            hours(3) + minutes(4) + seconds(5)));
+   EXPECT_EQ("at 2014-01-02T03:04:05.000000", s);
+}
+
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,244 @@
+#include <gtest/gtest.h>
+
+#include "Logging/LogFileIndex.h"
+#include "Logging/Logging.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace mm::logging;
+
+
+static std::string Line(const std::string& time, const std::string& level,
+      const std::string& component, const std::string& text)
+{
+   return "2014-10-03T" + time + " tid12345 [" + level + "," + component +
+      "] " + text + "\n";
+}
+
+
+TEST(LogFileIndexTests, ParsesFormattedPrefix)
+{
+   Metadata::StampDataType stamp;
+   stamp.Stamp();
+   Metadata metadata("dev:Camera", LogLevelWarning, stamp);
+   std::ostringstream strm;
+   internal::MetadataFormatter formatter;
+   formatter.FormatLinePrefix(strm, metadata);
+   strm << " text";
+   const std::string line = strm.str();
+
+   LogLineHeader header;
+   ASSERT_TRUE(ParseLogLineHeader(line.data(), line.data() + line.size(),
+            header));
+   EXPECT_EQ(LogLevelWarning, header.level);
+   EXPECT_EQ("dev:Camera",
+         std::string(header.component, header.componentLength));
+
+   strm.str(std::string());
+   formatter.FormatContinuationPrefix(strm);
+   strm << " more text";
+   const std::string continuation = strm.str();
+   EXPECT_FALSE(ParseLogLineHeader(continuation.data(),
+            continuation.data() + continuation.size(), header));
+}
+
+
+TEST(LogFileIndexTests, ParsesTimestamps)
+{
+   const std::string withFraction = "1970-01-02T00:00:01.5";
+   const std::string withoutFraction = "1970-01-02 00:00:01";
+   boost::int64_t t;
+   EXPECT_EQ(withFraction.size(), ParseLogTimestamp(withFraction.data(),
+            withFraction.data() + withFraction.size(), t));
+   EXPECT_EQ(86401500000LL, t);
+   EXPECT_EQ(withoutFraction.size(), ParseLogTimestamp(withoutFraction.data(),
+            withoutFraction.data() + withoutFraction.size(), t));
+   EXPECT_EQ(86401000000LL, t);
+}
+
+
+static std::string TwoDigits(int n)
+{
+   return (n < 10 ? "0" : "") + boost::lexical_cast<std::string>(n);
+}
+
+
+class LogFileIndexQueryTests : public ::testing::Test
+{
+protected:
+   std::string log_;
+   LogFileIndex index_;
+
+   virtual void SetUp()
+   {
+      log_ = "Not an entry\n";
+      for (int i = 0; i < 3000; ++i)
+      {
+         const std::string n = boost::lexical_cast<std::string>(i);
+         const std::string time = "00:" + TwoDigits(i / 60) + ":" +
+            TwoDigits(i % 60);
+         const char* component = (i % 3 == 0) ? "dev:Stage" : "Core";
+         const char* level = (i % 100 == 7) ? "ERR" : "dbg";
+         log_ += Line(time, level, component, "entry " + n);
+         if (i % 10 == 7)
+            log_ += "                                [   ] continued " + n +
+               "\n";
+      }
+      index_.Update(log_.data(), log_.size());
+   }
+
+   std::size_t Count(const LogQuery& query, std::string* text = 0)
+   {
+      std::ostringstream out;
+      std::size_t n = index_.Query(log_.data(), log_.size(), query, out);
+      if (text)
+         *text = out.str();
+      return n;
+   }
+};
+
+
+TEST_F(LogFileIndexQueryTests, MatchesAll)
+{
+   std::string text;
+   EXPECT_EQ(3000u, Count(LogQuery(), &text));
+   EXPECT_EQ(log_.substr(log_.find('\n') + 1), text);
+   EXPECT_GT(index_.GetBlocks().size(), 2u);
+}
+
+
+TEST_F(LogFileIndexQueryTests, FiltersByLevelAndComponent)
+{
+   LogQuery query;
+   query.SetMinimumLevel(LogLevelError);
+   EXPECT_EQ(30u, Count(query));
+   query.AddDevice("Stage");
+   std::string text;
+   EXPECT_EQ(10u, Count(query, &text));
+   // Continuation lines are part of the entry
+   EXPECT_NE(std::string::npos, text.find("continued 207\n"));
+   EXPECT_EQ(std::string::npos, text.find("continued 17\n"));
+
+   query.components.clear();
+   query.components.push_back("NoSuchComponent");
+   EXPECT_EQ(0u, Count(query));
+}
+
+
+TEST_F(LogFileIndexQueryTests, FiltersByTimeAndText)
+{
+   LogQuery query;
+   const std::string since = "2014-10-03T00:10:00";
+   const std::string until = "2014-10-03T00:10:59.999";
+   boost::int64_t t;
+   ParseLogTimestamp(since.data(), since.data() + since.size(), t);
+   query.since = t;
+   ParseLogTimestamp(until.data(), until.data() + until.size(), t);
+   query.until = t;
+   EXPECT_EQ(60u, Count(query));
+
+   query.text = "continued";
+   EXPECT_EQ(6u, Count(query));
+}
+
+
+TEST_F(LogFileIndexQueryTests, IncrementalUpdateMatchesFullIndex)
+{
+   LogFileIndex partial;
+   // Cut in the middle of a line
+   const std::size_t cut = log_.size() / 2 + 5;
+   partial.Update(log_.data(), cut);
+   EXPECT_LE(partial.GetIndexedLength(), cut);
+   EXPECT_TRUE(partial.IsValidFor(log_.data(), log_.size()));
+   partial.Update(log_.data(), log_.size());
+
+   std::ostringstream expected, actual;
+   index_.Save(expected);
+   partial.Save(actual);
+   EXPECT_EQ(expected.str(), actual.str());
+}
+
+
+TEST_F(LogFileIndexQueryTests, SaveAndLoad)
+{
+   std::stringstream stream;
+   index_.Save(stream);
+   LogFileIndex loaded;
+   ASSERT_TRUE(loaded.Load(stream));
+   EXPECT_TRUE(loaded.IsValidFor(log_.data(), log_.size()));
+   EXPECT_EQ(index_.GetIndexedLength(), loaded.GetIndexedLength());
+
+   LogQuery query;
+   query.SetMinimumLevel(LogLevelError);
+   std::ostringstream out;
+   EXPECT_EQ(30u, loaded.Query(log_.data(), log_.size(), query, out));
+
+   std::string replaced(log_);
+   replaced[0] = 'X';
+   EXPECT_FALSE(loaded.IsValidFor(replaced.data(), replaced.size()));
+
+   std::istringstream garbage("MMLOGIX1 truncated");
+   EXPECT_FALSE(loaded.Load(garbage));
+}
+
+
+TEST(LogFileIndexTests, IndexedFileAndFollower)
+{
+   const std::string filename = "LogFileIndexTests.log";
+   {
+      std::ofstream log(filename.c_str(), std::ios_base::binary);
+      log << Line("00:00:00", "IFO", "Core", "first");
+      log << Line("00:00:01", "ERR", "Core", "second");
+   }
+
+   LogQuery query;
+   query.SetMinimumLevel(LogLevelError);
+   boost::uint64_t end;
+   {
+      IndexedLogFile file(filename);
+      std::ostringstream out;
+      EXPECT_EQ(1u, file.Query(query, out));
+      end = file.GetIndex().GetIndexedLength();
+   }
+   {
+      // The index was saved
+      std::ifstream sidecar(IndexedLogFile::SidecarFilename(filename).c_str());
+      EXPECT_TRUE(sidecar.is_open());
+   }
+
+   LogFollower follower(filename, query, end);
+   std::ostringstream followed;
+   EXPECT_EQ(0u, follower.Poll(followed));
+   {
+      std::ofstream log(filename.c_str(),
+            std::ios_base::binary | std::ios_base::app);
+      log << Line("00:00:02", "ERR", "Core", "third");
+      log << "   continued\n";
+      log << Line("00:00:03", "IFO", "Core", "fourth");
+      log << "2014-10-03T00:00:04 tid1 [ERR,Co"; // Partial line
+   }
+   EXPECT_EQ(1u, follower.Poll(followed));
+   EXPECT_EQ(Line("00:00:02", "ERR", "Core", "third") + "   continued\n",
+         followed.str());
+   {
+      std::ofstream log(filename.c_str(),
+            std::ios_base::binary | std::ios_base::app);
+      log << "re] fifth\n";
+   }
+   EXPECT_EQ(1u, follower.Poll(followed));
+
+   std::remove(filename.c_str());
+   std::remove(IndexedLogFile::SidecarFilename(filename).c_str());
+}
+
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
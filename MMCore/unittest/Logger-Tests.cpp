@@ -3,10 +3,14 @@
 #include "Logging/Logging.h"
 
 #include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/make_shared.hpp>
 #include <boost/thread.hpp>
 
+#include <cstdio>
+#include <fstream>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -122,6 +126,396 @@ TEST(LoggerTests, AsyncAndThreaded)
 }
 
 
+// Records the text of the packets it receives, optionally slowly
+class CollectingSink : public LogSink
+{
+   boost::mutex mutex_;
+   std::vector<std::string> lines_;
+   unsigned delayUs_;
+
+public:
+   CollectingSink(unsigned delayUs = 0) : delayUs_(delayUs) {}
+
+   virtual void Consume(const PacketArrayType& packets)
+   {
+      if (delayUs_ > 0)
+         boost::this_thread::sleep(boost::posix_time::microseconds(delayUs_));
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      for (PacketArrayType::ConstIteratorType it = packets.Begin(),
+            end = packets.End(); it != end; ++it)
+      {
+         lines_.push_back(it->GetText());
+      }
+   }
+
+   std::vector<std::string> GetLines()
+   {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      return lines_;
+   }
+};
+
+
+class NumberingThreadFunc
+{
+   unsigned n_;
+   unsigned nrEntries_;
+   boost::shared_ptr<LoggingCore> c_;
+
+public:
+   NumberingThreadFunc(unsigned n, unsigned nrEntries,
+         boost::shared_ptr<LoggingCore> c) :
+      n_(n), nrEntries_(nrEntries), c_(c)
+   {}
+
+   void Run()
+   {
+      Logger lgr = c_->NewLogger("thread");
+      for (unsigned j = 0; j < nrEntries_; ++j)
+         LOG_DEBUG(lgr) << n_ << ' ' << j;
+   }
+};
+
+
+static void RunNumberingThreads(boost::shared_ptr<LoggingCore> c,
+      unsigned nrThreads, unsigned nrEntries)
+{
+   std::vector< boost::shared_ptr<boost::thread> > threads;
+   std::vector< boost::shared_ptr<NumberingThreadFunc> > funcs;
+   for (unsigned i = 0; i < nrThreads; ++i)
+   {
+      funcs.push_back(boost::make_shared<NumberingThreadFunc>(i, nrEntries, c));
+      threads.push_back(boost::make_shared<boost::thread>(
+               &NumberingThreadFunc::Run, funcs[i].get()));
+   }
+   for (unsigned i = 0; i < threads.size(); ++i)
+      threads[i]->join();
+}
+
+
+TEST(LoggerTests, AsyncQueueBlocksWhenFull)
+{
+   boost::shared_ptr<LoggingCore> c =
+      boost::make_shared<LoggingCore>();
+   c->SetAsyncQueueCapacity(16, true);
+   c->SetAsyncFlushInterval(boost::posix_time::milliseconds(1));
+
+   boost::shared_ptr<CollectingSink> sink =
+      boost::make_shared<CollectingSink>(100);
+   c->AddSink(sink, SinkModeAsynchronous);
+
+   RunNumberingThreads(c, 4, 200);
+   c->RemoveSink(sink, SinkModeAsynchronous); // Drains the queue
+
+   // Nothing is lost, and each thread's entries are in order
+   std::vector<std::string> lines = sink->GetLines();
+   ASSERT_EQ(800u, lines.size());
+   std::vector<unsigned> nextIndex(4, 0);
+   for (size_t i = 0; i < lines.size(); ++i)
+   {
+      unsigned thread, index;
+      std::istringstream strm(lines[i]);
+      strm >> thread >> index;
+      ASSERT_LT(thread, 4u);
+      ASSERT_EQ(nextIndex[thread], index);
+      ++nextIndex[thread];
+   }
+}
+
+
+TEST(LoggerTests, AsyncQueueDropsOldestWhenFull)
+{
+   boost::shared_ptr<LoggingCore> c =
+      boost::make_shared<LoggingCore>();
+   c->SetAsyncQueueCapacity(16, false);
+
+   boost::shared_ptr<CollectingSink> sink =
+      boost::make_shared<CollectingSink>(1000);
+   c->AddSink(sink, SinkModeAsynchronous);
+
+   RunNumberingThreads(c, 1, 1000);
+   c->RemoveSink(sink, SinkModeAsynchronous);
+
+   // The most recent entries are kept, and the number of lines dropped is
+   // recorded in place of the others
+   std::vector<std::string> lines = sink->GetLines();
+   ASSERT_FALSE(lines.empty());
+   EXPECT_EQ("0 999", lines.back());
+   unsigned nrLogged = 0, nrDropped = 0;
+   for (size_t i = 0; i < lines.size(); ++i)
+   {
+      if (lines[i].find("log lines dropped") != std::string::npos)
+      {
+         unsigned n;
+         std::istringstream(lines[i].substr(1)) >> n;
+         nrDropped += n;
+      }
+      else
+         ++nrLogged;
+   }
+   EXPECT_LT(nrLogged, 1000u);
+   EXPECT_EQ(1000u, nrLogged + nrDropped);
+}
+
+
+TEST(LoggerTests, AsyncThroughputFromManyThreads)
+{
+   boost::shared_ptr<LoggingCore> c =
+      boost::make_shared<LoggingCore>();
+   boost::shared_ptr<CollectingSink> sink =
+      boost::make_shared<CollectingSink>();
+   c->AddSink(sink, SinkModeAsynchronous);
+
+   const unsigned nrThreads = 8, nrEntries = 20000;
+   boost::posix_time::ptime start =
+      boost::posix_time::microsec_clock::universal_time();
+   RunNumberingThreads(c, nrThreads, nrEntries);
+   boost::posix_time::time_duration elapsed =
+      boost::posix_time::microsec_clock::universal_time() - start;
+   c->RemoveSink(sink, SinkModeAsynchronous);
+   EXPECT_EQ(nrThreads * nrEntries, sink->GetLines().size());
+
+   // Recorded in the test report (--gtest_output=xml) rather than checked,
+   // since it depends on the machine
+   RecordProperty("ElapsedUs",
+         static_cast<int>(elapsed.total_microseconds()));
+}
+
+
+TEST(LoggerTests, DeferredEntryFormatting)
+{
+   using mm::logging::internal::DeferredEntry;
+
+   DeferredEntry e("Device {} moved to {} ({}, {}){}");
+   e.AddArg(std::string("Stage"));
+   e.AddArg(12.5);
+   e.AddArg(-3);
+   e.AddArg(7u);
+   e.AddArg('!');
+   std::ostringstream strm;
+   e.Format(strm);
+   EXPECT_EQ("Device Stage moved to 12.5 (-3, 7)!", strm.str());
+
+   // Missing arguments are marked; extra ones are ignored
+   DeferredEntry missing("{} and {}");
+   missing.AddArg("one");
+   std::ostringstream strm2;
+   missing.Format(strm2);
+   EXPECT_EQ("one and {?}", strm2.str());
+
+   // Strings that do not fit are truncated
+   DeferredEntry longString("{}");
+   longString.AddArg(std::string(1000, 'x'));
+   DeferredEntry copy(longString);
+   std::ostringstream strm3;
+   copy.Format(strm3);
+   EXPECT_EQ(std::string(DeferredEntry::StringStorageLen, 'x') + "[...]",
+         strm3.str());
+}
+
+
+TEST(LoggerTests, DeferredEntriesAsynchronous)
+{
+   boost::shared_ptr<LoggingCore> c =
+      boost::make_shared<LoggingCore>();
+   boost::shared_ptr<CollectingSink> sink =
+      boost::make_shared<CollectingSink>();
+   c->AddSink(sink, SinkModeAsynchronous);
+
+   Logger lgr = c->NewLogger("mylabel");
+   LOG_DEBUG(lgr) << "Immediate " << 1;
+   LOG_DEBUG_DEFERRED(lgr, "Deferred {}") % 2;
+   LOG_DEBUG_DEFERRED(lgr, "Two\nlines");
+   c->RemoveSink(sink, SinkModeAsynchronous);
+
+   // Deferred entries keep their order relative to immediate ones
+   std::vector<std::string> lines = sink->GetLines();
+   ASSERT_EQ(4u, lines.size());
+   EXPECT_EQ("Immediate 1", lines[0]);
+   EXPECT_EQ("Deferred 2", lines[1]);
+   EXPECT_EQ("Two", lines[2]);
+   EXPECT_EQ("lines", lines[3]);
+}
+
+
+TEST(LoggerTests, DeferredEntriesSynchronous)
+{
+   boost::shared_ptr<LoggingCore> c =
+      boost::make_shared<LoggingCore>();
+   boost::shared_ptr<CollectingSink> sink =
+      boost::make_shared<CollectingSink>();
+   c->AddSink(sink, SinkModeSynchronous);
+
+   Logger lgr = c->NewLogger("mylabel");
+   LOG_INFO_DEFERRED(lgr, "{} = {}") % "x" % 42;
+
+   std::vector<std::string> lines = sink->GetLines();
+   ASSERT_EQ(1u, lines.size());
+   EXPECT_EQ("x = 42", lines[0]);
+}
+
+
+TEST(LoggerTests, DeferredThroughput)
+{
+   boost::shared_ptr<LoggingCore> c =
+      boost::make_shared<LoggingCore>();
+   boost::shared_ptr<CollectingSink> sink =
+      boost::make_shared<CollectingSink>();
+   c->AddSink(sink, SinkModeAsynchronous);
+
+   const unsigned nrEntries = 200000;
+   Logger lgr = c->NewLogger("thread");
+   boost::posix_time::ptime start =
+      boost::posix_time::microsec_clock::universal_time();
+   for (unsigned j = 0; j < nrEntries; ++j)
+      LOG_DEBUG_DEFERRED(lgr, "{} {}") % 0 % j;
+   boost::posix_time::time_duration elapsed =
+      boost::posix_time::microsec_clock::universal_time() - start;
+   c->RemoveSink(sink, SinkModeAsynchronous);
+   EXPECT_EQ(nrEntries, sink->GetLines().size());
+
+   // Time spent in the calling thread; recorded in the test report
+   // (--gtest_output=xml) rather than checked
+   RecordProperty("ElapsedUs",
+         static_cast<int>(elapsed.total_microseconds()));
+}
+
+
+static bool FileExists(const std::string& filename)
+{
+   return std::ifstream(filename.c_str()).is_open();
+}
+
+
+static std::string RotatingTestSegment(unsigned n)
+{
+   return "LoggerTests-rotating." + boost::lexical_cast<std::string>(n) +
+      ".log";
+}
+
+
+// Log nrEntries to a rotating file with a 1000-byte limit; return the number
+// of segment files created (numbered from 1).
+static unsigned LogToRotatingFile(const std::string& filename,
+      unsigned nrEntries, std::size_t maxOldFiles)
+{
+   for (unsigned i = 1; FileExists(RotatingTestSegment(i)); ++i)
+      std::remove(RotatingTestSegment(i).c_str());
+
+   boost::shared_ptr<LoggingCore> c =
+      boost::make_shared<LoggingCore>();
+   boost::shared_ptr<RotatingFileLogSink> sink =
+      boost::make_shared<RotatingFileLogSink>(filename, false, 1000,
+            boost::posix_time::time_duration(), maxOldFiles);
+   EXPECT_EQ(RotatingTestSegment(1), sink->NextSegmentFilename());
+   c->AddSink(sink, SinkModeSynchronous);
+
+   // Each entry is a batch for a synchronous sink
+   Logger lgr = c->NewLogger("rotating");
+   for (unsigned i = 0; i < nrEntries; ++i)
+      LOG_INFO(lgr) << "Entry number " << i;
+
+   const std::string next = sink->NextSegmentFilename();
+   c->RemoveSink(sink, SinkModeSynchronous);
+   sink.reset(); // Close the file
+
+   unsigned nrSegments = 0;
+   while (RotatingTestSegment(nrSegments + 1) != next)
+      ++nrSegments;
+   return nrSegments;
+}
+
+
+static unsigned CountLinesInFile(const std::string& filename)
+{
+   std::ifstream file(filename.c_str());
+   unsigned count = 0;
+   std::string line;
+   while (std::getline(file, line))
+      ++count;
+   return count;
+}
+
+
+TEST(LoggerTests, RotatingFileSinkKeepsAllEntries)
+{
+   const std::string filename = "LoggerTests-rotating.log";
+   const unsigned nrEntries = 100;
+   unsigned nrSegments = LogToRotatingFile(filename, nrEntries, 0);
+   EXPECT_GT(nrSegments, 2u);
+
+   unsigned total = CountLinesInFile(filename);
+   for (unsigned i = 1; i <= nrSegments; ++i)
+   {
+      std::ifstream segment(RotatingTestSegment(i).c_str(),
+            std::ios_base::ate);
+      ASSERT_TRUE(segment.is_open());
+      EXPECT_GE(static_cast<std::streamoff>(segment.tellg()), 1000);
+      EXPECT_LT(static_cast<std::streamoff>(segment.tellg()), 1200);
+      segment.close();
+      total += CountLinesInFile(RotatingTestSegment(i));
+      std::remove(RotatingTestSegment(i).c_str());
+   }
+   EXPECT_EQ(nrEntries, total);
+   std::remove(filename.c_str());
+}
+
+
+TEST(LoggerTests, RotatingFileSinkDeletesOldFiles)
+{
+   const std::string filename = "LoggerTests-rotating.log";
+   unsigned nrSegments = LogToRotatingFile(filename, 100, 2);
+   ASSERT_GT(nrSegments, 2u);
+
+   for (unsigned i = 1; i <= nrSegments - 2; ++i)
+      EXPECT_FALSE(FileExists(RotatingTestSegment(i)));
+   EXPECT_TRUE(FileExists(RotatingTestSegment(nrSegments - 1)));
+   EXPECT_TRUE(FileExists(RotatingTestSegment(nrSegments)));
+
+   std::remove(RotatingTestSegment(nrSegments - 1).c_str());
+   std::remove(RotatingTestSegment(nrSegments).c_str());
+   std::remove(filename.c_str());
+}
+
+
+TEST(LoggerTests, RotatingFileSinkContinuesAfterExistingFiles)
+{
+   // Segments left by an earlier session that pruned the ones before them
+   const std::string filename = "LoggerTests-rotating.log";
+   std::ofstream(RotatingTestSegment(5).c_str()) << "old\n";
+   std::ofstream(RotatingTestSegment(6).c_str()) << "old\n";
+   std::ofstream(filename.c_str()) << "previous session\n";
+
+   boost::shared_ptr<LoggingCore> c =
+      boost::make_shared<LoggingCore>();
+   boost::shared_ptr<RotatingFileLogSink> sink =
+      boost::make_shared<RotatingFileLogSink>(filename, true, 1000,
+            boost::posix_time::time_duration(), 2);
+   EXPECT_EQ(RotatingTestSegment(7), sink->NextSegmentFilename());
+   c->AddSink(sink, SinkModeSynchronous);
+
+   Logger lgr = c->NewLogger("rotating");
+   for (unsigned i = 0; i < 20; ++i)
+      LOG_INFO(lgr) << "Entry number " << i;
+   EXPECT_EQ(RotatingTestSegment(8), sink->NextSegmentFilename());
+   c->RemoveSink(sink, SinkModeSynchronous);
+   sink.reset();
+
+   // The oldest segment is pruned; the appended file was rotated intact
+   EXPECT_FALSE(FileExists(RotatingTestSegment(5)));
+   EXPECT_TRUE(FileExists(RotatingTestSegment(6)));
+   std::ifstream segment(RotatingTestSegment(7).c_str());
+   std::string firstLine;
+   std::getline(segment, firstLine);
+   EXPECT_EQ("previous session", firstLine);
+   segment.close();
+
+   std::remove(RotatingTestSegment(6).c_str());
+   std::remove(RotatingTestSegment(7).c_str());
+   std::remove(filename.c_str());
+}
+
+
 int main(int argc, char **argv)
 {
    ::testing::InitGoogleTest(&argc, argv);
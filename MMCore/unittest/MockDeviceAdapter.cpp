@@ -0,0 +1,809 @@
+// Minimal in-memory device adapter used by the MMCore unit tests and
+// benchmarks. Built as a loadable module (libmmgr_dal_MockDeviceAdapter) so
+// that tests exercise the same loading path as real device adapters.
+
+#include "../../MMDevice/DeviceBase.h"
+#include "../../MMDevice/ModuleInterface.h"
+
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+   const char* const g_MockGenericName = "MockGeneric";
+   const char* const g_MockSequencerName = "MockSequencer";
+   const char* const g_MockShutterName = "MockShutter";
+   const char* const g_MockCameraName = "MockCamera";
+   const char* const g_MockStageName = "MockStage";
+   const char* const g_MockXYStageName = "MockXYStage";
+   const char* const g_MockSLMName = "MockSLM";
+   const char* const g_MockGalvoName = "MockGalvo";
+} // anonymous namespace
+
+
+// A generic device with a free-form string property and a sequenceable float
+// property, both backed by member variables. The float property ends up at
+// the last value of its sequence when the sequence is stopped. Numeric
+// sequences are loaded as numbers.
+class MockGeneric : public CGenericBase<MockGeneric>
+{
+   std::string value_;
+   double number_;
+   std::vector<double> numberSequence_;
+   long numberSequenceStarts_;
+
+public:
+   MockGeneric() : value_("0"), number_(0.0), numberSequenceStarts_(0) {}
+
+   int Initialize()
+   {
+      CreateProperty("Value", value_.c_str(), MM::String, false,
+            new CPropertyAction(this, &MockGeneric::OnValue));
+      CreateProperty("Number", "0.0", MM::Float, false,
+            new CPropertyAction(this, &MockGeneric::OnNumber));
+      SetPropertyLimits("Number", -1000.0, 1000.0);
+      CreateProperty("NumberSequenceStarts", "0", MM::Integer, true,
+            new CPropertyAction(this, &MockGeneric::OnNumberSequenceStarts));
+      return DEVICE_OK;
+   }
+
+   int Shutdown() { return DEVICE_OK; }
+   void GetName(char* name) const
+   { CDeviceUtils::CopyLimitedString(name, g_MockGenericName); }
+   bool Busy() { return false; }
+
+   int LoadNumericPropertySequence(const char* name, const double* values,
+         unsigned long nrValues)
+   {
+      MM::Property* pProp;
+      int ret = GetSequenceableProperty(&pProp, name);
+      if (ret != DEVICE_OK)
+         return ret;
+      ret = pProp->LoadNumericSequence(values, nrValues);
+      if (ret != DEVICE_OK)
+         return ret;
+      return pProp->SendSequence();
+   }
+
+   int OnValue(MM::PropertyBase* pProp, MM::ActionType eAct)
+   {
+      if (eAct == MM::BeforeGet)
+         pProp->Set(value_.c_str());
+      else if (eAct == MM::AfterSet)
+         pProp->Get(value_);
+      return DEVICE_OK;
+   }
+
+   int OnNumber(MM::PropertyBase* pProp, MM::ActionType eAct)
+   {
+      if (eAct == MM::BeforeGet)
+         pProp->Set(number_);
+      else if (eAct == MM::AfterSet)
+         pProp->Get(number_);
+      else if (eAct == MM::IsSequenceable)
+         pProp->SetSequenceable(100);
+      else if (eAct == MM::AfterLoadSequence)
+         numberSequence_ = pProp->GetNumericSequence();
+      else if (eAct == MM::StartSequence)
+         ++numberSequenceStarts_;
+      else if (eAct == MM::StopSequence && !numberSequence_.empty())
+         number_ = numberSequence_.back();
+      return DEVICE_OK;
+   }
+
+   int OnNumberSequenceStarts(MM::PropertyBase* pProp, MM::ActionType eAct)
+   {
+      if (eAct == MM::BeforeGet)
+         pProp->Set(numberSequenceStarts_);
+      return DEVICE_OK;
+   }
+};
+
+
+// A generic device whose "Volts" property is sequenced by overriding the
+// per-value sequence functions, as adapters written before the bulk sequence
+// load do (the property itself is not marked sequenceable). The loaded
+// sequence can be read back from the read-only "Sequence" property.
+class MockSequencer : public CGenericBase<MockSequencer>
+{
+   double volts_;
+   std::vector<std::string> pending_;
+   std::string sequence_;
+
+public:
+   MockSequencer() : volts_(0.0) {}
+
+   int Initialize()
+   {
+      CreateProperty("Volts", "0.0", MM::Float, false,
+            new CPropertyAction(this, &MockSequencer::OnVolts));
+      SetPropertyLimits("Volts", 0.0, 10.0);
+      CreateProperty("Sequence", "", MM::String, true,
+            new CPropertyAction(this, &MockSequencer::OnSequence));
+      return DEVICE_OK;
+   }
+
+   int Shutdown() { return DEVICE_OK; }
+   void GetName(char* name) const
+   { CDeviceUtils::CopyLimitedString(name, g_MockSequencerName); }
+   bool Busy() { return false; }
+
+   int IsPropertySequenceable(const char* name, bool& sequenceable) const
+   {
+      sequenceable = (strcmp(name, "Volts") == 0);
+      return DEVICE_OK;
+   }
+
+   int GetPropertySequenceMaxLength(const char* name, long& nrEvents) const
+   {
+      if (strcmp(name, "Volts") != 0)
+         return DEVICE_PROPERTY_NOT_SEQUENCEABLE;
+      nrEvents = 10;
+      return DEVICE_OK;
+   }
+
+   int StartPropertySequence(const char*) { return DEVICE_OK; }
+   int StopPropertySequence(const char*) { return DEVICE_OK; }
+
+   int ClearPropertySequence(const char* name)
+   {
+      if (strcmp(name, "Volts") != 0)
+         return DEVICE_PROPERTY_NOT_SEQUENCEABLE;
+      pending_.clear();
+      return DEVICE_OK;
+   }
+
+   int AddToPropertySequence(const char* name, const char* value)
+   {
+      if (strcmp(name, "Volts") != 0)
+         return DEVICE_PROPERTY_NOT_SEQUENCEABLE;
+      if (pending_.size() >= 10)
+         return DEVICE_SEQUENCE_TOO_LARGE;
+      pending_.push_back(value);
+      return DEVICE_OK;
+   }
+
+   int SendPropertySequence(const char* name)
+   {
+      if (strcmp(name, "Volts") != 0)
+         return DEVICE_PROPERTY_NOT_SEQUENCEABLE;
+      sequence_.clear();
+      for (std::vector<std::string>::const_iterator it = pending_.begin();
+            it != pending_.end(); ++it)
+      {
+         if (it != pending_.begin())
+            sequence_ += ",";
+         sequence_ += *it;
+      }
+      return DEVICE_OK;
+   }
+
+   int OnVolts(MM::PropertyBase* pProp, MM::ActionType eAct)
+   {
+      if (eAct == MM::BeforeGet)
+         pProp->Set(volts_);
+      else if (eAct == MM::AfterSet)
+         pProp->Get(volts_);
+      return DEVICE_OK;
+   }
+
+   int OnSequence(MM::PropertyBase* pProp, MM::ActionType eAct)
+   {
+      if (eAct == MM::BeforeGet)
+         pProp->Set(sequence_.c_str());
+      return DEVICE_OK;
+   }
+};
+
+
+class MockShutter : public CShutterBase<MockShutter>
+{
+   bool open_;
+
+public:
+   MockShutter() : open_(false) {}
+
+   int Initialize()
+   {
+      CreateProperty(MM::g_Keyword_State, "0", MM::Integer, false,
+            new CPropertyAction(this, &MockShutter::OnState));
+      AddAllowedValue(MM::g_Keyword_State, "0");
+      AddAllowedValue(MM::g_Keyword_State, "1");
+      return DEVICE_OK;
+   }
+
+   int Shutdown() { return DEVICE_OK; }
+   void GetName(char* name) const
+   { CDeviceUtils::CopyLimitedString(name, g_MockShutterName); }
+   bool Busy() { return false; }
+
+   int SetOpen(bool open) { open_ = open; return DEVICE_OK; }
+   int GetOpen(bool& open) { open = open_; return DEVICE_OK; }
+   int Fire(double) { return DEVICE_UNSUPPORTED_COMMAND; }
+
+   int OnState(MM::PropertyBase* pProp, MM::ActionType eAct)
+   {
+      if (eAct == MM::BeforeGet)
+         pProp->Set(open_ ? 1L : 0L);
+      else if (eAct == MM::AfterSet)
+      {
+         long state;
+         pProp->Get(state);
+         open_ = (state != 0);
+      }
+      return DEVICE_OK;
+   }
+};
+
+
+// A 16-bit camera whose pixels all hold the number of images snapped so far
+// (starting at 1). With Channels set to 2, the pixels of the second channel
+// hold that number plus 1000.
+class MockCamera : public CCameraBase<MockCamera>
+{
+   static const unsigned width_ = 16;
+   static const unsigned height_ = 8;
+   static const unsigned maxChannels_ = 2;
+   unsigned short image_[maxChannels_][width_ * height_];
+   unsigned short nrSnapped_;
+   double exposureMs_;
+   double readoutMs_;
+   long nrChannels_;
+   bool insertChannelsSeparately_;
+
+public:
+   MockCamera() :
+      nrSnapped_(0), exposureMs_(10.0), readoutMs_(0.0), nrChannels_(1),
+      insertChannelsSeparately_(false)
+   { std::memset(image_, 0, sizeof(image_)); }
+
+   int Initialize()
+   {
+      CreateProperty("ReadoutTimeMs", "0.0", MM::Float, false,
+            new CPropertyAction(this, &MockCamera::OnReadoutTimeMs));
+      CreateProperty("Channels", "1", MM::Integer, false,
+            new CPropertyAction(this, &MockCamera::OnChannels));
+      SetPropertyLimits("Channels", 1, maxChannels_);
+      CreateProperty("InsertChannelsSeparately", "No", MM::String, false,
+            new CPropertyAction(this, &MockCamera::OnInsertChannelsSeparately));
+      AddAllowedValue("InsertChannelsSeparately", "No");
+      AddAllowedValue("InsertChannelsSeparately", "Yes");
+      return DEVICE_OK;
+   }
+   int Shutdown() { return DEVICE_OK; }
+   void GetName(char* name) const
+   { CDeviceUtils::CopyLimitedString(name, g_MockCameraName); }
+
+   // The exposure takes no time; the readout takes ReadoutTimeMs, after the
+   // end of the exposure has been signaled
+   int SnapImage()
+   {
+      OnExposureFinished();
+      if (readoutMs_ > 0.0)
+         CDeviceUtils::SleepMs(static_cast<long>(readoutMs_));
+      ++nrSnapped_;
+      for (unsigned ch = 0; ch < maxChannels_; ++ch)
+         for (unsigned i = 0; i < width_ * height_; ++i)
+            image_[ch][i] = static_cast<unsigned short>(nrSnapped_ + 1000 * ch);
+      return DEVICE_OK;
+   }
+   const unsigned char* GetImageBuffer()
+   { return reinterpret_cast<const unsigned char*>(image_[0]); }
+   const unsigned char* GetImageBuffer(unsigned channel)
+   {
+      if (channel >= static_cast<unsigned>(nrChannels_))
+         return 0;
+      return reinterpret_cast<const unsigned char*>(image_[channel]);
+   }
+   unsigned GetNumberOfChannels() const
+   { return static_cast<unsigned>(nrChannels_); }
+   long GetImageBufferSize() const { return sizeof(image_[0]); }
+   unsigned GetImageWidth() const { return width_; }
+   unsigned GetImageHeight() const { return height_; }
+   unsigned GetImageBytesPerPixel() const { return 2; }
+   unsigned GetBitDepth() const { return 16; }
+   int GetBinning() const { return 1; }
+   int SetBinning(int) { return DEVICE_OK; }
+   void SetExposure(double exposureMs) { exposureMs_ = exposureMs; }
+   double GetExposure() const { return exposureMs_; }
+   int SetROI(unsigned, unsigned, unsigned, unsigned)
+   { return DEVICE_UNSUPPORTED_COMMAND; }
+   int GetROI(unsigned& x, unsigned& y, unsigned& xSize, unsigned& ySize)
+   { x = y = 0; xSize = width_; ySize = height_; return DEVICE_OK; }
+   int ClearROI() { return DEVICE_OK; }
+   int IsExposureSequenceable(bool& isSequenceable) const
+   { isSequenceable = false; return DEVICE_OK; }
+
+   // During sequence acquisition, the channels are inserted together, or
+   // else one at a time, last channel first, each with its channel index
+   int InsertImage()
+   {
+      if (nrChannels_ == 1)
+         return CCameraBase<MockCamera>::InsertImage();
+      if (!insertChannelsSeparately_)
+         return GetCoreCallback()->InsertMultiChannel(this, GetImageBuffer(),
+               static_cast<unsigned>(nrChannels_), width_, height_, 2);
+      for (long ch = nrChannels_ - 1; ch >= 0; --ch)
+      {
+         Metadata md;
+         md.PutImageTag(MM::g_Keyword_CameraChannelIndex, ch);
+         int ret = GetCoreCallback()->InsertImage(this,
+               GetImageBuffer(static_cast<unsigned>(ch)), width_, height_, 2,
+               &md);
+         if (ret != DEVICE_OK)
+            return ret;
+      }
+      return DEVICE_OK;
+   }
+
+   int OnReadoutTimeMs(MM::PropertyBase* pProp, MM::ActionType eAct)
+   {
+      if (eAct == MM::BeforeGet)
+         pProp->Set(readoutMs_);
+      else if (eAct == MM::AfterSet)
+         pProp->Get(readoutMs_);
+      return DEVICE_OK;
+   }
+
+   int OnChannels(MM::PropertyBase* pProp, MM::ActionType eAct)
+   {
+      if (eAct == MM::BeforeGet)
+         pProp->Set(nrChannels_);
+      else if (eAct == MM::AfterSet)
+         pProp->Get(nrChannels_);
+      return DEVICE_OK;
+   }
+
+   int OnInsertChannelsSeparately(MM::PropertyBase* pProp,
+         MM::ActionType eAct)
+   {
+      if (eAct == MM::BeforeGet)
+         pProp->Set(insertChannelsSeparately_ ? "Yes" : "No");
+      else if (eAct == MM::AfterSet)
+      {
+         std::string value;
+         pProp->Get(value);
+         insertChannelsSeparately_ = (value == "Yes");
+      }
+      return DEVICE_OK;
+   }
+};
+
+
+// A focus stage that reaches its target immediately. It accepts position
+// sequences of up to 10000 positions, and ends up at the last position when
+// the sequence is stopped.
+class MockStage : public CStageBase<MockStage>
+{
+   double positionUm_;
+   std::vector<double> sequence_;
+   long sequenceStarts_;
+
+public:
+   MockStage() : positionUm_(0.0), sequenceStarts_(0) {}
+
+   int Initialize()
+   {
+      CreateProperty("SequenceStarts", "0", MM::Integer, true,
+            new CPropertyAction(this, &MockStage::OnSequenceStarts));
+      return DEVICE_OK;
+   }
+   int Shutdown() { return DEVICE_OK; }
+   void GetName(char* name) const
+   { CDeviceUtils::CopyLimitedString(name, g_MockStageName); }
+   bool Busy() { return false; }
+
+   int SetPositionUm(double pos) { positionUm_ = pos; return DEVICE_OK; }
+   int GetPositionUm(double& pos) { pos = positionUm_; return DEVICE_OK; }
+   int SetPositionSteps(long steps)
+   { positionUm_ = 0.1 * steps; return DEVICE_OK; }
+   int GetPositionSteps(long& steps)
+   { steps = static_cast<long>(positionUm_ / 0.1); return DEVICE_OK; }
+   int SetOrigin() { return DEVICE_OK; }
+   int GetLimits(double& lower, double& upper)
+   { lower = -10000.0; upper = 10000.0; return DEVICE_OK; }
+   int IsStageSequenceable(bool& isSequenceable) const
+   { isSequenceable = true; return DEVICE_OK; }
+   bool IsContinuousFocusDrive() const { return false; }
+
+   int GetStageSequenceMaxLength(long& nrEvents) const
+   { nrEvents = 10000; return DEVICE_OK; }
+   int StartStageSequence() { ++sequenceStarts_; return DEVICE_OK; }
+   int StopStageSequence()
+   {
+      if (!sequence_.empty())
+         positionUm_ = sequence_.back();
+      return DEVICE_OK;
+   }
+   int ClearStageSequence() { sequence_.clear(); return DEVICE_OK; }
+   int AddToStageSequence(double position)
+   { sequence_.push_back(position); return DEVICE_OK; }
+   int SendStageSequence() { return DEVICE_OK; }
+
+   int OnSequenceStarts(MM::PropertyBase* pProp, MM::ActionType eAct)
+   {
+      if (eAct == MM::BeforeGet)
+         pProp->Set(sequenceStarts_);
+      return DEVICE_OK;
+   }
+};
+
+
+// An XY stage that reaches its target immediately.
+class MockXYStage : public CXYStageBase<MockXYStage>
+{
+   long xSteps_;
+   long ySteps_;
+
+public:
+   MockXYStage() : xSteps_(0), ySteps_(0) {}
+
+   int Initialize() { return DEVICE_OK; }
+   int Shutdown() { return DEVICE_OK; }
+   void GetName(char* name) const
+   { CDeviceUtils::CopyLimitedString(name, g_MockXYStageName); }
+   bool Busy() { return false; }
+
+   int SetPositionSteps(long x, long y)
+   { xSteps_ = x; ySteps_ = y; return DEVICE_OK; }
+   int GetPositionSteps(long& x, long& y)
+   { x = xSteps_; y = ySteps_; return DEVICE_OK; }
+   int Home() { return DEVICE_OK; }
+   int Stop() { return DEVICE_OK; }
+   int SetOrigin() { return DEVICE_OK; }
+   int GetLimitsUm(double& xMin, double& xMax, double& yMin, double& yMax)
+   {
+      xMin = yMin = -10000.0;
+      xMax = yMax = 10000.0;
+      return DEVICE_OK;
+   }
+   int GetStepLimits(long& xMin, long& xMax, long& yMin, long& yMax)
+   {
+      xMin = yMin = -100000;
+      xMax = yMax = 100000;
+      return DEVICE_OK;
+   }
+   double GetStepSizeXUm() { return 0.1; }
+   double GetStepSizeYUm() { return 0.1; }
+   int IsXYStageSequenceable(bool& isSequenceable) const
+   { isSequenceable = false; return DEVICE_OK; }
+};
+
+
+// A 16x8 8-bit SLM that keeps the first pixel of the current image. It
+// supports sequences and, unless the "Patterns" property is set to 0,
+// patterns. Raw images (as opposed to patterns) that it has been given are
+// counted.
+class MockSLM : public CSLMBase<MockSLM>
+{
+   bool supportsPatterns_;
+   std::map<long, const unsigned char*> patterns_;
+   unsigned char firstPixel_;
+   std::vector<unsigned char> sequence_;
+   long imagesReceived_;
+
+public:
+   MockSLM() :
+      supportsPatterns_(true), firstPixel_(0), imagesReceived_(0)
+   {}
+
+   int Initialize()
+   {
+      CreateProperty("Patterns", "1", MM::Integer, false,
+            new CPropertyAction(this, &MockSLM::OnPatterns));
+      AddAllowedValue("Patterns", "0");
+      AddAllowedValue("Patterns", "1");
+      CreateProperty("PreparedPatterns", "0", MM::Integer, true,
+            new CPropertyAction(this, &MockSLM::OnPreparedPatterns));
+      CreateProperty("ImagesReceived", "0", MM::Integer, true,
+            new CPropertyAction(this, &MockSLM::OnImagesReceived));
+      CreateProperty("FirstPixel", "0", MM::Integer, true,
+            new CPropertyAction(this, &MockSLM::OnFirstPixel));
+      CreateProperty("SequenceFirstPixels", "", MM::String, true,
+            new CPropertyAction(this, &MockSLM::OnSequenceFirstPixels));
+      return DEVICE_OK;
+   }
+   int Shutdown() { return DEVICE_OK; }
+   void GetName(char* name) const
+   { CDeviceUtils::CopyLimitedString(name, g_MockSLMName); }
+   bool Busy() { return false; }
+
+   unsigned GetWidth() { return 16; }
+   unsigned GetHeight() { return 8; }
+   unsigned GetNumberOfComponents() { return 1; }
+   unsigned GetBytesPerPixel() { return 1; }
+
+   int SetImage(unsigned char* pixels)
+   { ++imagesReceived_; firstPixel_ = pixels[0]; return DEVICE_OK; }
+   int SetImage(unsigned int*) { return DEVICE_UNSUPPORTED_COMMAND; }
+   int DisplayImage() { return DEVICE_OK; }
+   int SetPixelsTo(unsigned char intensity)
+   { firstPixel_ = intensity; return DEVICE_OK; }
+   int SetPixelsTo(unsigned char, unsigned char, unsigned char)
+   { return DEVICE_UNSUPPORTED_COMMAND; }
+   int SetExposure(double) { return DEVICE_OK; }
+   double GetExposure() { return 0.0; }
+
+   int IsSLMSequenceable(bool& isSequenceable) const
+   { isSequenceable = true; return DEVICE_OK; }
+   int GetSLMSequenceMaxLength(long& nrEvents) const
+   { nrEvents = 1000; return DEVICE_OK; }
+   int StartSLMSequence() { return DEVICE_OK; }
+   int StopSLMSequence() { return DEVICE_OK; }
+   int ClearSLMSequence() { sequence_.clear(); return DEVICE_OK; }
+   int AddToSLMSequence(const unsigned char* const pixels)
+   { ++imagesReceived_; sequence_.push_back(pixels[0]); return DEVICE_OK; }
+   int AddToSLMSequence(const unsigned int* const)
+   { return DEVICE_UNSUPPORTED_COMMAND; }
+   int SendSLMSequence() { return DEVICE_OK; }
+
+   int PrepareSLMPattern(long patternId, const unsigned char* pixels)
+   {
+      if (!supportsPatterns_)
+         return DEVICE_UNSUPPORTED_COMMAND;
+      patterns_[patternId] = pixels;
+      return DEVICE_OK;
+   }
+   int ReleaseSLMPattern(long patternId)
+   {
+      return patterns_.erase(patternId) ? DEVICE_OK : DEVICE_ERR;
+   }
+   int SetSLMPattern(long patternId)
+   {
+      std::map<long, const unsigned char*>::const_iterator it =
+         patterns_.find(patternId);
+      if (it == patterns_.end())
+         return DEVICE_ERR;
+      firstPixel_ = it->second[0];
+      return DEVICE_OK;
+   }
+   int AddPatternToSLMSequence(long patternId)
+   {
+      std::map<long, const unsigned char*>::const_iterator it =
+         patterns_.find(patternId);
+      if (it == patterns_.end())
+         return DEVICE_ERR;
+      sequence_.push_back(it->second[0]);
+      return DEVICE_OK;
+   }
+
+   int OnPatterns(MM::PropertyBase* pProp, MM::ActionType eAct)
+   {
+      if (eAct == MM::BeforeGet)
+         pProp->Set(supportsPatterns_ ? 1L : 0L);
+      else if (eAct == MM::AfterSet)
+      {
+         long patterns;
+         pProp->Get(patterns);
+         supportsPatterns_ = (patterns != 0);
+      }
+      return DEVICE_OK;
+   }
+
+   int OnPreparedPatterns(MM::PropertyBase* pProp, MM::ActionType eAct)
+   {
+      if (eAct == MM::BeforeGet)
+         pProp->Set(static_cast<long>(patterns_.size()));
+      return DEVICE_OK;
+   }
+
+   int OnImagesReceived(MM::PropertyBase* pProp, MM::ActionType eAct)
+   {
+      if (eAct == MM::BeforeGet)
+         pProp->Set(imagesReceived_);
+      return DEVICE_OK;
+   }
+
+   int OnFirstPixel(MM::PropertyBase* pProp, MM::ActionType eAct)
+   {
+      if (eAct == MM::BeforeGet)
+         pProp->Set(static_cast<long>(firstPixel_));
+      return DEVICE_OK;
+   }
+
+   // Comma-separated
+   int OnSequenceFirstPixels(MM::PropertyBase* pProp, MM::ActionType eAct)
+   {
+      if (eAct == MM::BeforeGet)
+      {
+         std::string pixels;
+         for (size_t i = 0; i < sequence_.size(); ++i)
+         {
+            if (i > 0)
+               pixels += ",";
+            pixels += CDeviceUtils::ConvertToString(
+                  static_cast<long>(sequence_[i]));
+         }
+         pProp->Set(pixels.c_str());
+      }
+      return DEVICE_OK;
+   }
+};
+
+
+// A galvo that records the polygons or scan path loaded into it. Scan paths
+// are supported unless the "ScanPaths" property is set to 0.
+class MockGalvo : public CGalvoBase<MockGalvo>
+{
+   bool supportsScanPaths_;
+   double x_, y_;
+   double spotInterval_us_;
+   std::map<int, std::vector<double> > polygonXs_;
+   std::vector<double> pathXs_;
+   std::vector<double> pathDwellTimes_us_;
+
+public:
+   MockGalvo() :
+      supportsScanPaths_(true), x_(0.0), y_(0.0), spotInterval_us_(0.0)
+   {}
+
+   int Initialize()
+   {
+      CreateProperty("ScanPaths", "1", MM::Integer, false,
+            new CPropertyAction(this, &MockGalvo::OnScanPaths));
+      AddAllowedValue("ScanPaths", "0");
+      AddAllowedValue("ScanPaths", "1");
+      CreateProperty("Polygons", "0", MM::Integer, true,
+            new CPropertyAction(this, &MockGalvo::OnPolygons));
+      CreateProperty("PolygonFirstXs", "", MM::String, true,
+            new CPropertyAction(this, &MockGalvo::OnPolygonFirstXs));
+      CreateProperty("SpotInterval", "0", MM::Float, true,
+            new CPropertyAction(this, &MockGalvo::OnSpotInterval));
+      CreateProperty("ScanPathPoints", "0", MM::Integer, true,
+            new CPropertyAction(this, &MockGalvo::OnScanPathPoints));
+      CreateProperty("ScanPathTime", "0", MM::Float, true,
+            new CPropertyAction(this, &MockGalvo::OnScanPathTime));
+      return DEVICE_OK;
+   }
+   int Shutdown() { return DEVICE_OK; }
+   void GetName(char* name) const
+   { CDeviceUtils::CopyLimitedString(name, g_MockGalvoName); }
+   bool Busy() { return false; }
+
+   int PointAndFire(double x, double y, double)
+   { x_ = x; y_ = y; return DEVICE_OK; }
+   int SetSpotInterval(double pulseInterval_us)
+   { spotInterval_us_ = pulseInterval_us; return DEVICE_OK; }
+   int SetPosition(double x, double y) { x_ = x; y_ = y; return DEVICE_OK; }
+   int GetPosition(double& x, double& y) { x = x_; y = y_; return DEVICE_OK; }
+   int SetIlluminationState(bool) { return DEVICE_OK; }
+   double GetXRange() { return 100.0; }
+   double GetYRange() { return 100.0; }
+   int AddPolygonVertex(int polygonIndex, double x, double)
+   { polygonXs_[polygonIndex].push_back(x); return DEVICE_OK; }
+   int DeletePolygons()
+   {
+      polygonXs_.clear();
+      pathXs_.clear();
+      pathDwellTimes_us_.clear();
+      return DEVICE_OK;
+   }
+   int RunSequence() { return DEVICE_OK; }
+   int LoadPolygons() { return DEVICE_OK; }
+   int SetPolygonRepetitions(int) { return DEVICE_OK; }
+   int RunPolygons() { return DEVICE_OK; }
+   int StopSequence() { return DEVICE_OK; }
+   int GetChannel(char* channelName)
+   { CDeviceUtils::CopyLimitedString(channelName, ""); return DEVICE_OK; }
+
+   int LoadScanPath(const double* xs, const double*,
+         const double* dwellTimes_us, long nrPoints)
+   {
+      if (!supportsScanPaths_)
+         return DEVICE_UNSUPPORTED_COMMAND;
+      polygonXs_.clear();
+      pathXs_.assign(xs, xs + nrPoints);
+      pathDwellTimes_us_.assign(dwellTimes_us, dwellTimes_us + nrPoints);
+      return DEVICE_OK;
+   }
+
+   int OnScanPaths(MM::PropertyBase* pProp, MM::ActionType eAct)
+   {
+      if (eAct == MM::BeforeGet)
+         pProp->Set(supportsScanPaths_ ? 1L : 0L);
+      else if (eAct == MM::AfterSet)
+      {
+         long scanPaths;
+         pProp->Get(scanPaths);
+         supportsScanPaths_ = (scanPaths != 0);
+      }
+      return DEVICE_OK;
+   }
+
+   int OnPolygons(MM::PropertyBase* pProp, MM::ActionType eAct)
+   {
+      if (eAct == MM::BeforeGet)
+         pProp->Set(static_cast<long>(polygonXs_.size()));
+      return DEVICE_OK;
+   }
+
+   // Comma-separated, in polygon index order
+   int OnPolygonFirstXs(MM::PropertyBase* pProp, MM::ActionType eAct)
+   {
+      if (eAct == MM::BeforeGet)
+      {
+         std::string xs;
+         for (std::map<int, std::vector<double> >::const_iterator it =
+               polygonXs_.begin(); it != polygonXs_.end(); ++it)
+         {
+            if (!xs.empty())
+               xs += ",";
+            xs += CDeviceUtils::ConvertToString(it->second[0]);
+         }
+         pProp->Set(xs.c_str());
+      }
+      return DEVICE_OK;
+   }
+
+   int OnSpotInterval(MM::PropertyBase* pProp, MM::ActionType eAct)
+   {
+      if (eAct == MM::BeforeGet)
+         pProp->Set(spotInterval_us_);
+      return DEVICE_OK;
+   }
+
+   int OnScanPathPoints(MM::PropertyBase* pProp, MM::ActionType eAct)
+   {
+      if (eAct == MM::BeforeGet)
+         pProp->Set(static_cast<long>(pathXs_.size()));
+      return DEVICE_OK;
+   }
+
+   // Sum of the dwell times
+   int OnScanPathTime(MM::PropertyBase* pProp, MM::ActionType eAct)
+   {
+      if (eAct == MM::BeforeGet)
+      {
+         double time_us = 0.0;
+         for (size_t i = 0; i < pathDwellTimes_us_.size(); ++i)
+            time_us += pathDwellTimes_us_[i];
+         pProp->Set(time_us);
+      }
+      return DEVICE_OK;
+   }
+};
+
+
+MODULE_API void InitializeModuleData()
+{
+   RegisterDevice(g_MockGenericName, MM::GenericDevice, "Mock generic device");
+   RegisterDevice(g_MockSequencerName, MM::GenericDevice,
+         "Mock device with per-value property sequencing");
+   RegisterDevice(g_MockShutterName, MM::ShutterDevice, "Mock shutter");
+   RegisterDevice(g_MockCameraName, MM::CameraDevice, "Mock camera");
+   RegisterDevice(g_MockStageName, MM::StageDevice, "Mock focus stage");
+   RegisterDevice(g_MockXYStageName, MM::XYStageDevice, "Mock XY stage");
+   RegisterDevice(g_MockSLMName, MM::SLMDevice, "Mock SLM");
+   RegisterDevice(g_MockGalvoName, MM::GalvoDevice, "Mock galvo");
+}
+
+MODULE_API MM::Device* CreateDevice(const char* deviceName)
+{
+   if (deviceName == 0)
+      return 0;
+   if (strcmp(deviceName, g_MockGenericName) == 0)
+      return new MockGeneric();
+   if (strcmp(deviceName, g_MockSequencerName) == 0)
+      return new MockSequencer();
+   if (strcmp(deviceName, g_MockShutterName) == 0)
+      return new MockShutter();
+   if (strcmp(deviceName, g_MockCameraName) == 0)
+      return new MockCamera();
+   if (strcmp(deviceName, g_MockStageName) == 0)
+      return new MockStage();
+   if (strcmp(deviceName, g_MockXYStageName) == 0)
+      return new MockXYStage();
+   if (strcmp(deviceName, g_MockSLMName) == 0)
+      return new MockSLM();
+   if (strcmp(deviceName, g_MockGalvoName) == 0)
+      return new MockGalvo();
+   return 0;
+}
+
+MODULE_API void DeleteDevice(MM::Device* pDevice)
+{
+   delete pDevice;
+}
@@ -0,0 +1,33 @@
+// Test fixture for tests that load devices from the MockDeviceAdapter module,
+// which is built alongside the tests (in .libs when built with libtool).
+
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "MMCore.h"
+
+#include <string>
+#include <vector>
+
+
+class MockDeviceTest : public ::testing::Test
+{
+protected:
+   CMMCore core_;
+
+   MockDeviceTest()
+   {
+      std::vector<std::string> paths;
+      paths.push_back(".libs");
+      paths.push_back(".");
+      core_.setDeviceAdapterSearchPaths(paths);
+      core_.enableStderrLog(false);
+   }
+
+   // Load a device from the MockDeviceAdapter module
+   void LoadMockDevice(const char* label, const char* deviceName)
+   {
+      core_.loadDevice(label, "MockDeviceAdapter", deviceName);
+   }
+};
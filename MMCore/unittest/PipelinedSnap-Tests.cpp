@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include "MMCore.h"
+#include "MockDeviceFixture.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <string>
+#include <vector>
+
+
+class PipelinedSnapTests : public MockDeviceTest
+{
+protected:
+   virtual void SetUp()
+   {
+      LoadMockDevice("Camera", "MockCamera");
+      LoadMockDevice("Shutter", "MockShutter");
+      core_.initializeAllDevices();
+      core_.setCameraDevice("Camera");
+      core_.setShutterDevice("");
+   }
+
+   long ElapsedMs(boost::posix_time::ptime start)
+   {
+      return static_cast<long>((boost::posix_time::microsec_clock::
+               universal_time() - start).total_milliseconds());
+   }
+
+   unsigned short FirstPixel()
+   {
+      return *static_cast<const unsigned short*>(core_.getImage());
+   }
+};
+
+
+TEST_F(PipelinedSnapTests, ReturnsBeforeReadout)
+{
+   core_.setProperty("Camera", "ReadoutTimeMs", "300");
+   boost::posix_time::ptime start =
+      boost::posix_time::microsec_clock::universal_time();
+   core_.startSnapImage();
+   const long startMs = ElapsedMs(start);
+   EXPECT_LT(startMs, 200);
+
+   EXPECT_EQ(1, FirstPixel());
+   EXPECT_GE(ElapsedMs(start), 290);
+}
+
+
+TEST_F(PipelinedSnapTests, SnapsWaitForPendingReadout)
+{
+   core_.setProperty("Camera", "ReadoutTimeMs", "50");
+   core_.startSnapImage();
+   core_.startSnapImage();
+   core_.waitForSnapImage();
+   EXPECT_EQ(2, FirstPixel());
+
+   core_.startSnapImage();
+   core_.snapImage();
+   EXPECT_EQ(4, FirstPixel());
+
+   // Nothing pending
+   EXPECT_NO_THROW(core_.waitForSnapImage());
+}
+
+
+TEST_F(PipelinedSnapTests, ClosesShutter)
+{
+   // The mock shutter is in the camera's module, so closing it waits for the
+   // readout
+   core_.setShutterDevice("Shutter");
+   core_.startSnapImage();
+   EXPECT_FALSE(core_.getShutterOpen());
+   EXPECT_EQ(1, FirstPixel());
+}
+
+
+TEST_F(PipelinedSnapTests, RequiresCamera)
+{
+   core_.setCameraDevice("");
+   EXPECT_THROW(core_.startSnapImage(), CMMError);
+}
+
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
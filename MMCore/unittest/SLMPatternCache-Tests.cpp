@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+
+#include "MMCore.h"
+#include "MockDeviceFixture.h"
+#include "SLMPatternCache.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using mm::SLMPatternCache;
+
+
+static std::vector<unsigned char> Pattern(std::size_t size, unsigned char value)
+{
+   std::vector<unsigned char> pixels(size, 0);
+   pixels[0] = value;
+   pixels[size - 1] = value;
+   return pixels;
+}
+
+
+TEST(SLMPatternCacheTests, DeduplicatesIdenticalPatterns)
+{
+   SLMPatternCache cache(1001);
+   std::vector<unsigned char> a = Pattern(1001, 1);
+   std::vector<unsigned char> b = Pattern(1001, 2);
+
+   bool added;
+   const long idA = cache.Add(&a[0], added);
+   EXPECT_TRUE(added);
+   const long idB = cache.Add(&b[0], added);
+   EXPECT_TRUE(added);
+   EXPECT_NE(idA, idB);
+
+   std::vector<unsigned char> copyOfA(a);
+   EXPECT_EQ(idA, cache.Add(&copyOfA[0], added));
+   EXPECT_FALSE(added);
+   EXPECT_EQ(2u, cache.GetNumberOfPatterns());
+
+   // Only the last byte differs
+   std::vector<unsigned char> c(a);
+   c[1000] = 3;
+   EXPECT_NE(idA, cache.Add(&c[0], added));
+   EXPECT_TRUE(added);
+}
+
+
+TEST(SLMPatternCacheTests, CopiesIntoAlignedMemory)
+{
+   SLMPatternCache cache(100);
+   std::vector<unsigned char> a = Pattern(100, 7);
+   bool added;
+   const long id = cache.Add(&a[0], added);
+   a[0] = 0;
+
+   const unsigned char* pixels = cache.GetPixels(id);
+   ASSERT_TRUE(pixels != 0);
+   EXPECT_EQ(0u, reinterpret_cast<std::size_t>(pixels) %
+         SLMPatternCache::Alignment);
+   EXPECT_EQ(7, pixels[0]);
+   EXPECT_EQ(7, pixels[99]);
+}
+
+
+TEST(SLMPatternCacheTests, RemovesPatterns)
+{
+   SLMPatternCache cache(64);
+   std::vector<unsigned char> a = Pattern(64, 1);
+   bool added;
+   const long id = cache.Add(&a[0], added);
+   cache.SetPreparedInDevice(id, true);
+   EXPECT_TRUE(cache.IsPreparedInDevice(id));
+
+   EXPECT_TRUE(cache.Remove(id));
+   EXPECT_FALSE(cache.Remove(id));
+   EXPECT_TRUE(cache.GetPixels(id) == 0);
+   EXPECT_FALSE(cache.IsPreparedInDevice(id));
+
+   // Re-adding gives a new id
+   EXPECT_NE(id, cache.Add(&a[0], added));
+   EXPECT_TRUE(added);
+
+   cache.Reset(32);
+   EXPECT_EQ(0u, cache.GetNumberOfPatterns());
+   EXPECT_EQ(32u, cache.GetPatternBytes());
+}
+
+
+TEST(SLMPatternCacheTests, HashDependsOnEveryByte)
+{
+   std::vector<unsigned char> a(37, 0);
+   const boost::uint64_t hash = SLMPatternCache::Hash(&a[0], a.size());
+   for (std::size_t i = 0; i < a.size(); ++i)
+   {
+      std::vector<unsigned char> b(a);
+      b[i] = 1;
+      EXPECT_NE(hash, SLMPatternCache::Hash(&b[0], b.size()));
+   }
+   EXPECT_NE(hash, SLMPatternCache::Hash(&a[0], a.size() - 1));
+}
+
+
+class SLMPatternTests : public MockDeviceTest
+{
+protected:
+   std::size_t patternBytes_;
+
+   virtual void SetUp()
+   {
+      LoadMockDevice("SLM", "MockSLM");
+      core_.initializeAllDevices();
+      patternBytes_ = core_.getSLMWidth("SLM") * core_.getSLMHeight("SLM");
+   }
+
+   long AddPattern(unsigned char value)
+   {
+      std::vector<unsigned char> pixels = Pattern(patternBytes_, value);
+      return core_.addSLMPattern("SLM", &pixels[0]);
+   }
+};
+
+
+TEST_F(SLMPatternTests, SendsEachPatternOnce)
+{
+   const long id1 = AddPattern(1);
+   const long id2 = AddPattern(2);
+   EXPECT_EQ(id1, AddPattern(1));
+   EXPECT_EQ("2", core_.getProperty("SLM", "PreparedPatterns"));
+
+   core_.setSLMPattern("SLM", id2);
+   core_.displaySLMImage("SLM");
+   EXPECT_EQ("2", core_.getProperty("SLM", "FirstPixel"));
+
+   std::vector<long> ids;
+   for (int i = 0; i < 3; ++i)
+   {
+      ids.push_back(id1);
+      ids.push_back(id2);
+   }
+   core_.loadSLMPatternSequence("SLM", ids);
+   EXPECT_EQ("1,2,1,2,1,2", core_.getProperty("SLM", "SequenceFirstPixels"));
+   EXPECT_EQ("0", core_.getProperty("SLM", "ImagesReceived"));
+
+   core_.removeSLMPattern("SLM", id1);
+   EXPECT_EQ("1", core_.getProperty("SLM", "PreparedPatterns"));
+   EXPECT_THROW(core_.setSLMPattern("SLM", id1), CMMError);
+   EXPECT_THROW(core_.loadSLMPatternSequence("SLM", ids), CMMError);
+   // The failed load leaves the device's sequence alone
+   EXPECT_EQ("1,2,1,2,1,2", core_.getProperty("SLM", "SequenceFirstPixels"));
+
+   core_.clearSLMPatterns("SLM");
+   EXPECT_EQ("0", core_.getProperty("SLM", "PreparedPatterns"));
+   EXPECT_TRUE(core_.getSLMPatterns("SLM").empty());
+}
+
+
+TEST_F(SLMPatternTests, FallsBackToImages)
+{
+   core_.setProperty("SLM", "Patterns", "0");
+   const long id1 = AddPattern(1);
+   const long id2 = AddPattern(2);
+   EXPECT_EQ("0", core_.getProperty("SLM", "PreparedPatterns"));
+   EXPECT_EQ(2u, core_.getSLMPatterns("SLM").size());
+
+   core_.setSLMPattern("SLM", id1);
+   EXPECT_EQ("1", core_.getProperty("SLM", "FirstPixel"));
+
+   std::vector<long> ids;
+   ids.push_back(id2);
+   ids.push_back(id1);
+   core_.loadSLMPatternSequence("SLM", ids);
+   EXPECT_EQ("2,1", core_.getProperty("SLM", "SequenceFirstPixels"));
+   EXPECT_EQ("3", core_.getProperty("SLM", "ImagesReceived"));
+
+   EXPECT_NO_THROW(core_.removeSLMPattern("SLM", id1));
+   EXPECT_THROW(core_.removeSLMPattern("SLM", id1), CMMError);
+}
+
+
+TEST_F(SLMPatternTests, RequiresSLM)
+{
+   std::vector<unsigned char> pixels(patternBytes_, 0);
+   EXPECT_THROW(core_.addSLMPattern("NoSuchSLM", &pixels[0]), CMMError);
+   EXPECT_THROW(core_.addSLMPattern("SLM", 0), CMMError);
+   EXPECT_THROW(core_.setSLMPattern("SLM", 0), CMMError);
+   EXPECT_NO_THROW(core_.clearSLMPatterns("SLM"));
+}
+
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+
+#include "MMCore.h"
+#include "MockDeviceFixture.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <limits>
+#include <string>
+#include <vector>
+
+
+class SequenceLoadTests : public MockDeviceTest
+{
+protected:
+   virtual void SetUp()
+   {
+      LoadMockDevice("Z", "MockStage");
+      LoadMockDevice("Generic", "MockGeneric");
+      LoadMockDevice("Sequencer", "MockSequencer");
+      core_.initializeAllDevices();
+   }
+};
+
+
+TEST_F(SequenceLoadTests, LoadsLongStageSequence)
+{
+   const long length = core_.getStageSequenceMaxLength("Z");
+   ASSERT_EQ(10000, length);
+   std::vector<double> positions;
+   for (long i = 0; i < length; ++i)
+      positions.push_back(0.1 * i);
+
+   core_.loadStageSequence("Z", positions);
+   core_.startStageSequence("Z");
+   core_.stopStageSequence("Z");
+   EXPECT_DOUBLE_EQ(positions.back(), core_.getPosition("Z"));
+}
+
+
+TEST_F(SequenceLoadTests, LoadsPropertySequence)
+{
+   const long length = core_.getPropertySequenceMaxLength("Generic", "Number");
+   ASSERT_EQ(100, length);
+   std::vector<std::string> values;
+   for (long i = 0; i < length; ++i)
+      values.push_back(boost::lexical_cast<std::string>(i % 10));
+   EXPECT_NO_THROW(core_.loadPropertySequence("Generic", "Number", values));
+   EXPECT_NO_THROW(core_.startPropertySequence("Generic", "Number"));
+   EXPECT_NO_THROW(core_.stopPropertySequence("Generic", "Number"));
+
+   values.push_back("0");
+   EXPECT_THROW(core_.loadPropertySequence("Generic", "Number", values),
+         CMMError);
+}
+
+
+TEST_F(SequenceLoadTests, LoadsPropertySequenceThroughPerValueFunctions)
+{
+   std::vector<std::string> values;
+   values.push_back("1.5");
+   values.push_back("2");
+   values.push_back("0.25");
+   core_.loadPropertySequence("Sequencer", "Volts", values);
+   EXPECT_EQ("1.5,2,0.25", core_.getProperty("Sequencer", "Sequence"));
+
+   values.assign(11, "1");
+   EXPECT_THROW(core_.loadPropertySequence("Sequencer", "Volts", values),
+         CMMError);
+}
+
+
+TEST_F(SequenceLoadTests, LoadsNumericPropertySequence)
+{
+   std::vector<double> values;
+   for (int i = 0; i < 100; ++i)
+      values.push_back(0.25 * i - 10.0);
+   core_.loadPropertySequence("Generic", "Number", values);
+   core_.startPropertySequence("Generic", "Number");
+   core_.stopPropertySequence("Generic", "Number");
+   EXPECT_EQ("14.7500", core_.getProperty("Generic", "Number"));
+
+   // The device reads string sequences as numbers, too
+   std::vector<std::string> strings(3, "2.5");
+   core_.loadPropertySequence("Generic", "Number", strings);
+   core_.startPropertySequence("Generic", "Number");
+   core_.stopPropertySequence("Generic", "Number");
+   EXPECT_EQ("2.5000", core_.getProperty("Generic", "Number"));
+}
+
+
+TEST_F(SequenceLoadTests, ChecksNumericPropertySequence)
+{
+   std::vector<double> values(100, 1.0);
+   values.push_back(1.0);
+   EXPECT_THROW(core_.loadPropertySequence("Generic", "Number", values),
+         CMMError);
+
+   // Limits are -1000 to 1000
+   values.assign(10, 999.0);
+   values[5] = 1000.5;
+   EXPECT_THROW(core_.loadPropertySequence("Generic", "Number", values),
+         CMMError);
+   values[5] = -1001.0;
+   EXPECT_THROW(core_.loadPropertySequence("Generic", "Number", values),
+         CMMError);
+   values[5] = std::numeric_limits<double>::quiet_NaN();
+   EXPECT_THROW(core_.loadPropertySequence("Generic", "Number", values),
+         CMMError);
+
+   // Only for numeric properties
+   values.assign(1, 1.0);
+   EXPECT_THROW(core_.loadPropertySequence("Generic", "Value", values),
+         CMMError);
+}
+
+
+TEST_F(SequenceLoadTests, LoadsNumericPropertySequenceThroughPerValueFunctions)
+{
+   std::vector<double> values;
+   values.push_back(1.5);
+   values.push_back(2.0);
+   values.push_back(0.1);
+   core_.loadPropertySequence("Sequencer", "Volts", values);
+   EXPECT_EQ("1.5,2,0.1", core_.getProperty("Sequencer", "Sequence"));
+
+   // Limits are 0 to 10
+   values[1] = 10.5;
+   EXPECT_THROW(core_.loadPropertySequence("Sequencer", "Volts", values),
+         CMMError);
+   values.assign(11, 1.0);
+   EXPECT_THROW(core_.loadPropertySequence("Sequencer", "Volts", values),
+         CMMError);
+}
+
+
+TEST_F(SequenceLoadTests, NumericPropertySequenceBenchmark)
+{
+   const int nrLoads = 1000;
+   std::vector<double> values;
+   std::vector<std::string> strings;
+   for (int i = 0; i < 100; ++i)
+   {
+      values.push_back(0.001 * i);
+      strings.push_back(boost::lexical_cast<std::string>(values.back()));
+   }
+
+   boost::posix_time::ptime start =
+      boost::posix_time::microsec_clock::universal_time();
+   for (int i = 0; i < nrLoads; ++i)
+      core_.loadPropertySequence("Generic", "Number", strings);
+   boost::posix_time::ptime middle =
+      boost::posix_time::microsec_clock::universal_time();
+   for (int i = 0; i < nrLoads; ++i)
+      core_.loadPropertySequence("Generic", "Number", values);
+   boost::posix_time::ptime end =
+      boost::posix_time::microsec_clock::universal_time();
+
+   // Recorded in the test report (--gtest_output=xml) rather than checked,
+   // since they depend on the machine
+   RecordProperty("StringLoadsUs",
+         static_cast<int>((middle - start).total_microseconds()));
+   RecordProperty("NumericLoadsUs",
+         static_cast<int>((end - middle).total_microseconds()));
+}
+
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,202 @@
+#include <gtest/gtest.h>
+
+#include "SequencePlanner.h"
+
+#include <string>
+#include <vector>
+
+using namespace mm;
+
+
+static std::vector<AcquisitionEvent> ZStack(int nrSlices)
+{
+   std::vector<AcquisitionEvent> events;
+   for (int z = 0; z < nrSlices; ++z)
+   {
+      AcquisitionEvent event(0, 0, 0, z);
+      event.setZPosition(0.5 * z);
+      events.push_back(event);
+   }
+   return events;
+}
+
+
+static SequenceCapabilities Capabilities(long zMaxLength)
+{
+   SequenceCapabilities capabilities;
+   capabilities.zMaxLength = zMaxLength;
+   capabilities.cameraMaxLength = 1000;
+   return capabilities;
+}
+
+
+TEST(SequencePlannerTests, ZStackIsOneBurst)
+{
+   std::vector<SequenceBurst> bursts =
+      PlanSequenceBursts(ZStack(10), Capabilities(50));
+   ASSERT_EQ(1u, bursts.size());
+   EXPECT_EQ(0u, bursts[0].firstEvent);
+   EXPECT_EQ(10u, bursts[0].nrEvents);
+   EXPECT_TRUE(bursts[0].IsHardwareSequenced());
+   EXPECT_TRUE(bursts[0].sequenceZ);
+   EXPECT_FALSE(bursts[0].sequenceXY);
+   EXPECT_FALSE(bursts[0].sequenceExposure);
+   EXPECT_TRUE(bursts[0].properties.empty());
+}
+
+
+TEST(SequencePlannerTests, SplitsAtMaximumLength)
+{
+   std::vector<SequenceBurst> bursts =
+      PlanSequenceBursts(ZStack(10), Capabilities(4));
+   ASSERT_EQ(3u, bursts.size());
+   EXPECT_EQ(4u, bursts[0].nrEvents);
+   EXPECT_EQ(4u, bursts[1].firstEvent);
+   EXPECT_EQ(4u, bursts[1].nrEvents);
+   EXPECT_EQ(2u, bursts[2].nrEvents);
+
+   SequenceCapabilities capabilities = Capabilities(50);
+   capabilities.cameraMaxLength = 3;
+   EXPECT_EQ(4u, PlanSequenceBursts(ZStack(10), capabilities).size());
+}
+
+
+TEST(SequencePlannerTests, FallsBackToSoftware)
+{
+   std::vector<SequenceBurst> bursts =
+      PlanSequenceBursts(ZStack(5), Capabilities(0));
+   ASSERT_EQ(5u, bursts.size());
+   for (std::size_t i = 0; i < bursts.size(); ++i)
+   {
+      EXPECT_EQ(i, bursts[i].firstEvent);
+      EXPECT_FALSE(bursts[i].IsHardwareSequenced());
+   }
+}
+
+
+TEST(SequencePlannerTests, UnchangedSettingsNeedNoDeviceSequence)
+{
+   // A time series at full speed only needs the camera
+   std::vector<AcquisitionEvent> events;
+   for (int t = 0; t < 5; ++t)
+   {
+      AcquisitionEvent event(t, 0, 0, 0);
+      event.setZPosition(2.0);
+      event.setExposure(10.0);
+      events.push_back(event);
+   }
+   std::vector<SequenceBurst> bursts =
+      PlanSequenceBursts(events, Capabilities(0));
+   ASSERT_EQ(1u, bursts.size());
+   EXPECT_EQ(5u, bursts[0].nrEvents);
+   EXPECT_FALSE(bursts[0].sequenceZ);
+   EXPECT_FALSE(bursts[0].sequenceExposure);
+}
+
+
+TEST(SequencePlannerTests, MinimumStartTimeEndsBurst)
+{
+   std::vector<AcquisitionEvent> events = ZStack(6);
+   for (std::size_t i = 3; i < events.size(); ++i)
+      events[i].setMinimumStartTime(1000.0);
+   std::vector<SequenceBurst> bursts =
+      PlanSequenceBursts(events, Capabilities(50));
+   ASSERT_EQ(2u, bursts.size());
+   EXPECT_EQ(3u, bursts[0].nrEvents);
+   EXPECT_EQ(3u, bursts[1].nrEvents);
+}
+
+
+class SequencePlannerChannelTests : public ::testing::Test
+{
+protected:
+   SequenceCapabilities capabilities_;
+   std::vector<AcquisitionEvent> events_;
+
+   virtual void SetUp()
+   {
+      capabilities_.cameraMaxLength = 1000;
+      capabilities_.zMaxLength = 1000;
+      AddPreset("DAPI", "1");
+      AddPreset("GFP", "2");
+
+      // Channels interleaved within a Z-stack
+      const char* channels[] = { "DAPI", "GFP" };
+      for (int z = 0; z < 3; ++z)
+         for (int c = 0; c < 2; ++c)
+         {
+            AcquisitionEvent event(0, 0, c, z);
+            event.setZPosition(z);
+            event.setConfig("Channel", channels[c]);
+            events_.push_back(event);
+         }
+   }
+
+   void AddPreset(const std::string& preset, const std::string& filter)
+   {
+      Configuration settings;
+      settings.addSetting(PropertySetting("Wheel", "State", filter.c_str()));
+      settings.addSetting(PropertySetting("Lamp", "Intensity", "50"));
+      capabilities_.presets[SequenceCapabilities::Key("Channel", preset)] =
+         settings;
+   }
+};
+
+
+TEST_F(SequencePlannerChannelTests, InterleavesSequenceableChannels)
+{
+   capabilities_.propertyMaxLengths[
+      SequenceCapabilities::Key("Wheel", "State")] = 10;
+
+   std::vector<SequenceBurst> bursts =
+      PlanSequenceBursts(events_, capabilities_);
+   ASSERT_EQ(1u, bursts.size());
+   EXPECT_EQ(6u, bursts[0].nrEvents);
+   EXPECT_TRUE(bursts[0].sequenceZ);
+   // Only the varying property is sequenced
+   ASSERT_EQ(1u, bursts[0].properties.size());
+   const PropertySequence& sequence = bursts[0].properties[0];
+   EXPECT_EQ("Wheel", sequence.device);
+   EXPECT_EQ("State", sequence.property);
+   const char* expected[] = { "1", "2", "1", "2", "1", "2" };
+   EXPECT_EQ(std::vector<std::string>(expected, expected + 6),
+         sequence.values);
+}
+
+
+TEST_F(SequencePlannerChannelTests, NonSequenceableChannelsSplit)
+{
+   // Each channel's slice alone (the Z changes with the next channel switch)
+   std::vector<SequenceBurst> bursts =
+      PlanSequenceBursts(events_, capabilities_);
+   EXPECT_EQ(6u, bursts.size());
+
+   // Channel-major order: Z-stacks run as bursts
+   std::vector<AcquisitionEvent> channelMajor;
+   for (int c = 0; c < 2; ++c)
+      for (int z = 0; z < 3; ++z)
+         channelMajor.push_back(events_[z * 2 + c]);
+   bursts = PlanSequenceBursts(channelMajor, capabilities_);
+   ASSERT_EQ(2u, bursts.size());
+   EXPECT_EQ(3u, bursts[0].nrEvents);
+   EXPECT_TRUE(bursts[0].properties.empty());
+}
+
+
+TEST_F(SequencePlannerChannelTests, DifferentPropertiesSplit)
+{
+   capabilities_.propertyMaxLengths[
+      SequenceCapabilities::Key("Wheel", "State")] = 10;
+   Configuration other;
+   other.addSetting(PropertySetting("Wheel", "State", "3"));
+   capabilities_.presets[SequenceCapabilities::Key("Channel", "GFP")] = other;
+
+   EXPECT_EQ(6u, PlanSequenceBursts(events_, capabilities_).size());
+}
+
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include "StateCache.h"
+
+using mm::StateCache;
+
+
+TEST(StateCacheTests, VersionAdvancesOnlyOnChange)
+{
+   StateCache c;
+   ASSERT_EQ(0, c.GetVersion());
+
+   c.Set(PropertySetting("Dev", "A", "1"));
+   c.Set(PropertySetting("Dev", "B", "2"));
+   long long v = c.GetVersion();
+   EXPECT_EQ(2, v);
+
+   c.Set(PropertySetting("Dev", "A", "1"));
+   EXPECT_EQ(v, c.GetVersion());
+
+   c.Set(PropertySetting("Dev", "A", "3"));
+   EXPECT_EQ(v + 1, c.GetVersion());
+   EXPECT_EQ("3", c.Get("Dev", "A").getPropertyValue());
+   EXPECT_EQ(2u, c.GetAll().size());
+}
+
+
+TEST(StateCacheTests, ChangesSince)
+{
+   StateCache c;
+   c.Set(PropertySetting("Dev", "A", "1"));
+   c.Set(PropertySetting("Dev", "B", "2"));
+   long long v = c.GetVersion();
+
+   EXPECT_EQ(2u, c.GetChangesSince(0).size());
+   EXPECT_EQ(0u, c.GetChangesSince(v).size());
+
+   c.Set(PropertySetting("Dev", "B", "5"));
+   c.Set(PropertySetting("Dev", "C", "6"));
+   Configuration changes = c.GetChangesSince(v);
+   ASSERT_EQ(2u, changes.size());
+   EXPECT_TRUE(changes.isPropertyIncluded("Dev", "B"));
+   EXPECT_TRUE(changes.isPropertyIncluded("Dev", "C"));
+   EXPECT_FALSE(changes.isPropertyIncluded("Dev", "A"));
+}
+
+
+TEST(StateCacheTests, UpdateInPlace)
+{
+   StateCache c;
+   c.Set(PropertySetting("Dev", "A", "1"));
+   c.Set(PropertySetting("Dev", "B", "2"));
+   c.Set(PropertySetting("Old", "X", "0"));
+   long long v = c.GetVersion();
+   ASSERT_EQ(0, c.GetResetVersion());
+
+   Configuration state;
+   state.addSetting(PropertySetting("Dev", "A", "1"));
+   state.addSetting(PropertySetting("Dev", "B", "7"));
+   c.Update(state);
+
+   EXPECT_EQ(2u, c.GetAll().size());
+   EXPECT_FALSE(c.Has("Old", "X"));
+   EXPECT_THROW(c.Get("Old", "X"), CMMError);
+   EXPECT_EQ("7", c.Get("Dev", "B").getPropertyValue());
+
+   // Removal makes deltas from before the removal return everything
+   EXPECT_GT(c.GetResetVersion(), v);
+   EXPECT_EQ(2u, c.GetChangesSince(v).size());
+   EXPECT_EQ(0u, c.GetChangesSince(c.GetVersion()).size());
+
+   // Updating with an identical state changes nothing
+   long long v2 = c.GetVersion();
+   c.Update(state);
+   EXPECT_EQ(v2, c.GetVersion());
+}
+
+
+TEST(StateCacheTests, SnapshotIsSharedUntilChange)
+{
+   StateCache c;
+   c.Set(PropertySetting("Dev", "A", "1"));
+   boost::shared_ptr<const Configuration> s1 = c.GetSnapshot();
+   boost::shared_ptr<const Configuration> s2 = c.GetSnapshot();
+   EXPECT_EQ(s1.get(), s2.get());
+
+   // Setting an identical value does not invalidate the snapshot
+   c.Set(PropertySetting("Dev", "A", "1"));
+   EXPECT_EQ(s1.get(), c.GetSnapshot().get());
+
+   c.Set(PropertySetting("Dev", "A", "2"));
+   boost::shared_ptr<const Configuration> s3 = c.GetSnapshot();
+   EXPECT_NE(s1.get(), s3.get());
+   // Earlier snapshots are not modified
+   EXPECT_EQ("1", s1->getSetting("Dev", "A").getPropertyValue());
+   EXPECT_EQ("2", s3->getSetting("Dev", "A").getPropertyValue());
+}
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
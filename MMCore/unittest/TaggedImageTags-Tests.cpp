@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+
+#include "MMCore.h"
+#include "MockDeviceFixture.h"
+
+#include <string>
+
+
+class TaggedImageTagsTests : public MockDeviceTest
+{
+protected:
+   virtual void SetUp()
+   {
+      LoadMockDevice("Camera", "MockCamera");
+      core_.initializeAllDevices();
+      core_.setCameraDevice("Camera");
+   }
+};
+
+
+TEST_F(TaggedImageTagsTests, IncludesSingleTags)
+{
+   Metadata md;
+   md.PutImageTag("Label", "abc");
+
+   const std::string tags = core_.getTaggedImageTags(md);
+   EXPECT_NE(std::string::npos, tags.find("\"Label\":\"abc\""));
+   EXPECT_NE(std::string::npos, tags.find("\"Core-Camera\":\"Camera\""));
+}
+
+
+TEST_F(TaggedImageTagsTests, SkipsArrayTags)
+{
+   Metadata md;
+   md.PutImageTag("Label", "abc");
+   MetadataArrayTag array;
+   array.SetName("Values");
+   array.SetDevice("_");
+   array.AddValue("1");
+   array.AddValue("2");
+   md.SetTag(array);
+
+   std::string tags;
+   ASSERT_NO_THROW(tags = core_.getTaggedImageTags(md));
+   EXPECT_EQ(std::string::npos, tags.find("\"Values\""));
+   EXPECT_NE(std::string::npos, tags.find("\"Label\":\"abc\""));
+}
+
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
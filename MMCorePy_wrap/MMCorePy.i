@@ -210,6 +210,22 @@ PyObject *setSLMImage_pywrap(const char* slmLabel, char *pixels, int receivedLen
 }
 %ignore setSLMImage;
 
+%rename(addSLMPattern) addSLMPattern_pywrap;
+%extend CMMCore {
+PyObject *addSLMPattern_pywrap(const char* slmLabel, char *pixels, int receivedLength)
+{
+   long expectedLength = self->getSLMWidth(slmLabel) * self->getSLMHeight(slmLabel);
+
+   if (receivedLength != expectedLength)
+   {
+      PyErr_SetString(PyExc_TypeError, "Pattern dimensions are wrong for this SLM.");
+      return (PyObject *) NULL;
+   }
+   return PyInt_FromLong(self->addSLMPattern(slmLabel, (unsigned char *)pixels));
+}
+}
+%ignore addSLMPattern;
+
 %{
 #define SWIG_FILE_WITH_INIT
 #include "../MMDevice/MMDeviceConstants.h"
@@ -217,6 +233,7 @@ PyObject *setSLMImage_pywrap(const char* slmLabel, char *pixels, int receivedLen
 #include "../MMCore/Configuration.h"
 #include "../MMDevice/ImageMetadata.h"
 #include "../MMCore/MMEventCallback.h"
+#include "../MMCore/AcquisitionPlan.h"
 #include "../MMCore/MMCore.h"
 %}
 
@@ -278,6 +295,7 @@ namespace std {
 %include "../MMDevice/MMDeviceConstants.h"
 %include "../MMCore/Error.h"
 %include "../MMCore/Configuration.h"
+%include "../MMCore/AcquisitionPlan.h"
 %include "../MMCore/MMCore.h"
 %include "../MMDevice/ImageMetadata.h"
 %include "../MMCore/MMEventCallback.h"
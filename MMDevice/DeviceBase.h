@@ -480,6 +480,71 @@ public:
       return pProp->SendSequence();
    }
 
+   /**
+    * This function is used by the Core to communicate a whole sequence to
+    * the device in one call. The default implementation uses the per-value
+    * functions (ClearPropertySequence(), AddToPropertySequence() and
+    * SendPropertySequence()), so that devices overriding those keep working.
+    * Override to load the sequence in one step (see
+    * MM::Property::LoadSequence()).
+    * @param name - name of the sequenceable property
+    * @param values - the sequence
+    * @param nrValues - length of the sequence
+    */
+   virtual int LoadPropertySequence(const char* name,
+         const char* const* values, unsigned long nrValues)
+   {
+      int ret = ClearPropertySequence(name);
+      if (ret != DEVICE_OK)
+         return ret;
+      for (unsigned long i = 0; i < nrValues; ++i)
+      {
+         ret = AddToPropertySequence(name, values[i]);
+         if (ret != DEVICE_OK)
+            return ret;
+      }
+      return SendPropertySequence(name);
+   }
+
+   /**
+    * Numeric version of LoadPropertySequence(), for Float and Integer
+    * properties. The default implementation checks the values (see
+    * MM::Property::CheckNumericSequence()), then passes them formatted as
+    * text to the per-value functions, as LoadPropertySequence() does.
+    * Override to keep them as numbers (see
+    * MM::Property::LoadNumericSequence() and
+    * MM::PropertyBase::GetNumericSequence()).
+    * @param name - name of the sequenceable property
+    * @param values - the sequence
+    * @param nrValues - length of the sequence
+    */
+   virtual int LoadNumericPropertySequence(const char* name,
+         const double* values, unsigned long nrValues)
+   {
+      MM::Property* pProp = properties_.Find(name);
+      if (!pProp)
+      {
+         SetMorePropertyErrorInfo(name);
+         return DEVICE_INVALID_PROPERTY;
+      }
+      int ret = pProp->CheckNumericSequence(values, nrValues);
+      if (ret != DEVICE_OK)
+         return ret;
+
+      ret = ClearPropertySequence(name);
+      if (ret != DEVICE_OK)
+         return ret;
+      for (unsigned long i = 0; i < nrValues; ++i)
+      {
+         std::ostringstream os;
+         os << std::setprecision(15) << values[i];
+         ret = AddToPropertySequence(name, os.str().c_str());
+         if (ret != DEVICE_OK)
+            return ret;
+      }
+      return SendPropertySequence(name);
+   }
+
    /**
    * Obtains the property name given the index.
    * Can be used for enumerating properties.
@@ -1040,6 +1105,48 @@ protected:
       return DEVICE_NO_CALLBACK_REGISTERED;
    }
 
+   /**
+   * Sends a batch of commands to the serial port without waiting for the
+   * answers in between, then receives one answer per command, in order.
+   * This saves a round trip per command on controllers that accept several
+   * commands in flight.
+   * @param portName
+   * @param commands - command strings
+   * @param commandTerm - terminating string appended to each command
+   * @param answerTerm - terminating string of each answer
+   * @param answers - answer strings without the terminating characters; on
+   * error, contains the answers received before the error
+   * @param answerTimeoutsMs - per-answer timeouts (empty, or one per command;
+   * values <= 0 select the port's default timeout)
+   */
+   int SendSerialCommandBatch(const char* portName,
+         const std::vector<std::string>& commands, const char* commandTerm,
+         const char* answerTerm, std::vector<std::string>& answers,
+         const std::vector<double>& answerTimeoutsMs = std::vector<double>())
+   {
+      answers.clear();
+      if (!callback_)
+         return DEVICE_NO_CALLBACK_REGISTERED;
+      if (commands.empty())
+         return DEVICE_OK;
+      if (!answerTimeoutsMs.empty() && answerTimeoutsMs.size() != commands.size())
+         return DEVICE_INVALID_INPUT_PARAM;
+
+      const unsigned MAX_BUFLEN = 2000;
+      std::vector<const char*> cmdPtrs(commands.size());
+      for (size_t i = 0; i < commands.size(); ++i)
+         cmdPtrs[i] = commands[i].c_str();
+      std::vector<char> buf(commands.size() * MAX_BUFLEN);
+      unsigned nrAnswers = 0;
+      int ret = callback_->SendSerialCommandBatch(this, portName,
+            (unsigned)commands.size(), &cmdPtrs[0], commandTerm,
+            &buf[0], MAX_BUFLEN, answerTerm,
+            answerTimeoutsMs.empty() ? 0 : &answerTimeoutsMs[0], nrAnswers);
+      for (unsigned i = 0; i < nrAnswers && i < commands.size(); ++i)
+         answers.push_back(std::string(&buf[i * MAX_BUFLEN]));
+      return ret;
+   }
+
    /**
    * Reads the current contents of Rx serial buffer.
    */
@@ -1122,6 +1229,16 @@ protected:
       return DEVICE_NO_CALLBACK_REGISTERED;
    }
 
+   /*
+    * Signals, from within SnapImage(), that the exposure has ended
+    */
+   int OnExposureFinished()
+   {
+      if (callback_)
+         return callback_->OnExposureFinished(this);
+      return DEVICE_NO_CALLBACK_REGISTERED;
+   }
+
    /*
     */
    int OnSLMExposureChanged(double exposure)
@@ -1231,12 +1348,6 @@ protected:
       return hub;
    }
 
-private:
-   bool PropertyDefined(const char* propName) const
-   {
-      return properties_.Find(propName) != 0;
-   }
-
    /**
     * Finds a property by name and determines whether it is a sequenceable property
     * @param pProp - pointer to pointer used to return the property if found
@@ -1261,6 +1372,11 @@ private:
       return DEVICE_OK;
    }
 
+private:
+   bool PropertyDefined(const char* propName) const
+   {
+      return properties_.Find(propName) != 0;
+   }
 
    MM::PropertyCollection properties_;
    HDEVMODULE module_;
@@ -1476,6 +1592,26 @@ public:
       return DEVICE_UNSUPPORTED_COMMAND;
    }
 
+   /**
+   * Default implementation of the bulk sequence load, using the per-value
+   * functions. Override to send the sequence to the camera in one
+   * transaction.
+   */
+   virtual int LoadExposureSequence(const double* exposureTimes_ms,
+         unsigned long nrExposures)
+   {
+      int ret = ClearExposureSequence();
+      if (ret != DEVICE_OK)
+         return ret;
+      for (unsigned long i = 0; i < nrExposures; ++i)
+      {
+         ret = AddToExposureSequence(exposureTimes_ms[i]);
+         if (ret != DEVICE_OK)
+            return ret;
+      }
+      return SendExposureSequence();
+   }
+
    virtual bool IsCapturing(){return !thd_->IsStopped();}
 
    virtual void AddTag(const char* key, const char* deviceLabel, const char* value)
@@ -1817,6 +1953,26 @@ class CStageBase : public CDeviceBase<MM::Stage, U>
       return DEVICE_UNSUPPORTED_COMMAND;
    }
 
+   /**
+   * Default implementation of the bulk sequence load, using the per-value
+   * functions. Override to send the sequence to the stage in one
+   * transaction.
+   */
+   virtual int LoadStageSequence(const double* positions,
+         unsigned long nrPositions)
+   {
+      int ret = ClearStageSequence();
+      if (ret != DEVICE_OK)
+         return ret;
+      for (unsigned long i = 0; i < nrPositions; ++i)
+      {
+         ret = AddToStageSequence(positions[i]);
+         if (ret != DEVICE_OK)
+            return ret;
+      }
+      return SendStageSequence();
+   }
+
    virtual int SetStageLinearSequence(double, long)
    {
       return DEVICE_UNSUPPORTED_COMMAND;
@@ -2012,6 +2168,26 @@ public:
       return DEVICE_UNSUPPORTED_COMMAND;
    }
 
+   /**
+   * Default implementation of the bulk sequence load, using the per-value
+   * functions. Override to send the sequence to the stage in one
+   * transaction.
+   */
+   virtual int LoadXYStageSequence(const double* positionsX,
+         const double* positionsY, unsigned long nrPositions)
+   {
+      int ret = ClearXYStageSequence();
+      if (ret != DEVICE_OK)
+         return ret;
+      for (unsigned long i = 0; i < nrPositions; ++i)
+      {
+         ret = AddToXYStageSequence(positionsX[i], positionsY[i]);
+         if (ret != DEVICE_OK)
+            return ret;
+      }
+      return SendXYStageSequence();
+   }
+
 protected:
 
    /**
@@ -2060,6 +2236,33 @@ class CShutterBase : public CDeviceBase<MM::Shutter, U>
 template <class U>
 class CSerialBase : public CDeviceBase<MM::Serial, U>
 {
+public:
+   /**
+   * Default implementation: sends all commands, then reads the answers using
+   * SetCommand() and GetAnswer(). Per-answer timeouts are not supported and
+   * the port's own timeout applies to each answer.
+   */
+   virtual int SendCommandBatch(unsigned nrCommands,
+         const char* const* commands, const char* commandTerm,
+         char* answers, unsigned maxAnswerChars, const char* answerTerm,
+         const double* /*answerTimeoutsMs*/, unsigned& nrAnswers)
+   {
+      nrAnswers = 0;
+      for (unsigned i = 0; i < nrCommands; ++i)
+      {
+         int ret = this->SetCommand(commands[i], commandTerm);
+         if (ret != DEVICE_OK)
+            return ret;
+      }
+      for (unsigned i = 0; i < nrCommands; ++i)
+      {
+         int ret = this->GetAnswer(answers + i * maxAnswerChars, maxAnswerChars, answerTerm);
+         if (ret != DEVICE_OK)
+            return ret;
+         ++nrAnswers;
+      }
+      return DEVICE_OK;
+   }
 };
 
 /**
@@ -2158,6 +2361,27 @@ class CSLMBase : public CDeviceBase<MM::SLM, U>
    virtual int SendSLMSequence() {
       return DEVICE_UNSUPPORTED_COMMAND;
    }
+
+   virtual int PrepareSLMPattern(long /*patternId*/,
+         const unsigned char* /*pixels*/)
+   {
+      return DEVICE_UNSUPPORTED_COMMAND;
+   }
+
+   virtual int ReleaseSLMPattern(long /*patternId*/)
+   {
+      return DEVICE_UNSUPPORTED_COMMAND;
+   }
+
+   virtual int SetSLMPattern(long /*patternId*/)
+   {
+      return DEVICE_UNSUPPORTED_COMMAND;
+   }
+
+   virtual int AddPatternToSLMSequence(long /*patternId*/)
+   {
+      return DEVICE_UNSUPPORTED_COMMAND;
+   }
 };
 
 /**
@@ -2168,6 +2392,12 @@ class CGalvoBase : public CDeviceBase<MM::Galvo, U>
 {
    double GetXMinimum() { return 0.0;};
    double GetYMinimum() { return 0.0;};
+
+   virtual int LoadScanPath(const double* /*xs*/, const double* /*ys*/,
+         const double* /*dwellTimes_us*/, long /*nrPoints*/)
+   {
+      return DEVICE_UNSUPPORTED_COMMAND;
+   }
 };
 
 /**
@@ -500,7 +500,10 @@ public:
       return os.str();
    }
 
-private:
+   /**
+    * Returns the tag with the given key, which may be a single or an array
+    * tag (see MetadataTag::ToSingleTag() and MetadataTag::ToArrayTag()).
+    */
    MetadataTag* FindTag(const char* key) const
    {
       TagIterator it = tags_.find(key);
@@ -510,6 +513,7 @@ private:
          throw MetadataKeyError();
    }
 
+private:
    std::map<std::string, MetadataTag*> tags_;
    typedef std::map<std::string, MetadataTag*>::const_iterator TagIterator;
 };
@@ -27,7 +27,7 @@
 // Header version
 // If any of the class definitions changes, the interface version
 // must be incremented
-#define DEVICE_INTERFACE_VERSION 69
+#define DEVICE_INTERFACE_VERSION 75
 ///////////////////////////////////////////////////////////////////////////////
 
 
@@ -289,6 +289,20 @@ namespace MM {
        * Signal that we are done sending sequence values so that the adapter can send the whole sequence to the device
        */
       virtual int SendPropertySequence(const char* propertyName) = 0;
+      /**
+       * Replace the sequence with nrValues values and send it to the device,
+       * in a single call. Equivalent to ClearPropertySequence(),
+       * AddToPropertySequence() for each value and SendPropertySequence().
+       */
+      virtual int LoadPropertySequence(const char* propertyName,
+            const char* const* values, unsigned long nrValues) = 0;
+      /**
+       * Like LoadPropertySequence(), for a Float or Integer property, with
+       * the values passed as numbers. The values are checked against the
+       * property's limits and allowed values.
+       */
+      virtual int LoadNumericPropertySequence(const char* propertyName,
+            const double* values, unsigned long nrValues) = 0;
 
       virtual bool GetErrorText(int errorCode, char* errMessage) const = 0;
       virtual bool Busy() = 0;
@@ -577,6 +591,11 @@ namespace MM {
       virtual int AddToExposureSequence(double exposureTime_ms) = 0;
       // Signal that we are done sending sequence values so that the adapter can send the whole sequence to the device
       virtual int SendExposureSequence() const = 0;
+      // Replace the sequence and send it to the camera, in a single call.
+      // Equivalent to ClearExposureSequence(), AddToExposureSequence() for
+      // each value and SendExposureSequence().
+      virtual int LoadExposureSequence(const double* exposureTimes_ms,
+            unsigned long nrExposures) = 0;
    };
 
    /**
@@ -690,6 +709,13 @@ namespace MM {
        * can send the whole sequence to the device
        */
       virtual int SendStageSequence() = 0;
+      /**
+       * Replace the sequence and send it to the device, in a single call.
+       * Equivalent to ClearStageSequence(), AddToStageSequence() for each
+       * position and SendStageSequence().
+       */
+      virtual int LoadStageSequence(const double* positions,
+            unsigned long nrPositions) = 0;
 
       /**
        * Set up to perform an equally-spaced triggered Z stack.
@@ -785,6 +811,13 @@ namespace MM {
        * can send the whole sequence to the device
        */
       virtual int SendXYStageSequence() = 0;
+      /**
+       * Replace the sequence and send it to the device, in a single call.
+       * Equivalent to ClearXYStageSequence(), AddToXYStageSequence() for each
+       * position and SendXYStageSequence().
+       */
+      virtual int LoadXYStageSequence(const double* positionsX,
+            const double* positionsY, unsigned long nrPositions) = 0;
 
    };
 
@@ -834,6 +867,20 @@ namespace MM {
       virtual int Write(const unsigned char* buf, unsigned long bufLen) = 0;
       virtual int Read(unsigned char* buf, unsigned long bufLen, unsigned long& charsRead) = 0;
       virtual int Purge() = 0;
+
+      /**
+       * Sends a batch of commands back-to-back, then receives one answer per
+       * command, in order.
+       *
+       * Answer i is stored (without terminator) at answers + i * maxAnswerChars.
+       * answerTimeoutsMs may be null; otherwise it holds one timeout per
+       * answer, with values <= 0 meaning the port's default timeout.
+       * On error, nrAnswers is the number of answers received successfully.
+       */
+      virtual int SendCommandBatch(unsigned nrCommands,
+            const char* const* commands, const char* commandTerm,
+            char* answers, unsigned maxAnswerChars, const char* answerTerm,
+            const double* answerTimeoutsMs, unsigned& nrAnswers) = 0;
    };
 
    /**
@@ -1128,6 +1175,45 @@ namespace MM {
        */
       virtual int SendSLMSequence() = 0;
 
+      // SLM pattern functions
+      // The Core keeps a cache of 8-bit patterns for each SLM and registers
+      // them with the device under an id, so that patterns that are shown
+      // repeatedly need to be transferred (and converted to the device's
+      // native format) only once. Devices that do not support patterns
+      // return DEVICE_UNSUPPORTED_COMMAND from these functions, in which case
+      // the Core passes the pattern's pixels to SetImage() or
+      // AddToSLMSequence() instead.
+
+      /**
+       * Registers an 8-bit pattern under an id.
+       * The pixels remain valid and unchanged until ReleaseSLMPattern() is
+       * called with the same id or the device is shut down, so the adapter
+       * may keep the pointer and convert the pattern later or on a worker
+       * thread.
+       * @param patternId id by which the Core refers to the pattern
+       * @param pixels An array of 8-bit pixels whose length matches that expected by the SLM.
+       * @return errorcode (DEVICE_OK if no error)
+       */
+      virtual int PrepareSLMPattern(long patternId, const unsigned char* pixels) = 0;
+
+      /**
+       * Forgets a pattern registered with PrepareSLMPattern().
+       * @return errorcode (DEVICE_OK if no error)
+       */
+      virtual int ReleaseSLMPattern(long patternId) = 0;
+
+      /**
+       * Loads a registered pattern as the image to be displayed, like
+       * SetImage().
+       * @return errorcode (DEVICE_OK if no error)
+       */
+      virtual int SetSLMPattern(long patternId) = 0;
+
+      /**
+       * Adds a registered pattern to the sequence, like AddToSLMSequence().
+       * @return errorcode (DEVICE_OK if no error)
+       */
+      virtual int AddPatternToSLMSequence(long patternId) = 0;
    };
 
    /**
@@ -1180,6 +1266,22 @@ namespace MM {
       virtual int RunPolygons() = 0;
       virtual int StopSequence() = 0;
       virtual int GetChannel(char* channelName) = 0;
+
+      /**
+       * Loads a scan path compiled by the Core from a set of ROIs: the
+       * points to visit in order, with the time to spend at each (with the
+       * light source on). The path replaces any loaded polygons, and is run
+       * by RunPolygons().
+       * Return DEVICE_UNSUPPORTED_COMMAND if not supported; the Core then
+       * loads the ROIs as polygons instead.
+       * @param xs X positions in native units
+       * @param ys Y positions in native units
+       * @param dwellTimes_us time at each position
+       * @param nrPoints length of each of the arrays
+       * @return errorcode (DEVICE_OK if no error)
+       */
+      virtual int LoadScanPath(const double* xs, const double* ys,
+            const double* dwellTimes_us, long nrPoints) = 0;
    };
 
    /**
@@ -1272,6 +1374,14 @@ namespace MM {
                                       const char* stopBits) = 0;
       virtual int SetSerialCommand(const Device* caller, const char* portName, const char* command, const char* term) = 0;
       virtual int GetSerialAnswer(const Device* caller, const char* portName, unsigned long ansLength, char* answer, const char* term) = 0;
+      /// Send a batch of commands and receive one answer per command.
+      /**
+       * See MM::Serial::SendCommandBatch() for the meaning of the parameters.
+       */
+      virtual int SendSerialCommandBatch(const Device* caller, const char* portName,
+            unsigned nrCommands, const char* const* commands, const char* commandTerm,
+            char* answers, unsigned maxAnswerChars, const char* answerTerm,
+            const double* answerTimeoutsMs, unsigned& nrAnswers) = 0;
       virtual int WriteToSerial(const Device* caller, const char* port, const unsigned char* buf, unsigned long length) = 0;
       virtual int ReadFromSerial(const Device* caller, const char* port, unsigned char* buf, unsigned long length, unsigned long& read) = 0;
       virtual int PurgeSerial(const Device* caller, const char* portName) = 0;
@@ -1298,6 +1408,14 @@ namespace MM {
        * When the exposure time has changed, use this callback to inform the UI
        */
       virtual int OnExposureChanged(const Device* caller, double newExposure) = 0;
+      /**
+       * Cameras can call this from within SnapImage() as soon as the
+       * exposure has ended, before the image is read out. This lets the
+       * Core return from a pipelined snap (and e.g. move stages) during
+       * the readout. Cameras that do not call it are assumed to have
+       * finished the exposure when SnapImage() returns.
+       */
+      virtual int OnExposureFinished(const Device* caller) = 0;
       /**
        * When the SLM exposure time has changed, use this callback to inform the UI
        */
@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          PortTrace.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMDevice - Device adapter kit
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Binary traces of serial port traffic, for recording in port
+//                adapters and replaying without hardware
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "PortTrace.h"
+
+#include <cstring>
+
+
+namespace
+{
+   const char g_Magic[8] = { 'M', 'M', 'P', 'T', 'R', 'A', 'C', 'E' };
+   const unsigned g_FormatVersion = 1;
+
+   // Largest record accepted when reading, to reject corrupt files
+   const unsigned long g_MaxRecordLength = 64 * 1024 * 1024;
+
+   void PutLE(char* buf, unsigned long long value, std::size_t size)
+   {
+      for (std::size_t i = 0; i < size; ++i)
+         buf[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+   }
+
+   unsigned long long GetLE(const char* buf, std::size_t size)
+   {
+      unsigned long long value = 0;
+      for (std::size_t i = 0; i < size; ++i)
+         value |= static_cast<unsigned long long>(
+               static_cast<unsigned char>(buf[i])) << (8 * i);
+      return value;
+   }
+} // anonymous namespace
+
+
+bool PortTraceWriter::Open(const std::string& path)
+{
+   MMThreadGuard g(lock_);
+   if (file_.is_open())
+      file_.close();
+   file_.clear();
+   if (path.empty())
+      return true;
+
+   file_.open(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+   if (!file_.is_open())
+      return false;
+
+   char version[4];
+   PutLE(version, g_FormatVersion, sizeof(version));
+   file_.write(g_Magic, sizeof(g_Magic));
+   file_.write(version, sizeof(version));
+   file_.flush();
+   return file_.good();
+}
+
+void PortTraceWriter::Close()
+{
+   MMThreadGuard g(lock_);
+   if (file_.is_open())
+      file_.close();
+}
+
+void PortTraceWriter::Record(long long timeUs, PortTraceRecordKind kind,
+      const char* data, std::size_t length)
+{
+   MMThreadGuard g(lock_);
+   if (!file_.is_open())
+      return;
+
+   char header[8 + 1 + 4];
+   PutLE(header, static_cast<unsigned long long>(timeUs), 8);
+   header[8] = static_cast<char>(kind);
+   PutLE(header + 9, length, 4);
+   file_.write(header, sizeof(header));
+   if (length > 0)
+      file_.write(data, length);
+   // Flush so that the trace is complete even if the process is killed
+   file_.flush();
+}
+
+
+bool PortTraceReader::Open(const std::string& path)
+{
+   file_.open(path.c_str(), std::ios::in | std::ios::binary);
+   if (!file_.is_open())
+      return false;
+
+   char header[sizeof(g_Magic) + 4];
+   if (!file_.read(header, sizeof(header)))
+      return false;
+   if (std::memcmp(header, g_Magic, sizeof(g_Magic)) != 0)
+      return false;
+   return GetLE(header + sizeof(g_Magic), 4) == g_FormatVersion;
+}
+
+bool PortTraceReader::Next(PortTraceRecord& record)
+{
+   char header[8 + 1 + 4];
+   if (!file_.read(header, sizeof(header)))
+      return false;
+
+   record.timeUs = static_cast<long long>(GetLE(header, 8));
+   record.kind = static_cast<PortTraceRecordKind>(
+         static_cast<unsigned char>(header[8]));
+   unsigned long length = static_cast<unsigned long>(GetLE(header + 9, 4));
+   if (length > g_MaxRecordLength)
+      return false;
+
+   record.data.resize(length);
+   if (length > 0 && !file_.read(&record.data[0], length))
+      return false;
+   return true;
+}
@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          PortTrace.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMDevice - Device adapter kit
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Binary traces of serial port traffic, for recording in port
+//                adapters and replaying without hardware
+//
+// COPYRIGHT:     University of California, San Francisco, 2014
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "DeviceThreads.h"
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+
+// Trace file format (all integers little-endian):
+//
+//   header:  "MMPTRACE" (8 bytes), format version (uint32)
+//   records: time in microseconds (int64), kind (uint8), length (uint32),
+//            followed by length bytes of data
+//
+// Outgoing records (Command, Write) contain the bytes sent to the device,
+// including any terminator. Incoming records (Answer, Read) contain the bytes
+// received, including the answer terminator. Times are as given by the
+// recording port (typically MM::MMTime in microseconds); only differences
+// between record times are meaningful.
+
+enum PortTraceRecordKind
+{
+   PortTraceCommand = 1, // SetCommand()
+   PortTraceWrite = 2,   // Write()
+   PortTraceAnswer = 3,  // GetAnswer()
+   PortTraceRead = 4     // Read()
+};
+
+struct PortTraceRecord
+{
+   long long timeUs;
+   PortTraceRecordKind kind;
+   std::string data;
+
+   bool IsOutgoing() const
+   { return kind == PortTraceCommand || kind == PortTraceWrite; }
+};
+
+/**
+ * Writes a port traffic trace. Safe to call from multiple threads.
+ */
+class PortTraceWriter
+{
+public:
+   PortTraceWriter() {}
+
+   // Start writing to the given file (truncating it). Returns false on
+   // failure. An empty path closes the current trace.
+   bool Open(const std::string& path);
+   void Close();
+   bool IsOpen() const { return file_.is_open(); }
+
+   void Record(long long timeUs, PortTraceRecordKind kind,
+         const char* data, std::size_t length);
+   void Record(long long timeUs, PortTraceRecordKind kind,
+         const std::string& data)
+   { Record(timeUs, kind, data.data(), data.size()); }
+
+private:
+   PortTraceWriter(const PortTraceWriter&);
+   PortTraceWriter& operator=(const PortTraceWriter&);
+
+   MMThreadLock lock_;
+   std::ofstream file_;
+};
+
+/**
+ * Reads a port traffic trace written by PortTraceWriter.
+ */
+class PortTraceReader
+{
+public:
+   PortTraceReader() {}
+
+   // Returns false if the file cannot be opened or is not a trace.
+   bool Open(const std::string& path);
+
+   // Returns false at the end of the trace (or at a truncated record).
+   bool Next(PortTraceRecord& record);
+
+private:
+   std::ifstream file_;
+};
@@ -21,7 +21,9 @@
 
 #include "Property.h"
 
+#include <algorithm>
 #include <cstdio>
+#include <cstdlib>
 #include <math.h>
 
 using namespace std;
@@ -87,6 +89,138 @@ void MM::Property::SetSequenceable(long sequenceMaxSize)
    sequenceMaxSize_ = sequenceMaxSize;
 }
 
+int MM::Property::LoadSequence(const char* const* values,
+      unsigned long nrValues)
+{
+   if (nrValues > (unsigned long) GetSequenceMaxSize())
+      return DEVICE_SEQUENCE_TOO_LARGE;
+   try
+   {
+      sequenceEvents_.assign(values, values + nrValues);
+      numericSequence_.clear();
+      sequenceIsNumeric_ = false;
+   }
+   catch (...)
+   {
+      return MM_CODE_ERR;
+   }
+   return DEVICE_OK;
+}
+
+// Finds the smallest and largest values. The loop has no branches, so that
+// the compiler can vectorize it. Returns false if any value is NaN.
+static bool GetRange(const double* values, unsigned long nrValues,
+      double& minValue, double& maxValue)
+{
+   double lo = values[0];
+   double hi = values[0];
+   bool numbers = true;
+   for (unsigned long i = 0; i < nrValues; ++i)
+   {
+      const double v = values[i];
+      lo = v < lo ? v : lo;
+      hi = v > hi ? v : hi;
+      numbers &= (v == v);
+   }
+   minValue = lo;
+   maxValue = hi;
+   return numbers;
+}
+
+int MM::Property::LoadNumericSequence(const double* values,
+      unsigned long nrValues)
+{
+   int ret = CheckNumericSequence(values, nrValues);
+   if (ret != DEVICE_OK)
+      return ret;
+   if (nrValues > (unsigned long) GetSequenceMaxSize())
+      return DEVICE_SEQUENCE_TOO_LARGE;
+
+   try
+   {
+      numericSequence_.assign(values, values + nrValues);
+      sequenceEvents_.clear();
+      sequenceIsNumeric_ = true;
+   }
+   catch (...)
+   {
+      return MM_CODE_ERR;
+   }
+   return DEVICE_OK;
+}
+
+int MM::Property::CheckNumericSequence(const double* values,
+      unsigned long nrValues)
+{
+   const PropertyType type = GetType();
+   if (type != Float && type != Integer)
+      return DEVICE_INVALID_PROPERTY_TYPE;
+
+   if (nrValues > 0)
+   {
+      double minValue, maxValue;
+      if (!GetRange(values, nrValues, minValue, maxValue))
+         return DEVICE_INVALID_PROPERTY_VALUE;
+      if (limits_ && (minValue < lowerLimit_ || maxValue > upperLimit_))
+         return DEVICE_INVALID_PROPERTY_VALUE;
+
+      if (type == Integer)
+      {
+         for (unsigned long i = 0; i < nrValues; ++i)
+         {
+            if (values[i] != floor(values[i]))
+               return DEVICE_INVALID_PROPERTY_VALUE;
+         }
+      }
+
+      if (!values_.empty())
+      {
+         vector<double> allowed;
+         allowed.reserve(values_.size());
+         for (map<string, long>::const_iterator it = values_.begin();
+               it != values_.end(); ++it)
+            allowed.push_back(atof(it->first.c_str()));
+         sort(allowed.begin(), allowed.end());
+         for (unsigned long i = 0; i < nrValues; ++i)
+         {
+            if (!binary_search(allowed.begin(), allowed.end(), values[i]))
+               return DEVICE_INVALID_PROPERTY_VALUE;
+         }
+      }
+   }
+   return DEVICE_OK;
+}
+
+vector<string> MM::Property::GetSequence() const
+{
+   if (!sequenceIsNumeric_)
+      return sequenceEvents_;
+
+   vector<string> sequence;
+   sequence.reserve(numericSequence_.size());
+   char buf[BUFSIZE];
+   for (vector<double>::const_iterator it = numericSequence_.begin();
+         it != numericSequence_.end(); ++it)
+   {
+      snprintf(buf, BUFSIZE, "%.15g", *it);
+      sequence.push_back(buf);
+   }
+   return sequence;
+}
+
+vector<double> MM::Property::GetNumericSequence() const
+{
+   if (sequenceIsNumeric_)
+      return numericSequence_;
+
+   vector<double> sequence;
+   sequence.reserve(sequenceEvents_.size());
+   for (vector<string>::const_iterator it = sequenceEvents_.begin();
+         it != sequenceEvents_.end(); ++it)
+      sequence.push_back(atof(it->c_str()));
+   return sequence;
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // MM::StringProperty
@@ -63,6 +63,7 @@ public:
    virtual void SetSequenceable(long sequenceSize) = 0;
    virtual  long GetSequenceMaxSize() const = 0;
    virtual std::vector<std::string> GetSequence() const = 0;
+   virtual std::vector<double> GetNumericSequence() const = 0;
    virtual int ClearSequence() = 0;
    virtual int AddToSequence(const char* value) = 0;
    virtual int SendSequence() = 0;
@@ -136,6 +137,8 @@ public:
       sequenceable_(false),
       sequenceMaxSize_(0),
       sequenceEvents_(),
+      numericSequence_(),
+      sequenceIsNumeric_(false),
       lowerLimit_(0.0),
       upperLimit_(0.0),
       name_(name)
@@ -236,6 +239,8 @@ public:
          if (sequenceEvents_.size() > 0){
             sequenceEvents_.clear();
          }
+         numericSequence_.clear();
+         sequenceIsNumeric_ = false;
       } catch (...)
       {
          return MM_CODE_ERR;
@@ -248,6 +253,12 @@ public:
    {
       try
       {
+         if (sequenceIsNumeric_)
+         {
+            sequenceEvents_ = GetSequence();
+            numericSequence_.clear();
+            sequenceIsNumeric_ = false;
+         }
          sequenceEvents_.push_back(value);
          if (sequenceEvents_.size() > (unsigned) GetSequenceMaxSize())           
             return DEVICE_SEQUENCE_TOO_LARGE;
@@ -259,6 +270,27 @@ public:
       return DEVICE_OK;
    }
 
+   /**
+    * Replace the sequence. Fails without changing the sequence if it is
+    * longer than the maximum sequence size.
+    */
+   int LoadSequence(const char* const* values, unsigned long nrValues);
+
+   /**
+    * Replace the sequence of a Float or Integer property with numbers.
+    * Fails without changing the sequence if it is too long, or if any value
+    * is outside the limits, not allowed, or (for Integer properties) not an
+    * integer. The values are kept as numbers; GetSequence() formats them
+    * only if called.
+    */
+   int LoadNumericSequence(const double* values, unsigned long nrValues);
+
+   /**
+    * Check numbers for a Float or Integer property as LoadNumericSequence()
+    * does, except for the sequence length, without changing the sequence.
+    */
+   int CheckNumericSequence(const double* values, unsigned long nrValues);
+
    int SendSequence() 
    {
       if (fpAction_)
@@ -272,10 +304,13 @@ public:
       return name_;
    }
 
-   std::vector<std::string> GetSequence() const
-   {
-      return sequenceEvents_;
-   }
+   std::vector<std::string> GetSequence() const;
+
+   /**
+    * The sequence as numbers. Values loaded as strings are parsed (and are
+    * 0 if not numeric).
+    */
+   std::vector<double> GetNumericSequence() const;
 
    int StartSequence() 
    {
@@ -301,6 +336,9 @@ protected:
    bool sequenceable_;
    long sequenceMaxSize_;
    std::vector<std::string> sequenceEvents_;
+   // Used instead of sequenceEvents_ when sequenceIsNumeric_
+   std::vector<double> numericSequence_;
+   bool sequenceIsNumeric_;
    double lowerLimit_;
    double upperLimit_;
    std::map<std::string, long> values_; // allowed values
@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+
+#include "PortTrace.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+
+TEST(PortTraceTests, RecordsRoundTrip)
+{
+   const std::string path = "PortTrace-Tests.trace";
+   {
+      PortTraceWriter writer;
+      ASSERT_TRUE(writer.Open(path));
+      writer.Record(1000, PortTraceCommand, std::string("?POS\r"));
+      writer.Record(1500, PortTraceAnswer, std::string("1234\r\n"));
+      const char binary[] = { 0, 1, 2, '\xff' };
+      writer.Record(-5, PortTraceWrite, binary, sizeof(binary));
+      writer.Record(0x123456789LL, PortTraceRead, std::string());
+      writer.Close();
+      // Records after closing are ignored
+      writer.Record(2000, PortTraceRead, std::string("x"));
+   }
+
+   PortTraceReader reader;
+   ASSERT_TRUE(reader.Open(path));
+   PortTraceRecord rec;
+
+   ASSERT_TRUE(reader.Next(rec));
+   EXPECT_EQ(1000, rec.timeUs);
+   EXPECT_EQ(PortTraceCommand, rec.kind);
+   EXPECT_EQ("?POS\r", rec.data);
+   EXPECT_TRUE(rec.IsOutgoing());
+
+   ASSERT_TRUE(reader.Next(rec));
+   EXPECT_EQ(1500, rec.timeUs);
+   EXPECT_EQ(PortTraceAnswer, rec.kind);
+   EXPECT_EQ("1234\r\n", rec.data);
+   EXPECT_FALSE(rec.IsOutgoing());
+
+   ASSERT_TRUE(reader.Next(rec));
+   EXPECT_EQ(-5, rec.timeUs);
+   EXPECT_EQ(PortTraceWrite, rec.kind);
+   ASSERT_EQ(4u, rec.data.size());
+   EXPECT_EQ('\xff', rec.data[3]);
+
+   ASSERT_TRUE(reader.Next(rec));
+   EXPECT_EQ(0x123456789LL, rec.timeUs);
+   EXPECT_TRUE(rec.data.empty());
+
+   EXPECT_FALSE(reader.Next(rec));
+   std::remove(path.c_str());
+}
+
+
+TEST(PortTraceTests, RejectsOtherFiles)
+{
+   const std::string path = "PortTrace-Tests.bad";
+   {
+      std::ofstream f(path.c_str());
+      f << "not a trace file";
+   }
+   PortTraceReader reader;
+   EXPECT_FALSE(reader.Open(path));
+   std::remove(path.c_str());
+
+   PortTraceReader missing;
+   EXPECT_FALSE(missing.Open("PortTrace-Tests.missing"));
+}
+
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,254 @@
+package org.micromanager.benchmarks;
+
+import java.util.ArrayList;
+import java.util.Collection;
+import java.util.List;
+import mmcorej.AcquisitionEvent;
+import mmcorej.AcquisitionPlan;
+import mmcorej.CMMCore;
+import mmcorej.TaggedImage;
+import mmcorej.org.json.JSONObject;
+import org.junit.Rule;
+import org.junit.Test;
+import org.junit.runner.RunWith;
+import org.junit.runners.Parameterized;
+import org.micromanager.testing.BenchmarkRecorder;
+import org.micromanager.testing.MMCoreWithTestHubResource;
+import org.micromanager.testing.TaggedImageDecoder;
+import static org.junit.Assert.*;
+import static org.micromanager.testing.TestImageDecoder.InfoPacket;
+import static org.micromanager.testing.TestImageDecoder.SettingValue;
+
+
+/*
+ * Run a standard set of acquisition plans (CMMCore.startAcquisitionPlan())
+ * against SequenceTester devices with simulated command latency and exposure,
+ * and record the throughput and timing of each run.
+ *
+ * Every image is decoded to check that the devices were in the state
+ * requested by its event when the exposure started, so the benchmark also
+ * catches acquisitions that get faster by skipping or reordering settings.
+ *
+ * Timing is recorded, not asserted (it depends on the machine); compare the
+ * results (see BenchmarkRecorder) between builds to catch regressions:
+ * - eventsPerSecond: events divided by the wall time of the whole plan
+ * - overheadMsPerEvent: wall time per event beyond the simulated exposures
+ *   (includes the simulated command latencies, which are recorded alongside)
+ * - intervals: mean, standard deviation (jitter), min and max of the
+ *   intervals between consecutive images, from their ElapsedTime-ms
+ */
+@RunWith(Parameterized.class)
+public class AcquisitionPlanBenchmark {
+   static final String CAMERA = "TCamera";
+   static final String WHEEL = "TSwitcher";
+   static final String Z_STAGE = "TZStage";
+   static final String XY_STAGE = "TXYStage";
+   static final String CHANNEL_GROUP = "Channel";
+   static final int NR_CHANNEL_PRESETS = 3;
+   static final double EXPOSURE_MS = 1.0;
+   static final double Z_STEP_UM = 0.5;
+   static final double POSITION_SPACING_UM = 100.0;
+   static final long XY_STEPS_PER_UM = 10;
+
+   enum Plan {
+      // frames, positions, channels, slices
+      TIME_LAPSE(100, 0, 0, 0),
+      CHANNELS(30, 0, 3, 0),
+      Z_STACK(10, 0, 0, 10),
+      MULTI_D(3, 3, 2, 5);
+
+      final int nrFrames;
+      final int nrPositions;
+      final int nrChannels;
+      final int nrSlices;
+
+      Plan(int nrFrames, int nrPositions, int nrChannels, int nrSlices) {
+         this.nrFrames = nrFrames;
+         this.nrPositions = nrPositions;
+         this.nrChannels = nrChannels;
+         this.nrSlices = nrSlices;
+      }
+   }
+
+   @Parameterized.Parameters
+   public static Collection<Object[]> data() {
+      double[] latenciesMs = { 0.0, 2.0 };
+      boolean[] sequencing = { true, false };
+      List<Object[]> params = new ArrayList<Object[]>();
+      for (Plan plan : Plan.values()) {
+         for (double latencyMs : latenciesMs) {
+            for (boolean useSequencing : sequencing) {
+               params.add(new Object[] { plan, latencyMs, useSequencing });
+            }
+         }
+      }
+      return params;
+   }
+
+   final Plan plan_;
+   final double commandLatencyMs_;
+   final boolean useHardwareSequencing_;
+
+   public AcquisitionPlanBenchmark(Plan plan, double commandLatencyMs,
+         boolean useHardwareSequencing)
+   {
+      plan_ = plan;
+      commandLatencyMs_ = commandLatencyMs;
+      useHardwareSequencing_ = useHardwareSequencing;
+   }
+
+   @Rule
+   public MMCoreWithTestHubResource coreResource =
+      new MMCoreWithTestHubResource();
+
+   // The state the devices must be in for an event's image
+   static class ExpectedState {
+      long wheelPosition = -1; // -1: not set by the plan
+      double zUm = Double.NaN;
+      long xSteps = Long.MIN_VALUE;
+      long ySteps = Long.MIN_VALUE;
+   }
+
+   void prepareDevices(CMMCore mmc) throws Exception {
+      for (String device : new String[] { CAMERA, WHEEL, Z_STAGE, XY_STAGE }) {
+         mmc.loadDevice(device, "SequenceTester", device);
+         mmc.setParentLabel(device, "THub");
+         mmc.setProperty(device, "CommandLatencyMs", commandLatencyMs_);
+         if (device.equals(CAMERA)) {
+            mmc.setProperty(device, "ImageMode", "MachineReadable");
+            mmc.setProperty(device, "ImageWidth", 128);
+            mmc.setProperty(device, "ImageHeight", 128);
+            mmc.setProperty(device, "SimulateExposure", "Yes");
+         }
+         mmc.initializeDevice(device);
+      }
+      mmc.setCameraDevice(CAMERA);
+      mmc.setFocusDevice(Z_STAGE);
+      mmc.setXYStageDevice(XY_STAGE);
+
+      for (int i = 0; i < NR_CHANNEL_PRESETS; i++) {
+         mmc.defineConfig(CHANNEL_GROUP, "Ch" + i, WHEEL, "State",
+               Integer.toString(i + 1));
+      }
+
+      // Allow the channels and Z to be run as hardware sequences
+      for (String device : new String[] { WHEEL, Z_STAGE }) {
+         mmc.setProperty(device, "TriggerSourceDevice", CAMERA);
+         mmc.setProperty(device, "TriggerSourcePort", "ExposureStartEdge");
+         mmc.setProperty(device, "TriggerSequenceMaxLength", 1000);
+      }
+   }
+
+   AcquisitionPlan makePlan(List<ExpectedState> expected) {
+      AcquisitionPlan plan = new AcquisitionPlan();
+      plan.setUseHardwareSequencing(useHardwareSequencing_);
+      for (int t = 0; t < plan_.nrFrames; t++) {
+         for (int p = 0; p < Math.max(1, plan_.nrPositions); p++) {
+            for (int c = 0; c < Math.max(1, plan_.nrChannels); c++) {
+               for (int z = 0; z < Math.max(1, plan_.nrSlices); z++) {
+                  AcquisitionEvent event = new AcquisitionEvent(t, p, c, z);
+                  ExpectedState state = new ExpectedState();
+                  event.setExposure(EXPOSURE_MS);
+                  if (plan_.nrPositions > 0) {
+                     double xUm = POSITION_SPACING_UM * p;
+                     double yUm = -POSITION_SPACING_UM * p;
+                     event.setXYPosition(xUm, yUm);
+                     state.xSteps = Math.round(XY_STEPS_PER_UM * xUm);
+                     state.ySteps = Math.round(XY_STEPS_PER_UM * yUm);
+                  }
+                  if (plan_.nrChannels > 0) {
+                     event.setConfig(CHANNEL_GROUP, "Ch" + c);
+                     state.wheelPosition = c + 1;
+                  }
+                  if (plan_.nrSlices > 0) {
+                     event.setZPosition(Z_STEP_UM * z);
+                     state.zUm = Z_STEP_UM * z;
+                  }
+                  plan.addEvent(event);
+                  expected.add(state);
+               }
+            }
+         }
+      }
+      return plan;
+   }
+
+   void verify(int index, InfoPacket packet, ExpectedState expected)
+      throws Exception
+   {
+      String what = plan_ + " event " + index + ": ";
+      assertEquals(what + "exposure", EXPOSURE_MS,
+            packet.getCurrentSetting(CAMERA, "Exposure").asDouble(), 1e-9);
+      if (expected.wheelPosition >= 0) {
+         assertEquals(what + "channel", expected.wheelPosition,
+               packet.getCurrentSetting(WHEEL, "Position").asInteger());
+      }
+      if (!Double.isNaN(expected.zUm)) {
+         assertEquals(what + "Z", expected.zUm,
+               packet.getCurrentSetting(Z_STAGE, "ZPositionUm").asDouble(),
+               1e-6);
+      }
+      if (expected.xSteps != Long.MIN_VALUE) {
+         SettingValue x = packet.getCurrentSetting(XY_STAGE, "XPositionSteps");
+         SettingValue y = packet.getCurrentSetting(XY_STAGE, "YPositionSteps");
+         assertEquals(what + "X", expected.xSteps, x.asInteger());
+         assertEquals(what + "Y", expected.ySteps, y.asInteger());
+      }
+   }
+
+   @Test
+   public void runPlan() throws Exception {
+      CMMCore mmc = coreResource.getMMCore();
+      // Keep debug logging out of the timing
+      mmc.enableDebugLog(false);
+      prepareDevices(mmc);
+
+      List<ExpectedState> expected = new ArrayList<ExpectedState>();
+      AcquisitionPlan plan = makePlan(expected);
+      int nrEvents = (int) plan.getNumberOfEvents();
+
+      long startNs = System.nanoTime();
+      mmc.startAcquisitionPlan(plan);
+      mmc.waitForAcquisitionPlan();
+      double wallMs = (System.nanoTime() - startNs) / 1e6;
+
+      assertEquals(nrEvents, mmc.getRemainingImageCount());
+      List<Double> timestampsMs = new ArrayList<Double>();
+      int nrSequenced = 0;
+      for (int i = 0; i < nrEvents; i++) {
+         TaggedImage image = mmc.popNextTaggedImage();
+         assertEquals(i, image.tags.getInt("AcquisitionEventIndex"));
+         timestampsMs.add(image.tags.getDouble("ElapsedTime-ms"));
+
+         InfoPacket packet = TaggedImageDecoder.decode(image);
+         assertEquals(CAMERA, packet.camera.name);
+         if (packet.camera.isSequence) {
+            nrSequenced++;
+         }
+         verify(i, packet, expected.get(i));
+      }
+      if (!useHardwareSequencing_) {
+         assertEquals(0, nrSequenced);
+      }
+      else if (plan_ != Plan.TIME_LAPSE) {
+         // Each of these plans has channel or Z runs to sequence
+         assertTrue("No images were sequenced", nrSequenced > 0);
+      }
+
+      double exposureTotalMs = nrEvents * EXPOSURE_MS;
+      JSONObject result = new JSONObject();
+      result.put("benchmark", "AcquisitionPlan");
+      result.put("plan", plan_.toString());
+      result.put("commandLatencyMs", commandLatencyMs_);
+      result.put("exposureMs", EXPOSURE_MS);
+      result.put("hardwareSequencing", useHardwareSequencing_);
+      result.put("events", nrEvents);
+      result.put("sequencedImages", nrSequenced);
+      result.put("wallMs", wallMs);
+      result.put("eventsPerSecond", 1000.0 * nrEvents / wallMs);
+      result.put("overheadMsPerEvent", (wallMs - exposureTotalMs) / nrEvents);
+      result.put("intervals", BenchmarkRecorder.toJSON(
+               BenchmarkRecorder.intervalStats(timestampsMs)));
+      BenchmarkRecorder.record(result);
+   }
+}
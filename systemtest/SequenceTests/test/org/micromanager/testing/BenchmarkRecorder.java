@@ -0,0 +1,87 @@
+package org.micromanager.testing;
+
+import java.io.FileWriter;
+import java.io.IOException;
+import java.util.List;
+import mmcorej.org.json.JSONException;
+import mmcorej.org.json.JSONObject;
+
+
+/**
+ * Compute timing statistics for a benchmark run and record them as one JSON
+ * object per line.
+ *
+ * Results are always printed to stdout (prefixed with "BENCHMARK "). If the
+ * environment variable MMTEST_BENCHMARK_RESULTS names a file, they are also
+ * appended to that file, so that results from successive builds can be
+ * compared by scripts.
+ */
+@org.junit.Ignore
+public class BenchmarkRecorder {
+   public static class IntervalStats {
+      public int count;
+      public double meanMs;
+      public double stdDevMs;
+      public double minMs;
+      public double maxMs;
+   }
+
+   /**
+    * Statistics of the intervals between consecutive timestamps.
+    */
+   public static IntervalStats intervalStats(List<Double> timestampsMs) {
+      IntervalStats stats = new IntervalStats();
+      stats.count = Math.max(0, timestampsMs.size() - 1);
+      if (stats.count == 0) {
+         return stats;
+      }
+
+      stats.minMs = Double.MAX_VALUE;
+      stats.maxMs = -Double.MAX_VALUE;
+      double sum = 0.0;
+      for (int i = 1; i < timestampsMs.size(); i++) {
+         double interval = timestampsMs.get(i) - timestampsMs.get(i - 1);
+         sum += interval;
+         stats.minMs = Math.min(stats.minMs, interval);
+         stats.maxMs = Math.max(stats.maxMs, interval);
+      }
+      stats.meanMs = sum / stats.count;
+
+      double sumSq = 0.0;
+      for (int i = 1; i < timestampsMs.size(); i++) {
+         double dev = timestampsMs.get(i) - timestampsMs.get(i - 1) -
+            stats.meanMs;
+         sumSq += dev * dev;
+      }
+      stats.stdDevMs = Math.sqrt(sumSq / stats.count);
+      return stats;
+   }
+
+   public static JSONObject toJSON(IntervalStats stats) throws JSONException {
+      JSONObject json = new JSONObject();
+      json.put("count", stats.count);
+      json.put("meanMs", stats.meanMs);
+      json.put("stdDevMs", stats.stdDevMs);
+      json.put("minMs", stats.minMs);
+      json.put("maxMs", stats.maxMs);
+      return json;
+   }
+
+   public static void record(JSONObject result) throws IOException {
+      String line = result.toString();
+      System.out.println("BENCHMARK " + line);
+
+      String path = System.getenv("MMTEST_BENCHMARK_RESULTS");
+      if (path == null || path.isEmpty()) {
+         return;
+      }
+      FileWriter writer = new FileWriter(path, true);
+      try {
+         writer.write(line);
+         writer.write("\n");
+      }
+      finally {
+         writer.close();
+      }
+   }
+}
@@ -96,6 +96,18 @@ public class TestImageDecoder {
          }
          return false;
       }
+
+      public SettingValue getCurrentSetting(String device,
+            String settingName)
+      {
+         for (SettingState state : currentState) {
+            if (state.key.device.equals(device) &&
+                  state.key.key.equals(settingName)) {
+               return state.value;
+            }
+         }
+         return null;
+      }
    }
 
    public static InfoPacket decode(byte[] image) throws IOException {